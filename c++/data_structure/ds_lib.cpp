@@ -1,12 +1,27 @@
 /***********************************************
  *
+ *  g++ -std=c++17 -O2 -pthread -I. ds_lib.cpp -o ds_lib
  *  valgrind --tool=memcheck --leak-check=yes ./a.out
  *
+ *  ./ds_lib --bench-hash [keys]      HashTable vs std::unordered_map vs the old chained table
+ *  ./ds_lib --bench-trie [keys]      Trie (radix tree) vs the old map-per-character trie: memory, lookups
+ *  ./ds_lib --bench-vector [n]       Vector vs std::vector vs the old new T[] Vector: push_back, grow
+ *  ./ds_lib --bench-graph [scale] [edge factor] [threads]
+ *                                    CSR graph vs adjacency lists on R-MAT: build, BFS, SSSP, components
+ *  ./ds_lib --bench-heap [n]         PriorityQueue vs std::priority_queue: push/pop, build, decrease-key
  *
  * ******************************************/
 
 #include <ds_lib.h>
 
+#include <malloc.h>
+
+#include <chrono>
+#include <iomanip>
+#include <queue>
+#include <random>
+#include <unordered_map>
+
 void array_test()
 {
 	std::cout << "<<---------- " << __func__ << "---------->>" << std::endl;
@@ -46,6 +61,12 @@ void vector_test()
 		std::cout << a << std::endl;
 	std::for_each(v.begin(), v.end(), [](std::string& i) { std::cout << i << std::endl; });
 
+	dsa::Vector<std::unique_ptr<int>> owners;          // move-only, no default constructor needed
+	for ( int i = 0; i < 5; i++ )
+		owners.emplace_back(std::make_unique<int>(i));
+	owners.shrink_to_fit();
+	std::cout << "owners " << owners.size() << "/" << owners.capacity() << ", last " << *owners[4] << std::endl;
+
 }
 
 void stack_test()
@@ -86,6 +107,27 @@ void queue_test()
 	std::cout << queue.front() << std::endl;
 }
 
+void priority_queue_test()
+{
+	std::cout << "<<---------- " << __func__ << "---------->>" << std::endl;
+
+	// min-heap of (deadline, job): rescheduling moves a job instead of queueing it twice
+	using Job = std::pair<int, std::string>;
+	dsa::PriorityQueue<Job, std::greater<Job>> pq;
+
+	std::vector<Job> jobs = { { 30, "flush" }, { 10, "poll" }, { 20, "ping" } };
+	auto handles = pq.heapify(jobs.begin(), jobs.end());
+	auto report = pq.push(Job{ 40, "report" });
+
+	pq.update(handles[1], Job{ 35, "poll" });		// poll: 10 -> 35
+	pq.erase(report);
+
+	while ( !pq.empty() ) {
+		std::cout << pq.top().first << " " << pq.top().second << std::endl;
+		pq.pop();
+	}
+}
+
 void list_test()
 {
 	std::cout << "<<---------- " << __func__ << "---------->>" << std::endl;
@@ -192,6 +234,28 @@ void string_test()
 	
 }
 
+void trie_test()
+{
+	std::cout << "<<---------- " << __func__ << "---------->>" << std::endl;
+
+	dsa::Trie trie;
+	trie.insert("NSE:INFY");
+	trie.insert("NSE:INFY-EQ");
+	trie.insert("NSE:IRCTC");
+	trie.insert("BSE:INFY");
+
+	std::cout << "search(NSE:INFY) = " << trie.search("NSE:INFY") << std::endl;
+	std::cout << "search(NSE:INF) = " << trie.search("NSE:INF") << std::endl;
+	std::cout << "startsWith(NSE:I) = " << trie.startsWith("NSE:I") << std::endl;
+	for ( auto& s : trie.autoSuggest("NSE:", 0) )
+		std::cout << s << std::endl;
+
+	dsa::Trie bulk;
+	bulk.insert_sorted({ "/api/v1/orders", "/api/v1/quotes", "/api/v2/orders" });
+	for ( auto& s : bulk.autoSuggest("/api/v1", 0) )
+		std::cout << s << std::endl;
+}
+
 void graph_test() {
 
 	{	
@@ -215,18 +279,795 @@ void graph_test() {
 		Graph graph(edges, 6);
 		graph.print();
 	}
+
+	{
+		using namespace dsa::csr_graph;
+
+		std::vector<Edge> edges = {
+			 { 0, 1, 6 }, { 1, 2, 7 }, { 2, 0, 5 }, { 2, 1, 4 },
+			 { 3, 2, 10 }, { 5, 4, 1 }, { 4, 5, 3 }
+		};
+
+		WorkPool pool(2);
+		Graph graph(edges, 6, true, pool);
+		auto depth = bfs(graph, 3, pool);
+		auto dist = sssp(graph, 3, 4, pool);
+		auto comp = components(graph, pool);
+		for ( Vertex v = 0; v < graph.vertices(); ++v ) {
+			std::cout << v << ": hops " << (depth[v] == kUnreached ? -1 : int(depth[v]))
+				<< ", distance " << (dist[v] == kInfinity ? -1 : int(dist[v])) << ", component " << comp[v] << " -->";
+			for ( Vertex t : graph.out(v) )
+				std::cout << " " << t;
+			std::cout << std::endl;
+		}
+
+		// distances far beyond delta: buckets must not grow with them
+		std::vector<Edge> heavy = {
+			 { 0, 1, 100000000 }, { 1, 2, 100000000 }, { 0, 3, UINT32_MAX }, { 3, 2, 1 }, { 2, 4, 1 }
+		};
+		Graph far(heavy, 5, true, pool);
+		auto farDist = sssp(far, 0, 1, pool);
+		std::vector<std::uint64_t> expected = { 0, 100000000, 200000000, UINT32_MAX, 200000001 };
+		std::cout << "large weights, delta 1: " << farDist[2] << " " << farDist[3] << " " << farDist[4]
+			<< (farDist == expected ? " ok" : " MISMATCH") << std::endl;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+   Benchmarks
+   ---------------------------------------------------------------------------- */
+
+using BenchClock = std::chrono::steady_clock;
+
+static double ns_per(BenchClock::time_point t0, std::size_t ops) {
+	return std::chrono::duration<double, std::nano>(BenchClock::now() - t0).count() / ops;
+}
+
+// HashTable as it was before the open-addressing rewrite: N fixed chains, no rehashing
+template<typename K, typename V, std::size_t N = 10>
+	class ChainedHashTable {
+		std::vector<std::list<std::pair<K, V>>> table;
+		std::size_t index_for(const K& k) const { return std::hash<K>{}(k) % N; }
+
+		public:
+		ChainedHashTable() : table(N) {}
+
+		void insert(const K& k, const V& v) {
+			auto& bucket = table[index_for(k)];
+			for (auto& kv : bucket)
+				if (kv.first == k) { kv.second = v; return; }
+			bucket.emplace_back(k, v);
+		}
+		V* find_pointer(const K& k) {
+			for (auto& kv : table[index_for(k)])
+				if (kv.first == k) return &kv.second;
+			return nullptr;
+		}
+		bool remove(const K& k) {
+			auto& bucket = table[index_for(k)];
+			for (auto it = bucket.begin(); it != bucket.end(); ++it)
+				if (it->first == k) { bucket.erase(it); return true; }
+			return false;
+		}
+	};
+
+// Uniform access to the three tables
+template<typename T, typename K, typename V> void bench_insert(T& t, const K& k, const V& v) { t.insert(k, v); }
+template<typename K, typename V> void bench_insert(std::unordered_map<K, V>& t, const K& k, const V& v) { t.insert_or_assign(k, v); }
+template<typename T, typename K> auto bench_find(T& t, const K& k) { return t.find_pointer(k); }
+template<typename K, typename V> V* bench_find(std::unordered_map<K, V>& t, const K& k) {
+	auto it = t.find(k);
+	return it == t.end() ? nullptr : &it->second;
+}
+template<typename T, typename K> bool bench_remove(T& t, const K& k) { return t.remove(k); }
+template<typename K, typename V> bool bench_remove(std::unordered_map<K, V>& t, const K& k) { return t.erase(k) != 0; }
+
+// insert `keys` (all new), find each in `order` (hit), find `misses` (absent), remove each in `order`;
+// ns per operation
+template<typename Table, typename K>
+	void hash_bench(const char* name, const std::vector<K>& keys, const std::vector<K>& order, const std::vector<K>& misses) {
+		Table t;
+		std::size_t found = 0;
+
+		auto t0 = BenchClock::now();
+		for (std::size_t i = 0; i < keys.size(); ++i) bench_insert(t, keys[i], i);
+		double insert = ns_per(t0, keys.size());
+
+		t0 = BenchClock::now();
+		for (const auto& k : order) found += bench_find(t, k) != nullptr;
+		double hit = ns_per(t0, keys.size());
+
+		t0 = BenchClock::now();
+		for (const auto& k : misses) found += bench_find(t, k) != nullptr;
+		double miss = ns_per(t0, misses.size());
+
+		t0 = BenchClock::now();
+		for (const auto& k : order) found -= bench_remove(t, k);
+		double remove = ns_per(t0, keys.size());
+
+		std::cout << "  " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << insert << std::setw(10) << hit << std::setw(10) << miss << std::setw(10) << remove
+			<< (found ? "   (lookups disagree!)" : "") << "\n";
+	}
+
+template<typename K>
+	void hash_bench_all(const char* label, const std::vector<K>& keys, const std::vector<K>& misses, bool chained) {
+		std::vector<K> order(keys);
+		std::shuffle(order.begin(), order.end(), std::mt19937_64(7));
+		std::cout << label << ", " << keys.size() << " keys\n"
+			<< "                            insert      find      miss    remove  (ns/op)\n";
+		hash_bench<dsa::HashTable<K, std::size_t>>("dsa::HashTable", keys, order, misses);
+		hash_bench<std::unordered_map<K, std::size_t>>("std::unordered_map", keys, order, misses);
+		if (chained) hash_bench<ChainedHashTable<K, std::size_t>>("old chained (N = 10)", keys, order, misses);
+	}
+
+int hash_table_bench(std::size_t n) {
+	std::mt19937_64 rng(42);
+	std::vector<std::uint64_t> ints(n), intMisses(n);
+	for (auto& k : ints) k = rng();
+	for (auto& k : intMisses) k = rng();                 // a collision with ints is a 2^-64 event
+
+	std::vector<std::string> strs(n), strMisses(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		strs[i] = "sym:" + std::to_string(ints[i]);
+		strMisses[i] = "sym:" + std::to_string(intMisses[i]);
+	}
+
+	// The old table walks one of 10 chains per operation: only measured on a small key set
+	std::size_t small = std::min<std::size_t>(n, 20000);
+	std::vector<std::uint64_t> smallInts(ints.begin(), ints.begin() + small);
+	std::vector<std::uint64_t> smallMisses(intMisses.begin(), intMisses.begin() + small);
+	hash_bench_all("uint64_t keys", smallInts, smallMisses, true);
+	hash_bench_all("uint64_t keys", ints, intMisses, false);
+	hash_bench_all("std::string keys", strs, strMisses, false);
+
+	// Heterogeneous lookup: a const char* goes straight to HashTable, std::unordered_map (C++17) builds a string
+	dsa::HashTable<std::string, std::size_t> table;
+	std::unordered_map<std::string, std::size_t> map;
+	for (std::size_t i = 0; i < n; ++i) { table.insert(strs[i], i); map.emplace(strs[i], i); }
+	std::size_t sum = 0;
+	auto t0 = BenchClock::now();
+	for (const auto& s : strs) sum += *table.find_pointer(s.c_str());
+	double het = ns_per(t0, n);
+	t0 = BenchClock::now();
+	for (const auto& s : strs) sum -= map.find(s.c_str())->second;
+	double tmp = ns_per(t0, n);
+	std::cout << "find(const char*): dsa::HashTable " << het << " ns, std::unordered_map " << tmp << " ns"
+		<< (sum ? "   (lookups disagree!)" : "") << "\n";
+	return 0;
+}
+
+// Trie as it was before the radix tree: one node per character, children in an unordered_map
+class MapTrie {
+	struct Node {
+		std::unordered_map<char, std::unique_ptr<Node>> next;
+		bool isEnd = false;
+	};
+	std::unique_ptr<Node> root = std::make_unique<Node>();
+
+	const Node* walk(const std::string& s) const {
+		const Node* cur = root.get();
+		for (char c : s) {
+			auto it = cur->next.find(c);
+			if (it == cur->next.end()) return nullptr;
+			cur = it->second.get();
+		}
+		return cur;
+	}
+	void collect(const Node* n, std::string& path, std::vector<std::string>& out, std::size_t k) const {
+		if (n->isEnd) {
+			out.push_back(path);
+			if (k && out.size() >= k) return;
+		}
+		std::vector<char> keys;
+		for (const auto& kv : n->next) keys.push_back(kv.first);
+		std::sort(keys.begin(), keys.end());
+		for (char ch : keys) {
+			path.push_back(ch);
+			collect(n->next.at(ch).get(), path, out, k);
+			path.pop_back();
+			if (k && out.size() >= k) break;
+		}
+	}
+
+	public:
+	void insert(const std::string& word) {
+		Node* cur = root.get();
+		for (char c : word) {
+			auto& next = cur->next[c];
+			if (!next) next = std::make_unique<Node>();
+			cur = next.get();
+		}
+		cur->isEnd = true;
+	}
+	bool search(const std::string& word) const { const Node* n = walk(word); return n && n->isEnd; }
+	bool startsWith(const std::string& prefix) const { return walk(prefix) != nullptr; }
+	std::vector<std::string> autoSuggest(const std::string& prefix, std::size_t k) const {
+		std::vector<std::string> out;
+		std::string path = prefix;
+		if (const Node* n = walk(prefix)) collect(n, path, out, k);
+		return out;
+	}
+};
+
+// Route / symbol like keys: 2-5 segments out of a small vocabulary, most ending in a number
+static std::vector<std::string> trie_keys(std::size_t n, std::mt19937_64& rng) {
+	static const char* words[] = { "api", "v1", "v2", "orders", "users", "quotes", "NSE", "BSE", "MCX", "EQ", "FUT",
+		"OPT", "RELIANCE", "INFY", "TCS", "HDFCBANK", "settlement", "risk", "margin", "ledger", "positions" };
+	std::vector<std::string> keys(n);
+	for (auto& k : keys) {
+		int segments = 2 + rng() % 4;
+		for (int s = 0; s < segments; ++s) k += std::string("/") + words[rng() % std::size(words)];
+		if (rng() % 4) k += "/" + std::to_string(rng() % 1000000);
+	}
+	return keys;
+}
+
+static std::size_t heap_used() { return mallinfo2().uordblks; }
+
+template<typename T>
+	void trie_lookups(const char* name, const T& t, const std::vector<std::string>& hits, const std::vector<std::string>& misses,
+			const std::vector<std::string>& prefixes) {
+		std::size_t found = 0, suggested = 0;
+		auto t0 = BenchClock::now();
+		for (const auto& k : hits) found += t.search(k);
+		double hit = ns_per(t0, hits.size());
+		t0 = BenchClock::now();
+		for (const auto& k : misses) found += t.search(k);
+		double miss = ns_per(t0, misses.size());
+		t0 = BenchClock::now();
+		for (const auto& p : prefixes) found += t.startsWith(p);
+		double starts = ns_per(t0, prefixes.size());
+		t0 = BenchClock::now();
+		for (std::size_t i = 0; i < prefixes.size() / 10; ++i) suggested += t.autoSuggest(prefixes[i], 10).size();
+		double suggest = ns_per(t0, prefixes.size() / 10);
+		std::cout << "  " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << hit << std::setw(10) << miss << std::setw(12) << starts << std::setw(14) << suggest
+			<< "   (" << found << " found, " << suggested << " suggested)\n";
+	}
+
+int trie_bench(std::size_t n) {
+	std::mt19937_64 rng(42);
+	std::vector<std::string> keys = trie_keys(n, rng);
+	std::vector<std::string> misses = trie_keys(n, rng);
+	for (auto& m : misses) m += "#";                     // '#' appears in no key
+	std::vector<std::string> prefixes(n);
+	for (std::size_t i = 0; i < n; ++i) prefixes[i] = keys[rng() % n].substr(0, 4 + rng() % 12);
+	std::vector<std::string> sorted(keys);
+	std::sort(sorted.begin(), sorted.end());
+	std::size_t bytes = 0;
+	for (const auto& k : keys) bytes += k.size();
+
+	std::cout << n << " keys, " << double(bytes) / n << " bytes each on average\n"
+		<< "                          build (ns/key)   heap (bytes/key)\n";
+	auto report = [&](const char* name, double ns, std::size_t heap) {
+		std::cout << "  " << std::left << std::setw(26) << name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << ns << std::setw(18) << double(heap) / n << "\n";
+	};
+
+	std::size_t h0 = heap_used();
+	auto t0 = BenchClock::now();
+	auto old = std::make_unique<MapTrie>();
+	for (const auto& k : keys) old->insert(k);
+	report("old (map per character)", ns_per(t0, n), heap_used() - h0);
+
+	h0 = heap_used();
+	t0 = BenchClock::now();
+	auto art = std::make_unique<dsa::Trie>();
+	for (const auto& k : keys) art->insert(k);
+	report("dsa::Trie insert()", ns_per(t0, n), heap_used() - h0);
+
+	h0 = heap_used();
+	t0 = BenchClock::now();
+	auto bulk = std::make_unique<dsa::Trie>();
+	bulk->insert_sorted(sorted);
+	report("dsa::Trie insert_sorted()", ns_per(t0, n), heap_used() - h0);
+
+	std::cout << "                            search    miss   startsWith   autoSuggest(10)  (ns/op)\n";
+	trie_lookups("old (map per character)", *old, keys, misses, prefixes);
+	trie_lookups("dsa::Trie", *art, keys, misses, prefixes);
+	trie_lookups("dsa::Trie (bulk)", *bulk, keys, misses, prefixes);
+	return 0;
+}
+
+// Vector as it was before raw storage: new T[] growth, every slot default constructed, copy-assigned over
+template<typename T>
+	class OldVector {
+		std::size_t size_{0}, capacity_{0};
+		T* data_{nullptr};
+
+		public:
+		~OldVector() { delete[] data_; }
+		std::size_t size() const { return size_; }
+		void reserve(std::size_t n) {
+			if (n <= capacity_) return;
+			T* tmp = new T[n];
+			for (std::size_t i = 0; i < size_; ++i) tmp[i] = std::move(data_[i]);
+			delete[] data_;
+			data_ = tmp;
+			capacity_ = n;
+		}
+		void push_back(const T& t) {
+			if (size_ == capacity_) reserve(capacity_ ? capacity_ * 2 : 1);
+			data_[size_++] = t;
+		}
+	};
+
+struct Blob64 { std::uint64_t word[8]; };           // trivially copyable, 64 bytes
+
+template<typename T> T vector_value(std::size_t i);
+template<> int vector_value<int>(std::size_t i) { return int(i); }
+template<> std::string vector_value<std::string>(std::size_t i) { return "value number " + std::to_string(i); }
+template<> Blob64 vector_value<Blob64>(std::size_t i) { return Blob64{{i, i, i, i, i, i, i, i}}; }
+
+// ns per push_back of n values without reserve()
+template<typename V, typename T>
+	double vector_push(const std::vector<T>& values) {
+		V v;
+		auto t0 = BenchClock::now();
+		for (const auto& x : values) v.push_back(x);
+		asm volatile("" : : "r"(&v) : "memory");
+		double ns = ns_per(t0, values.size());
+		return v.size() == values.size() ? ns : -1;
+	}
+
+// us for one reserve() doubling the capacity of a full vector of n values
+template<typename V, typename T>
+	double vector_grow(const std::vector<T>& values) {
+		V v;
+		v.reserve(values.size());
+		for (const auto& x : values) v.push_back(x);
+		auto t0 = BenchClock::now();
+		v.reserve(2 * values.size());
+		asm volatile("" : : "r"(&v) : "memory");           // the moved elements count as used
+		return ns_per(t0, 1) / 1000;
+	}
+
+// Rounds alternate between the vectors, so that none of them always meets a fresh (or a fragmented) heap
+template<typename T>
+	void vector_bench_type(const char* label, std::size_t n) {
+		std::vector<T> values;
+		values.reserve(n);
+		for (std::size_t i = 0; i < n; ++i) values.push_back(vector_value<T>(i));
+
+		const char* names[] = { "dsa::Vector", "std::vector", "old Vector" };
+		double push[3], grow[3];
+		for (int round = 0; round < 3; ++round) {
+			double p[3] = { vector_push<dsa::Vector<T>>(values), vector_push<std::vector<T>>(values), vector_push<OldVector<T>>(values) };
+			double g[3] = { vector_grow<dsa::Vector<T>>(values), vector_grow<std::vector<T>>(values), vector_grow<OldVector<T>>(values) };
+			for (int i = 0; i < 3; ++i) {
+				push[i] = round ? std::min(push[i], p[i]) : p[i];
+				grow[i] = round ? std::min(grow[i], g[i]) : g[i];
+			}
+		}
+
+		std::cout << label << " x " << n << "\n                  push_back (ns)   grow x2 (us)\n";
+		for (int i = 0; i < 3; ++i)
+			std::cout << "  " << std::left << std::setw(16) << names[i] << std::right << std::fixed << std::setprecision(2)
+				<< std::setw(12) << push[i] << std::setw(16) << grow[i] << "\n";
+	}
+
+int vector_bench(std::size_t n) {
+	vector_bench_type<int>("int", n);
+	vector_bench_type<Blob64>("Blob64 (trivially copyable)", n / 4);
+	vector_bench_type<std::string>("std::string (noexcept move)", n / 4);
+	return 0;
+}
+
+// R-MAT edges (a, b, c = 0.57, 0.19, 0.19), weights 1..255; every 64k block has a seed of its own, so the
+// graph does not depend on the thread count
+static std::vector<dsa::csr_graph::Edge> rmat_edges(unsigned scale, std::size_t m, dsa::csr_graph::WorkPool& pool) {
+	std::vector<dsa::csr_graph::Edge> edges(m);
+	pool.parallel_for(m, 1 << 16, [&](std::size_t first, std::size_t end, unsigned) {
+		const std::uint32_t a = 0.57 * 65536, ab = 0.76 * 65536, abc = 0.95 * 65536;
+		std::mt19937_64 rng;
+		for (std::size_t i = first; i < end; ++i) {
+			if (i % (1 << 16) == 0) rng.seed(i);
+			std::uint32_t src = 0, dst = 0;
+			std::uint64_t bits = 0;
+			for (unsigned level = 0; level < scale; ++level, bits >>= 16) {
+				if (level % 4 == 0) bits = rng();
+				std::uint32_t r = bits & 0xFFFF;                   // quadrant of this level
+				src = src << 1 | (r >= ab);
+				dst = dst << 1 | ((r >= a && r < ab) || r >= abc);
+			}
+			edges[i] = { src, dst, std::uint32_t(1 + rng() % 255) };
+		}
+	});
+	return edges;
+}
+
+// Adjacency lists as directed_graph_weight::Graph keeps them, both directions stored; serial baselines on them
+using AdjacencyLists = std::vector<std::vector<std::pair<int, int>>>;
+
+static std::vector<std::uint32_t> lists_bfs(const AdjacencyLists& adj, int src) {
+	std::vector<std::uint32_t> depth(adj.size(), dsa::csr_graph::kUnreached);
+	std::vector<int> queue{src};
+	depth[src] = 0;
+	for (std::size_t head = 0; head < queue.size(); ++head)
+		for (auto& e : adj[queue[head]])
+			if (depth[e.first] == dsa::csr_graph::kUnreached) {
+				depth[e.first] = depth[queue[head]] + 1;
+				queue.push_back(e.first);
+			}
+	return depth;
+}
+
+static std::vector<std::uint64_t> lists_dijkstra(const AdjacencyLists& adj, int src) {
+	std::vector<std::uint64_t> dist(adj.size(), dsa::csr_graph::kInfinity);
+	using Item = std::pair<std::uint64_t, int>;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+	dist[src] = 0;
+	heap.push({ 0, src });
+	while (!heap.empty()) {
+		auto [d, u] = heap.top();
+		heap.pop();
+		if (d != dist[u]) continue;
+		for (auto& e : adj[u])
+			if (d + e.second < dist[e.first]) {
+				dist[e.first] = d + e.second;
+				heap.push({ dist[e.first], e.first });
+			}
+	}
+	return dist;
+}
+
+static std::vector<int> lists_components(const AdjacencyLists& adj) {
+	std::vector<int> comp(adj.size(), -1), stack;
+	for (int v = 0; v < int(adj.size()); ++v) {
+		if (comp[v] != -1) continue;
+		comp[v] = v;
+		stack.push_back(v);
+		while (!stack.empty()) {
+			int u = stack.back();
+			stack.pop_back();
+			for (auto& e : adj[u])
+				if (comp[e.first] == -1) {
+					comp[e.first] = v;
+					stack.push_back(e.first);
+				}
+		}
+	}
+	return comp;
+}
+
+// Same partition: labels map one-to-one
+template<typename A, typename B>
+	static bool same_partition(const std::vector<A>& a, const std::vector<B>& b) {
+		std::unordered_map<A, B> ab;
+		std::unordered_map<B, A> ba;
+		for (std::size_t i = 0; i < a.size(); ++i)
+			if (ab.emplace(a[i], b[i]).first->second != b[i] || ba.emplace(b[i], a[i]).first->second != a[i]) return false;
+		return true;
+	}
+
+int graph_bench(unsigned scale, unsigned edge_factor, unsigned threads) {
+	using namespace dsa::csr_graph;
+	WorkPool pool(threads), single(1);
+	const Vertex n = Vertex(1) << scale;
+	const std::size_t m = std::size_t(n) * edge_factor;
+	auto ms = [](BenchClock::time_point t0) { return ns_per(t0, 1) / 1e6; };
+
+	auto t0 = BenchClock::now();
+	std::vector<Edge> edges = rmat_edges(scale, m, pool);
+	std::cout << "R-MAT scale " << scale << ": " << n << " vertices, " << m << " undirected edges, generated in "
+		<< std::fixed << std::setprecision(1) << ms(t0) << " ms; " << pool.size() << " threads\n"
+		<< "                            lists (1)    CSR (1)    CSR (" << pool.size() << ")   (ms)\n";
+	auto row = [](const char* name, double lists, double one, double all, const std::string& note) {
+		std::cout << "  " << std::left << std::setw(24) << name << std::right << std::setw(11) << lists
+			<< std::setw(11) << one << std::setw(11) << all << "   " << note << "\n";
+	};
+
+	t0 = BenchClock::now();
+	AdjacencyLists adj(n);
+	for (const auto& e : edges) {
+		adj[e.src].push_back({ int(e.dst), int(e.weight) });
+		adj[e.dst].push_back({ int(e.src), int(e.weight) });
+	}
+	double build_lists = ms(t0);
+	t0 = BenchClock::now();
+	{ Graph g(edges, n, false, single); }
+	double build_one = ms(t0);
+	t0 = BenchClock::now();
+	Graph g(edges, n, false, pool);
+	double build_all = ms(t0);
+	row("build", build_lists, build_one, build_all, std::to_string(g.arcs()) + " arcs");
+
+	Vertex src = 0;
+	for (std::mt19937 rng(7); g.out_degree(src) == 0;) src = rng() % n;
+
+	t0 = BenchClock::now();
+	auto depth_lists = lists_bfs(adj, int(src));
+	double bfs_lists = ms(t0);
+	t0 = BenchClock::now();
+	auto depth_one = bfs(g, src, single);
+	double bfs_one = ms(t0);
+	t0 = BenchClock::now();
+	auto depth_all = bfs(g, src, pool);
+	double bfs_all = ms(t0);
+	std::size_t reached = std::count_if(depth_all.begin(), depth_all.end(), [](std::uint32_t d) { return d != kUnreached; });
+	row("bfs", bfs_lists, bfs_one, bfs_all, std::to_string(reached) + " reached, " +
+		std::to_string(int(g.arcs() / 2 / (bfs_all * 1000))) + " MTEPS" +
+		(depth_one == depth_lists && depth_all == depth_lists ? "" : "  MISMATCH"));
+
+	t0 = BenchClock::now();
+	auto dist_lists = lists_dijkstra(adj, int(src));
+	double sssp_lists = ms(t0);
+	t0 = BenchClock::now();
+	auto dist_one = sssp(g, src, 32, single);
+	double sssp_one = ms(t0);
+	t0 = BenchClock::now();
+	auto dist_all = sssp(g, src, 32, pool);
+	double sssp_all = ms(t0);
+	row("sssp (delta 32)", sssp_lists, sssp_one, sssp_all, std::string("lists: Dijkstra") +
+		(dist_one == dist_lists && dist_all == dist_lists ? "" : "  MISMATCH"));
+
+	t0 = BenchClock::now();
+	auto comp_lists = lists_components(adj);
+	double cc_lists = ms(t0);
+	t0 = BenchClock::now();
+	auto comp_one = components(g, single);
+	double cc_one = ms(t0);
+	t0 = BenchClock::now();
+	auto comp_all = components(g, pool);
+	double cc_all = ms(t0);
+	std::vector<int> labels(comp_lists);
+	std::sort(labels.begin(), labels.end());
+	row("components", cc_lists, cc_one, cc_all,
+		std::to_string(std::unique(labels.begin(), labels.end()) - labels.begin()) + " components" +
+		(same_partition(comp_lists, comp_one) && same_partition(comp_lists, comp_all) ? "" : "  MISMATCH"));
+	return 0;
+}
+
+// PriorityQueue as it was before the 4-ary rewrite: binary heap, swaps, no handles
+template<typename T, class Compare = std::less<T>>
+	class OldPriorityQueue {
+		std::vector<T> data_;
+		Compare        comp_;
+
+		public:
+		bool        empty() const { return data_.empty(); }
+		const T&    top()   const { return data_.front(); }
+		void push(const T& v) {
+			data_.push_back(v);
+			for (std::size_t i = data_.size() - 1; i > 0;) {
+				std::size_t p = (i - 1) / 2;
+				if (!comp_(data_[p], data_[i])) break;
+				std::swap(data_[p], data_[i]);
+				i = p;
+			}
+		}
+		void pop() {
+			std::swap(data_.front(), data_.back());
+			data_.pop_back();
+			for (std::size_t i = 0, n = data_.size();;) {
+				std::size_t best = i, l = 2 * i + 1, r = l + 1;
+				if (l < n && comp_(data_[best], data_[l])) best = l;
+				if (r < n && comp_(data_[best], data_[r])) best = r;
+				if (best == i) break;
+				std::swap(data_[i], data_[best]);
+				i = best;
+			}
+		}
+	};
+
+// ns per operation for n pushes followed by n pops; the checksum keeps the pops honest
+template<typename Q>
+	double heap_push_pop(const std::vector<std::uint64_t>& values, std::uint64_t& sum) {
+		Q q;
+		auto t0 = BenchClock::now();
+		for (auto v : values) q.push(v);
+		while (!q.empty()) {
+			sum = sum * 31 + q.top();
+			q.pop();
+		}
+		return ns_per(t0, 2 * values.size());
+	}
+
+// Dijkstra on a random graph with decrease-key (update through the vertex's handle) and with lazy
+// deletion (push again, skip stale entries when they come up)
+static void heap_dijkstra(std::size_t n) {
+	std::mt19937_64 rng(5);
+	std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> adj(n);
+	for (std::size_t e = 0; e < 8 * n; ++e) adj[rng() % n].push_back({ std::uint32_t(rng() % n), std::uint32_t(1 + rng() % 1000) });
+
+	using Item = std::pair<std::uint64_t, std::uint32_t>;                       // (distance, vertex)
+	const std::uint64_t inf = UINT64_MAX;
+	std::size_t pushes = 0, peak = 0, updates = 0;
+
+	auto t0 = BenchClock::now();
+	std::vector<std::uint64_t> lazy(n, inf);
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item>> pq;
+	lazy[0] = 0;
+	pq.push({ 0, 0 });
+	while (!pq.empty()) {
+		auto [d, u] = pq.top();
+		pq.pop();
+		if (d != lazy[u]) continue;
+		for (auto [v, w] : adj[u])
+			if (d + w < lazy[v]) {
+				lazy[v] = d + w;
+				pq.push({ lazy[v], v });
+				++pushes;
+				peak = std::max(peak, pq.size());
+			}
+	}
+	double lazy_ms = ns_per(t0, 1) / 1e6;
+	std::cout << "  " << std::left << std::setw(34) << "std::priority_queue, lazy deletion" << std::right << std::setw(10)
+		<< lazy_ms << " ms   " << pushes << " pushes, peak size " << peak << "\n";
+
+	peak = 0;
+	t0 = BenchClock::now();
+	std::vector<std::uint64_t> dist(n, inf);
+	std::vector<dsa::PriorityQueue<Item, std::greater<Item>>::Handle> handle(n);
+	std::vector<bool> queued(n, false);
+	dsa::PriorityQueue<Item, std::greater<Item>> q;
+	dist[0] = 0;
+	handle[0] = q.push(Item{ 0, 0 });
+	while (!q.empty()) {
+		auto [d, u] = q.top();
+		q.pop();
+		queued[u] = false;
+		for (auto [v, w] : adj[u])
+			if (d + w < dist[v]) {
+				dist[v] = d + w;
+				if (queued[v]) {
+					q.update(handle[v], Item{ dist[v], v });
+					++updates;
+				} else {
+					handle[v] = q.push(Item{ dist[v], v });
+					queued[v] = true;
+					peak = std::max(peak, q.size());
+				}
+			}
+	}
+	double keyed_ms = ns_per(t0, 1) / 1e6;
+	std::cout << "  " << std::left << std::setw(34) << "dsa::PriorityQueue, update()" << std::right << std::setw(10)
+		<< keyed_ms << " ms   " << updates << " updates, peak size " << peak
+		<< (dist == lazy ? "" : "  MISMATCH") << "\n";
+}
+
+// Timer wheel stand-in: `timers` deadlines; each step fires the earliest timer and re-arms it, then
+// postpones `moves` random timers
+static void heap_scheduler(std::size_t timers, std::size_t steps, std::size_t moves) {
+	using Item = std::pair<std::uint64_t, std::uint32_t>;                       // (deadline, timer)
+	std::uint64_t fired = 0;
+	std::size_t peak = 0;
+
+	std::mt19937_64 rng(9);
+	std::vector<std::uint64_t> deadline(timers);
+	for (auto& d : deadline) d = rng() % 1000000;
+
+	{
+		std::vector<std::uint64_t> due(deadline);
+		std::priority_queue<Item, std::vector<Item>, std::greater<Item>> pq;
+		for (std::uint32_t t = 0; t < timers; ++t) pq.push({ due[t], t });
+		std::mt19937_64 r(11);
+		auto t0 = BenchClock::now();
+		for (std::size_t s = 0; s < steps; ++s) {
+			for (;;) {
+				auto [d, t] = pq.top();
+				pq.pop();
+				if (d != due[t]) continue;                      // postponed: a later entry exists
+				fired += t;
+				due[t] = d + 1 + r() % 1000000;
+				pq.push({ due[t], t });
+				break;
+			}
+			for (std::size_t m = 0; m < moves; ++m) {
+				std::uint32_t t = r() % timers;
+				due[t] += 1 + r() % 1000;
+				pq.push({ due[t], t });
+			}
+			peak = std::max(peak, pq.size());
+		}
+		std::cout << "  " << std::left << std::setw(34) << "std::priority_queue, lazy deletion" << std::right << std::setw(10)
+			<< ns_per(t0, steps) << " ns/step   peak size " << peak << "\n";
+	}
+
+	std::uint64_t fired2 = 0;
+	{
+		std::vector<std::uint64_t> due(deadline);
+		dsa::PriorityQueue<Item, std::greater<Item>> q;
+		std::vector<Item> items;
+		for (std::uint32_t t = 0; t < timers; ++t) items.push_back({ due[t], t });
+		auto handle = q.heapify(items.begin(), items.end());
+		std::mt19937_64 r(11);
+		auto t0 = BenchClock::now();
+		for (std::size_t s = 0; s < steps; ++s) {
+			auto [d, t] = q.top();
+			fired2 += t;
+			due[t] = d + 1 + r() % 1000000;
+			q.update(handle[t], Item{ due[t], t });
+			for (std::size_t m = 0; m < moves; ++m) {
+				std::uint32_t t = r() % timers;
+				due[t] += 1 + r() % 1000;
+				q.update(handle[t], Item{ due[t], t });
+			}
+		}
+		std::cout << "  " << std::left << std::setw(34) << "dsa::PriorityQueue, update()" << std::right << std::setw(10)
+			<< ns_per(t0, steps) << " ns/step   size " << q.size() << (fired == fired2 ? "" : "  MISMATCH") << "\n";
+	}
+}
+
+int heap_bench(std::size_t n) {
+	std::mt19937_64 rng(3);
+	std::vector<std::uint64_t> values(n);
+	for (auto& v : values) v = rng();
+
+	using Plain = dsa::PriorityQueue<std::uint64_t, std::less<std::uint64_t>, false>;
+	const char* names[] = { "dsa::PriorityQueue", "  without handles", "std::priority_queue", "old PriorityQueue" };
+	const char* how[] = { "heapify()", "heapify()", "range constructor", "n x push()" };
+	std::uint64_t sum[4] = {};
+	double push_pop[4], build[4];
+	for (int round = 0; round < 3; ++round) {
+		double p[4] = {
+			heap_push_pop<dsa::PriorityQueue<std::uint64_t>>(values, sum[0]),
+			heap_push_pop<Plain>(values, sum[1]),
+			heap_push_pop<std::priority_queue<std::uint64_t>>(values, sum[2]),
+			heap_push_pop<OldPriorityQueue<std::uint64_t>>(values, sum[3]) };
+
+		auto t0 = BenchClock::now();
+		dsa::PriorityQueue<std::uint64_t> a;
+		a.heapify(values.begin(), values.end());
+		double b0 = ns_per(t0, 1) / 1e6;
+		t0 = BenchClock::now();
+		Plain pl;
+		pl.heapify(values.begin(), values.end());
+		double b1 = ns_per(t0, 1) / 1e6;
+		t0 = BenchClock::now();
+		std::priority_queue<std::uint64_t> s(values.begin(), values.end());
+		double b2 = ns_per(t0, 1) / 1e6;
+		t0 = BenchClock::now();
+		OldPriorityQueue<std::uint64_t> o;
+		for (auto v : values) o.push(v);
+		double b3 = ns_per(t0, 1) / 1e6;
+		if (a.top() != s.top() || pl.top() != s.top() || o.top() != s.top()) std::cout << "  MISMATCH\n";
+
+		double b[4] = { b0, b1, b2, b3 };
+		for (int i = 0; i < 4; ++i) {
+			push_pop[i] = round ? std::min(push_pop[i], p[i]) : p[i];
+			build[i] = round ? std::min(build[i], b[i]) : b[i];
+		}
+	}
+
+	std::cout << n << " random 64-bit keys\n                        push + pop (ns/op)   build (ms)\n";
+	for (int i = 0; i < 4; ++i)
+		std::cout << "  " << std::left << std::setw(22) << names[i] << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(12) << push_pop[i] << std::setw(16) << build[i] << "   " << how[i] << "\n";
+	if (sum[0] != sum[1] || sum[1] != sum[2] || sum[2] != sum[3]) std::cout << "  MISMATCH\n";
+
+	std::cout << "Dijkstra, " << n / 4 << " vertices, " << 2 * n << " random edges\n";
+	heap_dijkstra(n / 4);
+	std::cout << "scheduler, " << n / 10 << " timers, 4 postponed per fired one\n";
+	heap_scheduler(n / 10, n, 4);
+	return 0;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+	if (argc > 1 && std::string(argv[1]) == "--bench-hash")
+		return hash_table_bench(argc > 2 ? std::stoul(argv[2]) : 1000000);
+	if (argc > 1 && std::string(argv[1]) == "--bench-trie")
+		return trie_bench(argc > 2 ? std::stoul(argv[2]) : 200000);
+	if (argc > 1 && std::string(argv[1]) == "--bench-vector")
+		return vector_bench(argc > 2 ? std::stoul(argv[2]) : 10000000);
+	if (argc > 1 && std::string(argv[1]) == "--bench-graph")
+		return graph_bench(argc > 2 ? std::stoul(argv[2]) : 20, argc > 3 ? std::stoul(argv[3]) : 16,
+			argc > 4 ? std::stoul(argv[4]) : 0);
+	if (argc > 1 && std::string(argv[1]) == "--bench-heap")
+		return heap_bench(argc > 2 ? std::stoul(argv[2]) : 4000000);
+
 	array_test();
 	vector_test();
 	stack_test();
 	queue_test();
+	priority_queue_test();
 	list_test();
 	hash_table_test();
 	map_test();
 	string_test();
+	trie_test();
 	graph_test();
 	return 0;
 
@@ -9,9 +9,27 @@
 #include <algorithm>
 #include <utility>
 #include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
 #include <memory>
 #include <optional>
+#include <stdexcept>
 #include <unordered_map>
+#include <string_view>
+#include <type_traits>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <climits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 namespace dsa
@@ -52,54 +70,225 @@ namespace dsa
 		};
 
 
+	// Types whose objects can be moved to another address with memcpy, dropping the old bytes without a
+	// destructor call. Trivially copyable types can; specialize for others that can too (a class that
+	// only holds a std::unique_ptr, say). libstdc++'s std::string cannot: it points into itself.
 	template<typename T>
+		struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+
+	// Elements live in raw storage from Alloc and are only constructed when added. Growing moves the
+	// elements (copies them if their move may throw, so a failed push_back leaves the vector as it was),
+	// memcpys trivially relocatable ones, and with std::allocator hands those to realloc(), which can
+	// extend the block in place or remap large ones instead of copying. Capacity doubles when every
+	// element has to be moved over, and grows by half when realloc() does the work: less slack for
+	// the same number of cheap steps.
+	template<typename T, class Alloc = std::allocator<T>>
 		class Vector {
 			private:
+				using Traits = std::allocator_traits<Alloc>;
+
+				static constexpr bool kRelocatable = is_trivially_relocatable<T>::value;
+				static constexpr bool kRealloc = kRelocatable && std::is_same_v<Alloc, std::allocator<T>>
+					&& alignof(T) <= alignof(std::max_align_t);
+
 				std::size_t size_{0};
 				std::size_t capacity_{0};
 				T*          data_{nullptr};
+				Alloc       alloc_;
+
+				std::size_t grown(std::size_t need) const {
+					return std::max(need, kRealloc ? capacity_ + capacity_ / 2 : capacity_ * 2);
+				}
+
+				T* allocate(std::size_t n) {
+					if (n == 0) return nullptr;
+					if constexpr (kRealloc) {
+						void* p = std::malloc(n * sizeof(T));
+						if (!p) throw std::bad_alloc();
+						return static_cast<T*>(p);
+					} else {
+						return Traits::allocate(alloc_, n);
+					}
+				}
+				void deallocate(T* p, std::size_t n) noexcept {
+					if (!p) return;
+					if constexpr (kRealloc) std::free(p);
+					else Traits::deallocate(alloc_, p, n);
+				}
+
+				// Moves the elements into dst; if a copy throws, dst is cleaned up and the vector is untouched
+				void transfer(T* dst) {
+					if constexpr (kRelocatable) {
+						if (size_) std::memcpy(static_cast<void*>(dst), static_cast<const void*>(data_), size_ * sizeof(T));
+					} else if constexpr (std::is_nothrow_move_constructible_v<T>) {
+						for (std::size_t i = 0; i < size_; ++i) {      // one pass: nothing can fail half way
+							Traits::construct(alloc_, dst + i, std::move(data_[i]));
+							Traits::destroy(alloc_, data_ + i);
+						}
+					} else {
+						std::size_t i = 0;
+						try {
+							for (; i < size_; ++i) Traits::construct(alloc_, dst + i, std::move_if_noexcept(data_[i]));
+						} catch (...) {
+							while (i) Traits::destroy(alloc_, dst + --i);
+							throw;
+						}
+						for (i = 0; i < size_; ++i) Traits::destroy(alloc_, data_ + i);
+					}
+				}
+
+				// New storage for cap >= size_ elements
+				void reallocate(std::size_t cap) {
+					if constexpr (kRealloc) {
+						if (cap == 0) { std::free(data_); data_ = nullptr; capacity_ = 0; return; }
+						void* p = std::realloc(data_, cap * sizeof(T));
+						if (!p) throw std::bad_alloc();
+						data_ = static_cast<T*>(p);
+					} else {
+						T* mem = allocate(cap);
+						try { transfer(mem); } catch (...) { deallocate(mem, cap); throw; }
+						deallocate(data_, capacity_);
+						data_ = mem;
+					}
+					capacity_ = cap;
+				}
+
+				void destroy_all() noexcept {
+					if constexpr (!std::is_trivially_destructible_v<T>)
+						for (std::size_t i = 0; i < size_; ++i) Traits::destroy(alloc_, data_ + i);
+					size_ = 0;
+				}
 
 			public:
 				Vector() = default;
-				~Vector() { 
-					for ( int i = 0; i < size_; i++ )	data_[i].~T();
-					delete[] data_; data_ = nullptr;
+				explicit Vector(const Alloc& alloc) : alloc_(alloc) {}
+				~Vector() {
+					destroy_all();
+					deallocate(data_, capacity_);
+				}
+
+				Vector(const Vector& other) : alloc_(Traits::select_on_container_copy_construction(other.alloc_)) {
+					data_ = allocate(other.size_);
+					capacity_ = other.size_;
+					try {
+						for (; size_ < other.size_; ++size_) Traits::construct(alloc_, data_ + size_, other.data_[size_]);
+					} catch (...) {
+						destroy_all();
+						deallocate(data_, capacity_);
+						throw;
+					}
+				}
+				Vector(Vector&& other) noexcept
+					: size_(other.size_), capacity_(other.capacity_), data_(other.data_), alloc_(std::move(other.alloc_)) {
+					other.size_ = other.capacity_ = 0;
+					other.data_ = nullptr;
+				}
+
+				Vector& operator=(const Vector& other) {
+					if (this != &other) {
+						Vector tmp(other);
+						swap(tmp);
+					}
+					return *this;
+				}
+				Vector& operator=(Vector&& other) noexcept(Traits::propagate_on_container_move_assignment::value
+						|| Traits::is_always_equal::value) {
+					if (this == &other) return *this;
+					if constexpr (Traits::propagate_on_container_move_assignment::value || Traits::is_always_equal::value) {
+						Vector tmp(std::move(other));
+						swap(tmp);
+					} else {
+						clear();
+						reserve(other.size_);                 // storage from our allocator, elements moved over
+						for (; size_ < other.size_; ++size_) Traits::construct(alloc_, data_ + size_, std::move(other.data_[size_]));
+						other.clear();
+					}
+					return *this;
+				}
+
+				void swap(Vector& other) noexcept {
+					std::swap(size_, other.size_);
+					std::swap(capacity_, other.capacity_);
+					std::swap(data_, other.data_);
+					if constexpr (Traits::propagate_on_container_swap::value) std::swap(alloc_, other.alloc_);
 				}
 
 				// capacity/size
 				std::size_t size()     const { return size_; }
 				std::size_t capacity() const { return capacity_; }
 				bool        empty()    const { return size_ == 0; }
+				Alloc       get_allocator() const { return alloc_; }
+
+				void reserve(std::size_t n) {
+					if (n > capacity_) reallocate(n);
+				}
+				void shrink_to_fit() {
+					if (capacity_ > size_) reallocate(size_);
+				}
 
-				// element access (single non-const versions, with inline checks)
-				T& operator[](std::size_t idx) { return data_[idx]; }
+				// element access
+				T&       operator[](std::size_t idx)       { return data_[idx]; }
+				const T& operator[](std::size_t idx) const { return data_[idx]; }
 				T& at(std::size_t idx) {
 					if (idx >= size_) throw std::out_of_range("Vector::at out_of_range");
 					return data_[idx];
 				}
+				const T& at(std::size_t idx) const {
+					if (idx >= size_) throw std::out_of_range("Vector::at out_of_range");
+					return data_[idx];
+				}
+				T*       data()       { return data_; }
+				const T* data() const { return data_; }
 
 				// modifiers
-				void push_back(const T& t) {
-					if (size_ == capacity_) {
-						std::size_t new_cap = capacity_ ? capacity_ * 2 : 1;
-						T* tmp = new T[new_cap];                 // requires T default-constructible & assignable
-						for (std::size_t i = 0; i < size_; ++i)
-							tmp[i] = std::move(data_[i]);
-						delete[] data_;
-						data_ = tmp;
-						capacity_ = new_cap;
+				void push_back(const T& t) { emplace_back(t); }
+				void push_back(T&& t)      { emplace_back(std::move(t)); }
+
+				template<class... Args>
+					T& emplace_back(Args&&... args) {
+						if (size_ < capacity_) {
+							Traits::construct(alloc_, data_ + size_, std::forward<Args>(args)...);
+						} else if constexpr (kRealloc) {
+							T tmp(std::forward<Args>(args)...);     // args may point into the block realloc() moves
+							reallocate(grown(size_ + 1));
+							Traits::construct(alloc_, data_ + size_, std::move(tmp));
+						} else {
+							// The new element first: args may refer to an element that is about to move
+							std::size_t cap = grown(size_ + 1);
+							T* mem = allocate(cap);
+							try {
+								Traits::construct(alloc_, mem + size_, std::forward<Args>(args)...);
+							} catch (...) {
+								deallocate(mem, cap);
+								throw;
+							}
+							try {
+								transfer(mem);
+							} catch (...) {
+								Traits::destroy(alloc_, mem + size_);
+								deallocate(mem, cap);
+								throw;
+							}
+							deallocate(data_, capacity_);
+							data_ = mem;
+							capacity_ = cap;
+						}
+						return data_[size_++];
 					}
-					data_[size_++] = t;
-				}
 
 				void pop_back() {
 					if (size_ == 0) throw std::underflow_error("Vector::pop_back underflow");
-					data_[--size_].~T();
+					Traits::destroy(alloc_, data_ + --size_);
 				}
 
-				// iterators (non-const only)
-				T* begin() { return data_; }
-				T* end()   { return data_ + size_; }
+				void clear() noexcept { destroy_all(); }
+
+				// iterators
+				T*       begin()       { return data_; }
+				T*       end()         { return data_ + size_; }
+				const T* begin() const { return data_; }
+				const T* end()   const { return data_ + size_; }
 		};
 
 
@@ -294,73 +483,253 @@ namespace dsa
 		};
 
 
-	template<typename K, typename V, std::size_t N = 10>
+	// Default hasher of HashTable: std::hash, except that strings hash through string_view, so a
+	// HashTable<std::string, V> can be searched with a const char* or string_view without building a key.
+	template<typename K>
+		struct Hash : std::hash<K> {};
+
+	template<>
+		struct Hash<std::string> {
+			using is_transparent = void;
+			std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+		};
+
+	namespace detail {
+		template<class T, class = void> struct is_transparent : std::false_type {};
+		template<class T> struct is_transparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
+
+		// Type of a lookup argument: whatever the caller passes when hash and equality are transparent,
+		// K otherwise (an alias member, so the argument type is still deduced)
+		template<bool Transparent> struct KeyArg { template<class Q, class K> using type = K; };
+		template<> struct KeyArg<true> { template<class Q, class K> using type = Q; };
+	}
+
+
+	// Open addressing over groups of 16 slots (Swiss table layout). Every slot has a control byte: empty,
+	// or the low 7 bits of its key's hash. A lookup compares the 16 control bytes of a group with one
+	// SSE2 instruction and only looks at the keys whose 7 bits match.
+	// Deletion leaves no tombstones: each group counts the keys that had to probe past it because it was
+	// full, a lookup ends at the first group with a zero count, remove() counts down along the removed
+	// key's probe path. Doubles at 7/8 load. N: initial capacity.
+	template<typename K, typename V, std::size_t N = 10, class Hasher = Hash<K>, class KeyEqual = std::equal_to<>>
 		class HashTable {
 			static_assert(N > 0, "HashTable: N must be > 0");
 
-			std::size_t count{0};
-			std::vector<std::list<std::pair<K, V>>> table;
+			using Slot = std::pair<K, V>;
+			static constexpr std::size_t  kGroup = 16;
+			static constexpr std::uint8_t kEmpty = 0x80;
+			static constexpr std::size_t  npos   = std::size_t(-1);
+			static constexpr bool transparent = detail::is_transparent<Hasher>::value && detail::is_transparent<KeyEqual>::value;
+
+			template<class Q> using key_arg = typename detail::KeyArg<transparent>::template type<Q, K>;
+
+			std::size_t   count{0};
+			std::size_t   groups_{0};             // power of two
+			std::uint8_t* ctrl_{nullptr};         // groups_ * kGroup control bytes, then one overflow count per group
+			Slot*         slots_{nullptr};
+			Hasher        hash_;
+			KeyEqual      eq_;
+
+			// std::hash of an integer is the integer: mix so that the group and the 7 bits see all of it
+			template<class Q>
+				std::uint64_t hash_of(const Q& k) const {
+					std::uint64_t h = hash_(k);
+					h ^= h >> 33;  h *= 0xff51afd7ed558ccdULL;
+					h ^= h >> 33;  h *= 0xc4ceb9fe1a85ec53ULL;
+					return h ^ (h >> 33);
+				}
 
-			std::size_t index_for(const K& k) const { return std::hash<K>{}(k) % N; }
+			std::size_t   home(std::uint64_t h) const { return (h >> 7) & (groups_ - 1); }
+			// Triangular steps visit every group once when the group count is a power of two
+			std::size_t   next(std::size_t g, std::size_t step) const { return (g + step) & (groups_ - 1); }
+			std::uint8_t& overflow(std::size_t g) const { return ctrl_[groups_ * kGroup + g]; }
+
+			// Bit i set: control byte i of the group at c equals b
+			static std::uint32_t match(const std::uint8_t* c, std::uint8_t b) {
+#ifdef __SSE2__
+				__m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));
+				return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(b)))));
+#else
+				std::uint32_t m = 0;
+				for (std::size_t i = 0; i < kGroup; ++i) m |= std::uint32_t(c[i] == b) << i;
+				return m;
+#endif
+			}
+			static std::uint32_t empties(const std::uint8_t* c) {
+#ifdef __SSE2__
+				return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c))));
+#else
+				return match(c, kEmpty);
+#endif
+			}
+
+			template<class Q>
+				std::size_t find_index(const Q& k, std::uint64_t h) const {
+					if (count == 0) return npos;
+					const std::uint8_t h2 = h & 0x7F;
+					std::size_t g = home(h);
+					for (std::size_t step = 1; step <= groups_; ++step) {
+						for (std::uint32_t m = match(ctrl_ + g * kGroup, h2); m; m &= m - 1) {
+							std::size_t i = g * kGroup + __builtin_ctz(m);
+							if (eq_(slots_[i].first, k)) return i;
+						}
+						if (overflow(g) == 0) return npos;
+						g = next(g, step);
+					}
+					return npos;
+				}
+
+			// First empty slot on the probe path of h; nothing is marked until commit()
+			std::size_t free_slot(std::uint64_t h) const {
+				std::size_t g = home(h);
+				for (std::size_t step = 1;; ++step) {
+					if (std::uint32_t m = empties(ctrl_ + g * kGroup)) return g * kGroup + __builtin_ctz(m);
+					g = next(g, step);
+				}
+			}
+
+			// Marks slot i full and counts the key in every group it probed past (counts saturate)
+			void commit(std::uint64_t h, std::size_t i) {
+				ctrl_[i] = h & 0x7F;
+				for (std::size_t g = home(h), step = 1; g != i / kGroup; g = next(g, step++))
+					if (overflow(g) != 0xFF) ++overflow(g);
+			}
+
+			void allocate(std::size_t groups) {
+				groups_ = groups;
+				ctrl_ = new std::uint8_t[groups * (kGroup + 1)];
+				std::memset(ctrl_, kEmpty, groups * kGroup);
+				std::memset(ctrl_ + groups * kGroup, 0, groups);
+				slots_ = std::allocator<Slot>().allocate(groups * kGroup);
+			}
+
+			void release() noexcept {
+				for (std::size_t i = 0; i < groups_ * kGroup; ++i)
+					if (ctrl_[i] != kEmpty) slots_[i].~Slot();
+				if (slots_) std::allocator<Slot>().deallocate(slots_, groups_ * kGroup);
+				delete[] ctrl_;
+				ctrl_ = nullptr; slots_ = nullptr; groups_ = 0; count = 0;
+			}
+
+			static std::size_t groups_for(std::size_t n) {
+				std::size_t g = 1;
+				while (g * kGroup * 7 / 8 < n) g *= 2;
+				return g;
+			}
+
+			void rehash(std::size_t groups) {
+				HashTable old(std::move(*this));
+				allocate(groups);
+				for (std::size_t i = 0; i < old.groups_ * kGroup; ++i) {
+					if (old.ctrl_[i] == kEmpty) continue;
+					std::uint64_t h = hash_of(old.slots_[i].first);
+					std::size_t j = free_slot(h);
+					new (slots_ + j) Slot(std::move_if_noexcept(old.slots_[i]));
+					commit(h, j);
+					++count;
+				}
+			}
 
 			public:
-			HashTable() : table(N) {}
-			std::size_t size() const { return count; }
+			HashTable() { allocate(groups_for(N)); }
+			~HashTable() { release(); }
+
+			HashTable(const HashTable& other) : hash_(other.hash_), eq_(other.eq_) {
+				allocate(other.groups_ ? other.groups_ : 1);
+				for (std::size_t i = 0; i < other.groups_ * kGroup; ++i)
+					if (other.ctrl_[i] != kEmpty) insert(other.slots_[i].first, other.slots_[i].second);
+			}
+			HashTable(HashTable&& other) noexcept
+				: count(other.count), groups_(other.groups_), ctrl_(other.ctrl_), slots_(other.slots_),
+				  hash_(std::move(other.hash_)), eq_(std::move(other.eq_)) {
+				other.count = 0; other.groups_ = 0; other.ctrl_ = nullptr; other.slots_ = nullptr;
+			}
+			HashTable& operator=(HashTable other) noexcept {
+				std::swap(count, other.count);
+				std::swap(groups_, other.groups_);
+				std::swap(ctrl_, other.ctrl_);
+				std::swap(slots_, other.slots_);
+				std::swap(hash_, other.hash_);
+				std::swap(eq_, other.eq_);
+				return *this;
+			}
+
+			std::size_t size()     const { return count; }
+			bool        empty()    const { return count == 0; }
+			std::size_t capacity() const { return groups_ * kGroup; }
+
+			void clear() noexcept {
+				std::size_t groups = groups_;
+				release();
+				if (groups) allocate(groups);
+			}
+
+			// Room for n keys without growing
+			void reserve(std::size_t n) {
+				if (groups_for(n) > groups_) rehash(groups_for(n));
+			}
 
-			// Perfect-forwarding insert (handles lvalues/rvalues/convertibles)
+			// Perfect-forwarding insert (handles lvalues/rvalues/convertibles); overwrites an existing value
 			template<class KK, class VV>
 				void insert(KK&& k, VV&& v) {
-					const auto idx = index_for(static_cast<const K&>(k));
-					auto& bucket = table[idx];
-					for (auto& kv : bucket) {
-						if (kv.first == k) { kv.second = std::forward<VV>(v); return; }
+					if constexpr (!transparent && !std::is_same_v<std::decay_t<KK>, K>) {
+						insert(K(std::forward<KK>(k)), std::forward<VV>(v));
+					} else {
+						const std::uint64_t h = hash_of(k);
+						if (std::size_t i = find_index(k, h); i != npos) {
+							slots_[i].second = std::forward<VV>(v);
+							return;
+						}
+						if ((count + 1) * 8 > capacity() * 7) rehash(groups_ ? groups_ * 2 : 1);
+						const std::size_t i = free_slot(h);
+						new (slots_ + i) Slot(std::forward<KK>(k), std::forward<VV>(v));
+						commit(h, i);
+						++count;
 					}
-					bucket.emplace_back(std::forward<KK>(k), std::forward<VV>(v));
-					++count;
 				}
 
-			bool remove(const K& k) {
-				const auto idx = index_for(k);
-				auto& bucket = table[idx];
-				for (auto it = bucket.begin(); it != bucket.end(); ++it) {
-					if (it->first == k) { bucket.erase(it); --count; return true; }
+			template<class Q = K>
+				bool remove(const key_arg<Q>& k) {
+					const std::uint64_t h = hash_of(k);
+					const std::size_t i = find_index(k, h);
+					if (i == npos) return false;
+					for (std::size_t g = home(h), step = 1; g != i / kGroup; g = next(g, step++))
+						if (overflow(g) != 0xFF) --overflow(g);
+					slots_[i].~Slot();
+					ctrl_[i] = kEmpty;
+					--count;
+					return true;
 				}
-				return false;
-			}
 
 			// 1) Value copy
-			std::optional<V> find(const K& k) const {
-				const auto idx = index_for(k);
-				const auto& bucket = table[idx];
-				for (const auto& kv : bucket)
-					if (kv.first == k) return kv.second;  // copy out
-				return std::nullopt;
-			}
+			template<class Q = K>
+				std::optional<V> find(const key_arg<Q>& k) const {
+					const std::size_t i = find_index(k, hash_of(k));
+					if (i == npos) return std::nullopt;
+					return slots_[i].second;              // copy out
+				}
 
 			// 2) Reference (no copy)
-			std::optional<std::reference_wrapper<V>> find_reference(const K& k) {
-				const auto idx = index_for(k);
-				auto& bucket = table[idx];
-				for (auto& kv : bucket)
-					if (kv.first == k) return kv.second;  // wraps V& in reference_wrapper
-				return std::nullopt;
-			}
+			template<class Q = K>
+				std::optional<std::reference_wrapper<V>> find_reference(const key_arg<Q>& k) {
+					const std::size_t i = find_index(k, hash_of(k));
+					if (i == npos) return std::nullopt;
+					return slots_[i].second;              // wraps V& in reference_wrapper
+				}
 
 			// 3) Pointer (no copy)
-			V* find_pointer(const K& k) {
-				const auto idx = index_for(k);
-				auto& bucket = table[idx];
-				for (auto& kv : bucket)
-					if (kv.first == k) return &kv.second;
-				return nullptr;
-			}
+			template<class Q = K>
+				V* find_pointer(const key_arg<Q>& k) {
+					const std::size_t i = find_index(k, hash_of(k));
+					return i == npos ? nullptr : &slots_[i].second;
+				}
 
 			void print() const {
-				std::size_t b = 0;
-				for (const auto& bucket : table) {
-					std::cout << "bucket[" << b++ << "]: ";
-					for (const auto& kv : bucket)
-						std::cout << "{" << kv.first << "," << kv.second << "} ";
+				for (std::size_t g = 0; g < groups_; ++g) {
+					std::cout << "group[" << g << "]: ";
+					for (std::size_t i = g * kGroup; i < (g + 1) * kGroup; ++i)
+						if (ctrl_[i] != kEmpty)
+							std::cout << "{" << slots_[i].first << "," << slots_[i].second << "} ";
 					std::cout << "\n";
 				}
 			}
@@ -663,159 +1032,584 @@ namespace dsa
 	};
 
 
+	// Adaptive radix tree (ART) over the bytes of the words. Inner nodes come in four sizes (Node4 and
+	// Node16: sorted key bytes + children, Node48: 256 byte index into 48 children, Node256: direct
+	// array) and grow into the next one when full; a node with a single path below it is merged into
+	// its child, which keeps the skipped bytes (path compression). A word that ends in the middle of a
+	// path is a node with isEnd set, a node without children is a leaf carrying the rest of its word.
+	// The compressed path is stored right behind the node's child arrays, so a node is one allocation.
 	class Trie {
+		enum Type : std::uint8_t { kLeaf, kNode4, kNode16, kNode48, kNode256 };
+
 		struct Node {
-			std::unordered_map<char, std::unique_ptr<Node>> next;
-			bool isEnd = false;
+			Type          type  = kLeaf;
+			bool          isEnd = false;         // a word ends here
+			std::uint16_t count = 0;             // children
+			std::uint32_t plen  = 0;             // bytes of the compressed path
 		};
+		struct Node4   : Node { std::uint8_t key[4];  Node* child[4]; };
+		struct Node16  : Node { std::uint8_t key[16]; Node* child[16]; };
+		struct Node48  : Node { std::uint8_t index[256]; Node* child[48]; };   // index: child slot + 1, 0 = none
+		struct Node256 : Node { Node* child[256]; };
+
+		static constexpr std::size_t kSize[]     = { sizeof(Node), sizeof(Node4), sizeof(Node16), sizeof(Node48), sizeof(Node256) };
+		static constexpr std::uint16_t kFanout[] = { 0, 4, 16, 48, 256 };
+
+		Node*       root_{nullptr};
+		std::size_t words_{0};
+
+		static char*       path(Node* n)       { return reinterpret_cast<char*>(n) + kSize[n->type]; }
+		static const char* path(const Node* n) { return reinterpret_cast<const char*>(n) + kSize[n->type]; }
+
+		static Node* make(Type type, const char* p, std::size_t plen) {
+			void* mem = ::operator new(kSize[type] + plen);
+			Node* n;
+			switch (type) {
+				case kNode4:   n = new (mem) Node4();   break;
+				case kNode16:  n = new (mem) Node16();  break;
+				case kNode48:  n = new (mem) Node48();  break;
+				case kNode256: n = new (mem) Node256(); break;
+				default:       n = new (mem) Node();    break;
+			}
+			n->type = type;
+			n->plen = static_cast<std::uint32_t>(plen);
+			std::memcpy(path(n), p, plen);
+			return n;
+		}
 
-		std::unique_ptr<Node> root = std::make_unique<Node>();
+		static void destroy(Node* n) noexcept {
+			if (!n) return;
+			for_each_child(n, [](std::uint8_t, Node* c) { destroy(c); });
+			::operator delete(n);
+		}
 
-		public:
+		// Children in byte order
+		template<class F>
+			static void for_each_child(const Node* n, F&& f) {
+				switch (n->type) {
+					case kNode4: {
+						auto* s = static_cast<const Node4*>(n);
+						for (int i = 0; i < n->count; ++i) f(s->key[i], s->child[i]);
+						break;
+					}
+					case kNode16: {
+						auto* s = static_cast<const Node16*>(n);
+						for (int i = 0; i < n->count; ++i) f(s->key[i], s->child[i]);
+						break;
+					}
+					case kNode48: {
+						auto* s = static_cast<const Node48*>(n);
+						for (int b = 0; b < 256; ++b)
+							if (s->index[b]) f(std::uint8_t(b), s->child[s->index[b] - 1]);
+						break;
+					}
+					case kNode256: {
+						auto* s = static_cast<const Node256*>(n);
+						for (int b = 0; b < 256; ++b)
+							if (s->child[b]) f(std::uint8_t(b), s->child[b]);
+						break;
+					}
+					default: break;
+				}
+			}
 
-		// Insert a word
-		void insert(const std::string& word) {
-			Node* cur = root.get();
-			for (char c : word) {
-				if (!cur->next[c])                                   // if key not exists, may default-insert nullptr
-					cur->next[c] = std::make_unique<Node>();
-				cur = cur->next[c].get();
-			}
-			cur->isEnd = true;
+		static Node* const* find_child(const Node* n, std::uint8_t b) {
+			switch (n->type) {
+				case kNode4: {
+					auto* s = static_cast<const Node4*>(n);
+					for (int i = 0; i < n->count; ++i)
+						if (s->key[i] == b) return &s->child[i];
+					return nullptr;
+				}
+				case kNode16: {
+					auto* s = static_cast<const Node16*>(n);
+#ifdef __SSE2__
+					__m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s->key));
+					unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(keys, _mm_set1_epi8(static_cast<char>(b))));
+					m &= (1u << n->count) - 1;
+					return m ? &s->child[__builtin_ctz(m)] : nullptr;
+#else
+					for (int i = 0; i < n->count; ++i)
+						if (s->key[i] == b) return &s->child[i];
+					return nullptr;
+#endif
+				}
+				case kNode48: {
+					auto* s = static_cast<const Node48*>(n);
+					return s->index[b] ? &s->child[s->index[b] - 1] : nullptr;
+				}
+				case kNode256: {
+					auto* s = static_cast<const Node256*>(n);
+					return s->child[b] ? &s->child[b] : nullptr;
+				}
+				default:
+					return nullptr;
+			}
 		}
-
-		// Search exact word
-		bool search(const std::string& word) const {
-			const Node* cur = root.get();
-			for (char c : word) {
-				auto it = cur->next.find(c);
-				if (it == cur->next.end()) return false;
-				cur = it->second.get();
-			}
-			return cur->isEnd;
+		static Node** find_child(Node* n, std::uint8_t b) {
+			return const_cast<Node**>(find_child(static_cast<const Node*>(n), b));
 		}
 
-		// Check prefix
-		bool startsWith(const std::string& prefix) const {
-			const Node* cur = root.get();
-			for (char c : prefix) {
-				auto it = cur->next.find(c);
-				if (it == cur->next.end()) return false;
-				cur = it->second.get();
-			}
-			return true;
+		// The same node one size up, n is freed
+		static Node* grow(Node* n) {
+			Node* g = make(Type(n->type + 1), path(n), n->plen);
+			g->isEnd = n->isEnd;
+			for_each_child(n, [g](std::uint8_t b, Node* c) { add_child(g, b, c); });
+			::operator delete(n);
+			return g;
 		}
 
-		// Return up to `k` suggestions for the given prefix.
-		// If k == 0 → return all suggestions.
-		std::vector<std::string> autoSuggest(const std::string& prefix, std::size_t k) const {
-			std::vector<std::string> out;
-			const Node* start = prefixNode(prefix);
-			if (!start) return out;
+		// n must have room (see grow)
+		static void add_child(Node* n, std::uint8_t b, Node* c) {
+			switch (n->type) {
+				case kNode4:
+				case kNode16: {
+					std::uint8_t* key = n->type == kNode4 ? static_cast<Node4*>(n)->key : static_cast<Node16*>(n)->key;
+					Node** child = n->type == kNode4 ? static_cast<Node4*>(n)->child : static_cast<Node16*>(n)->child;
+					int i = n->count;
+					for (; i > 0 && key[i - 1] > b; --i) {
+						key[i] = key[i - 1];
+						child[i] = child[i - 1];
+					}
+					key[i] = b;
+					child[i] = c;
+					break;
+				}
+				case kNode48: {
+					auto* s = static_cast<Node48*>(n);
+					s->child[n->count] = c;                  // nothing is ever removed: slots fill in order
+					s->index[b] = std::uint8_t(n->count + 1);
+					break;
+				}
+				case kNode256:
+					static_cast<Node256*>(n)->child[b] = c;
+					break;
+				default:
+					break;
+			}
+			++n->count;
+		}
 
-			std::string path = prefix;   // build full words starting from the prefix
-			dfsCollect(start, path, out, k);
-			return out;
+		static Type type_for(std::size_t children) {
+			return children == 0 ? kLeaf : children <= 4 ? kNode4 : children <= 16 ? kNode16 : children <= 48 ? kNode48 : kNode256;
 		}
 
-		// ---- helpers ----
+		// words[lo, hi): sorted, sharing their first `depth` bytes
+		Node* build(const std::vector<std::string>& words, std::size_t lo, std::size_t hi, std::size_t depth) {
+			const std::string& first = words[lo];
+			const std::string& last  = words[hi - 1];
+			std::size_t end = depth;                 // the common prefix of a sorted range is the one of its ends
+			while (end < first.size() && end < last.size() && first[end] == last[end]) ++end;
 
-		// Walk down the trie by 'prefix'; return the node reached (or nullptr if missing).
-		const Trie::Node* prefixNode(const std::string& prefix) const {
-			const Node* cur = root.get();
-			for (char c : prefix) {
-				auto it = cur->next.find(c);
-				if (it == cur->next.end()) return nullptr;
-				cur = it->second.get();
+			bool isEnd = false;
+			for (; lo < hi && words[lo].size() == end; ++lo) isEnd = true;   // the word that is the prefix (+ duplicates)
+			words_ += isEnd;
+
+			std::size_t children = 0;
+			for (std::size_t i = lo; i < hi; ++i)
+				if (i == lo || words[i][end] != words[i - 1][end]) ++children;
+
+			Node* n = make(type_for(children), first.data() + depth, end - depth);
+			n->isEnd = isEnd;
+			for (std::size_t i = lo; i < hi;) {
+				std::size_t j = i + 1;
+				while (j < hi && words[j][end] == words[i][end]) ++j;
+				add_child(n, std::uint8_t(words[i][end]), build(words, i, j, end + 1));
+				i = j;
 			}
-			return cur;
+			return n;
 		}
 
-		// DFS from 'start', accumulating into 'path' and collecting words into 'out'.
-		// If k==0 → unlimited; otherwise stop after collecting k items.
-		void dfsCollect(const Node* start, std::string& path, std::vector<std::string>& out, std::size_t k) const {
-			if (!start) return;
+		// The node holding the words that start with `prefix`, and how many bytes of its path the prefix
+		// covers; nullptr if there is none
+		const Node* locate(std::string_view prefix, std::size_t& covered) const {
+			const Node* n = root_;
+			std::size_t depth = 0;
+			while (n) {
+				std::size_t p = std::min<std::size_t>(n->plen, prefix.size() - depth);
+				if (std::memcmp(path(n), prefix.data() + depth, p) != 0) return nullptr;
+				if (depth + n->plen >= prefix.size()) { covered = p; return n; }
+				depth += n->plen;
+				Node* const* c = find_child(n, std::uint8_t(prefix[depth++]));
+				n = c ? *c : nullptr;
+			}
+			return nullptr;
+		}
 
-			if (start->isEnd) {
-				out.push_back(path);
-				if (k && out.size() >= k) return; // reached quota at this node
+		// DFS below n (whose words start with `word`), collecting at most k words (k == 0: all)
+		static void collect(const Node* n, std::string& word, std::vector<std::string>& out, std::size_t k) {
+			if (n->isEnd) {
+				out.push_back(word);
+				if (k && out.size() >= k) return;
 			}
+			for_each_child(n, [&](std::uint8_t b, const Node* c) {
+				if (k && out.size() >= k) return;
+				std::size_t len = word.size();
+				word.push_back(char(b));
+				word.append(path(c), c->plen);
+				collect(c, word, out, k);
+				word.resize(len);
+			});
+		}
 
-			// Iterate children in lexicographic order for deterministic output
-			std::vector<char> keys;
-			keys.reserve(start->next.size());
-			for (const auto& kv : start->next) keys.push_back(kv.first);
-			std::sort(keys.begin(), keys.end());
+		public:
+		Trie() = default;
+		~Trie() { destroy(root_); }
+
+		Trie(const Trie&)            = delete;
+		Trie& operator=(const Trie&) = delete;
 
-			for (char ch : keys) {
-				path.push_back(ch);
-				const Node* child = start->next.at(ch).get();
-				dfsCollect(child, path, out, k);
-				path.pop_back();
+		Trie(Trie&& other) noexcept : root_(other.root_), words_(other.words_) { other.root_ = nullptr; other.words_ = 0; }
+		Trie& operator=(Trie&& other) noexcept {
+			std::swap(root_, other.root_);
+			std::swap(words_, other.words_);
+			return *this;
+		}
 
-				if (k && out.size() >= k) break; // stop exploring siblings if quota reached
+		std::size_t size() const noexcept { return words_; }
+
+		// Insert a word
+		void insert(std::string_view word) {
+			Node** ref = &root_;
+			std::size_t depth = 0;
+
+			for (;;) {
+				Node* n = *ref;
+				if (!n) {
+					Node* leaf = make(kLeaf, word.data() + depth, word.size() - depth);
+					leaf->isEnd = true;
+					*ref = leaf;
+					++words_;
+					return;
+				}
+
+				std::size_t p = 0, rest = word.size() - depth;
+				while (p < n->plen && p < rest && path(n)[p] == word[depth + p]) ++p;
+
+				if (p < n->plen) {
+					// The word leaves the compressed path: a Node4 takes over the common part
+					Node* split = make(kNode4, path(n), p);
+					std::uint8_t b = std::uint8_t(path(n)[p]);
+					std::memmove(path(n), path(n) + p + 1, n->plen - p - 1);
+					n->plen -= p + 1;
+					add_child(split, b, n);
+					if (p == rest) {
+						split->isEnd = true;
+					} else {
+						Node* leaf = make(kLeaf, word.data() + depth + p + 1, rest - p - 1);
+						leaf->isEnd = true;
+						add_child(split, std::uint8_t(word[depth + p]), leaf);
+					}
+					*ref = split;
+					++words_;
+					return;
+				}
+
+				depth += n->plen;
+				if (depth == word.size()) {
+					words_ += !n->isEnd;
+					n->isEnd = true;
+					return;
+				}
+
+				std::uint8_t b = std::uint8_t(word[depth]);
+				if (Node** c = find_child(n, b)) {
+					ref = c;
+					++depth;
+					continue;
+				}
+
+				if (n->count == kFanout[n->type]) *ref = n = grow(n);
+				Node* leaf = make(kLeaf, word.data() + depth + 1, word.size() - depth - 1);
+				leaf->isEnd = true;
+				add_child(n, b, leaf);
+				++words_;
+				return;
 			}
 		}
+
+		// Bulk load: every node is allocated once, at its final size. On an empty trie `words` must be
+		// sorted (duplicates allowed); a trie that has words already takes them one by one.
+		void insert_sorted(const std::vector<std::string>& words) {
+			if (words.empty()) return;
+			if (root_) {
+				for (const auto& w : words) insert(w);
+				return;
+			}
+			if (!std::is_sorted(words.begin(), words.end()))
+				throw std::invalid_argument("Trie::insert_sorted: input not sorted");
+			root_ = build(words, 0, words.size(), 0);
+		}
+
+		// Search exact word
+		bool search(std::string_view word) const {
+			const Node* n = root_;
+			std::size_t depth = 0;
+			while (n) {
+				if (word.size() - depth < n->plen || std::memcmp(path(n), word.data() + depth, n->plen) != 0)
+					return false;
+				depth += n->plen;
+				if (depth == word.size()) return n->isEnd;
+				Node* const* c = find_child(n, std::uint8_t(word[depth++]));
+				n = c ? *c : nullptr;
+			}
+			return false;
+		}
+
+		// Check prefix
+		bool startsWith(std::string_view prefix) const {
+			std::size_t covered;
+			return prefix.empty() || locate(prefix, covered) != nullptr;
+		}
+
+		// Return up to `k` suggestions for the given prefix, in byte order.
+		// If k == 0 → return all suggestions.
+		std::vector<std::string> autoSuggest(std::string_view prefix, std::size_t k) const {
+			std::vector<std::string> out;
+			std::size_t covered = 0;
+			const Node* start = locate(prefix, covered);
+			if (!start) return out;
+
+			std::string word(prefix);              // complete the prefix to the end of the node's path
+			word.append(path(start) + covered, start->plen - covered);
+			collect(start, word, out, k);
+			return out;
+		}
 	};
 
 
 
 
 
-	template<typename T, class Compare = std::less<T>>
+	// 4-ary heap: the four children of a node sit side by side, the best of them is found with three
+	// comparisons whose results are added rather than branched on, and the tree is half as deep as a
+	// binary one. push() hands out a handle that stays with the value while it is in the queue, so the
+	// value can be changed (update) or removed (erase) in O(log n) instead of being left behind as a
+	// stale entry. A handle is valid until its value is popped or erased; its number may then be reused.
+	// Handles = false drops the bookkeeping (push() returns nothing) for plain push/pop use.
+	template<typename T, class Compare = std::less<T>, bool Handles = true>
 		class PriorityQueue {
-			std::vector<T> data_;
-			Compare        comp_;  // for max-heap: comp_(a,b) == (a < b)
+			public:
+			struct Handle {
+				std::uint32_t id;
+				bool operator==(Handle o) const noexcept { return id == o.id; }
+				bool operator!=(Handle o) const noexcept { return id != o.id; }
+			};
+
+			private:
+			static constexpr std::size_t   kArity = 4;
+			static constexpr std::uint32_t npos   = UINT32_MAX;
+
+			std::vector<T>             data_;
+			std::vector<std::uint32_t> ids_;     // ids_[i]: handle of data_[i]
+			std::vector<std::uint32_t> where_;   // where_[id]: position in data_, npos when free
+			std::vector<std::uint32_t> free_;    // ids to hand out again
+			Compare                    comp_;    // for max-heap: comp_(a,b) == (a < b)
+
+			void place(std::size_t i, T&& v, std::uint32_t id) {
+				data_[i] = std::move(v);
+				if constexpr (Handles) {
+					ids_[i] = id;
+					where_[id] = std::uint32_t(i);
+				}
+			}
+			void move_to(std::size_t to, std::size_t from) {
+				place(to, std::move(data_[from]), Handles ? ids_[from] : 0);
+			}
+
+			// Highest child of i, or npos if it is a leaf
+			std::size_t best_child(std::size_t i) const {
+				const std::size_t first = kArity * i + 1, size = data_.size();
+				if (first >= size) return npos;
+				if (first + kArity <= size) {
+					std::size_t a = first + comp_(data_[first], data_[first + 1]);
+					std::size_t b = first + 2 + comp_(data_[first + 2], data_[first + 3]);
+					return comp_(data_[a], data_[b]) ? b : a;
+				}
+				std::size_t best = first;
+				for (std::size_t c = first + 1; c < size; ++c)
+					if (comp_(data_[best], data_[c])) best = c;
+				return best;
+			}
 
-			void sift_up(std::size_t i) {
+			// The value moves towards the root while it outranks the parent: the hole goes up, the value
+			// is written once
+			void sift_up(std::size_t i, T&& v, std::uint32_t id) {
 				while (i > 0) {
-					std::size_t p = (i - 1) / 2;
-					if (!comp_(data_[p], data_[i])) break; // parent >= child
-					std::swap(data_[p], data_[i]);
+					std::size_t p = (i - 1) / kArity;
+					if (!comp_(data_[p], v)) break; // parent >= child
+					move_to(i, p);
 					i = p;
 				}
+				place(i, std::move(v), id);
 			}
-			void sift_down(std::size_t i) {
-				const std::size_t n = data_.size();
-				for (;;) {
-					std::size_t best = i, l = 2*i + 1, r = l + 1;
-					if (l < n && comp_(data_[best], data_[l])) best = l;
-					if (r < n && comp_(data_[best], data_[r])) best = r;
-					if (best == i) break;
-					std::swap(data_[i], data_[best]);
-					i = best;
+			void sift_down(std::size_t i, T&& v, std::uint32_t id) {
+				for (std::size_t best; (best = best_child(i)) != npos && comp_(v, data_[best]); i = best)
+					move_to(i, best);
+				place(i, std::move(v), id);
+			}
+			void sift_up(std::size_t i)   { T v = std::move(data_[i]); sift_up(i, std::move(v), Handles ? ids_[i] : 0); }
+			void sift_down(std::size_t i) { T v = std::move(data_[i]); sift_down(i, std::move(v), Handles ? ids_[i] : 0); }
+
+			std::uint32_t new_id() {
+				if (!free_.empty()) {
+					std::uint32_t id = free_.back();
+					free_.pop_back();
+					return id;
 				}
+				if (where_.size() == npos) throw std::length_error("PriorityQueue: too many values");
+				where_.push_back(npos);
+				return std::uint32_t(where_.size() - 1);
+			}
+			std::size_t position(Handle h) const {
+				if (!contains(h)) throw std::invalid_argument("PriorityQueue: stale handle");
+				return where_[h.id];
+			}
+
+			// Take the value at i out. The hole sinks to a leaf along the best children (no comparisons
+			// against a filler on the way), then the last value fills it and sifts up, mostly not far.
+			T remove_at(std::size_t i) {
+				T value = std::move(data_[i]);
+				std::uint32_t last_id = 0;
+				if constexpr (Handles) {
+					where_[ids_[i]] = npos;
+					free_.push_back(ids_[i]);
+					last_id = ids_.back();
+					ids_.pop_back();
+				}
+				T last = std::move(data_.back());
+				data_.pop_back();
+				if (i == data_.size()) return value;
+
+				for (std::size_t best; (best = best_child(i)) != npos; i = best)
+					move_to(i, best);
+				sift_up(i, std::move(last), last_id);
+				return value;
 			}
 
 			public:
 			PriorityQueue() = default;
+			explicit PriorityQueue(const Compare& comp) : comp_(comp) {}
 
 			bool        empty() const noexcept { return data_.empty(); }
 			std::size_t size()  const noexcept { return data_.size(); }
 
+			void reserve(std::size_t n) {
+				data_.reserve(n);
+				if constexpr (Handles) {
+					ids_.reserve(n);
+					where_.reserve(n);
+				}
+			}
+			void clear() noexcept {
+				data_.clear();
+				ids_.clear();
+				where_.clear();
+				free_.clear();
+			}
+
 			const T& top() const {
 				if (empty()) throw std::underflow_error("PriorityQueue::top on empty");
 				return data_.front();
 			}
 
 			template<class U>
-				void push(U&& v) {
-					data_.emplace_back(std::forward<U>(v));   // constructs T in-place
-					sift_up(data_.size() - 1);
+				auto push(U&& v) {
+					return emplace(std::forward<U>(v));
 				}
 
-
 			template<class... Args>
-				void emplace(Args&&... args) {
-					data_.emplace_back(std::forward<Args>(args)...);
-					sift_up(data_.size() - 1);
+				auto emplace(Args&&... args) {
+					if constexpr (Handles) {
+						std::uint32_t id = new_id();
+						try {
+							ids_.push_back(id);
+							data_.emplace_back(std::forward<Args>(args)...);   // constructs T in-place
+						} catch (...) {
+							if (ids_.size() > data_.size()) ids_.pop_back();
+							free_.push_back(id);
+							throw;
+						}
+						sift_up(data_.size() - 1);
+						return Handle{ id };
+					} else {
+						data_.emplace_back(std::forward<Args>(args)...);
+						sift_up(data_.size() - 1);
+					}
 				}
 
 			void pop() {
 				if (empty()) throw std::underflow_error("PriorityQueue::pop on empty");
-				std::swap(data_.front(), data_.back());
-				data_.pop_back();
-				if (!empty()) sift_down(0);
+				remove_at(0);
+			}
+
+			// Add a range of values at once: appended unordered, then Floyd's bottom-up construction over the
+			// whole heap, O(size) instead of O(k log size) for k pushes (unless k is small next to size).
+			// Returns their handles in range order.
+			template<class It>
+				auto heapify(It first, It last) {
+					std::vector<Handle> handles;
+					if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>)
+						reserve(data_.size() + std::distance(first, last));
+
+					const std::size_t before = data_.size();
+					try {
+						for (; first != last; ++first) {
+							T value(*first);
+							if constexpr (Handles) {
+								std::uint32_t id = new_id();
+								try {
+									ids_.push_back(id);
+									data_.push_back(std::move(value));
+								} catch (...) {
+									if (ids_.size() > data_.size()) ids_.pop_back();
+									free_.push_back(id);
+									throw;
+								}
+								where_[id] = std::uint32_t(data_.size() - 1);
+								handles.push_back({ id });
+							} else {
+								data_.push_back(std::move(value));
+							}
+						}
+					} catch (...) {
+						for (std::size_t i = before; i < data_.size(); ++i) sift_up(i);
+						throw;
+					}
+
+					const std::size_t added = data_.size() - before;
+					if (added < before / 8) {                    // a few into a big heap: pushing is cheaper
+						for (std::size_t i = before; i < data_.size(); ++i) sift_up(i);
+					} else if (data_.size() > 1) {
+						for (std::size_t i = (data_.size() - 2) / kArity + 1; i-- > 0;) sift_down(i);
+					}
+					if constexpr (Handles) return handles;
+				}
+
+			Handle top_handle() const {
+				static_assert(Handles, "PriorityQueue without handles");
+				if (empty()) throw std::underflow_error("PriorityQueue::top_handle on empty");
+				return { ids_.front() };
+			}
+
+			bool contains(Handle h) const noexcept { return h.id < where_.size() && where_[h.id] != npos; }
+
+			const T& value(Handle h) const { return data_[position(h)]; }
+
+			// Replace the value behind h, moving it up or down as its new priority requires
+			template<class U>
+				void update(Handle h, U&& v) {
+					static_assert(Handles, "PriorityQueue without handles");
+					std::size_t i = position(h);
+					T value(std::forward<U>(v));
+					if (i > 0 && comp_(data_[(i - 1) / kArity], value)) sift_up(i, std::move(value), h.id);
+					else sift_down(i, std::move(value), h.id);
+				}
+
+			// Remove the value behind h and return it
+			T erase(Handle h) {
+				static_assert(Handles, "PriorityQueue without handles");
+				return remove_at(position(h));
 			}
 		};
 
@@ -890,4 +1684,540 @@ namespace dsa
 		};
 	}
 
+
+	// Graphs with tens of millions of edges: compressed sparse row (CSR) storage built in parallel, and
+	// parallel traversals on a small work-stealing thread pool. Vertices are 0 .. n-1.
+	namespace csr_graph {
+
+		using Vertex = std::uint32_t;
+		using Weight = std::uint32_t;
+
+		constexpr std::uint32_t kUnreached = UINT32_MAX;     // bfs() depth of a vertex it did not reach
+		constexpr std::uint64_t kInfinity  = UINT64_MAX;     // sssp() distance of a vertex it did not reach
+
+		struct Edge {
+			Vertex src;
+			Vertex dst;
+			Weight weight = 1;
+		};
+
+		// Runs parallel loops on a fixed set of threads, the calling thread being worker 0. The chunks of a
+		// loop are dealt out in equal slices, one per worker; a worker takes chunks from the front of its
+		// slice and, once it is empty, steals the back half of the fullest other slice. A slice is one
+		// atomic word (first and end chunk), so taking and stealing are a compare-and-swap each.
+		// parallel_for() must not be nested and its body must not throw.
+		class WorkPool {
+			struct alignas(64) Slice {
+				std::atomic<std::uint64_t> range{0};         // chunks [low half, high half)
+			};
+
+			std::vector<std::thread>   threads_;
+			std::unique_ptr<Slice[]>   slices_;
+			unsigned                   workers_;
+
+			std::mutex                 mu_;
+			std::condition_variable    wake_, done_;
+			std::uint64_t              generation_ = 0;    // bumped for every loop
+			unsigned                   pending_ = 0;       // threads still in the current loop
+			bool                       stop_ = false;
+
+			void (*fn_)(void*, std::size_t, std::size_t, unsigned) = nullptr;
+			void*                      ctx_ = nullptr;
+			std::size_t                n_ = 0, grain_ = 1;
+
+			static std::uint64_t pack(std::uint64_t first, std::uint64_t end) { return first | (end << 32); }
+
+			bool take(unsigned w, std::uint64_t& chunk) {
+				auto& range = slices_[w].range;
+				std::uint64_t cur = range.load(std::memory_order_relaxed);
+				for (;;) {
+					std::uint64_t first = cur & 0xFFFFFFFF, end = cur >> 32;
+					if (first >= end) return false;
+					if (range.compare_exchange_weak(cur, pack(first + 1, end), std::memory_order_acq_rel)) {
+						chunk = first;
+						return true;
+					}
+				}
+			}
+
+			bool steal(unsigned w) {
+				for (;;) {
+					unsigned victim = w;
+					std::uint64_t most = 0;
+					for (unsigned i = 0; i < workers_; ++i) {
+						std::uint64_t cur = slices_[i].range.load(std::memory_order_relaxed);
+						std::uint64_t first = cur & 0xFFFFFFFF, end = cur >> 32;
+						if (i != w && end > first && end - first > most) { most = end - first; victim = i; }
+					}
+					if (most == 0) return false;
+
+					auto& range = slices_[victim].range;
+					std::uint64_t cur = range.load(std::memory_order_relaxed);
+					std::uint64_t first = cur & 0xFFFFFFFF, end = cur >> 32;
+					if (first >= end) continue;
+					std::uint64_t mid = first + (end - first) / 2;     // one chunk left: the thief takes it
+					if (range.compare_exchange_strong(cur, pack(first, mid), std::memory_order_acq_rel)) {
+						slices_[w].range.store(pack(mid, end), std::memory_order_release);
+						return true;
+					}
+				}
+			}
+
+			void run(unsigned w) {
+				std::uint64_t chunk;
+				do {
+					while (take(w, chunk)) {
+						std::size_t first = chunk * grain_;
+						fn_(ctx_, first, std::min(n_, first + grain_), w);
+					}
+				} while (steal(w));
+			}
+
+			void loop(unsigned w) {
+				std::uint64_t seen = 0;
+				for (;;) {
+					{
+						std::unique_lock<std::mutex> lock(mu_);
+						wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+						if (stop_) return;
+						seen = generation_;
+					}
+					run(w);
+					std::lock_guard<std::mutex> lock(mu_);
+					if (--pending_ == 0) done_.notify_one();
+				}
+			}
+
+			public:
+			// threads: 0 = one per CPU
+			explicit WorkPool(unsigned threads = 0)
+				: workers_(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {
+				slices_.reset(new Slice[workers_]);
+				for (unsigned w = 1; w < workers_; ++w) threads_.emplace_back([this, w] { loop(w); });
+			}
+			~WorkPool() {
+				{
+					std::lock_guard<std::mutex> lock(mu_);
+					stop_ = true;
+				}
+				wake_.notify_all();
+				for (auto& t : threads_) t.join();
+			}
+
+			WorkPool(const WorkPool&)            = delete;
+			WorkPool& operator=(const WorkPool&) = delete;
+
+			unsigned size() const noexcept { return workers_; }
+
+			// f(first, end, worker) for the chunks of `grain` indices that make up [0, n); worker < size()
+			template<class F>
+				void parallel_for(std::size_t n, std::size_t grain, F&& f) {
+					if (n == 0) return;
+					grain = std::max<std::size_t>(grain, (n >> 32) + 1);      // chunk numbers fit a half word
+					const std::size_t chunks = (n + grain - 1) / grain;
+					if (workers_ == 1 || chunks == 1) {
+						f(std::size_t(0), n, 0u);
+						return;
+					}
+
+					using Body = std::remove_reference_t<F>;
+					fn_ = [](void* ctx, std::size_t first, std::size_t end, unsigned w) { (*static_cast<Body*>(ctx))(first, end, w); };
+					ctx_ = const_cast<void*>(static_cast<const void*>(&f));
+					n_ = n;
+					grain_ = grain;
+					for (unsigned w = 0; w < workers_; ++w)
+						slices_[w].range.store(pack(chunks * w / workers_, chunks * (w + 1) / workers_), std::memory_order_relaxed);
+
+					{
+						std::lock_guard<std::mutex> lock(mu_);
+						pending_ = workers_ - 1;
+						++generation_;
+					}
+					wake_.notify_all();
+					run(0);
+					std::unique_lock<std::mutex> lock(mu_);
+					done_.wait(lock, [&] { return pending_ == 0; });
+				}
+		};
+
+
+		// The out-edges of v are targets[offsets[v] .. offsets[v + 1]), in edge list order, with their
+		// weights at the same positions. A directed graph also keeps its in-edges that way (bottom-up BFS
+		// walks them); an undirected one stores every edge in both directions.
+		class Graph {
+			struct Csr {
+				std::vector<std::uint64_t> offsets;
+				std::vector<Vertex>        targets;
+				std::vector<Weight>        weights;
+			};
+
+			Vertex n_ = 0;
+			bool   directed_;
+			Csr    out_;
+			Csr    in_;
+
+			// offsets = exclusive prefix sum of counts: per-block sums in parallel, then the block starts
+			static std::uint64_t prefix_sum(const std::vector<std::uint64_t>& counts, std::vector<std::uint64_t>& offsets, WorkPool& pool) {
+				const std::size_t n = counts.size(), blocks = std::min<std::size_t>(n, pool.size() * 4);
+				std::vector<std::uint64_t> start(blocks + 1, 0);
+				pool.parallel_for(blocks, 1, [&](std::size_t first, std::size_t end, unsigned) {
+					for (std::size_t b = first; b < end; ++b)
+						for (std::size_t i = n * b / blocks; i < n * (b + 1) / blocks; ++i) start[b + 1] += counts[i];
+				});
+				for (std::size_t b = 0; b < blocks; ++b) start[b + 1] += start[b];
+				offsets.resize(n + 1);
+				pool.parallel_for(blocks, 1, [&](std::size_t first, std::size_t end, unsigned) {
+					for (std::size_t b = first; b < end; ++b) {
+						std::uint64_t sum = start[b];
+						for (std::size_t i = n * b / blocks; i < n * (b + 1) / blocks; ++i) {
+							offsets[i] = sum;
+							sum += counts[i];
+						}
+					}
+				});
+				offsets[n] = start[blocks];
+				return start[blocks];
+			}
+
+			// Counting sort of the edges by source (by destination if `reverse`, by both ends if `both`), in two
+			// passes so that no counter is shared: the edge list is cut into blocks that deal their arcs out to
+			// vertex ranges, then every range counts and places its own arcs. Both passes are stable, so a
+			// list keeps the order of the edge list.
+			static void build(Csr& c, Vertex n, const std::vector<Edge>& edges, bool reverse, bool both, WorkPool& pool) {
+				struct Arc { Vertex from, to; Weight weight; };
+
+				const std::size_t m = edges.size(), blocks = std::min<std::size_t>(m ? m : 1, pool.size() * 4);
+				unsigned shift = 0;
+				while ((std::uint64_t(n) >> shift) > 1024) ++shift;
+				const std::size_t ranges = n ? ((n - 1) >> shift) + 1 : 0;
+
+				auto each = [&](std::size_t i, auto&& arc) {
+					const Edge& e = edges[i];
+					if (reverse) arc(e.dst, e.src, e.weight);
+					else arc(e.src, e.dst, e.weight);
+					if (both) arc(e.dst, e.src, e.weight);
+				};
+
+				// next[b * ranges + r]: where block b puts its next arc of range r
+				std::vector<std::uint64_t> next(blocks * ranges, 0);
+				pool.parallel_for(blocks, 1, [&](std::size_t first, std::size_t end, unsigned) {
+					for (std::size_t b = first; b < end; ++b)
+						for (std::size_t i = m * b / blocks; i < m * (b + 1) / blocks; ++i)
+							each(i, [&](Vertex from, Vertex, Weight) { ++next[b * ranges + (from >> shift)]; });
+				});
+				std::vector<std::uint64_t> rangeStart(ranges + 1, 0);
+				for (std::size_t r = 0; r < ranges; ++r) {
+					rangeStart[r + 1] = rangeStart[r];
+					for (std::size_t b = 0; b < blocks; ++b) {
+						std::uint64_t count = next[b * ranges + r];
+						next[b * ranges + r] = rangeStart[r + 1];
+						rangeStart[r + 1] += count;
+					}
+				}
+
+				std::unique_ptr<Arc[]> arcs(new Arc[rangeStart[ranges]]);
+				pool.parallel_for(blocks, 1, [&](std::size_t first, std::size_t end, unsigned) {
+					for (std::size_t b = first; b < end; ++b)
+						for (std::size_t i = m * b / blocks; i < m * (b + 1) / blocks; ++i)
+							each(i, [&](Vertex from, Vertex to, Weight w) { arcs[next[b * ranges + (from >> shift)]++] = { from, to, w }; });
+				});
+
+				std::vector<std::uint64_t> degree(n, 0);
+				pool.parallel_for(ranges, 1, [&](std::size_t first, std::size_t end, unsigned) {
+					for (std::uint64_t i = rangeStart[first]; i < rangeStart[end]; ++i) ++degree[arcs[i].from];
+				});
+				prefix_sum(degree, c.offsets, pool);
+				c.targets.resize(rangeStart[ranges]);
+				c.weights.resize(rangeStart[ranges]);
+				pool.parallel_for(ranges, 1, [&](std::size_t first, std::size_t end, unsigned) {
+					const Vertex low = Vertex(first << shift), high = Vertex(std::min<std::uint64_t>(n, std::uint64_t(end) << shift));
+					std::copy(c.offsets.begin() + low, c.offsets.begin() + high, degree.begin() + low);     // next position
+					for (std::uint64_t i = rangeStart[first]; i < rangeStart[end]; ++i) {
+						std::uint64_t pos = degree[arcs[i].from]++;
+						c.targets[pos] = arcs[i].to;
+						c.weights[pos] = arcs[i].weight;
+					}
+				});
+			}
+
+			public:
+			// Neighbour list of one vertex
+			struct Range {
+				const Vertex* first;
+				const Vertex* last;
+				const Vertex* begin() const { return first; }
+				const Vertex* end()   const { return last; }
+				std::size_t   size()  const { return last - first; }
+			};
+
+			// Edges with src or dst >= n are not allowed
+			Graph(const std::vector<Edge>& edges, Vertex n, bool directed, WorkPool& pool) : n_(n), directed_(directed) {
+				build(out_, n, edges, false, !directed, pool);
+				if (directed) build(in_, n, edges, true, false, pool);
+			}
+
+			Vertex        vertices() const { return n_; }
+			std::uint64_t arcs()     const { return out_.targets.size(); }    // stored edges (2 per undirected edge)
+			bool          directed() const { return directed_; }
+
+			std::uint64_t out_degree(Vertex v) const { return out_.offsets[v + 1] - out_.offsets[v]; }
+			Range out(Vertex v) const {
+				return { out_.targets.data() + out_.offsets[v], out_.targets.data() + out_.offsets[v + 1] };
+			}
+			const Weight* out_weights(Vertex v) const { return out_.weights.data() + out_.offsets[v]; }
+			Range in(Vertex v) const {
+				const Csr& c = directed_ ? in_ : out_;
+				return { c.targets.data() + c.offsets[v], c.targets.data() + c.offsets[v + 1] };
+			}
+		};
+
+
+		namespace detail {
+			inline void gather(std::vector<std::vector<Vertex>>& parts, std::vector<Vertex>& out) {
+				std::size_t total = 0;
+				for (auto& p : parts) total += p.size();
+				out.clear();
+				out.reserve(total);
+				for (auto& p : parts) {
+					out.insert(out.end(), p.begin(), p.end());
+					p.clear();
+				}
+			}
+		}
+
+		// Hops from src along out-edges (kUnreached: not reachable). Direction-optimizing: levels are
+		// expanded top-down (frontier vertices claim unvisited neighbours) while the frontier is small, and
+		// bottom-up (every unvisited vertex looks for a parent in the frontier bitmap, stopping at the
+		// first) once the frontier's edges outnumber 1/15 of the unexplored ones, until it shrinks below
+		// n/18 vertices again.
+		inline std::vector<std::uint32_t> bfs(const Graph& g, Vertex src, WorkPool& pool) {
+			constexpr std::uint64_t alpha = 15, beta = 18;
+			const Vertex n = g.vertices();
+			const std::size_t words = (std::size_t(n) + 63) / 64;
+			std::vector<std::uint32_t> depth(n, kUnreached);
+			if (src >= n) return depth;
+
+			std::vector<Vertex> frontier{src};
+			std::vector<std::vector<Vertex>> next(pool.size());
+			std::vector<std::uint64_t> perWorker(pool.size());
+			std::vector<std::uint64_t> frontBits, nextBits;
+			std::uint64_t unexplored = g.arcs(), scout = g.out_degree(src);
+			std::uint32_t level = 0;
+			depth[src] = 0;
+
+			auto sum = [&] {
+				std::uint64_t s = 0;
+				for (auto& x : perWorker) { s += x; x = 0; }
+				return s;
+			};
+
+			while (!frontier.empty()) {
+				if (scout > unexplored / alpha) {
+					frontBits.assign(words, 0);
+					nextBits.assign(words, 0);
+					for (Vertex v : frontier) frontBits[v >> 6] |= 1ULL << (v & 63);
+
+					std::uint64_t awake = frontier.size(), before;
+					do {
+						before = awake;
+						pool.parallel_for(words, 64, [&](std::size_t first, std::size_t end, unsigned w) {
+							std::uint64_t found = 0;
+							for (std::size_t word = first; word < end; ++word) {
+								std::uint64_t bits = 0;
+								const Vertex last = Vertex(std::min<std::size_t>(n, word * 64 + 64));
+								for (Vertex v = Vertex(word * 64); v < last; ++v) {
+									if (depth[v] != kUnreached) continue;
+									for (Vertex u : g.in(v)) {
+										if (frontBits[u >> 6] >> (u & 63) & 1) {
+											depth[v] = level + 1;
+											bits |= 1ULL << (v & 63);
+											++found;
+											break;
+										}
+									}
+								}
+								nextBits[word] = bits;
+							}
+							perWorker[w] += found;
+						});
+						awake = sum();
+						std::swap(frontBits, nextBits);
+						++level;
+					} while (awake >= before || awake > n / beta);
+
+					pool.parallel_for(words, 1024, [&](std::size_t first, std::size_t end, unsigned w) {
+						for (std::size_t word = first; word < end; ++word)
+							for (std::uint64_t bits = frontBits[word]; bits; bits &= bits - 1)
+								next[w].push_back(Vertex(word * 64 + __builtin_ctzll(bits)));
+					});
+					detail::gather(next, frontier);
+					scout = 1;
+				} else {
+					unexplored -= std::min(unexplored, scout);
+					pool.parallel_for(frontier.size(), 256, [&](std::size_t first, std::size_t end, unsigned w) {
+						std::uint64_t edges = 0;
+						for (std::size_t i = first; i < end; ++i) {
+							for (Vertex v : g.out(frontier[i])) {
+								std::uint32_t expected = kUnreached;
+								if (__atomic_load_n(&depth[v], __ATOMIC_RELAXED) == kUnreached &&
+										__atomic_compare_exchange_n(&depth[v], &expected, level + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+									next[w].push_back(v);
+									edges += g.out_degree(v);
+								}
+							}
+						}
+						perWorker[w] += edges;
+					});
+					scout = sum();
+					detail::gather(next, frontier);
+					++level;
+				}
+			}
+			return depth;
+		}
+
+		// Shortest path weights from src (kInfinity: not reachable). Delta-stepping: bucket i holds the
+		// vertices whose tentative distance lies in [i * delta, (i + 1) * delta). The lowest non-empty bucket
+		// is relaxed in parallel, again and again while relaxations refill it, then the next one. Every
+		// worker files improved vertices in buckets of its own; an entry whose vertex has meanwhile been
+		// settled in a lower bucket is skipped. Small delta: little wasted work, many rounds; large delta:
+		// the reverse (Bellman-Ford in the limit). The edge weight scale is a good start.
+		// Only the kWindow buckets from the current one on exist, reused cyclically; entries further out
+		// wait in a per-worker overflow list, moved into the window before it reaches their bucket. Memory
+		// follows the queued entries, not the largest distance over delta.
+		inline std::vector<std::uint64_t> sssp(const Graph& g, Vertex src, Weight delta, WorkPool& pool) {
+			constexpr std::uint64_t kWindow = 1024;
+			const Vertex n = g.vertices();
+			std::vector<std::uint64_t> dist(n, kInfinity);
+			if (src >= n) return dist;
+			delta = std::max<Weight>(delta, 1);
+
+			struct Buckets {
+				std::vector<std::vector<Vertex>> ring = std::vector<std::vector<Vertex>>(kWindow);   // bucket b at b % kWindow
+				std::vector<Vertex>              far;                                                 // bucket >= current + kWindow
+				std::uint64_t                    farMin = UINT64_MAX;                                 // lowest bucket in far
+			};
+			std::vector<Buckets> buckets(pool.size());     // per worker
+			std::vector<Vertex> frontier{src};
+			std::uint64_t current = 0;
+			dist[src] = 0;
+
+			// far entries whose bucket the window [current, current + kWindow) covers go into the ring; those
+			// settled below current meanwhile are dropped
+			auto pullFar = [&] {
+				for (auto& mine : buckets) {
+					if (mine.farMin >= current + kWindow) continue;
+					std::size_t kept = 0;
+					mine.farMin = UINT64_MAX;
+					for (Vertex v : mine.far) {
+						const std::uint64_t b = dist[v] / delta;
+						if (b < current) continue;
+						if (b - current < kWindow) {
+							mine.ring[b % kWindow].push_back(v);
+						} else {
+							mine.far[kept++] = v;
+							mine.farMin = std::min(mine.farMin, b);
+						}
+					}
+					mine.far.resize(kept);
+				}
+			};
+
+			while (!frontier.empty()) {
+				pool.parallel_for(frontier.size(), 64, [&](std::size_t first, std::size_t end, unsigned w) {
+					auto& mine = buckets[w];
+					for (std::size_t i = first; i < end; ++i) {
+						const Vertex u = frontier[i];
+						const std::uint64_t du = __atomic_load_n(&dist[u], __ATOMIC_RELAXED);
+						if (du / delta < current) continue;
+						const Weight* weight = g.out_weights(u);
+						for (Vertex v : g.out(u)) {
+							const std::uint64_t nd = du + *weight++;
+							std::uint64_t old = __atomic_load_n(&dist[v], __ATOMIC_RELAXED);
+							while (nd < old) {
+								if (__atomic_compare_exchange_n(&dist[v], &old, nd, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+									const std::uint64_t b = nd / delta;     // >= current: du is in the current bucket
+									if (b - current < kWindow) {
+										mine.ring[b % kWindow].push_back(v);
+									} else {
+										mine.far.push_back(v);
+										mine.farMin = std::min(mine.farMin, b);
+									}
+									break;
+								}
+							}
+						}
+					}
+				});
+
+				pullFar();
+				std::uint64_t next = UINT64_MAX;
+				for (auto& mine : buckets)
+					for (std::uint64_t b = current; b < current + kWindow && b < next; ++b)
+						if (!mine.ring[b % kWindow].empty()) { next = b; break; }
+
+				if (next == UINT64_MAX) {
+					// window empty, current done: jump to the lowest far bucket above it. farMin only bounds the
+					// buckets the entries had when filed, so every list is sorted through again.
+					for (auto& mine : buckets) {
+						for (Vertex v : mine.far)
+							if (dist[v] / delta > current) next = std::min(next, dist[v] / delta);
+						mine.farMin = 0;
+					}
+					if (next == UINT64_MAX) break;
+					current = next;
+					pullFar();
+				}
+
+				current = next;
+				frontier.clear();
+				for (auto& mine : buckets) {
+					auto& slot = mine.ring[current % kWindow];
+					frontier.insert(frontier.end(), slot.begin(), slot.end());
+					slot.clear();
+				}
+			}
+			return dist;
+		}
+
+		// Weakly connected components: comp[v] is the same vertex for all vertices of one component.
+		// Shiloach-Vishkin: every edge whose ends carry different labels hooks the root of the larger label
+		// under the smaller one, then pointer jumping flattens the trees; repeated until no edge hooks.
+		inline std::vector<Vertex> components(const Graph& g, WorkPool& pool) {
+			const Vertex n = g.vertices();
+			std::vector<Vertex> comp(n);
+			pool.parallel_for(n, 1 << 16, [&](std::size_t first, std::size_t end, unsigned) {
+				for (std::size_t v = first; v < end; ++v) comp[v] = Vertex(v);
+			});
+
+			auto load  = [&](Vertex v) { return __atomic_load_n(&comp[v], __ATOMIC_RELAXED); };
+			auto store = [&](Vertex v, Vertex c) { __atomic_store_n(&comp[v], c, __ATOMIC_RELAXED); };
+
+			for (bool changed = true; changed;) {
+				std::atomic<bool> hooked{false};
+				pool.parallel_for(n, 1024, [&](std::size_t first, std::size_t end, unsigned) {
+					bool any = false;
+					for (Vertex u = Vertex(first); u < end; ++u) {
+						for (Vertex v : g.out(u)) {
+							const Vertex cu = load(u), cv = load(v);
+							if (cu == cv) continue;
+							const Vertex high = std::max(cu, cv), low = std::min(cu, cv);
+							if (load(high) == high) {
+								store(high, low);
+								any = true;
+							}
+						}
+					}
+					if (any) hooked.store(true, std::memory_order_relaxed);
+				});
+				pool.parallel_for(n, 1 << 14, [&](std::size_t first, std::size_t end, unsigned) {
+					for (Vertex v = Vertex(first); v < end; ++v)
+						while (load(v) != load(load(v))) store(v, load(load(v)));
+				});
+				changed = hooked.load(std::memory_order_relaxed);
+			}
+			return comp;
+		}
+	}
+
 }
@@ -49,6 +49,7 @@
 
 #include <iostream>
 #include <vector>
+#include <queue>
 #include <exception>
 #include "tree.h"
 
@@ -121,7 +122,7 @@ void level_order(Node *root) {
 		q.pop();
 		
 		if ( node->left )
-			q.push(node->left)
+			q.push(node->left);
 		if ( node->right )
 			q.push(node->right);
 	}		
@@ -324,32 +325,75 @@ bool Tree::is_bst(Node *node) {
 }
 
 
+void PriorityQueue::place(int idx, int key, int h) {
+
+	v[idx] = key;
+	handle[idx] = h;
+	where[h] = idx;
+}
+
 void PriorityQueue::heapify_up(int idx) {
 
-	if ( idx && (v[idx] > v[parent(idx)]) ){             // max heap binary property violation. child value is greater than parent
-		std::swap(v[idx], v[parent(idx)]);           // swap and call recursively
-		heapify_up(parent(idx));
+	int key = v[idx], h = handle[idx];
+	while ( idx && key > v[parent(idx)] ) {             // max heap property violation. child value is greater than parent
+		place(idx, v[parent(idx)], handle[parent(idx)]); // parent moves down into the hole
+		idx = parent(idx);
 	}
+	place(idx, key, h);
 }
 
 void PriorityQueue::heapify_down(int idx) {
 	
-	unsigned int largest = idx;
-	unsigned int left_idx = left(idx);                            // get right and left node index
-	unsigned int right_idx = right(idx);
+	int key = v[idx], h = handle[idx];
+	int n = size();
 
-	if ( left_idx < size() && v[left_idx] > v[idx] )     // check if left node value is greater than parent node
-		largest = left_idx;
+	for ( ;; ) {
+		int first = child(idx), largest = first;
+		if ( first >= n )
+			break;
 
-	if ( right_idx < size() && v[right_idx] > v[idx] )   // check if right node value is greater than parent node
-		largest = right_idx;
+		for ( int c = first + 1; c < first + 4 && c < n; c++ )   // largest of up to 4 children
+			if ( v[c] > v[largest] )
+				largest = c;
 
-	if ( idx != largest) {                               // Swap, if child node value is greater than parent node, and call recursively
-		std::swap(v[idx], v[largest]);
-		heapify_down(largest);
+		if ( v[largest] <= key )                                  // no child is greater than the key : it stays here
+			break;
+
+		place(idx, v[largest], handle[largest]);
+		idx = largest;
 	}
+	place(idx, key, h);
+}
 
+int PriorityQueue::newHandle() {
 
+	if ( !freeHandles.empty() ) {
+		int h = freeHandles.back();
+		freeHandles.pop_back();
+		return h;
+	}
+	where.push_back(-1);
+	return where.size() - 1;
+}
+
+void PriorityQueue::removeAt(int idx) {
+
+	where[handle[idx]] = -1;
+	freeHandles.push_back(handle[idx]);
+
+	int last = size() - 1;
+	if ( idx != last ) {
+		place(idx, v[last], handle[last]);     // last element fills the hole, then moves whichever way it has to
+		v.pop_back();
+		handle.pop_back();
+		if ( idx && v[idx] > v[parent(idx)] )
+			heapify_up(idx);
+		else
+			heapify_down(idx);
+	} else {
+		v.pop_back();
+		handle.pop_back();
+	}
 }
 
 int PriorityQueue::top() {
@@ -361,27 +405,71 @@ int PriorityQueue::top() {
 	}catch(const out_of_range& ex) {
 		std::cout << ex.what() << std::endl;
 	}
+	return 0;
 }
 
-void PriorityQueue::push(int key) {
+int PriorityQueue::push(int key) {
 
+	int h = newHandle();
 	v.push_back(key);
-	int idx = size() - 1;
-	heapify_up(idx);
+	handle.push_back(h);
+	heapify_up(size() - 1);
+	return h;
 }
 
 void PriorityQueue::pop() {
 	try {
 		if ( size() == 0)
 			throw out_of_range("Vector<X>::pop() : Index is out of range(Heap Underflow)");
-		v[0] = v.back(); // Replace the root of the heap with last element of the vector
-		v.pop_back();
-		heapify_down(0); // call heapify_down on root node
+		removeAt(0);
 	} catch ( const out_of_range& ex) {
 		std::cout << ex.what() << std::endl;
 	}
 }
 
+void PriorityQueue::update(int h, int key) {
+	try {
+		if ( !contains(h) )
+			throw out_of_range("PriorityQueue::update() : no such handle");
+		int idx = where[h], old = v[idx];
+		v[idx] = key;
+		if ( key > old )
+			heapify_up(idx);
+		else
+			heapify_down(idx);
+	} catch ( const out_of_range& ex) {
+		std::cout << ex.what() << std::endl;
+	}
+}
+
+void PriorityQueue::erase(int h) {
+	try {
+		if ( !contains(h) )
+			throw out_of_range("PriorityQueue::erase() : no such handle");
+		removeAt(where[h]);
+	} catch ( const out_of_range& ex) {
+		std::cout << ex.what() << std::endl;
+	}
+}
+
+// Appends the keys unordered, then heapify_down on every node that has children, last one first
+// (Floyd): O(n) against O(n log n) for n push() calls.
+std::vector<int> PriorityQueue::heapify(const std::vector<int>& keys) {
+
+	std::vector<int> handles;
+	for ( int key : keys ) {
+		int h = newHandle();
+		where[h] = size();
+		v.push_back(key);
+		handle.push_back(h);
+		handles.push_back(h);
+	}
+
+	for ( int idx = (int(size()) - 2) / 4; size() > 1 && idx >= 0; idx-- )
+		heapify_down(idx);
+	return handles;
+}
+
 
 void heap_binary_max_impl_test() {
 
@@ -428,6 +516,21 @@ void heap_binary_max_impl_test() {
 	pq.top();	// top operation on an empty heap
 	pq.pop();	// pop operation on an empty heap
 
+	// handles : change or remove a key wherever it sits in the heap
+	std::vector<int> h = pq.heapify({ 7, 20, 1, 13, 9 });
+	int h30 = pq.push(30);
+	pq.update(h[2], 25);		// 1 -> 25
+	pq.update(h30, 8);		// 30 -> 8
+	pq.erase(h[1]);			// 20 goes
+	pq.erase(h[1]);			// already gone
+
+	cout << endl;
+	while ( !pq.empty() ) {
+		cout << pq.top() << " ";	// 25 13 9 8 7
+		pq.pop();
+	}
+	cout << endl;
+
 }
 
 
@@ -61,23 +61,34 @@ class AVL : public Tree {
 };
 
 
+// 4-ary max heap. push() returns a handle for the key, usable with update() and erase() until the key
+// is popped or erased (after that the handle may be given to a new key).
 class PriorityQueue {
 	private:
 		
 		std::vector<int> v;                          // vector to store heap elements
+		std::vector<int> handle;                     // handle[i] : handle of v[i]
+		std::vector<int> where;                      // where[h]  : index of handle h in v, -1 if unused
+		std::vector<int> freeHandles;
 
-		int parent(int idx) { return (idx-1) / 2; }   // don't call this function if idx is root node
-		int left  (int idx) { return (idx*2) + 1; }
-		int right (int idx) { return (idx*2) + 2; }
+		int parent(int idx) { return (idx-1) / 4; }   // don't call this function if idx is root node
+		int child (int idx) { return (idx*4) + 1; }   // first of up to 4 children
+		void place(int idx, int key, int h);
 		void heapify_up(int idx);
 		void heapify_down(int idx);
+		int  newHandle();
+		void removeAt(int idx);
 
 	public:
 		unsigned int size() { return v.size();    }
 		bool empty()        { return size() == 0; }
 		int top();
-		void push(int key);
+		int push(int key);
 		void pop();
+		bool contains(int h) { return h >= 0 && h < (int)where.size() && where[h] != -1; }
+		void update(int h, int key);                 // change the key of h
+		void erase(int h);
+		std::vector<int> heapify(const std::vector<int>& keys);  // add keys in O(n), returns their handles
 };
 
 
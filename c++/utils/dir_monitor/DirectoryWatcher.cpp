@@ -2,12 +2,81 @@
 #include "DirectoryWatcher.hpp"
 
 #include <sys/inotify.h>
+#include <sys/fanotify.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <climits>
 
 #include <iostream>
 #include <cstring>
 #include <chrono>
+#include <vector>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+
+namespace {
+
+// inotify mask bit <-> fanotify mask bit, for the events the watcher understands
+const std::pair<uint32_t, uint64_t> kFanotifyBits[] = {
+	{IN_CREATE,      FAN_CREATE},
+	{IN_DELETE,      FAN_DELETE},
+	{IN_MODIFY,      FAN_MODIFY},
+	{IN_MOVED_FROM,  FAN_MOVED_FROM},
+	{IN_MOVED_TO,    FAN_MOVED_TO},
+	{IN_CLOSE_WRITE, FAN_CLOSE_WRITE},
+	{IN_ATTRIB,      FAN_ATTRIB},
+};
+
+int64_t toNs(const struct timespec& t) {
+	return int64_t(t.tv_sec) * 1000000000 + t.tv_nsec;
+}
+
+int64_t realtimeNs() {
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return toNs(now);
+}
+
+// A file to (re)hash for the index; size and mtime were taken before the content is read.
+struct HashJob {
+	std::string path;
+	std::string key;
+	uint64_t size;
+	int64_t mtimeNs;
+	bool known;              // in the index, with oldHash
+	uint64_t oldHash;
+	size_t ready;            // applyIndex(): the event it belongs to
+	uint64_t hash = 0;
+	bool ok = false;
+};
+
+void hashParallel(std::vector<HashJob>& jobs, unsigned threads) {
+	std::atomic<size_t> next{0};
+	auto work = [&] {
+		for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < jobs.size(); )
+			jobs[i].ok = FileIndex::hashFile(jobs[i].path, jobs[i].hash);
+	};
+
+	threads = std::min<size_t>(threads, jobs.size());
+	if (threads <= 1) {
+		work();
+		return;
+	}
+	std::vector<std::thread> pool;
+	for (unsigned i = 0; i < threads; i++)
+		pool.emplace_back(work);
+	for (auto& t : pool)
+		t.join();
+}
+
+}
 
 uint32_t DirectoryWatcher::defaultMask() {
 	return IN_CREATE | IN_DELETE | IN_MODIFY |
@@ -15,42 +84,153 @@ uint32_t DirectoryWatcher::defaultMask() {
 		IN_CLOSE_WRITE | IN_ATTRIB;
 }
 
-DirectoryWatcher::DirectoryWatcher(const Path& root, uint32_t mask)
+DirectoryWatcher::DirectoryWatcher(const Path& root, uint32_t mask,
+		WatchBackend backend, unsigned scanThreads)
 	: m_root(root),
+	m_backend(backend),
 	m_fd(-1),
+	m_mountFd(-1),
+	m_epollFd(-1),
+	m_timerFd(-1),
+	m_wakeFd(-1),
+	m_poolFd(-1),
 	m_mask(mask),
+	m_scanThreads(scanThreads ? scanThreads : std::max(1u, std::thread::hardware_concurrency())),
 	m_running(false)
 {
 	if (!fs::exists(m_root) || !fs::is_directory(m_root)) {
 		throw std::runtime_error("Root is not directory: " + m_root.string());
 	}
 
-	m_fd = inotify_init1(IN_NONBLOCK);
-	if (m_fd == -1) {
-		throw std::runtime_error(
-				std::string("inotify_init1 failed: ") + std::strerror(errno)
-				);
+	m_rootPath = m_root.string();
+	while (m_rootPath.size() > 1 && m_rootPath.back() == '/')
+		m_rootPath.pop_back();
+
+	if (m_backend == WatchBackend::Fanotify) {
+		initFanotify();
+	} else {
+		m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_fd == -1) {
+			throw std::runtime_error(
+					std::string("inotify_init1 failed: ") + std::strerror(errno)
+					);
+		}
 	}
 
-	addWatchRecursive(m_root);
+	m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+	m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	m_poolFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_epollFd == -1 || m_timerFd == -1 || m_wakeFd == -1 || m_poolFd == -1) {
+		std::string err = std::strerror(errno);
+		for (int fd : {m_fd, m_mountFd, m_epollFd, m_timerFd, m_wakeFd, m_poolFd})
+			if (fd != -1) close(fd);
+		throw std::runtime_error("epoll/timerfd/eventfd setup failed: " + err);
+	}
+
+	for (int fd : {m_fd, m_timerFd, m_wakeFd, m_poolFd}) {
+		epoll_event ev{};
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev);
+	}
+
+	clock_gettime(CLOCK_REALTIME, &m_caughtUp);
+
+	if (m_backend == WatchBackend::Inotify)
+		addWatchRecursive(m_rootPath, m_scanThreads);
+	else
+		internDir(m_rootPath, -1);
 }
 
 DirectoryWatcher::~DirectoryWatcher() {
 	stop();
-	if (m_fd != -1) {
-		for (auto &kv : m_wdToPath)
-			inotify_rm_watch(m_fd, kv.first);
-		close(m_fd);
-		m_fd = -1;
-	}
+	stopWorkers();
+	// closing the inotify fd drops all its watches at once
+	for (int fd : {m_fd, m_mountFd, m_epollFd, m_timerFd, m_wakeFd, m_poolFd})
+		if (fd != -1) close(fd);
 }
 
 void DirectoryWatcher::stop() {
 	m_running = false;
+
+	uint64_t one = 1;
+	if (m_wakeFd != -1)
+		(void)!write(m_wakeFd, &one, sizeof(one));
 }
 
-bool DirectoryWatcher::shouldIgnoreFile(const Path& file) const {
-	std::string name = file.filename().string();
+DirectoryWatcher::Stats DirectoryWatcher::stats() const {
+	return {m_dirIds.size(), m_rawEvents.load(), m_emitted.load(), m_overflows.load(), m_suppressed.load()};
+}
+
+void DirectoryWatcher::setBatchCallback(BatchCB cb, unsigned workers, size_t maxQueued) {
+	stopWorkers();
+
+	m_onBatch = std::move(cb);
+	m_maxQueued = std::max<size_t>(1, maxQueued);
+	for (unsigned i = 0; i < std::max(1u, workers); i++) {
+		m_workers.push_back(std::make_unique<Worker>());
+		Worker& w = *m_workers.back();
+		w.thread = std::thread([this, &w] { workerLoop(w); });
+	}
+}
+
+// Takes everything queued as one batch; after a slow callback the next batch is simply bigger.
+void DirectoryWatcher::workerLoop(Worker& w) {
+	std::unique_lock<std::mutex> lock(w.mu);
+
+	while (true) {
+		w.cv.wait(lock, [&] { return !w.queue.empty() || w.stop; });
+		if (w.queue.empty())
+			break;                           // stopping, everything delivered
+
+		std::vector<Event> batch = std::move(w.queue.front());
+		w.queue.pop_front();
+		for (auto& more : w.queue)
+			std::move(more.begin(), more.end(), std::back_inserter(batch));
+		w.queue.clear();
+		lock.unlock();
+
+		size_t n = batch.size();
+		m_onBatch(batch);
+
+		lock.lock();
+		w.queued -= n;
+		if (w.full && w.queued <= m_maxQueued / 2) {
+			w.full = false;
+			uint64_t one = 1;
+			(void)!write(m_poolFd, &one, sizeof(one));
+		}
+	}
+}
+
+void DirectoryWatcher::stopWorkers() {
+	for (auto& w : m_workers) {
+		std::lock_guard<std::mutex> lock(w->mu);
+		w->stop = true;
+		w->cv.notify_one();
+	}
+	for (auto& w : m_workers)
+		w->thread.join();
+	m_workers.clear();
+}
+
+void DirectoryWatcher::dispatch(std::vector<std::vector<Event>>& perWorker) {
+	for (size_t i = 0; i < perWorker.size(); i++) {
+		if (perWorker[i].empty())
+			continue;
+
+		Worker& w = *m_workers[i];
+		{
+			std::lock_guard<std::mutex> lock(w.mu);
+			w.queued += perWorker[i].size();
+			w.queue.push_back(std::move(perWorker[i]));
+		}
+		w.cv.notify_one();
+	}
+}
+
+bool DirectoryWatcher::shouldIgnoreFile(std::string_view name) const {
 	if (name.empty()) return true;
 
 	if (name[0] == '.') return true;
@@ -63,8 +243,7 @@ bool DirectoryWatcher::shouldIgnoreFile(const Path& file) const {
 	return false;
 }
 
-bool DirectoryWatcher::shouldWatchDir(const Path& dir) const {
-	std::string name = dir.filename().string();
+bool DirectoryWatcher::shouldWatchDir(std::string_view name) const {
 	if (name.empty()) return false;
 
 	if (name == "out") return false;
@@ -73,47 +252,412 @@ bool DirectoryWatcher::shouldWatchDir(const Path& dir) const {
 	return true;
 }
 
-void DirectoryWatcher::addWatch(const Path& dir) {
-	if (!shouldWatchDir(dir)) return;
+DirectoryWatcher::DirId DirectoryWatcher::internDir(const std::string& path, int wd) {
+	auto [it, inserted] = m_dirIds.try_emplace(path, static_cast<DirId>(m_dirs.size()));
+	DirId id = it->second;
+	if (inserted)
+		m_dirs.push_back({path, wd});
+	else
+		m_dirs[id].wd = wd;
+
+	if (wd < 0)
+		return id;
+
+	if (static_cast<size_t>(wd) >= m_wdToDir.size())
+		m_wdToDir.resize(std::max<size_t>(wd + 1, m_wdToDir.size() * 2), NoDir);
+
+	// Same inode under a new path (the directory was moved): the watch now belongs to the new path.
+	DirId old = m_wdToDir[wd];
+	if (old != NoDir && old != id) {
+		auto stale = m_dirIds.find(m_dirs[old].path);
+		if (stale != m_dirIds.end() && stale->second == old)
+			m_dirIds.erase(stale);
+		m_dirs[old].wd = -1;
+	}
+	m_wdToDir[wd] = id;
+	return id;
+}
 
-	int wd = inotify_add_watch(m_fd, dir.c_str(), m_mask);
-	if (wd == -1) {
-		std::cerr << "Failed watch on " << dir << ": "
-			<< std::strerror(errno) << "\n";
-		return;
+// Watches root and every directory below it that shouldWatchDir() accepts (the excluded ones are not
+// descended into). Directories are listed with readdir() by a pool of threads sharing a LIFO queue;
+// inotify_add_watch() is called from the threads too, the tables are filled afterwards on this thread.
+// Watching an already watched directory just returns its wd, so this is also how a rescan restores
+// watches. With changedSince, every entry is stat()ed and the ones changed since then are collected:
+// files by ctime (content, metadata, rename), directories by mtime (entries added / removed).
+void DirectoryWatcher::addWatchRecursive(const std::string& root, unsigned threads,
+		const struct timespec* changedSince, std::vector<Changed>* changed) {
+	struct Found {
+		std::string path;
+		int wd;
+	};
+
+	auto newer = [changedSince](const struct timespec& t) {
+		return t.tv_sec > changedSince->tv_sec ||
+			(t.tv_sec == changedSince->tv_sec && t.tv_nsec >= changedSince->tv_nsec);
+	};
+
+	std::mutex mu;
+	std::condition_variable cv;
+	std::vector<std::string> queue{root};
+	unsigned busy = 0;
+	std::vector<std::vector<Found>> found(threads);
+	std::vector<std::vector<Changed>> changes(threads);
+	size_t failed = 0;
+	std::string firstFailure;
+
+	auto scan = [&](unsigned self) {
+		std::vector<std::string> subdirs;
+		std::unique_lock<std::mutex> lock(mu);
+
+		while (true) {
+			cv.wait(lock, [&] { return !queue.empty() || busy == 0; });
+			if (queue.empty())
+				break;                       // nothing queued, nobody left who could queue more
+
+			std::string dir = std::move(queue.back());
+			queue.pop_back();
+			busy++;
+			lock.unlock();
+
+			// fanotify rescans only list: its mark covers every directory already
+			int wd = (m_backend == WatchBackend::Inotify) ? inotify_add_watch(m_fd, dir.c_str(), m_mask) : -1;
+			int err = errno;
+			bool ok = wd != -1 || m_backend != WatchBackend::Inotify;
+			if (ok) {
+				found[self].push_back({dir, wd});
+
+				if (DIR* d = opendir(dir.c_str())) {
+					struct stat st;
+					if (changedSince && fstat(dirfd(d), &st) == 0 && newer(st.st_mtim))
+						changes[self].push_back({dir, "", true, false, 0, 0});
+
+					while (struct dirent* ent = readdir(d)) {
+						bool isDir = ent->d_type == DT_DIR;
+						bool statted = false;
+						if (ent->d_type == DT_UNKNOWN || (changedSince && !isDir)) {
+							statted = fstatat(dirfd(d), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+							isDir = statted && S_ISDIR(st.st_mode);
+						}
+						if (isDir && shouldWatchDir(ent->d_name))   // also skips "." and ".."
+							subdirs.push_back(dir + "/" + ent->d_name);
+						else if (!isDir && statted && changedSince && newer(st.st_ctim))
+							changes[self].push_back({dir, ent->d_name, false, S_ISREG(st.st_mode) != 0,
+									static_cast<uint64_t>(st.st_size), toNs(st.st_mtim)});
+					}
+					closedir(d);
+				}
+			}
+
+			lock.lock();
+			busy--;
+			if (!ok && failed++ == 0)
+				firstFailure = dir + ": " + std::strerror(err);
+
+			bool wakeOthers = subdirs.size() > 1 || (busy == 0 && queue.empty() && subdirs.empty());
+			for (auto& s : subdirs)
+				queue.push_back(std::move(s));
+			subdirs.clear();
+			if (wakeOthers)
+				cv.notify_all();
+		}
+	};
+
+	if (threads <= 1) {
+		scan(0);
+	} else {
+		std::vector<std::thread> pool;
+		for (unsigned i = 0; i < threads; i++)
+			pool.emplace_back(scan, i);
+		for (auto& t : pool)
+			t.join();
+	}
+
+	for (auto& list : found)
+		for (auto& f : list)
+			internDir(f.path, f.wd);
+
+	if (changed)
+		for (auto& list : changes)
+			std::move(list.begin(), list.end(), std::back_inserter(*changed));
+
+	if (failed > 0) {
+		std::cerr << "Failed watch on " << firstFailure;
+		if (failed > 1)
+			std::cerr << " (and " << failed - 1 << " more)";
+		std::cerr << "\n";
 	}
-	m_wdToPath[wd] = dir;
 }
 
-void DirectoryWatcher::addWatchRecursive(const Path& root) {
-	addWatch(root);
+// The kernel queue overflowed: every event between the last clean drain and now may be lost. Walk the
+// tree again (restoring watches of directories created meanwhile) and report what changed since then:
+// Modify for files, Rescan for directories whose listing changed (that covers deletes and renames,
+// which leave nothing to stat). Unchanged entries produce nothing.
+void DirectoryWatcher::rescan() {
+	m_overflowed = false;
+	m_overflows.fetch_add(1, std::memory_order_relaxed);
+
+	struct timespec since = m_caughtUp, started;
+	since.tv_sec -= 1;                       // timestamps are only as fine as the kernel's coarse clock
+	clock_gettime(CLOCK_REALTIME, &started);
+
+	std::vector<Changed> changed;
+	addWatchRecursive(m_rootPath, m_scanThreads, &since, &changed);
+	m_pendingRename.clear();                 // their MOVED_TO halves may be among the lost events
 
-	for (auto it = fs::recursive_directory_iterator(root);
-			it != fs::recursive_directory_iterator(); ++it) {
-		if (!it->is_directory()) continue;
+	std::cerr << "Event queue overflow: rescanned, " << changed.size() << " changed entries\n";
 
-		Path d = it->path();
-		std::string name = d.filename().string();
+	for (auto& c : changed) {
+		auto it = m_dirIds.find(c.dir);
+		if (it == m_dirIds.end())
+			continue;
+		if (c.name.empty())
+			emitDebounced(FileEventType::Rescan, it->second, "", true);
+		else if (!shouldIgnoreFile(c.name))
+			emitDebounced(FileEventType::Modify, it->second, c.name, c.isDir);
+	}
+
+	m_caughtUp = started;
+}
 
-		if (name == "out") {
-			it.disable_recursion_pending();
+// The catch-up stats every file (a scan with "changed since the epoch"); only those whose size or mtime
+// differ from the index are read, hashes are only compared.
+void DirectoryWatcher::enableIndex(const std::string& indexFile) {
+	m_index = std::make_unique<FileIndex>(indexFile);
+	bool baseline = m_index->created();
+
+	int64_t scanStart = realtimeNs();
+	struct timespec epoch{};
+	std::vector<Changed> entries;
+	addWatchRecursive(m_rootPath, m_scanThreads, &epoch, &entries);
+
+	std::unordered_set<std::string> present;
+	std::vector<HashJob> jobs;
+	for (auto& c : entries) {
+		if (c.name.empty() || !c.regular || shouldIgnoreFile(c.name))
 			continue;
+
+		std::string path = c.dir + "/" + c.name;
+		std::string key = indexKey(path);
+		FileIndex::Entry e;
+		bool known = m_index->find(key, e);
+		if (!known || !FileIndex::sameStat(e, c.size, c.mtimeNs))
+			jobs.push_back({path, key, c.size, c.mtimeNs, known, known ? e.hash : 0, 0});
+		present.insert(std::move(key));
+	}
+	hashParallel(jobs, m_scanThreads);
+
+	// Directories gone since the last run get an id without a watch, only to build their paths.
+	std::unordered_map<std::string, DirId> goneDirs;
+	auto report = [&](FileEventType type, const std::string& path) {
+		size_t slash = path.rfind('/');
+		std::string dir = path.substr(0, slash), name = path.substr(slash + 1);
+
+		auto it = m_dirIds.find(dir);
+		DirId id = it != m_dirIds.end() ? it->second : NoDir;
+		if (id == NoDir) {
+			auto [gone, inserted] = goneDirs.try_emplace(dir, static_cast<DirId>(m_dirs.size()));
+			if (inserted)
+				m_dirs.push_back({dir, -1});
+			id = gone->second;
 		}
+		emitDebounced(type, id, name, false);
+		m_debounce[{id, name}].indexed = true;
+	};
+
+	size_t changed = 0;
+	for (auto& j : jobs) {
+		if (!j.ok)
+			continue;                        // gone or unreadable since the scan: live events follow
+		bool differs = !j.known || j.hash != j.oldHash;
+		m_index->put(j.key, {j.size, j.mtimeNs, j.hash, scanStart});
+		if (differs && !baseline) {
+			report(j.known ? FileEventType::Modify : FileEventType::Create, j.path);
+			changed++;
+		}
+	}
 
-		addWatch(d);
+	std::vector<std::string> gone;
+	m_index->forEach([&](const std::string& key, const FileIndex::Entry&) {
+		if (!present.count(key))
+			gone.push_back(key);
+	});
+	for (auto& key : gone) {
+		m_index->erase(key);
+		if (!baseline) {
+			report(FileEventType::Delete, m_rootPath + "/" + key);
+			changed++;
+		}
 	}
+
+	std::cerr << "Index " << indexFile << ": " << m_index->size() << " files, " << jobs.size() << " hashed, "
+		<< changed << " changed since the last run\n";
+}
+
+std::string DirectoryWatcher::indexKey(const std::string& path) const {
+	if (path.size() <= m_rootPath.size())
+		return {};                           // root itself
+	return path.substr(m_rootPath.size() + 1);
 }
 
 void DirectoryWatcher::removeWatch(int wd) {
-	auto it = m_wdToPath.find(wd);
-	if (it != m_wdToPath.end()) {
-		inotify_rm_watch(m_fd, wd);
-		m_wdToPath.erase(it);
+	if (wd < 0 || static_cast<size_t>(wd) >= m_wdToDir.size() || m_wdToDir[wd] == NoDir)
+		return;
+
+	DirId id = m_wdToDir[wd];
+	inotify_rm_watch(m_fd, wd);
+	m_wdToDir[wd] = NoDir;
+	m_dirs[id].wd = -1;
+
+	auto it = m_dirIds.find(m_dirs[id].path);
+	if (it != m_dirIds.end() && it->second == id)
+		m_dirIds.erase(it);
+}
+
+DirectoryWatcher::Path DirectoryWatcher::fullPath(DirId dir, const std::string& name) const {
+	if (name.empty())
+		return Path(m_dirs[dir].path);
+	return Path(m_dirs[dir].path + "/" + name);
+}
+
+void DirectoryWatcher::initFanotify() {
+	m_fd = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_NONBLOCK | FAN_CLOEXEC,
+			O_RDONLY | O_CLOEXEC);
+	if (m_fd == -1) {
+		throw std::runtime_error(
+				std::string("fanotify_init failed (needs CAP_SYS_ADMIN, kernel >= 5.9): ") +
+				std::strerror(errno));
+	}
+
+	uint64_t fanMask = FAN_ONDIR;
+	for (auto& [in, fan] : kFanotifyBits)
+		if (m_mask & in) fanMask |= fan;
+
+	m_mountFd = open(m_rootPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (m_mountFd == -1 ||
+			fanotify_mark(m_fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, fanMask, AT_FDCWD, m_rootPath.c_str()) == -1) {
+		std::string err = std::strerror(errno);
+		close(m_fd);
+		if (m_mountFd != -1) close(m_mountFd);
+		throw std::runtime_error("fanotify_mark failed on " + m_rootPath + ": " + err);
+	}
+
+	m_canonicalRoot = fs::canonical(m_root).string();
+}
+
+// Directory handle -> DirId of its path below root, NoDir for directories outside root or below an
+// excluded one. Results are cached by handle; the cache is dropped whenever a directory moves or goes.
+DirectoryWatcher::DirId DirectoryWatcher::resolveHandle(const void* fh) {
+	auto* handle = static_cast<const struct file_handle*>(fh);
+	std::string key(static_cast<const char*>(fh), sizeof(struct file_handle) + handle->handle_bytes);
+
+	auto cached = m_handleToDir.find(key);
+	if (cached != m_handleToDir.end())
+		return cached->second;
+
+	DirId id = NoDir;
+	int fd = open_by_handle_at(m_mountFd, const_cast<struct file_handle*>(handle), O_PATH | O_CLOEXEC);
+	if (fd != -1) {
+		char link[32], target[PATH_MAX];
+		std::snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+		ssize_t n = readlink(link, target, sizeof(target));
+		close(fd);
+
+		std::string_view path(target, n > 0 ? n : 0);
+		const std::string& root = m_canonicalRoot;
+		bool below = path == root ||
+			(path.size() > root.size() && path.starts_with(root) && (root == "/" || path[root.size()] == '/'));
+
+		if (below) {
+			// every component under root must be a directory we would have watched
+			std::string_view rest = path.substr(root.size());
+			bool accepted = true;
+			size_t pos = 0;
+			while (accepted && pos < rest.size()) {
+				if (rest[pos] == '/') { pos++; continue; }
+				size_t end = std::min(rest.find('/', pos), rest.size());
+				accepted = shouldWatchDir(rest.substr(pos, end - pos));
+				pos = end;
+			}
+			if (accepted) {
+				// report it under root as given, like the inotify backend does
+				if (rest.starts_with('/'))
+					rest.remove_prefix(1);
+				if (rest.empty())
+					id = internDir(m_rootPath, -1);
+				else
+					id = internDir((m_rootPath == "/" ? "" : m_rootPath) + "/" + std::string(rest), -1);
+			}
+		}
+	}
+
+	if (m_handleToDir.size() >= (1u << 20))
+		m_handleToDir.clear();
+	m_handleToDir.emplace(std::move(key), id);
+	return id;
+}
+
+void DirectoryWatcher::readFanotify() {
+	constexpr size_t BUF_LEN = 64 * 1024;
+	std::vector<char> buf(BUF_LEN);
+
+	while (true) {
+		ssize_t len = read(m_fd, buf.data(), buf.size());
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				std::cerr << "read() failed: " << std::strerror(errno) << "\n";
+				m_running = false;
+			}
+			return;
+		}
+
+		auto* meta = reinterpret_cast<struct fanotify_event_metadata*>(buf.data());
+		for (; FAN_EVENT_OK(meta, len); meta = FAN_EVENT_NEXT(meta, len)) {
+			m_rawEvents.fetch_add(1, std::memory_order_relaxed);
+			if (meta->fd >= 0)
+				close(meta->fd);
+			if (meta->mask & FAN_Q_OVERFLOW) {
+				m_overflowed = true;
+				continue;
+			}
+
+			auto* info = reinterpret_cast<struct fanotify_event_info_fid*>(meta + 1);
+			if (meta->event_len < sizeof(*meta) + sizeof(*info) ||
+					(info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME &&
+					 info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID))
+				continue;
+
+			auto* handle = reinterpret_cast<struct file_handle*>(info->handle);
+			std::string_view name;
+			if (info->hdr.info_type == FAN_EVENT_INFO_TYPE_DFID_NAME)
+				name = reinterpret_cast<const char*>(handle->f_handle + handle->handle_bytes);
+			if (name == ".")
+				name = {};
+
+			bool isDir = meta->mask & FAN_ONDIR;
+			uint32_t mask = isDir ? IN_ISDIR : 0;
+			for (auto& [in, fan] : kFanotifyBits)
+				if (meta->mask & fan) mask |= in;
+
+			// fanotify has no rename cookie: MOVED_FROM and its MOVED_TO come back to back
+			if (meta->mask & FAN_MOVED_FROM)
+				m_fanCookie++;
+
+			DirId dir = resolveHandle(handle);
+			if (isDir && (meta->mask & (FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO)))
+				m_handleToDir.clear();   // cached paths below it may be stale now
+			if (dir == NoDir)
+				continue;
+
+			emitEvent(mask, dir, name, isDir, m_fanCookie);
+		}
 	}
 }
 
 int DirectoryWatcher::strength(FileEventType t) {
 	switch (t) {
+		case FileEventType::Rescan: return 6;
 		case FileEventType::Move: return 5;
 		case FileEventType::Create: return 4;
 		case FileEventType::Delete: return 4;
@@ -128,67 +672,216 @@ FileEventType DirectoryWatcher::mergeStrength(FileEventType a, FileEventType b)
 }
 
 void DirectoryWatcher::emitMerged(const Event &e) {
+	m_emitted.fetch_add(1, std::memory_order_relaxed);
 	if (!onEvent) return;
 	onEvent(e);
 }
 
-void DirectoryWatcher::emitDebounced(const Event& e) {
-	std::string key = e.path.string();
+void DirectoryWatcher::emitDebounced(FileEventType type, DirId dir, std::string_view name, bool isDir,
+		DirId oldDir, const std::string& oldName) {
 	auto now = std::chrono::steady_clock::now();
 
-	auto &entry = m_debounce[key];
+	DebounceKey key{dir, std::string(name)};
+	auto [it, inserted] = m_debounce.try_emplace(key);
+	auto &entry = it->second;
 
-	if (entry.strongest == FileEventType::Unknown) {
-		entry.path = e.path;
-		entry.oldPath = e.oldPath;
-		entry.isDir = e.isDirectory;
-		entry.strongest = e.type;
-		entry.lastUpdate = now;
+	if (inserted) {
+		entry.oldDir = oldDir;
+		entry.oldName = oldName;
+		entry.isDir = isDir;
+		entry.strongest = type;
 	} else {
-		entry.strongest = mergeStrength(entry.strongest, e.type);
-		entry.lastUpdate = now;
+		entry.strongest = mergeStrength(entry.strongest, type);
+		entry.indexed = false;
+		m_deadlines.erase(entry.deadline);
+	}
+
+	// Every update pushes the deadline out: move the entry to its new place in the order.
+	entry.lastUpdate = now;
+	entry.deadline = m_deadlines.emplace(now + debounceWindow, std::move(key));
+}
+
+// Brings the index up to date with the events about to go out and marks the ones that change nothing
+// to drop: Create/Modify/CloseWrite of a file whose content hash is the recorded one. When size and
+// mtime still match (chmod, chown) that is settled without reading the file.
+void DirectoryWatcher::applyIndex(std::vector<Ready>& ready) {
+	int64_t checked = realtimeNs();
+	std::vector<HashJob> jobs;
+
+	for (size_t i = 0; i < ready.size(); i++) {
+		if (ready[i].indexed)
+			continue;
+
+		const Event& e = ready[i].event;
+		std::string key = indexKey(e.path.native());
+		switch (e.type) {
+		case FileEventType::Delete:
+			m_index->erase(key);
+			if (e.isDirectory)
+				m_index->eraseUnder(key);
+			break;
+		case FileEventType::Rescan: {
+			// drop what vanished from the directory; what changed in it comes as Modify
+			size_t children = key.empty() ? 0 : key.size() + 1;
+			std::vector<std::string> gone;
+			m_index->forEachUnder(key, [&](const std::string& k, const FileIndex::Entry&) {
+				if (k.find('/', children) == std::string::npos &&
+						access((m_rootPath + "/" + k).c_str(), F_OK) != 0)
+					gone.push_back(k);
+			});
+			for (auto& k : gone)
+				m_index->erase(k);
+			break;
+		}
+		case FileEventType::Move:
+			m_index->move(indexKey(e.oldPath.native()), key);
+			[[fallthrough]];                 // the file may have been written just before: refresh, never drop
+		case FileEventType::Create:
+		case FileEventType::Modify:
+		case FileEventType::CloseWrite: {
+			if (e.isDirectory)
+				break;
+			// gone again: its Delete or Move (maybe later in this very batch) updates the index
+			struct stat st;
+			if (lstat(e.path.c_str(), &st) != 0)
+				break;
+			if (!S_ISREG(st.st_mode)) {
+				m_index->erase(key);
+				break;
+			}
+			FileIndex::Entry old;
+			bool known = m_index->find(key, old);
+			uint64_t size = st.st_size;
+			int64_t mtime = toNs(st.st_mtim);
+			if (known && FileIndex::sameStat(old, size, mtime))
+				ready[i].drop = e.type != FileEventType::Move;
+			else
+				jobs.push_back({e.path.native(), std::move(key), size, mtime, known, known ? old.hash : 0, i});
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	hashParallel(jobs, m_scanThreads);
+
+	for (auto& j : jobs) {
+		if (!j.ok)
+			continue;
+		m_index->put(j.key, {j.size, j.mtimeNs, j.hash, checked});
+		if (j.known && j.hash == j.oldHash && ready[j.ready].event.type != FileEventType::Move)
+			ready[j.ready].drop = true;
 	}
 }
 
+// Emits the entries whose deadline passed (all of them with force), earliest first; only those are visited.
+// With a batch callback they are grouped per worker (by path hash) and queued in one go; when the worker
+// of the next entry is full, flushing stops there and resumes once it signals m_poolFd; the timer stays
+// disarmed meanwhile, the deadlines it would fire at have passed already.
 void DirectoryWatcher::flushDebounce(bool force) {
-	if (m_debounce.empty()) return;
-
 	auto now = std::chrono::steady_clock::now();
-	std::vector<std::string> toErase;
-
-	for (auto &kv : m_debounce) {
-		auto &entry = kv.second;
-
-		if (force ||
-				now - entry.lastUpdate >= debounceWindow) {
-			Event e;
-			e.type = entry.strongest;
-			e.path = entry.path;
-			e.oldPath = entry.oldPath;
-			e.isDirectory = entry.isDir;
-			e.rawMask = 0;
-
-			emitMerged(e);
-			toErase.push_back(kv.first);
+	bool batched = !m_workers.empty();
+	m_flushBlocked = false;
+
+	std::vector<Ready> ready;
+	std::vector<size_t> taken(m_workers.size(), 0);
+	std::vector<size_t> room(m_workers.size(), SIZE_MAX);
+	if (batched && !force) {
+		for (size_t i = 0; i < m_workers.size(); i++) {
+			std::lock_guard<std::mutex> lock(m_workers[i]->mu);
+			room[i] = m_maxQueued - std::min(m_maxQueued, m_workers[i]->queued);
 		}
 	}
 
-	for (auto &k : toErase)
-		m_debounce.erase(k);
+	while (!m_deadlines.empty() &&
+			(force || m_deadlines.begin()->first <= now)) {
+		const DebounceKey& next = m_deadlines.begin()->second;
+		Path path = fullPath(next.dir, next.name);
+
+		size_t target = 0;
+		if (batched) {
+			target = std::hash<std::string>{}(path.native()) % m_workers.size();
+			if (room[target] == 0) {
+				// it may have drained since we looked; what this flush already took counts as queued
+				Worker& w = *m_workers[target];
+				std::lock_guard<std::mutex> lock(w.mu);
+				size_t queued = w.queued + taken[target];
+				if (queued >= m_maxQueued) {
+					w.full = true;
+					m_flushBlocked = true;
+					break;
+				}
+				room[target] = m_maxQueued - queued;
+			}
+			room[target]--;
+			taken[target]++;
+		}
+
+		auto node = m_debounce.extract(next);
+		m_deadlines.erase(m_deadlines.begin());
+
+		auto &entry = node.mapped();
+		Event e;
+		e.type = entry.strongest;
+		e.path = std::move(path);
+		if (entry.oldDir != NoDir)
+			e.oldPath = fullPath(entry.oldDir, entry.oldName);
+		e.isDirectory = entry.isDir;
+		e.rawMask = 0;
+		ready.push_back({std::move(e), target, entry.indexed, false});
+	}
+
+	if (m_index)
+		applyIndex(ready);
+
+	std::vector<std::vector<Event>> perWorker(m_workers.size());
+	for (auto& r : ready) {
+		if (r.drop) {
+			m_suppressed.fetch_add(1, std::memory_order_relaxed);
+		} else if (batched) {
+			m_emitted.fetch_add(1, std::memory_order_relaxed);
+			perWorker[r.worker].push_back(std::move(r.event));
+		} else {
+			emitMerged(r.event);
+		}
+	}
+
+	dispatch(perWorker);
+}
+
+// Absolute CLOCK_MONOTONIC timer (steady_clock's clock on Linux) at the earliest deadline; disarmed while
+// that deadline has passed but its worker is full (it would fire again at once, over and over).
+void DirectoryWatcher::armDebounceTimer() {
+	auto next = m_deadlines.empty() || m_flushBlocked
+		? std::chrono::steady_clock::time_point{}
+		: m_deadlines.begin()->first;
+	if (next == m_timerArmedFor) return;
+
+	itimerspec spec{};
+	if (!m_deadlines.empty()) {
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch()).count();
+		spec.it_value.tv_sec = ns / 1000000000;
+		spec.it_value.tv_nsec = ns % 1000000000;
+	}
+	timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);   // all zero: disarm
+	m_timerArmedFor = next;
 }
 
 void DirectoryWatcher::emitEvent(uint32_t mask,
-		const Path& fullPath,
+		DirId dir,
+		std::string_view name,
 		bool isDir,
 		uint32_t cookie)
 {
-	if (shouldIgnoreFile(fullPath) && !isDir) {
+	if (shouldIgnoreFile(name) && !isDir) {
 		return;
 	}
 
 	if (mask & IN_MOVED_FROM) {
 		m_pendingRename[cookie] = {
-			fullPath,
+			dir,
+			std::string(name),
 			isDir,
 			std::chrono::steady_clock::now()
 		};
@@ -198,15 +891,9 @@ void DirectoryWatcher::emitEvent(uint32_t mask,
 	if (mask & IN_MOVED_TO) {
 		auto it = m_pendingRename.find(cookie);
 		if (it != m_pendingRename.end()) {
-			Event ev;
-			ev.type = FileEventType::Move;
-			ev.path = fullPath;
-			ev.oldPath = it->second.oldPath;
-			ev.isDirectory = isDir;
-			ev.rawMask = mask;
-
+			MovePending from = std::move(it->second);
 			m_pendingRename.erase(it);
-			emitDebounced(ev);
+			emitDebounced(FileEventType::Move, dir, name, isDir, from.dir, from.name);
 			return;
 		}
 	}
@@ -221,67 +908,116 @@ void DirectoryWatcher::emitEvent(uint32_t mask,
 
 	if (type == FileEventType::Unknown) return;
 
-	Event ev;
-	ev.type = type;
-	ev.path = fullPath;
-	ev.isDirectory = isDir;
-	ev.rawMask = mask;
-
-	emitDebounced(ev);
+	emitDebounced(type, dir, name, isDir);
 }
 
 void DirectoryWatcher::handleEvent(const struct inotify_event* ev) {
-	auto it = m_wdToPath.find(ev->wd);
-	if (it == m_wdToPath.end()) return;
+	if (ev->mask & IN_Q_OVERFLOW) {
+		m_overflowed = true;
+		return;
+	}
+	if (ev->wd < 0 || static_cast<size_t>(ev->wd) >= m_wdToDir.size()) return;
+	DirId dir = m_wdToDir[ev->wd];
+	if (dir == NoDir) return;
 
-	Path dir = it->second;
-	Path full = dir;
-	if (ev->len > 0 && ev->name[0] != '\0')
-		full /= ev->name;
+	std::string_view name;
+	if (ev->len > 0)
+		name = ev->name;                     // NUL padded
 
 	bool isDir = ev->mask & IN_ISDIR;
 
-	if ((ev->mask & IN_CREATE) && isDir) {
-		if (shouldWatchDir(full))
-			addWatch(full);
-	}
+	// New or moved-in directory: watch its whole subtree (mkdir -p creates several levels before we
+	// get here). For a move inside the tree this re-points the existing watches to the new paths.
+	if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && isDir && shouldWatchDir(name))
+		addWatchRecursive(m_dirs[dir].path + "/" + std::string(name), 1);
 
-	if (ev->mask & IN_DELETE_SELF)
+	// IN_IGNORED: the kernel dropped the watch (directory deleted, unmounted, ...)
+	if (ev->mask & (IN_DELETE_SELF | IN_IGNORED))
 		removeWatch(ev->wd);
 
-	emitEvent(ev->mask, full, isDir, ev->cookie);
+	emitEvent(ev->mask, dir, name, isDir, ev->cookie);
 }
 
-void DirectoryWatcher::run() {
-	m_running = true;
+// Drains the inotify (or fanotify) fd until EAGAIN, then answers an overflow seen on the way.
+void DirectoryWatcher::readEvents() {
+	struct timespec drainStart;
+	clock_gettime(CLOCK_REALTIME, &drainStart);
 
-	constexpr size_t BUF_LEN = 4096;
-	std::vector<char> buf(BUF_LEN);
+	if (m_backend == WatchBackend::Fanotify)
+		readFanotify();
+	else
+		readInotify();
 
-	while (m_running) {
-		flushDebounce(false);
+	if (m_overflowed)
+		rescan();
+	else
+		m_caughtUp = drainStart;
+}
+
+void DirectoryWatcher::readInotify() {
+	constexpr size_t BUF_LEN = 64 * 1024;
+	std::vector<char> buf(BUF_LEN);
 
+	while (true) {
 		ssize_t len = read(m_fd, buf.data(), buf.size());
 		if (len < 0) {
-			if (errno == EAGAIN || errno == EWOULDBLOCK) {
-				std::this_thread::sleep_for(std::chrono::milliseconds(50));
-				continue;
-			}
 			if (errno == EINTR)
 				continue;
-
-			std::cerr << "read() failed: " << std::strerror(errno) << "\n";
-			break;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				std::cerr << "read() failed: " << std::strerror(errno) << "\n";
+				m_running = false;
+			}
+			return;
 		}
 
 		size_t off = 0;
 		while (off < (size_t)len) {
 			auto *ev = reinterpret_cast<struct inotify_event*>(buf.data() + off);
+			m_rawEvents.fetch_add(1, std::memory_order_relaxed);
 			handleEvent(ev);
 			off += sizeof(struct inotify_event) + ev->len;
 		}
 	}
+}
+
+void DirectoryWatcher::run() {
+	m_running = true;
+
+	epoll_event events[4];
+
+	while (m_running) {
+		armDebounceTimer();
+
+		int n = epoll_wait(m_epollFd, events, 4, -1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			std::cerr << "epoll_wait() failed: " << std::strerror(errno) << "\n";
+			break;
+		}
+
+		for (int i = 0; i < n; i++) {
+			int fd = events[i].data.fd;
+			uint64_t count;
+
+			if (fd == m_fd) {
+				readEvents();
+			} else if (fd == m_timerFd) {
+				(void)!read(m_timerFd, &count, sizeof(count));
+				m_timerArmedFor = {};
+				flushDebounce(false);
+			} else if (fd == m_poolFd) {
+				// a worker has room again: hand out what expired meanwhile
+				(void)!read(m_poolFd, &count, sizeof(count));
+				flushDebounce(false);
+			} else if (fd == m_wakeFd) {
+				// stop() also counts when it came before run() set m_running
+				(void)!read(m_wakeFd, &count, sizeof(count));
+				m_running = false;
+			}
+		}
+	}
 
 	flushDebounce(true);
+	armDebounceTimer();
 }
-
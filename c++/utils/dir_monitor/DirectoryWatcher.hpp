@@ -1,9 +1,21 @@
 // DirectoryWatcher.hpp
 #pragma once
+#include "FileIndex.hpp"
+
 #include <filesystem>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <atomic>
+#include <chrono>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <cstdint>
 
 namespace fs = std::filesystem;
@@ -14,6 +26,7 @@ enum class FileEventType {
 	Modify,
 	Move,
 	CloseWrite,
+	Rescan,     // directory: events were lost (kernel queue overflow) and its listing changed, re-list it
 	Unknown
 };
 
@@ -25,61 +38,201 @@ struct FileEvent {
 	uint32_t      rawMask;
 };
 
+// Inotify: one watch per directory, added by a parallel scan at startup and as directories appear.
+// Fanotify: one FAN_MARK_FILESYSTEM mark on the filesystem holding root, no per-directory setup at all
+// (kernel >= 5.9 for FAN_REPORT_DFID_NAME, needs CAP_SYS_ADMIN); events outside root are dropped.
+enum class WatchBackend {
+	Inotify,
+	Fanotify
+};
+
 class DirectoryWatcher {
 	public:
 		using Event      = FileEvent;
 		using EventCB    = std::function<void(const Event&)>;
+		using BatchCB    = std::function<void(std::vector<Event>& batch)>;
 		using Path       = fs::path;
 
-		DirectoryWatcher(const Path& root, uint32_t mask = defaultMask());
+		struct Stats {
+			size_t   directories;   // interned (inotify: watched) directories
+			uint64_t rawEvents;     // kernel events read
+			uint64_t emitted;       // merged events passed to the callback
+			uint64_t overflows;     // kernel queue overflows, each answered by a rescan
+			uint64_t suppressed;    // events dropped because the file content did not change (index enabled)
+		};
+
+		// scanThreads: threads for the initial directory scan, 0 = one per CPU.
+		DirectoryWatcher(const Path& root, uint32_t mask = defaultMask(),
+				WatchBackend backend = WatchBackend::Inotify, unsigned scanThreads = 0);
 		~DirectoryWatcher();
 
+		// Blocks in epoll_wait() until kernel events, the next debounce deadline or stop().
 		void run();
+		// Thread-safe: wakes run() through an eventfd.
 		void stop();
+		// Called on the watcher thread for every merged event; a slow callback delays draining the kernel queue.
 		void setCallback(EventCB cb) { onEvent = cb; }
 
+		// Replaces setCallback(): merged events go out in batches on `workers` threads. Events of one path
+		// always go to the same worker, so they arrive in order; different paths run in parallel, so cb
+		// must be thread-safe. At most maxQueued events wait per worker: beyond that the watcher keeps
+		// coalescing in its debounce table (and keeps draining the kernel) until the worker catches up.
+		// Call before run().
+		void setBatchCallback(BatchCB cb, unsigned workers = 1, size_t maxQueued = 4096);
+
+		// Keeps size, mtime and content hash of every file in a memory-mapped index file (created when
+		// missing) and drops Create/Modify/CloseWrite events whose file still has the recorded content.
+		// Enabling it compares the index with the tree: files whose size or mtime differ are rehashed,
+		// Create/Modify/Delete go out for what changed while nobody watched (nothing on a new index, it
+		// is only filled). Hashing runs on the watcher thread, in parallel for many files. Call before run().
+		void enableIndex(const std::string& indexFile);
+
+		Stats stats() const;
+
 		static uint32_t defaultMask();
 
 	private:
+		// Directories are interned once: events carry a compact id + the entry name, the full path
+		// is only put together for events that survive the debounce. Ids are never reused, so an id
+		// still queued in m_debounce keeps its path after the directory is gone.
+		using DirId = uint32_t;
+		static constexpr DirId NoDir = UINT32_MAX;
+
+		struct DirEntry {
+			std::string path;
+			int wd = -1;             // inotify watch, -1: none / removed
+		};
+
 		// hidden implementation (pimpl-like but static)
-		void addWatch(const Path& dir);
-		void addWatchRecursive(const Path& root);
+		// Entry found changed by a rescan
+		struct Changed {
+			std::string dir;
+			std::string name;        // empty: the directory itself (its listing changed)
+			bool isDir;
+			bool regular;
+			uint64_t size;
+			int64_t mtimeNs;
+		};
+
+		DirId internDir(const std::string& path, int wd);
+		void addWatchRecursive(const std::string& root, unsigned threads,
+				const struct timespec* changedSince = nullptr, std::vector<Changed>* changed = nullptr);
+		void rescan();
 		void removeWatch(int wd);
+		Path fullPath(DirId dir, const std::string& name) const;
 
-		bool shouldWatchDir(const Path& dir) const;
-		bool shouldIgnoreFile(const Path& file) const;
+		bool shouldWatchDir(std::string_view name) const;
+		bool shouldIgnoreFile(std::string_view name) const;
 
 		void handleEvent(const struct inotify_event* ev);
-		void emitEvent(uint32_t mask, const Path& path, bool isDir, uint32_t cookie);
+		void emitEvent(uint32_t mask, DirId dir, std::string_view name, bool isDir, uint32_t cookie);
+
+		void initFanotify();
+		void readFanotify();
+		DirId resolveHandle(const void* fh);
 
 		// Vim-safe merging + rename pairing + debounce
 		void emitMerged(const Event& e);
-		void emitDebounced(const Event& e);
+		void dispatch(std::vector<std::vector<Event>>& perWorker);
+		void emitDebounced(FileEventType type, DirId dir, std::string_view name, bool isDir,
+				DirId oldDir = NoDir, const std::string& oldName = {});
 		void flushDebounce(bool force = false);
 
+		// An event leaving the debounce
+		struct Ready {
+			Event event;
+			size_t worker;
+			bool indexed;            // the index already reflects it
+			bool drop;
+		};
+		void applyIndex(std::vector<Ready>& ready);
+		std::string indexKey(const std::string& path) const;
+		void armDebounceTimer();
+		void readEvents();
+		void readInotify();
+
+		struct Worker {
+			std::thread thread;
+			std::mutex mu;
+			std::condition_variable cv;
+			std::deque<std::vector<Event>> queue;
+			size_t queued = 0;       // events in queue
+			bool full = false;       // the watcher is waiting for room: write m_poolFd when half empty
+			bool stop = false;
+		};
+		void workerLoop(Worker& w);
+		void stopWorkers();
+
 		// internal state
 		Path m_root;
-		int  m_fd;
+		WatchBackend m_backend;
+		int  m_fd;        // inotify or fanotify fd
+		int  m_mountFd;   // fanotify: root, for open_by_handle_at()
+		std::string m_rootPath;        // root as given, no trailing '/': prefix of every reported path
+		std::string m_canonicalRoot;   // fanotify: what handles of root resolve to
+		int  m_epollFd;   // m_fd, m_timerFd, m_wakeFd
+		int  m_timerFd;   // fires at the earliest debounce deadline
+		int  m_wakeFd;    // eventfd written by stop()
+		int  m_poolFd;    // eventfd written by a worker that has room again
 		uint32_t m_mask;
+		unsigned m_scanThreads;
 		std::atomic<bool> m_running;
 
-		std::unordered_map<int, Path> m_wdToPath;
+		std::vector<DirEntry> m_dirs;                        // DirId -> directory
+		std::unordered_map<std::string, DirId> m_dirIds;     // path -> DirId of live directories
+		std::vector<DirId> m_wdToDir;                        // inotify wd -> DirId
+		std::unordered_map<std::string, DirId> m_handleToDir;   // fanotify: file handle bytes -> DirId / NoDir
+		uint32_t m_fanCookie = 0;                            // fanotify: pairs MOVED_FROM with MOVED_TO
+
+		std::atomic<uint64_t> m_rawEvents{0};
+		std::atomic<uint64_t> m_emitted{0};
+		std::atomic<uint64_t> m_overflows{0};
+		std::atomic<uint64_t> m_suppressed{0};
+
+		std::unique_ptr<FileIndex> m_index;
+
+		bool m_overflowed = false;                           // rescan once the kernel queue is drained
+		struct timespec m_caughtUp{};                        // realtime of the last drain without loss
+
+		BatchCB m_onBatch;
+		std::vector<std::unique_ptr<Worker>> m_workers;
+		size_t m_maxQueued = 0;
 
 		struct MovePending {
-			fs::path oldPath;
+			DirId dir;
+			std::string name;
 			bool isDir;
 			std::chrono::steady_clock::time_point time;
 		};
 		std::unordered_map<uint32_t, MovePending> m_pendingRename;
 
+		struct DebounceKey {
+			DirId dir;
+			std::string name;
+			bool operator==(const DebounceKey& o) const { return dir == o.dir && name == o.name; }
+		};
+		struct DebounceKeyHash {
+			size_t operator()(const DebounceKey& k) const {
+				return std::hash<std::string_view>{}(k.name) ^ (k.dir * 0x9e3779b97f4a7c15ULL);
+			}
+		};
+
+		// Debounce deadline (last update + window) -> m_debounce key, earliest first.
+		using DeadlineMap = std::multimap<std::chrono::steady_clock::time_point, DebounceKey>;
+
 		struct DebounceEntry {
 			FileEventType strongest = FileEventType::Unknown;
-			fs::path path;
-			fs::path oldPath;
+			DirId oldDir = NoDir;
+			std::string oldName;
 			bool isDir = false;
+			bool indexed = false;    // emitted by the index catch-up, which updated the index already
 			std::chrono::steady_clock::time_point lastUpdate;
+			DeadlineMap::iterator deadline;
 		};
-		std::unordered_map<std::string, DebounceEntry> m_debounce;
+		std::unordered_map<DebounceKey, DebounceEntry, DebounceKeyHash> m_debounce;
+		DeadlineMap m_deadlines;
+		std::chrono::steady_clock::time_point m_timerArmedFor{};   // epoch: disarmed
+		bool m_flushBlocked = false;   // the earliest expired entry waits for a full worker: no timer until it signals
 
 		EventCB onEvent;
 		const std::chrono::milliseconds debounceWindow{180};
@@ -87,4 +240,3 @@ class DirectoryWatcher {
 		int strength(FileEventType t);
 		FileEventType mergeStrength(FileEventType a, FileEventType b);
 };
-
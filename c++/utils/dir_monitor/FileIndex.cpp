@@ -0,0 +1,473 @@
+// FileIndex.cpp
+#include "FileIndex.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const unsigned char* p) {
+	uint64_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+	uint32_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint64_t xxRound(uint64_t acc, uint64_t input) {
+	acc += input * P2;
+	return rotl(acc, 31) * P1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t v) {
+	acc ^= xxRound(0, v);
+	return acc * P1 + P4;
+}
+
+// Streaming XXH64. The four lanes do not depend on each other, so their multiplies overlap in the
+// pipeline; the stripe loop is all the hot path there is.
+class Hash64 {
+	public:
+		explicit Hash64(uint64_t seed)
+			: m_v{seed + P1 + P2, seed + P2, seed, seed - P1}, m_seed(seed) {}
+
+		void update(const void* data, size_t len) {
+			auto* p = static_cast<const unsigned char*>(data);
+			m_total += len;
+
+			if (m_buffered + len < 32) {
+				std::memcpy(m_buf + m_buffered, p, len);
+				m_buffered += len;
+				return;
+			}
+			if (m_buffered > 0) {
+				size_t fill = 32 - m_buffered;
+				std::memcpy(m_buf + m_buffered, p, fill);
+				stripe(m_buf);
+				p += fill;
+				len -= fill;
+				m_buffered = 0;
+			}
+
+			uint64_t v1 = m_v[0], v2 = m_v[1], v3 = m_v[2], v4 = m_v[3];
+			for (; len >= 32; p += 32, len -= 32) {
+				v1 = xxRound(v1, read64(p));
+				v2 = xxRound(v2, read64(p + 8));
+				v3 = xxRound(v3, read64(p + 16));
+				v4 = xxRound(v4, read64(p + 24));
+			}
+			m_v[0] = v1; m_v[1] = v2; m_v[2] = v3; m_v[3] = v4;
+
+			std::memcpy(m_buf, p, len);
+			m_buffered = len;
+		}
+
+		uint64_t digest() const {
+			uint64_t h;
+			if (m_total >= 32) {
+				h = rotl(m_v[0], 1) + rotl(m_v[1], 7) + rotl(m_v[2], 12) + rotl(m_v[3], 18);
+				for (uint64_t v : m_v)
+					h = mergeRound(h, v);
+			} else {
+				h = m_seed + P5;
+			}
+			h += m_total;
+
+			const unsigned char* p = m_buf;
+			size_t len = m_buffered;
+			for (; len >= 8; p += 8, len -= 8) {
+				h ^= xxRound(0, read64(p));
+				h = rotl(h, 27) * P1 + P4;
+			}
+			if (len >= 4) {
+				h ^= uint64_t(read32(p)) * P1;
+				h = rotl(h, 23) * P2 + P3;
+				p += 4;
+				len -= 4;
+			}
+			for (; len > 0; p++, len--) {
+				h ^= *p * P5;
+				h = rotl(h, 11) * P1;
+			}
+
+			h ^= h >> 33;
+			h *= P2;
+			h ^= h >> 29;
+			h *= P3;
+			h ^= h >> 32;
+			return h;
+		}
+
+	private:
+		void stripe(const unsigned char* p) {
+			for (int i = 0; i < 4; i++)
+				m_v[i] = xxRound(m_v[i], read64(p + 8 * i));
+		}
+
+		uint64_t m_v[4];
+		uint64_t m_seed;
+		uint64_t m_total = 0;
+		unsigned char m_buf[32];
+		size_t m_buffered = 0;
+};
+
+constexpr char kMagic[8] = {'D', 'W', 'I', 'N', 'D', 'E', 'X', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kInitialRecords = 1024;
+constexpr size_t kInitialHeap = 64 * 1024;
+
+}
+
+// File layout: header, `capacity` fixed-size records, then the path heap. Records and heap are append
+// only; erasing clears `live` and leaves the space for the next rebuild().
+struct FileIndex::Header {
+	char     magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	uint64_t capacity;       // records
+	uint64_t used;           // records written, live or not
+	uint64_t heapCapacity;   // bytes
+	uint64_t heapUsed;
+	uint64_t reserved[2];
+};
+
+struct FileIndex::Record {
+	uint64_t check;          // checksum() of everything below and the path
+	uint64_t pathOffset;     // into the heap
+	uint32_t pathLen;
+	uint32_t live;
+	Entry    entry;
+};
+
+static_assert(sizeof(FileIndex::Entry) == 32, "on-disk layout");
+
+FileIndex::Header* FileIndex::header() const { return reinterpret_cast<Header*>(m_base); }
+
+FileIndex::Record* FileIndex::records() const { return reinterpret_cast<Record*>(m_base + sizeof(Header)); }
+
+char* FileIndex::heap() const { return m_base + sizeof(Header) + header()->capacity * sizeof(Record); }
+
+uint64_t FileIndex::checksum(const Record& r) const {
+	uint64_t pathHash = hash64(heap() + r.pathOffset, r.pathLen);
+	return hash64(&r.pathOffset, sizeof(Record) - sizeof(r.check), pathHash);
+}
+
+FileIndex::FileIndex(const std::string& indexFile)
+	: m_file(indexFile)
+{
+	int fd = open(m_file.c_str(), O_RDWR | O_CLOEXEC);
+	if (fd == -1 && errno == ENOENT) {
+		m_created = true;
+		rebuild(kInitialRecords, kInitialHeap);
+		return;
+	}
+	if (fd == -1)
+		throw std::runtime_error("Cannot open index " + m_file + ": " + std::strerror(errno));
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+		close(fd);
+		throw std::runtime_error("Index " + m_file + " is truncated");
+	}
+	map(fd, st.st_size);
+
+	const Header* h = header();
+	size_t expected = sizeof(Header) + h->capacity * sizeof(Record) + h->heapCapacity;
+	if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion ||
+			h->recordSize != sizeof(Record) || expected != m_length ||
+			h->used > h->capacity || h->heapUsed > h->heapCapacity) {
+		unmap();
+		throw std::runtime_error("Index " + m_file + " is not a DirectoryWatcher index (or another version)");
+	}
+
+	load();
+	if (m_dead > m_slots.size())
+		rebuild(std::max(kInitialRecords, m_slots.size() * 2), header()->heapCapacity);
+}
+
+FileIndex::~FileIndex() {
+	sync();
+	unmap();
+}
+
+void FileIndex::map(int fd, size_t length) {
+	void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED) {
+		std::string err = std::strerror(errno);
+		close(fd);
+		throw std::runtime_error("mmap of index " + m_file + " failed: " + err);
+	}
+	m_fd = fd;
+	m_base = static_cast<char*>(base);
+	m_length = length;
+}
+
+void FileIndex::unmap() {
+	if (m_base)
+		munmap(m_base, m_length);
+	if (m_fd != -1)
+		close(m_fd);
+	m_base = nullptr;
+	m_fd = -1;
+	m_length = 0;
+}
+
+void FileIndex::load() {
+	const Header* h = header();
+	Record* recs = records();
+
+	for (uint32_t i = 0; i < h->used; i++) {
+		Record& r = recs[i];
+		if (!r.live) {
+			m_dead++;
+			continue;
+		}
+		if (r.pathOffset + r.pathLen > h->heapUsed || r.check != checksum(r)) {
+			r.live = 0;
+			m_dead++;
+			continue;
+		}
+		// a path recorded twice should not happen; if it does, the later record wins
+		auto [it, inserted] = m_slots.try_emplace(std::string(heap() + r.pathOffset, r.pathLen), i);
+		if (inserted) {
+			m_sorted.insert(&*it);
+		} else {
+			recs[it->second].live = 0;
+			it->second = i;
+			m_dead++;
+		}
+	}
+}
+
+// Writes the live records compactly into <file>.tmp with the given room and renames it over the index:
+// a crash leaves either the old or the new file, never a mix.
+void FileIndex::rebuild(size_t capacity, size_t heapCapacity) {
+	size_t heapNeeded = 0;
+	for (auto& [path, slot] : m_slots)
+		heapNeeded += path.size();
+	capacity = std::max(capacity, m_slots.size() + 1);
+	heapCapacity = std::max(heapCapacity, heapNeeded + 4096);
+
+	std::string tmp = m_file + ".tmp";
+	size_t length = sizeof(Header) + capacity * sizeof(Record) + heapCapacity;
+	int fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1 || ftruncate(fd, length) == -1) {
+		std::string err = std::strerror(errno);
+		if (fd != -1) close(fd);
+		throw std::runtime_error("Cannot create index " + tmp + ": " + err);
+	}
+
+	char* oldBase = m_base;
+	size_t oldLength = m_length;
+	int oldFd = m_fd;
+	Record* oldRecs = oldBase ? records() : nullptr;
+
+	map(fd, length);
+
+	Header* h = header();
+	std::memcpy(h->magic, kMagic, sizeof(kMagic));
+	h->version = kVersion;
+	h->recordSize = sizeof(Record);
+	h->capacity = capacity;
+	h->heapCapacity = heapCapacity;
+
+	Record* recs = records();
+	uint32_t used = 0;
+	for (auto& [path, slot] : m_slots) {
+		Record& r = recs[used];
+		r.pathOffset = h->heapUsed;
+		r.pathLen = path.size();
+		r.live = 1;
+		r.entry = oldRecs[slot].entry;
+		std::memcpy(heap() + h->heapUsed, path.data(), path.size());
+		h->heapUsed += path.size();
+		r.check = checksum(r);
+		used++;
+	}
+	h->used = used;
+
+	msync(m_base, m_length, MS_SYNC);
+	if (rename(tmp.c_str(), m_file.c_str()) == -1) {
+		std::string err = std::strerror(errno);
+		unmap();
+		unlink(tmp.c_str());
+		m_base = oldBase;
+		m_length = oldLength;
+		m_fd = oldFd;
+		throw std::runtime_error("Cannot replace index " + m_file + ": " + err);
+	}
+
+	// the slots point into the new file only once it is the index (same iteration order as above)
+	used = 0;
+	for (auto& [path, slot] : m_slots)
+		slot = used++;
+	m_dead = 0;
+
+	if (oldBase) {
+		munmap(oldBase, oldLength);
+		close(oldFd);
+	}
+}
+
+bool FileIndex::find(const std::string& path, Entry& out) const {
+	auto it = m_slots.find(path);
+	if (it == m_slots.end())
+		return false;
+	out = records()[it->second].entry;
+	return true;
+}
+
+void FileIndex::put(const std::string& path, const Entry& e) {
+	auto it = m_slots.find(path);
+	if (it != m_slots.end()) {
+		Record& r = records()[it->second];
+		r.entry = e;
+		r.check = checksum(r);
+		return;
+	}
+
+	const Header* h = header();
+	if (h->used == h->capacity || h->heapUsed + path.size() > h->heapCapacity) {
+		// grow only when compacting would not leave at least a quarter free
+		size_t live = m_slots.size() + 1;
+		size_t capacity = live * 4 / 3 > h->capacity ? h->capacity * 2 : h->capacity;
+		size_t heapCapacity = h->heapCapacity * 2;
+		rebuild(capacity, heapCapacity);
+	}
+
+	Header* w = header();
+	Record& r = records()[w->used];
+	r.pathOffset = w->heapUsed;
+	r.pathLen = path.size();
+	r.live = 1;
+	r.entry = e;
+	std::memcpy(heap() + w->heapUsed, path.data(), path.size());
+	r.check = checksum(r);
+
+	// publish the record only once it is complete
+	w->heapUsed += path.size();
+	m_sorted.insert(&*m_slots.emplace(path, static_cast<uint32_t>(w->used)).first);
+	w->used++;
+}
+
+bool FileIndex::erase(const std::string& path) {
+	auto it = m_slots.find(path);
+	if (it == m_slots.end())
+		return false;
+	records()[it->second].live = 0;
+	m_sorted.erase(&*it);
+	m_slots.erase(it);
+	m_dead++;
+	return true;
+}
+
+// Everything below "dir/" sorts between "dir/" and "dir0" ('0' follows '/').
+std::pair<std::set<FileIndex::Slot*, FileIndex::ByPath>::const_iterator,
+		std::set<FileIndex::Slot*, FileIndex::ByPath>::const_iterator>
+FileIndex::under(const std::string& dir) const {
+	if (dir.empty())
+		return {m_sorted.begin(), m_sorted.end()};
+	return {m_sorted.lower_bound(std::string_view(dir + "/")), m_sorted.lower_bound(std::string_view(dir + "0"))};
+}
+
+size_t FileIndex::move(const std::string& from, const std::string& to) {
+	std::vector<std::pair<std::string, Entry>> moved;
+
+	auto it = m_slots.find(from);
+	if (it != m_slots.end())
+		moved.emplace_back(from, records()[it->second].entry);
+	for (auto [s, end] = under(from); s != end; ++s)
+		moved.emplace_back((*s)->first, records()[(*s)->second].entry);
+
+	for (auto& [path, e] : moved) {
+		erase(path);
+		put(to + path.substr(from.size()), e);
+	}
+	return moved.size();
+}
+
+size_t FileIndex::eraseUnder(const std::string& dir) {
+	auto [first, last] = under(dir);
+	size_t gone = 0;
+
+	while (first != last) {
+		Slot* s = *first++;
+		records()[s->second].live = 0;
+		m_sorted.erase(s);
+		m_slots.erase(m_slots.find(s->first));
+		m_dead++;
+		gone++;
+	}
+	return gone;
+}
+
+void FileIndex::forEach(const std::function<void(const std::string& path, const Entry& e)>& f) const {
+	for (auto& [path, slot] : m_slots)
+		f(path, records()[slot].entry);
+}
+
+void FileIndex::forEachUnder(const std::string& dir,
+		const std::function<void(const std::string& path, const Entry& e)>& f) const {
+	for (auto [s, end] = under(dir); s != end; ++s)
+		f((*s)->first, records()[(*s)->second].entry);
+}
+
+void FileIndex::sync() {
+	if (m_base)
+		msync(m_base, m_length, MS_SYNC);
+}
+
+bool FileIndex::sameStat(const Entry& e, uint64_t size, int64_t mtimeNs) {
+	// mtimes come from the kernel's coarse clock: within a second of the hash, the same mtime may
+	// still hide a later write
+	constexpr int64_t racyNs = 1000000000;
+	return e.size == size && e.mtimeNs == mtimeNs && mtimeNs < e.checkedNs - racyNs;
+}
+
+uint64_t FileIndex::hash64(const void* data, size_t len, uint64_t seed) {
+	Hash64 h(seed);
+	h.update(data, len);
+	return h.digest();
+}
+
+bool FileIndex::hashFile(const std::string& path, uint64_t& hash) {
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+	if (fd == -1)
+		return false;
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	static thread_local std::vector<char> buf(256 * 1024);
+	Hash64 h(0);
+	ssize_t n;
+	while ((n = read(fd, buf.data(), buf.size())) != 0) {
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			close(fd);
+			return false;
+		}
+		h.update(buf.data(), n);
+	}
+	close(fd);
+
+	hash = h.digest();
+	return true;
+}
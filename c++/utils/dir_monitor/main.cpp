@@ -8,8 +8,8 @@ static std::atomic<bool> g_stop{false};
 void signal_handler(int) { g_stop = true; }
 
 int main(int argc, char** argv) {
-	if (argc != 2) {
-		std::cerr << "Usage: " << argv[0] << " <dir>\n";
+	if (argc != 2 && argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " <dir> [index file]\n";
 		return 1;
 	}
 
@@ -17,6 +17,8 @@ int main(int argc, char** argv) {
 	std::signal(SIGTERM, signal_handler);
 
 	DirectoryWatcher watcher(argv[1]);
+	if (argc == 3)
+		watcher.enableIndex(argv[2]);
 
 	watcher.setCallback([](const FileEvent& e){
 			std::string t;
@@ -26,6 +28,7 @@ int main(int argc, char** argv) {
 			case FileEventType::Modify: t = "MODIFY"; break;
 			case FileEventType::Move:   t = "MOVE"; break;
 			case FileEventType::CloseWrite: t = "CLOSE_WRITE"; break;
+			case FileEventType::Rescan: t = "RESCAN"; break;
 			default: t = "UNKNOWN"; break;
 			}
 
@@ -0,0 +1,123 @@
+// test_file_index.cpp
+//
+//   g++ -std=c++20 -O2 -pthread -I. FileIndex.cpp tests/test_file_index.cpp
+//       -lgtest -lgtest_main -o test_file_index
+
+#include <gtest/gtest.h>
+#include "FileIndex.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class TempIndex : public ::testing::Test {
+	protected:
+		std::string dir;
+		std::string file;
+
+		void SetUp() override {
+			char tmpl[] = "/tmp/file_index_test.XXXXXX";
+			ASSERT_NE(mkdtemp(tmpl), nullptr);
+			dir = tmpl;
+			file = dir + "/index";
+		}
+		void TearDown() override { fs::remove_all(dir); }
+
+		static FileIndex::Entry entry(uint64_t n) { return {n, static_cast<int64_t>(n), n * 31, 0}; }
+
+		static std::vector<std::string> pathsUnder(const FileIndex& index, const std::string& d) {
+			std::vector<std::string> paths;
+			index.forEachUnder(d, [&](const std::string& p, const FileIndex::Entry&) { paths.push_back(p); });
+			return paths;
+		}
+};
+
+// Only the directory's own subtree moves: "ab" and "a0" sort right next to "a/..." but are not below it.
+TEST_F(TempIndex, MoveTakesFileOrSubtree) {
+	FileIndex index(file);
+	index.put("a/b", entry(1));
+	index.put("a/c/d", entry(2));
+	index.put("ab", entry(3));
+	index.put("a0", entry(4));
+	index.put("x", entry(5));
+
+	EXPECT_EQ(index.move("x", "y"), 1u);
+	EXPECT_EQ(index.move("a", "z"), 2u);
+
+	FileIndex::Entry e;
+	EXPECT_FALSE(index.find("x", e));
+	ASSERT_TRUE(index.find("y", e));
+	EXPECT_EQ(e.size, 5u);
+	ASSERT_TRUE(index.find("z/c/d", e));
+	EXPECT_EQ(e.size, 2u);
+	EXPECT_TRUE(index.find("ab", e));
+	EXPECT_TRUE(index.find("a0", e));
+	EXPECT_TRUE(pathsUnder(index, "a").empty());
+	EXPECT_EQ(pathsUnder(index, "z"), (std::vector<std::string>{"z/b", "z/c/d"}));
+	EXPECT_EQ(pathsUnder(index, "").size(), 5u);
+}
+
+TEST_F(TempIndex, EraseUnderKeepsNeighbours) {
+	FileIndex index(file);
+	index.put("d/1", entry(1));
+	index.put("d/e/2", entry(2));
+	index.put("d.txt", entry(3));
+	index.put("d0", entry(4));
+
+	EXPECT_EQ(index.eraseUnder("d"), 2u);
+	EXPECT_EQ(index.size(), 2u);
+	EXPECT_EQ(pathsUnder(index, ""), (std::vector<std::string>{"d.txt", "d0"}));
+}
+
+// A burst of single-file renames (editor saves, rsync temp files) must not scan the whole index each.
+TEST_F(TempIndex, FileRenamesDoNotScanTheIndex) {
+	FileIndex index(file);
+	for (uint64_t i = 0; i < 200000; i++)
+		index.put("dir" + std::to_string(i % 100) + "/file" + std::to_string(i), entry(i));
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < 1000; i++)
+		ASSERT_EQ(index.move("dir7/file" + std::to_string(i * 100 + 7), "dir7/renamed" + std::to_string(i)), 1u);
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	EXPECT_LT(secs, 0.5);
+	EXPECT_EQ(index.size(), 200000u);
+}
+
+// A rebuild whose rename fails keeps the old file mapped; every slot must still point into it.
+TEST_F(TempIndex, FailedRebuildKeepsLookups) {
+	FileIndex index(file);
+	size_t n = 0;
+	index.put("first", entry(n++));
+	index.erase("first");                                   // a dead record: rebuild renumbers the rest
+
+	ASSERT_EQ(unlink(file.c_str()), 0);                     // rename() over a non-empty directory fails
+	ASSERT_EQ(mkdir(file.c_str(), 0755), 0);
+	ASSERT_EQ(mkdir((file + "/keep").c_str(), 0755), 0);
+
+	bool failed = false;
+	while (!failed) {
+		try {
+			index.put("path" + std::to_string(n), entry(n));
+			n++;
+		} catch (const std::runtime_error&) {
+			failed = true;
+		}
+	}
+
+	FileIndex::Entry e;
+	for (size_t i = 1; i < n; i++) {
+		ASSERT_TRUE(index.find("path" + std::to_string(i), e));
+		EXPECT_EQ(e.size, i);
+	}
+	EXPECT_TRUE(index.erase("path1"));
+	ASSERT_TRUE(index.find("path2", e));
+	EXPECT_EQ(e.size, 2u);
+}
@@ -0,0 +1,242 @@
+// watch_bench.cpp
+//
+//   g++ -std=c++20 -O2 -pthread DirectoryWatcher.cpp FileIndex.cpp watch_bench.cpp -o watch_bench
+//   ./watch_bench [directories] [files per directory] [events] [scan threads]
+//
+// Builds a throw-away tree under /tmp (directories spread over two levels, empty files in each) and
+// measures
+//   startup : DirectoryWatcher construction (initial scan + one inotify watch per directory) with one
+//             scan thread and with [scan threads] (default: one per CPU), next to a plain
+//             recursive_directory_iterator walk doing the same inotify_add_watch() calls
+//             (the way addWatchRecursive() used to work); fanotify construction when permitted
+//   events  : [events] files created across the tree while the watcher runs, until every merged
+//             CREATE came out of the debounce; kernel events per second of watcher thread CPU
+//   index   : enableIndex() on a new index (hashes every file), again on the unchanged tree (stat only),
+//             after rewriting 1% of the files offline (half of them with the same content); then the
+//             same rewrites while the watcher runs, counting the modifications it suppressed
+//
+// Raise fs.inotify.max_user_watches above [directories] first.
+
+#include "DirectoryWatcher.hpp"
+
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctime>
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double threadCpuSeconds() {
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void touch(const std::string& path) {
+	int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0644);
+	if (fd != -1) close(fd);
+}
+
+static std::vector<std::string> buildTree(const std::string& root, size_t dirs, size_t files) {
+	size_t top = std::max<size_t>(1, (size_t)std::sqrt((double)dirs));
+	std::vector<std::string> all;
+
+	for (size_t i = 0; i < dirs; i++) {
+		std::string parent = root + "/d" + std::to_string(i % top);
+		if (i < top) {
+			fs::create_directory(parent);
+			all.push_back(parent);
+			continue;
+		}
+		std::string dir = parent + "/s" + std::to_string(i);
+		fs::create_directory(dir);
+		all.push_back(dir);
+	}
+
+	for (auto& dir : all)
+		for (size_t f = 0; f < files; f++)
+			touch(dir + "/f" + std::to_string(f));
+
+	return all;
+}
+
+static void writeFile(const std::string& path, const std::string& content) {
+	int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+	if (fd == -1) return;
+	(void)!write(fd, content.data(), content.size());
+	close(fd);
+}
+
+// Every 100th file gets rewritten: the even ones with what they had, the odd ones with new content.
+static size_t rewrite(const std::vector<std::string>& dirs, size_t files, const std::string& tag) {
+	size_t n = 0;
+	for (size_t i = 0; i < dirs.size() * files; i += 100, n++) {
+		std::string path = dirs[i / files] + "/f" + std::to_string(i % files);
+		writeFile(path, n % 2 ? tag + std::to_string(i) : "content " + std::to_string(i));
+	}
+	return n;
+}
+
+static void index(const std::string& root, const std::vector<std::string>& dirs, size_t files) {
+	std::string file = root + ".index";
+	for (size_t i = 0; i < dirs.size() * files; i++)
+		writeFile(dirs[i / files] + "/f" + std::to_string(i % files), "content " + std::to_string(i));
+
+	auto catchUp = [&](const char* label) {
+		DirectoryWatcher w(root);
+		size_t changes = 0;
+		w.setCallback([&](const FileEvent&) { changes++; });
+		auto start = Clock::now();
+		w.enableIndex(file);
+		double ms = secondsSince(start) * 1000;
+		w.stop();
+		w.run();                             // hands out what the catch-up found
+		std::cout << "  " << std::left << std::setw(34) << label << std::right << ": " << std::setw(8) << ms
+			<< " ms  (" << changes << " changes reported)\n";
+	};
+
+	catchUp("new index (hash every file)");
+	catchUp("restart, tree unchanged");
+	size_t n = rewrite(dirs, files, "offline ");
+	std::string label = "restart, " + std::to_string(n) + " files rewritten";
+	catchUp(label.c_str());
+
+	DirectoryWatcher w(root);
+	w.enableIndex(file);
+	size_t modified = 0;
+	w.setCallback([&](const FileEvent& e) { if (e.type != FileEventType::Rescan) modified++; });
+	std::thread th([&] { w.run(); });
+	n = rewrite(dirs, files, "live ");
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	w.stop();
+	th.join();
+	std::cout << "  live: " << n << " files rewritten, " << modified << " events out, "
+		<< w.stats().suppressed << " suppressed as unchanged\n";
+
+	unlink(file.c_str());
+}
+
+static void referenceWalk(const std::string& root) {
+	int fd = inotify_init1(IN_CLOEXEC);
+	size_t watches = 0;
+	auto start = Clock::now();
+
+	inotify_add_watch(fd, root.c_str(), DirectoryWatcher::defaultMask());
+	for (auto it = fs::recursive_directory_iterator(root); it != fs::recursive_directory_iterator(); ++it) {
+		if (!it->is_directory()) continue;
+		if (inotify_add_watch(fd, it->path().c_str(), DirectoryWatcher::defaultMask()) != -1)
+			watches++;
+	}
+
+	std::cout << "  recursive_directory_iterator walk : " << std::setw(8) << secondsSince(start) * 1000
+		<< " ms  (" << watches + 1 << " watches)\n";
+	close(fd);
+}
+
+static void startup(const std::string& root, WatchBackend backend, unsigned threads, const char* label) {
+	auto start = Clock::now();
+	try {
+		DirectoryWatcher w(root, DirectoryWatcher::defaultMask(), backend, threads);
+		double ms = secondsSince(start) * 1000;
+		std::cout << "  " << std::left << std::setw(34) << label << std::right << ": " << std::setw(8) << ms
+			<< " ms  (" << w.stats().directories << " directories)\n";
+	} catch (const std::exception& e) {
+		std::cout << "  " << std::left << std::setw(34) << label << std::right << ": unavailable, " << e.what() << "\n";
+	}
+}
+
+static void events(const std::string& root, const std::vector<std::string>& dirs, size_t count,
+		WatchBackend backend, const char* label) {
+	std::unique_ptr<DirectoryWatcher> w;
+	try {
+		w = std::make_unique<DirectoryWatcher>(root, DirectoryWatcher::defaultMask(), backend);
+	} catch (const std::exception& e) {
+		std::cout << "  " << label << ": unavailable, " << e.what() << "\n";
+		return;
+	}
+
+	std::atomic<size_t> created{0};
+	double cpuStart = -1, cpuEnd = 0;
+	uint64_t raw = 0;
+
+	w->setCallback([&](const FileEvent& e) {
+		if (cpuStart < 0) cpuStart = threadCpuSeconds();
+		if (e.type == FileEventType::Create && !e.isDirectory && ++created == count) {
+			cpuEnd = threadCpuSeconds();
+			raw = w->stats().rawEvents;
+			w->stop();
+		}
+	});
+
+	double cpuBase = 0;
+	std::thread th([&] { cpuBase = threadCpuSeconds(); w->run(); if (cpuEnd == 0) cpuEnd = threadCpuSeconds(); });
+
+	auto start = Clock::now();
+	for (size_t i = 0; i < count; i++) {
+		int fd = open((dirs[i % dirs.size()] + "/e" + std::to_string(i)).c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0644);
+		if (fd == -1) continue;
+		(void)!write(fd, "x", 1);
+		close(fd);
+	}
+	double produce = secondsSince(start);
+
+	th.join();
+	double wall = secondsSince(start);
+	double cpu = cpuEnd - cpuBase;
+
+	std::cout << "  " << label << ": " << created << "/" << count << " files (" << raw << " kernel events) written in "
+		<< produce * 1000 << " ms, all delivered after " << wall * 1000 << " ms (debounce window included)\n"
+		<< "    watcher thread CPU " << cpu * 1000 << " ms => " << (size_t)(raw / std::max(cpu, 1e-9))
+		<< " kernel events/s, " << cpu * 1e9 / std::max<uint64_t>(raw, 1) << " ns per event\n";
+
+	for (size_t i = 0; i < count; i++)
+		unlink((dirs[i % dirs.size()] + "/e" + std::to_string(i)).c_str());
+}
+
+int main(int argc, char** argv) {
+	size_t dirs = argc > 1 ? std::stoul(argv[1]) : 20000;
+	size_t files = argc > 2 ? std::stoul(argv[2]) : 10;
+	size_t count = argc > 3 ? std::stoul(argv[3]) : 100000;
+	unsigned threads = argc > 4 ? std::stoul(argv[4]) : std::max(1u, std::thread::hardware_concurrency());
+
+	char tmpl[] = "/tmp/watch_bench.XXXXXX";
+	if (!mkdtemp(tmpl)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	std::string root = tmpl;
+
+	auto start = Clock::now();
+	auto all = buildTree(root, dirs, files);
+	std::cout << "tree: " << all.size() << " directories, " << all.size() * files << " files under " << root
+		<< " (built in " << secondsSince(start) << " s)\n";
+
+	std::cout << "startup\n";
+	referenceWalk(root);
+	startup(root, WatchBackend::Inotify, 1, "inotify, 1 scan thread");
+	std::string label = "inotify, " + std::to_string(threads) + " scan threads";
+	startup(root, WatchBackend::Inotify, threads, label.c_str());
+	startup(root, WatchBackend::Fanotify, 0, "fanotify filesystem mark");
+
+	std::cout << "events\n";
+	events(root, all, count, WatchBackend::Inotify, "inotify ");
+	events(root, all, count, WatchBackend::Fanotify, "fanotify");
+
+	std::cout << "index\n";
+	index(root, all, files);
+
+	fs::remove_all(root);
+	return 0;
+}
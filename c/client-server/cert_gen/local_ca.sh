@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# Local self-signed CA + server/client certificates for the TLS benchmark (client menu 8).
+#
+#   sh cert_gen/local_ca.sh [output directory, default .]
+#
+# The certificates shipped next to server.cpp / client.cpp are SHA-1 signed 1024 bit RSA,
+# which OpenSSL 3 rejects at its default security level ("CERTIFICATE FILE LOAD FAIL").
+# These use 2048 bit RSA / SHA-256 and the file names and CN ("unipay") getSocketInfo() expects.
+# Keys are written without a password (sockInfo.password is "").
+
+set -e
+
+OUT=${1:-.}
+DAYS=3650
+SUBJ="/C=IN/ST=Tamilnadu/O=Innoviti/OU=POS"
+
+mkdir -p "$OUT"
+cd "$OUT"
+
+openssl req -x509 -newkey rsa:2048 -sha256 -nodes -days $DAYS \
+	-keyout ca_key.pem -out ca.crt -subj "$SUBJ/CN=unipay-local-ca"
+
+for NAME in server client
+do
+	openssl req -newkey rsa:2048 -sha256 -nodes \
+		-keyout ${NAME}_key.pem -out $NAME.csr -subj "$SUBJ/CN=unipay"
+	openssl x509 -req -sha256 -days $DAYS -in $NAME.csr -CA ca.crt -CAkey ca_key.pem \
+		-CAcreateserial -out $NAME.crt
+	rm -f $NAME.csr
+done
+
+openssl verify -CAfile ca.crt server.crt client.crt
@@ -1,5 +1,6 @@
 /*
-      g++ client.cpp -lssl -lcrypto -lpthread -o client
+      gcc -c -O2 -DISO8583_NO_MAIN ../iso8583/Iso8583Parser.c
+      g++ client.cpp frame.cpp ../logger/async_log.cpp Iso8583Parser.o -lssl -lcrypto -lpthread -o client
 */
 
 
@@ -25,10 +26,20 @@
 #include <netinet/in.h>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
 
 // POSIX Threads
 #include <pthread.h>
 
+#include "../logger/async_log.h"
+#include "../iso8583/Iso8583Parser.h"
+#include "frame.h"
+
 #define LINUX
 
 #ifdef WINDOWS
@@ -84,17 +95,22 @@ void check_cert_chain (SSL *ssl, char *host);
 int verify_callback (int ok, X509_STORE_CTX *store);
 static int password_cb(char *buf,int num,int rwflag,void *userdata);
 
-int Time_Get(char *outField);
-int File_Log(const char* format, ...);
 BOOLEAN set_socket_nonblock(SOCKET sd);
 BOOLEAN set_socket_rcv_timeout(SOCKET sock, int secs);
 
 SocketHandle Socket_ClientInit(void);
+SocketHandle Socket_ClientConnect(BOOLEAN resume);
+BOOLEAN set_socket_keepalive(SOCKET sock, int idleSecs);
 void *client(void *args);
 
 short client_server();
 short client_server_multiThread();
 short client_server_polling();
+short client_loadgen();
+short client_tls_bench();
+short client_pipeline_bench();
+short client_iso_bench();
+void raise_fd_limit(void);
 
 static char *pass;
 
@@ -176,6 +192,7 @@ SOCKET Socket_Open( const char *host, unsigned short port )
 	{
 		
 		File_Log("Socket Connection Failed"); 
+		close(sock);
 		goto ERRORHANDLER;
 	}
 
@@ -278,7 +295,10 @@ void Socket_Destroy(SocketHandle *Socket)
 	//File_Log("Socket_Destroy() -> Destroying Socket...");
 
 	if ( Socket->ssl)
+	{
+		SSL_shutdown(Socket->ssl);              // without close_notify the session is not resumable
 		SSL_free(Socket->ssl);
+	}
 
 	Socket_Close(Socket->sock);
 
@@ -290,6 +310,59 @@ void Socket_Destroy(SocketHandle *Socket)
 }
 
 
+/****************************************************************************
+ *
+ * TLS session reuse and connection pool
+ *
+ * Every connection used to load the certificates into a new SSL_CTX and run a full handshake.
+ *   - one SSL_CTX per process (clientCtx), each SocketHandle holds a reference to it
+ *   - session_new_cb() keeps the latest session the server issued (TLS 1.2 session ID or ticket,
+ *     TLS 1.3 ticket, which arrives after the handshake with the first read); the next
+ *     Socket_ClientConnect(_TRUE) offers it and the server resumes instead of a full handshake
+ *   - ConnPool keeps finished connections open (TCP keep-alive on) and hands them out again,
+ *     so most requests need no handshake at all. Connections idle for TLS_POOL_IDLE_SECS (less
+ *     than the server's TLS_KEEPALIVE_SECS) or closed by the server are dropped on acquire.
+ *
+ * ***************************************************************************/
+
+#define TLS_POOL_MAX_IDLE    64
+#define TLS_POOL_IDLE_SECS   15
+#define TLS_KEEPALIVE_IDLE   10             // TCP keep-alive probes after this many idle seconds
+
+typedef struct CONN_POOL
+{
+	SocketHandle idle[TLS_POOL_MAX_IDLE];
+	time_t lastUsed[TLS_POOL_MAX_IDLE];
+	int count;
+	pthread_mutex_t lock;
+	unsigned long opened;                   // connections opened (handshakes)
+	unsigned long reused;                   // acquires served by an idle connection
+}ConnPool;
+
+static SSL_CTX *clientCtx;
+static pthread_once_t clientCtxOnce = PTHREAD_ONCE_INIT;
+static SSL_SESSION *savedSession;
+static pthread_mutex_t sessionLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long tlsHandshakes, tlsResumed;
+
+static int session_new_cb(SSL *, SSL_SESSION *session)
+{
+	pthread_mutex_lock(&sessionLock);
+	if ( savedSession )
+		SSL_SESSION_free(savedSession);
+	savedSession = session;
+	pthread_mutex_unlock(&sessionLock);
+
+	return 1;                               // we own the reference now
+}
+
+static void client_ctx_init(void)
+{
+	SocketInfo sockInfo = getSocketInfo();
+
+	clientCtx = initialize_ctx(sockInfo.certificate, sockInfo.keyfile, sockInfo.caCert, sockInfo.password);
+}
+
 SSL_CTX *initialize_ctx (char *certfile, char *keyfile, char *CA, char *password)
 {
 	int ret = 0;
@@ -350,6 +423,10 @@ SSL_CTX *initialize_ctx (char *certfile, char *keyfile, char *CA, char *password
 	SSL_CTX_set_verify_depth (ctx,2);
 	SSL_CTX_set_verify (ctx, SSL_VERIFY_PEER, verify_callback);
 
+	/* Session reuse: keep the last session / ticket the server handed out (see session_new_cb) */
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx, session_new_cb);
+
 	//File_Log("SSL CTX Initialization OK");
 
 	return ctx;
@@ -394,11 +471,17 @@ void check_cert_chain (SSL *ssl, char *host)
 		File_Log("Certificate doesn't verify");
 	/*Check the common name*/
 	peer = SSL_get_peer_certificate (ssl);
+	if ( peer == NULL )
+	{
+		File_Log("No peer certificate");
+		return;
+	}
 	X509_NAME_get_text_by_NID (X509_get_subject_name (peer), NID_commonName, peer_CN, 256);
 	if (strcmp(peer_CN, host)){
 		File_Log("Common name not matched");
 		File_Log("%s : %s", peer_CN, host);
 	}
+	X509_free(peer);
 	
 }
 
@@ -418,66 +501,13 @@ static int password_cb(char *buf,int num,int rwflag,void *userdata)
 
 
 
-int File_Log(const char* format, ...)
-{
-	int ret=0;
-	int month = 0;
-	int fp = 0;
-	char buffer[15001] = {'\0'};
-	char logfile[30] = {'\0'};	
-
-	va_list args;
-
-	month = Time_Get(buffer);
-
-	va_start(args, format);
-	vsprintf (&buffer[strlen(buffer)], format, args );
-	va_end(args);	
-
-	sprintf(logfile, "log_c_%02d.txt", month);
-
-	printf("%s", buffer);
-
-
-	fp = open (logfile, O_WRONLY|O_APPEND|O_CREAT, S_IWRITE | S_IREAD); // S_IWRITE - Open or Create with write permission 
-	
-	if(fp<0)
-	{
-		switch(errno)
-		{
-			case EACCES: //return _ERR_FILE_ACCESS; 
-			case EMFILE: //return _ERR_FILE_TOO_MANY_HANDLERS;
-			default: //return _ERR_FILE_UNKNOWN;
-				return -1;
-		}
-	}
-
-	ret = write(fp, (const char *)buffer,strlen(buffer));
-
-	close(fp);
-
-	return ret;
-	
-
-}
-
-
-int Time_Get(char *outField)
+SocketHandle Socket_ClientInit(void)
 {
-
-	time_t t = time(0);
-	struct tm* lt = localtime(&t);
- 	char time_str[128] = {0};
-
-    sprintf(time_str, "\n%02d%02d%02d: %02d/%02d/%02d: => ", lt->tm_hour, lt->tm_min, lt->tm_sec, lt->tm_mon + 1, lt->tm_mday, lt->tm_year - 100);
-
-	strncat(outField, time_str, strlen(time_str));
-	return lt->tm_mon + 1;
+	return Socket_ClientConnect(_TRUE);
 }
 
-
-
-SocketHandle Socket_ClientInit(void)
+// resume : offer the saved session, _FALSE forces a full handshake
+SocketHandle Socket_ClientConnect(BOOLEAN resume)
 {
 	BIO *sbio;
 
@@ -492,27 +522,44 @@ SocketHandle Socket_ClientInit(void)
 
 	if ( sockInfo.isSSL)
 	{
-
-		Client.ctx = initialize_ctx(sockInfo.certificate, sockInfo.keyfile, sockInfo.caCert, sockInfo.password);
-		if ( Client.ctx == NULL)
+		pthread_once(&clientCtxOnce, client_ctx_init);
+		if ( clientCtx == NULL)
 		{
 			Socket_Close(Client.sock);
 			return Client;
 		}
 
+		SSL_CTX_up_ref(clientCtx);
+		Client.ctx = clientCtx;
+
 		File_Log("SSL Connecting");
 
 		Client.ssl = SSL_new (Client.ctx);
 		sbio = BIO_new_socket (Client.sock, BIO_NOCLOSE);
 		SSL_set_bio (Client.ssl, sbio, sbio);
 
-		if ( SSL_connect (Client.ssl) < 0){
+		if ( resume )
+		{
+			pthread_mutex_lock(&sessionLock);
+			if ( savedSession )
+				SSL_set_session(Client.ssl, savedSession);
+			pthread_mutex_unlock(&sessionLock);
+		}
+
+		if ( SSL_connect (Client.ssl) <= 0){
+			SSL_free(Client.ssl);
 			Socket_Close(Client.sock);
 			destroy_ctx(Client.ctx);
+			Client.ssl = NULL;
+			Client.ctx = NULL;
 			File_Log("SSL Connection Error");
 			return Client;
 		}
 
+		__atomic_add_fetch(&tlsHandshakes, 1, __ATOMIC_RELAXED);
+		if ( SSL_session_reused(Client.ssl) )
+			__atomic_add_fetch(&tlsResumed, 1, __ATOMIC_RELAXED);
+
 		check_cert_chain (Client.ssl, sockInfo.commonName);
 	}
 
@@ -522,6 +569,102 @@ SocketHandle Socket_ClientInit(void)
 
 }
 
+BOOLEAN set_socket_keepalive(SOCKET sock, int idleSecs)
+{
+	int on = 1, interval = 5, probes = 3;
+
+	if ( setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) ||
+			setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &idleSecs, sizeof(idleSecs)) ||
+			setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) ||
+			setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes)) )
+	{
+		File_Log("ERROR : SET SOCKET KEEPALIVE");
+		return _FALSE;
+	}
+
+	return _TRUE;
+}
+
+
+/*****************************************    Connection Pool     *************************************************/
+
+void Pool_Init(ConnPool *pool)
+{
+	memset(pool, 0, sizeof(ConnPool));
+	pthread_mutex_init(&pool->lock, NULL);
+}
+
+// An idle pooled socket must have nothing to read: 0 is a FIN, data is an unexpected close_notify.
+static BOOLEAN pool_conn_alive(SocketHandle *conn)
+{
+	char c;
+	int ret = recv(conn->sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+	return ( ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ) ? _TRUE : _FALSE;
+}
+
+SocketHandle Pool_Acquire(ConnPool *pool)
+{
+	SocketHandle conn;
+	time_t lastUsed;
+
+	while ( _TRUE )
+	{
+		pthread_mutex_lock(&pool->lock);
+		if ( pool->count == 0 )
+		{
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		pool->count--;                                  // LIFO: the most recently used is the warmest
+		conn = pool->idle[pool->count];
+		lastUsed = pool->lastUsed[pool->count];
+		pthread_mutex_unlock(&pool->lock);
+
+		if ( time(0) - lastUsed < TLS_POOL_IDLE_SECS && pool_conn_alive(&conn) )
+		{
+			__atomic_add_fetch(&pool->reused, 1, __ATOMIC_RELAXED);
+			return conn;
+		}
+
+		Socket_Destroy(&conn);
+	}
+
+	conn = Socket_ClientConnect(_TRUE);
+	if ( conn.isConnected )
+	{
+		set_socket_keepalive(conn.sock, TLS_KEEPALIVE_IDLE);
+		__atomic_add_fetch(&pool->opened, 1, __ATOMIC_RELAXED);
+	}
+
+	return conn;
+}
+
+// reusable : _FALSE after an I/O error, the connection is closed instead of pooled
+void Pool_Release(ConnPool *pool, SocketHandle *conn, BOOLEAN reusable)
+{
+	pthread_mutex_lock(&pool->lock);
+	if ( reusable && pool->count < TLS_POOL_MAX_IDLE )
+	{
+		pool->idle[pool->count] = *conn;
+		pool->lastUsed[pool->count] = time(0);
+		pool->count++;
+		pthread_mutex_unlock(&pool->lock);
+		return;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	Socket_Destroy(conn);
+}
+
+void Pool_Destroy(ConnPool *pool)
+{
+	while ( pool->count > 0 )
+		Socket_Destroy(&pool->idle[--pool->count]);
+
+	pthread_mutex_destroy(&pool->lock);
+}
+
 
 void *client(void *args)
 {
@@ -689,11 +832,785 @@ short client_server_polling()
 }
 
 
+/*****************************************    Load Generator     *************************************************/
+
+/*
+ * Closed-loop echo load: LOADGEN connections spread over worker threads, each worker with its own epoll.
+ *   phase 1 : non-blocking connect of every connection            -> connections per second
+ *   phase 2 : each connection sends LOADGEN_REQ_SIZE bytes, waits for
+ *             the full echo, sends again, for the given seconds     -> requests per second
+ * Needs a raised fd limit on both sides for 10k+ connections (raise_fd_limit() tries the hard limit).
+ */
+
+#define LOADGEN_REQ_SIZE     64
+#define LOADGEN_MAX_EVENTS   1024
+
+typedef struct LOADGEN_CONN
+{
+	SOCKET sock;
+	int sent;                         // request bytes sent
+	int rcvd;                         // echo bytes received
+	BOOLEAN connected;
+}LoadConn;
+
+typedef struct LOADGEN_WORKER
+{
+	int id;
+	pthread_t tid;
+	int nconns;
+	int seconds;
+	struct sockaddr_in server;
+	unsigned long connected;
+	unsigned long failed;
+	unsigned long requests;           // completed inside the measuring window
+	double connectSecs;               // time until all connects finished
+}LoadWorker;
+
+static double loadgen_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void raise_fd_limit(void)
+{
+	struct rlimit rl;
+
+	if ( getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max )
+	{
+		rl.rlim_cur = rl.rlim_max;
+		if ( setrlimit(RLIMIT_NOFILE, &rl) != 0 )
+			File_Log("ERROR : setrlimit RLIMIT_NOFILE");
+	}
+}
+
+// Returns 0 while waiting on the socket, -1 on error.
+static int loadgen_pump(LoadConn *c, unsigned char *req, BOOLEAN counting, unsigned long *requests)
+{
+	int ret;
+	unsigned char buffer[LOADGEN_REQ_SIZE * 4];
+
+	while ( _TRUE )
+	{
+		if ( c->sent < LOADGEN_REQ_SIZE )
+		{
+			ret = send(c->sock, req + c->sent, LOADGEN_REQ_SIZE - c->sent, MSG_NOSIGNAL);
+			if ( ret < 0 )
+				return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+			c->sent += ret;
+			continue;
+		}
+
+		ret = recv(c->sock, buffer, sizeof(buffer), 0);
+		if ( ret == 0 )
+			return -1;
+		if ( ret < 0 )
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+
+		c->rcvd += ret;
+		if ( c->rcvd >= LOADGEN_REQ_SIZE )     // full echo back -> next request
+		{
+			if ( counting )
+				(*requests)++;
+			c->sent = 0;
+			c->rcvd -= LOADGEN_REQ_SIZE;
+		}
+	}
+}
+
+void *loadgen_worker(void *args)
+{
+	int i, ret, err, event_count, pending, on = 1;
+	socklen_t len;
+	double start, connectedAt = 0, deadline = 0;
+	LoadWorker *w = (LoadWorker *)args;
+	LoadConn *conns, *c;
+	SOCKET epoll_fd;
+	struct epoll_event ev, events[LOADGEN_MAX_EVENTS];
+	unsigned char req[LOADGEN_REQ_SIZE];
+
+	memset(req, 'x', sizeof(req));
+
+	conns = (LoadConn *)calloc(w->nconns, sizeof(LoadConn));
+	epoll_fd = epoll_create1(0);
+	if ( conns == NULL || epoll_fd == SOCKET_ERROR )
+	{
+		File_Log("WORKER %d => ERROR : setup", w->id);
+		free(conns);
+		return (void *)"FAIL";
+	}
+
+	start = loadgen_now();
+	pending = w->nconns;
+
+	for ( i = 0; i < w->nconns; i++ )
+	{
+		c = &conns[i];
+		c->sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		if ( c->sock == SOCKET_ERROR )
+		{
+			w->failed++;
+			pending--;
+			continue;
+		}
+		setsockopt(c->sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+		ret = connect(c->sock, (struct sockaddr *)&w->server, sizeof(w->server));
+		if ( ret == SOCKET_ERROR && errno != EINPROGRESS )
+		{
+			Socket_Close(c->sock);
+			c->sock = SOCKET_ERROR;
+			w->failed++;
+			pending--;
+			continue;
+		}
+
+		ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+		ev.data.ptr = c;
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->sock, &ev);
+	}
+
+	while ( _TRUE )
+	{
+		if ( pending == 0 && connectedAt == 0 )
+		{
+			connectedAt = loadgen_now();
+			w->connectSecs = connectedAt - start;
+			deadline = connectedAt + w->seconds;
+		}
+		if ( connectedAt != 0 && loadgen_now() >= deadline )
+			break;
+
+		event_count = epoll_wait(epoll_fd, events, LOADGEN_MAX_EVENTS, 100);
+		if ( event_count < 0 && errno != EINTR )
+			break;
+
+		for ( i = 0; i < event_count; i++ )
+		{
+			c = (LoadConn *)events[i].data.ptr;
+			if ( c->sock == SOCKET_ERROR )
+				continue;
+
+			if ( !c->connected )
+			{
+				err = 0;
+				len = sizeof(err);
+				getsockopt(c->sock, SOL_SOCKET, SO_ERROR, &err, &len);
+				if ( err != 0 || (events[i].events & (EPOLLERR | EPOLLHUP)) )
+				{
+					Socket_Close(c->sock);
+					c->sock = SOCKET_ERROR;
+					w->failed++;
+					pending--;
+					continue;
+				}
+				c->connected = _TRUE;
+				w->connected++;
+				pending--;
+			}
+
+			if ( loadgen_pump(c, req, connectedAt != 0 ? _TRUE : _FALSE, &w->requests) < 0 )
+			{
+				Socket_Close(c->sock);
+				c->sock = SOCKET_ERROR;
+			}
+		}
+	}
+
+	for ( i = 0; i < w->nconns; i++ )
+	{
+		if ( conns[i].sock != SOCKET_ERROR )
+			Socket_Close(conns[i].sock);
+	}
+
+	Socket_Close(epoll_fd);
+	free(conns);
+	return (void *)"SUCCESS";
+}
+
+short client_loadgen()
+{
+	int i, nconns = 10000, nthreads = 4, seconds = 10;
+	double connectSecs = 0;
+	unsigned long connected = 0, failed = 0, requests = 0;
+	LoadWorker *workers;
+	SocketInfo sockInfo = getSocketInfo();
+
+	printf("\n Enter connections threads seconds (e.g. 10000 4 10) : ");
+	if ( scanf("%d %d %d", &nconns, &nthreads, &seconds) != 3 || nconns < 1 || nthreads < 1 || seconds < 1 )
+	{
+		printf("\n Invalid load parameters\n");
+		return -1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	raise_fd_limit();
+
+	workers = (LoadWorker *)calloc(nthreads, sizeof(LoadWorker));
+	if ( workers == NULL )
+		return -1;
+
+	for ( i = 0; i < nthreads; i++ )
+	{
+		workers[i].id = i;
+		workers[i].nconns = nconns / nthreads + (i < nconns % nthreads ? 1 : 0);
+		workers[i].seconds = seconds;
+		workers[i].server.sin_family = AF_INET;
+		workers[i].server.sin_addr.s_addr = inet_addr(sockInfo.hostIP);
+		workers[i].server.sin_port = htons(sockInfo.hostPort);
+
+		if ( pthread_create(&workers[i].tid, NULL, loadgen_worker, &workers[i]) != 0 )
+		{
+			File_Log("WORKER %d : Thread creation failed", i);
+			nthreads = i;
+			break;
+		}
+	}
+
+	for ( i = 0; i < nthreads; i++ )
+	{
+		pthread_join(workers[i].tid, NULL);
+		connected += workers[i].connected;
+		failed    += workers[i].failed;
+		requests  += workers[i].requests;
+		if ( workers[i].connectSecs > connectSecs )
+			connectSecs = workers[i].connectSecs;
+	}
+
+	File_Log("LOADGEN => connections %lu (failed %lu) in %.3f s => %.0f conn/s", connected, failed, connectSecs,
+			connectSecs > 0 ? connected / connectSecs : 0.0);
+	File_Log("LOADGEN => requests %lu in %d s => %.0f req/s (%d byte echo, closed loop)\n", requests, seconds,
+			(double)requests / seconds, LOADGEN_REQ_SIZE);
+
+	free(workers);
+	return 0;
+}
+
+
+/*****************************************    TLS Handshake Benchmark     *************************************************/
+
+/*
+ * Same echo request, three ways of getting a TLS connection for it:
+ *   full    : new connection + full handshake per request (the old Socket_ClientInit behaviour)
+ *   resumed : new connection per request, handshake resumes the saved session
+ *   pooled  : connections from ConnPool, a handshake only when the pool is empty
+ * Needs isSSL = _TRUE in getSocketInfo() here and in server.cpp, server running Server-Multi-Thread.
+ * The client CPU per request comes from getrusage(); the server logs its own "TLS STATS" lines.
+ */
+
+#define TLS_BENCH_REQ_SIZE   64
+
+typedef enum
+{
+	TLS_BENCH_FULL,
+	TLS_BENCH_RESUMED,
+	TLS_BENCH_POOLED
+}TLS_BENCH_MODE;
+
+typedef struct TLS_BENCH_WORKER
+{
+	pthread_t tid;
+	TLS_BENCH_MODE mode;
+	int seconds;
+	ConnPool *pool;
+	unsigned long requests;
+	unsigned long failed;
+}TlsBenchWorker;
+
+static double tls_bench_cpu(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+void *tls_bench_worker(void *args)
+{
+	TlsBenchWorker *w = (TlsBenchWorker *)args;
+	unsigned char req[TLS_BENCH_REQ_SIZE], rsp[TLS_BENCH_REQ_SIZE + 1];
+	double end = loadgen_now() + w->seconds;
+	SocketHandle conn;
+	BOOLEAN ok;
+	int ret;
+
+	memset(req, 'T', sizeof(req));
+
+	while ( loadgen_now() < end )
+	{
+		if ( w->mode == TLS_BENCH_POOLED )
+			conn = Pool_Acquire(w->pool);
+		else
+			conn = Socket_ClientConnect(w->mode == TLS_BENCH_RESUMED ? _TRUE : _FALSE);
+
+		if ( !conn.isConnected )
+		{
+			w->failed++;
+			usleep(1000);                           // server down or overloaded, do not spin
+			continue;
+		}
+
+		ret = Socket_Write(conn.sock, conn.ssl, req, sizeof(req));
+		if ( ret == (int)sizeof(req) )
+			ret = Socket_Read(conn.sock, conn.ssl, rsp, sizeof(rsp));
+		ok = ( ret == (int)sizeof(req) ) ? _TRUE : _FALSE;
+
+		if ( ok )
+			w->requests++;
+		else
+			w->failed++;
+
+		if ( w->mode == TLS_BENCH_POOLED )
+			Pool_Release(w->pool, &conn, ok);
+		else
+			Socket_Destroy(&conn);
+	}
+
+	return (void *)"SUCCESS";
+}
+
+short client_tls_bench()
+{
+	static const char *modeName[] = { "full", "resumed", "pooled" };
+	int i, mode, nthreads = 4, seconds = 10;
+	unsigned long requests, failed, handshakes, resumed;
+	double cpu;
+	TlsBenchWorker *workers;
+	SocketInfo sockInfo = getSocketInfo();
+	ConnPool pool;
+
+	if ( !sockInfo.isSSL )
+	{
+		printf("\n Set isSSL = _TRUE in getSocketInfo() of client and server first\n");
+		return -1;
+	}
+
+	printf("\n Enter threads seconds per mode (e.g. 4 10) : ");
+	if ( scanf("%d %d", &nthreads, &seconds) != 2 || nthreads < 1 || seconds < 1 )
+	{
+		printf("\n Invalid benchmark parameters\n");
+		return -1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	workers = (TlsBenchWorker *)calloc(nthreads, sizeof(TlsBenchWorker));
+	if ( workers == NULL )
+		return -1;
+
+	Pool_Init(&pool);
+
+	for ( mode = TLS_BENCH_FULL; mode <= TLS_BENCH_POOLED; mode++ )
+	{
+		requests = failed = 0;
+		handshakes = tlsHandshakes;
+		resumed = tlsResumed;
+		cpu = tls_bench_cpu();
+
+		for ( i = 0; i < nthreads; i++ )
+		{
+			memset(&workers[i], 0, sizeof(TlsBenchWorker));
+			workers[i].mode = (TLS_BENCH_MODE)mode;
+			workers[i].seconds = seconds;
+			workers[i].pool = &pool;
+
+			if ( pthread_create(&workers[i].tid, NULL, tls_bench_worker, &workers[i]) != 0 )
+			{
+				File_Log("WORKER %d : Thread creation failed", i);
+				nthreads = i;
+				break;
+			}
+		}
+
+		for ( i = 0; i < nthreads; i++ )
+		{
+			pthread_join(workers[i].tid, NULL);
+			requests += workers[i].requests;
+			failed   += workers[i].failed;
+		}
+
+		cpu = tls_bench_cpu() - cpu;
+		handshakes = tlsHandshakes - handshakes;
+		resumed = tlsResumed - resumed;
+
+		File_Log("TLS BENCH => %-7s : %8.0f req/s  %8.0f handshakes/s (resumed %5.1f%%)  client CPU %7.1f us/req  failed %lu",
+				modeName[mode], (double)requests / seconds, (double)handshakes / seconds,
+				handshakes ? 100.0 * resumed / handshakes : 0.0, requests ? cpu * 1e6 / requests : 0.0, failed);
+	}
+
+	File_Log("TLS BENCH => pool opened %lu connections, reused idle ones %lu times\n", pool.opened, pool.reused);
+
+	Pool_Destroy(&pool);
+	free(workers);
+	return 0;
+}
+
+
+/*****************************************    Pipelined Benchmark     *************************************************/
+
+/*
+ * Framed echo requests (frame.h) against Server-Pipelined, one thread per connection:
+ *   lockstep  : one request in flight: send, wait for the response, send the next
+ *   pipelined : <depth> requests in flight; each response frees its slot for the next request and
+ *               all responses that arrived together are answered with one send()
+ * The message id is (sequence << 8 | slot) and responses are matched by id, so the server may answer
+ * in any order; "out of order" counts responses that came after one to a later request.
+ */
+
+#define PIPE_REQ_SIZE        64
+#define PIPE_MAX_DEPTH       256          // server's PIPE_MAX_INFLIGHT
+
+typedef struct PIPE_BENCH_WORKER
+{
+	pthread_t tid;
+	unsigned int depth;
+	int seconds;
+	unsigned long requests;
+	unsigned long outOfOrder;
+	unsigned long errors;
+}PipeBenchWorker;
+
+static int pipe_bench_queue(FrameConn *fc, unsigned int *slotId, unsigned int slot, unsigned int seq)
+{
+	unsigned char req[PIPE_REQ_SIZE];
+
+	memset(req, 'P', sizeof(req));
+	memcpy(req, &seq, sizeof(seq));
+	slotId[slot] = (seq << 8) | slot;
+
+	return Frame_Queue(fc, slotId[slot], req, sizeof(req));
+}
+
+void *pipe_bench_worker(void *args)
+{
+	PipeBenchWorker *w = (PipeBenchWorker *)args;
+	SocketInfo sockInfo = getSocketInfo();
+	unsigned int slotId[PIPE_MAX_DEPTH], slot, seq = 0, rseq, lastSeq = 0;
+	int ret, on = 1;
+	double end;
+	FrameConn fc;
+	Frame frame;
+	SOCKET sock;
+
+	sock = Socket_Open(sockInfo.hostIP, sockInfo.hostPort);
+	if ( sock == SOCKET_ERROR || Frame_Init(&fc, sock, NULL) != 0 )
+	{
+		w->errors++;
+		return (void *)"FAIL";
+	}
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	set_socket_rcv_timeout(sock, 30);
+
+	for ( slot = 0; slot < w->depth; slot++ )
+		pipe_bench_queue(&fc, slotId, slot, ++seq);
+	ret = Frame_Flush(&fc);
+
+	end = loadgen_now() + w->seconds;
+	while ( ret > 0 && loadgen_now() < end )
+	{
+		ret = Frame_Read(&fc, &frame);
+
+		while ( ret == 1 )
+		{
+			slot = frame.id & 0xff;
+			if ( frame.len != PIPE_REQ_SIZE || slot >= w->depth || frame.id != slotId[slot] )
+			{
+				ret = -1;                                   // not a response to a request in flight
+				break;
+			}
+
+			memcpy(&rseq, frame.payload, sizeof(rseq));
+			if ( rseq < lastSeq )
+				w->outOfOrder++;
+			lastSeq = rseq;
+			w->requests++;
+
+			pipe_bench_queue(&fc, slotId, slot, ++seq);
+			ret = Frame_Next(&fc, &frame);                  // answer everything already received at once
+		}
+
+		if ( ret < 0 )
+			break;
+		ret = Frame_Flush(&fc);
+	}
+
+	if ( ret < 0 )
+	{
+		w->errors++;
+		File_Log("PIPE BENCH => connection error after %lu requests", w->requests);
+	}
+
+	Frame_Free(&fc);
+	Socket_Close(sock);
+	return (void *)"SUCCESS";
+}
+
+short client_pipeline_bench()
+{
+	int i, round, nconns = 4, depth = 64, seconds = 10;
+	unsigned long requests, outOfOrder, errors;
+	double rate[2] = {0};
+	PipeBenchWorker *workers;
+
+	printf("\n Enter connections depth seconds (e.g. 4 64 10) : ");
+	if ( scanf("%d %d %d", &nconns, &depth, &seconds) != 3 || nconns < 1 || depth < 1 || depth > PIPE_MAX_DEPTH || seconds < 1 )
+	{
+		printf("\n Invalid benchmark parameters (depth 1..%d)\n", PIPE_MAX_DEPTH);
+		return -1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	workers = (PipeBenchWorker *)calloc(nconns, sizeof(PipeBenchWorker));
+	if ( workers == NULL )
+		return -1;
+
+	for ( round = 0; round < 2; round++ )                  // lockstep, then pipelined
+	{
+		requests = outOfOrder = errors = 0;
+
+		for ( i = 0; i < nconns; i++ )
+		{
+			memset(&workers[i], 0, sizeof(PipeBenchWorker));
+			workers[i].depth = round == 0 ? 1 : depth;
+			workers[i].seconds = seconds;
+			if ( pthread_create(&workers[i].tid, NULL, pipe_bench_worker, &workers[i]) != 0 )
+			{
+				File_Log("WORKER %d : Thread creation failed", i);
+				nconns = i;
+				break;
+			}
+		}
+
+		for ( i = 0; i < nconns; i++ )
+		{
+			pthread_join(workers[i].tid, NULL);
+			requests   += workers[i].requests;
+			outOfOrder += workers[i].outOfOrder;
+			errors     += workers[i].errors;
+		}
+
+		rate[round] = (double)requests / seconds;
+		File_Log("PIPE BENCH => %-9s depth %3d : %9.0f req/s over %d connections, out of order %lu, errors %lu",
+				round == 0 ? "lockstep" : "pipelined", round == 0 ? 1 : depth, rate[round], nconns, outOfOrder, errors);
+	}
+
+	File_Log("PIPE BENCH => pipelining gain x%.1f\n", rate[0] > 0 ? rate[1] / rate[0] : 0.0);
+
+	free(workers);
+	return 0;
+}
+
+
+/*****************************************    ISO8583 Gateway Benchmark     *************************************************/
+
+/*
+ * 0200 authorization requests against Server-ISO8583-Gateway, one thread per connection, <depth>
+ * requests in flight. All responses that one read brought are answered with new requests in one send().
+ * A response must be a 0210 with D39 "00"; its D11 names the slot, its D37 the request sequence of
+ * that slot. With "split" every send goes out in slices of 1..7 bytes, so the gateway sees messages
+ * and their length headers cut at every possible place.
+ */
+
+#define ISO_BENCH_MAX_DEPTH  1024         // server's GW_MAX_INFLIGHT / 2
+#define ISO_BENCH_SPANS      256
+
+typedef struct ISO_BENCH_WORKER
+{
+	pthread_t tid;
+	unsigned int depth;
+	int seconds;
+	BOOLEAN split;
+	unsigned long requests;
+	unsigned long errors;
+}IsoBenchWorker;
+
+static int iso_bench_queue(FrameConn *fc, unsigned int *slotSeq, unsigned int slot, unsigned int seq)
+{
+	unsigned char arena[256], pkt[256];
+	char rrn[13];
+	int len;
+	IsoBuilder b;
+
+	slotSeq[slot] = seq;
+	snprintf(rrn, sizeof(rrn), "%012u", seq);
+
+	isoBuilderInit(&b, 200, arena, sizeof(arena));
+	isoSetStr(&b, 2, "4761739001010010", -1);
+	isoSetNum(&b, 3, 0);
+	isoSetNum(&b, 4, 1000 + seq % 9000);
+	isoSetStr(&b, 7, "1019120000", -1);
+	isoSetNum(&b, 11, slot);
+	isoSetStr(&b, 12, "120000", -1);
+	isoSetStr(&b, 13, "1019", -1);
+	isoSetStr(&b, 37, rrn, 12);
+	isoSetStr(&b, 41, "41012001", -1);
+	isoSetStr(&b, 42, "MERCHANT0000001", -1);
+	isoSetStr(&b, 49, "840", -1);
+
+	len = isoPack(&b, pkt, sizeof(pkt));
+	return len > 0 ? Frame_QueueRaw(fc, pkt, len) : -1;
+}
+
+// Frame_Flush(), or the output buffer in slices of 1..7 bytes
+static int iso_bench_send(FrameConn *fc, BOOLEAN split)
+{
+	int ret;
+	size_t slice;
+
+	if ( !split )
+		return Frame_Flush(fc);
+
+	while ( fc->out.start < fc->out.end )
+	{
+		slice = 1 + rand() % 7;
+		if ( slice > fc->out.end - fc->out.start )
+			slice = fc->out.end - fc->out.start;
+		ret = send(fc->sock, fc->out.data + fc->out.start, slice, MSG_NOSIGNAL);
+		if ( ret < 0 )
+			return -1;
+		fc->out.start += ret;
+	}
+	fc->out.start = fc->out.end = 0;
+
+	return 1;
+}
+
+void *iso_bench_worker(void *args)
+{
+	IsoBenchWorker *w = (IsoBenchWorker *)args;
+	SocketInfo sockInfo = getSocketInfo();
+	unsigned int slotSeq[ISO_BENCH_MAX_DEPTH], slot, seq = 0;
+	unsigned long long stan;
+	int i, n, ret, on = 1;
+	char rrn[13], rsp[3], expected[13];
+	double end;
+	FrameConn fc;
+	FrameSpan spans[ISO_BENCH_SPANS];
+	IsoMsg msg;
+	SOCKET sock;
+
+	sock = Socket_Open(sockInfo.hostIP, sockInfo.hostPort);
+	if ( sock == SOCKET_ERROR || Frame_Init(&fc, sock, NULL) != 0 )
+	{
+		w->errors++;
+		return (void *)"FAIL";
+	}
+	fc.proto = FRAME_PROTO_ISO8583;
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	set_socket_rcv_timeout(sock, 30);
+
+	for ( slot = 0; slot < w->depth; slot++ )
+		iso_bench_queue(&fc, slotSeq, slot, ++seq);
+	ret = iso_bench_send(&fc, w->split);
+
+	end = loadgen_now() + w->seconds;
+	while ( ret > 0 && loadgen_now() < end )
+	{
+		n = Frame_NextIso(&fc, spans, ISO_BENCH_SPANS);
+		if ( n == 0 )
+		{
+			ret = Frame_Fill(&fc);
+			continue;
+		}
+		if ( n < 0 )
+		{
+			ret = -1;                                       // stream out of step
+			break;
+		}
+
+		for ( i = 0; i < n; i++ )
+		{
+			if ( isoUnpack(spans[i].data, spans[i].len, &msg) != ISO_OK || isoGetMTI(&msg) != 210 ||
+					isoGetNum(&msg, 11, &stan) != 0 || stan >= w->depth ||
+					isoGetStr(&msg, 37, rrn, sizeof(rrn)) != 12 || isoGetStr(&msg, 39, rsp, sizeof(rsp)) != 2 )
+			{
+				ret = -1;
+				break;
+			}
+			snprintf(expected, sizeof(expected), "%012u", slotSeq[stan]);
+			if ( strcmp(rrn, expected) != 0 || strcmp(rsp, "00") != 0 )
+			{
+				ret = -1;                                   // not the response to the request in flight
+				break;
+			}
+
+			w->requests++;
+			iso_bench_queue(&fc, slotSeq, (unsigned int)stan, ++seq);
+		}
+
+		if ( ret < 0 )
+			break;
+		ret = iso_bench_send(&fc, w->split);
+	}
+
+	if ( ret <= 0 )
+	{
+		w->errors++;
+		File_Log("ISO BENCH => connection error after %lu requests", w->requests);
+	}
+
+	Frame_Free(&fc);
+	Socket_Close(sock);
+	return (void *)"SUCCESS";
+}
+
+short client_iso_bench()
+{
+	int i, nconns = 4, depth = 256, seconds = 10, split = 0;
+	unsigned long requests = 0, errors = 0;
+	IsoBenchWorker *workers;
+
+	printf("\n Enter connections depth seconds split (e.g. 4 256 10 0) : ");
+	if ( scanf("%d %d %d %d", &nconns, &depth, &seconds, &split) != 4 || nconns < 1 || depth < 1 ||
+			depth > ISO_BENCH_MAX_DEPTH || seconds < 1 )
+	{
+		printf("\n Invalid benchmark parameters (depth 1..%d)\n", ISO_BENCH_MAX_DEPTH);
+		return -1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	workers = (IsoBenchWorker *)calloc(nconns, sizeof(IsoBenchWorker));
+	if ( workers == NULL )
+		return -1;
+
+	for ( i = 0; i < nconns; i++ )
+	{
+		workers[i].depth = depth;
+		workers[i].seconds = seconds;
+		workers[i].split = split ? _TRUE : _FALSE;
+		if ( pthread_create(&workers[i].tid, NULL, iso_bench_worker, &workers[i]) != 0 )
+		{
+			File_Log("WORKER %d : Thread creation failed", i);
+			nconns = i;
+			break;
+		}
+	}
+
+	for ( i = 0; i < nconns; i++ )
+	{
+		pthread_join(workers[i].tid, NULL);
+		requests += workers[i].requests;
+		errors   += workers[i].errors;
+	}
+
+	File_Log("ISO BENCH => depth %d%s : %9.0f msg/s over %d connections, errors %lu\n", depth,
+			split ? " (split sends)" : "", (double)requests / seconds, nconns, errors);
+
+	free(workers);
+	return 0;
+}
+
+
 int main()
 {
 
         int choice = 0;
 
+        Log_Init("log_c", LOG_ECHO_STDOUT);
+
         printf("\n\n\n---------------- Choose the client you want to run-------------------------\n");
         printf("\n 1. Client-Server");
         printf("\n 2. Client-Server-Multi-Process");
@@ -701,6 +1618,10 @@ int main()
         printf("\n 4. Client-Server-Select");
         printf("\n 5. Client-Server-Poll");
         printf("\n 6. Client-Server-Epoll");
+        printf("\n 7. Load-Generator (conn/s, req/s)");
+        printf("\n 8. TLS-Handshake-Benchmark (full / resumed / pooled)");
+        printf("\n 9. Pipelined-Benchmark (framed, lockstep vs pipelined)");
+        printf("\n10. ISO8583-Gateway-Benchmark (authorizations in flight, split sends)");
 
         printf("\n\n Enter your choice : ");
         scanf("%d", &choice);
@@ -713,7 +1634,10 @@ int main()
                 case 4: client_server_polling(); break;
                 case 5: client_server_polling(); break;
                 case 6: client_server_polling(); break;
-                case 7: break;
+                case 7: client_loadgen(); break;
+                case 8: client_tls_bench(); break;
+                case 9: client_pipeline_bench(); break;
+                case 10: client_iso_bench(); break;
                 default: printf("\n Sorry !!!! , You have entered in invalid choice\n"); break;
         }
 
@@ -0,0 +1,291 @@
+/*
+      Length-prefixed framing, see frame.h
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "frame.h"
+
+
+// Makes room for need more bytes after end: compacts first, grows only when that is not enough.
+static int frame_reserve(FrameBuffer *b, size_t need)
+{
+	size_t size;
+	unsigned char *data;
+
+	if ( b->start == b->end )
+		b->start = b->end = 0;
+
+	if ( b->size - b->end >= need )
+		return 0;
+
+	if ( b->start > 0 )
+	{
+		memmove(b->data, b->data + b->start, b->end - b->start);
+		b->end -= b->start;
+		b->start = 0;
+		if ( b->size - b->end >= need )
+			return 0;
+	}
+
+	size = b->size ? b->size : FRAME_BUF_SIZE;
+	while ( size - b->end < need )
+		size *= 2;
+
+	data = (unsigned char *)realloc(b->data, size);
+	if ( data == NULL )
+		return -1;
+
+	b->data = data;
+	b->size = size;
+	return 0;
+}
+
+int Frame_Init(FrameConn *fc, int sock, SSL *ssl)
+{
+	memset(fc, 0, sizeof(FrameConn));
+	fc->sock = sock;
+	fc->ssl = ssl;
+
+	// Non-blocking SSL_write() retries may come with a moved (realloc) and longer output buffer
+	if ( ssl )
+		SSL_set_mode(ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+	return frame_reserve(&fc->in, FRAME_BUF_SIZE);
+}
+
+void Frame_Free(FrameConn *fc)
+{
+	free(fc->in.data);
+	free(fc->out.data);
+	memset(&fc->in, 0, sizeof(FrameBuffer));
+	memset(&fc->out, 0, sizeof(FrameBuffer));
+}
+
+// Two BCD digits, -1 when a nibble is above 9
+static int frame_bcd(unsigned char b)
+{
+	if ( (b >> 4) > 9 || (b & 0x0F) > 9 )
+		return -1;
+	return (b >> 4) * 10 + (b & 0x0F);
+}
+
+// Length of the ISO8583 message at p (avail >= 2): -1 when the header is not a valid length
+static int frame_iso_len(const unsigned char *p)
+{
+	int hi = frame_bcd(p[0]), lo = frame_bcd(p[1]);
+
+	if ( hi < 0 || lo < 0 || hi * 100 + lo < FRAME_ISO_MIN )
+		return -1;
+	return hi * 100 + lo;
+}
+
+int Frame_Fill(FrameConn *fc)
+{
+	int ret, err, isoLen;
+	unsigned int len;
+	size_t avail = fc->in.end - fc->in.start, need = FRAME_BUF_SIZE / 4;
+
+	if ( fc->proto == FRAME_PROTO_ISO8583 )
+	{
+		isoLen = avail >= 2 ? frame_iso_len(fc->in.data + fc->in.start) : -1;
+		if ( isoLen > 0 && (size_t)isoLen > avail + need )   // partial message: make room for all of it
+			need = isoLen - avail;
+	}
+	else if ( avail >= FRAME_HEADER_SIZE )        // partial frame: make room for all of it
+	{
+		memcpy(&len, fc->in.data + fc->in.start, sizeof(len));
+		len = ntohl(len);
+		if ( len <= FRAME_MAX_PAYLOAD && FRAME_HEADER_SIZE + len - avail > need )
+			need = FRAME_HEADER_SIZE + len - avail;
+	}
+
+	if ( frame_reserve(&fc->in, need) != 0 )
+		return -1;
+
+	while ( 1 )
+	{
+		if ( fc->ssl )
+		{
+			ret = SSL_read(fc->ssl, fc->in.data + fc->in.end, (int)(fc->in.size - fc->in.end));
+			if ( ret <= 0 )
+			{
+				err = SSL_get_error(fc->ssl, ret);
+				if ( err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE )
+					return FRAME_AGAIN;
+				return err == SSL_ERROR_ZERO_RETURN ? 0 : -1;
+			}
+		}
+		else
+		{
+			ret = recv(fc->sock, fc->in.data + fc->in.end, fc->in.size - fc->in.end, 0);
+			if ( ret < 0 )
+			{
+				if ( errno == EINTR )
+					continue;
+				return (errno == EAGAIN || errno == EWOULDBLOCK) ? FRAME_AGAIN : -1;
+			}
+			if ( ret == 0 )
+				return 0;
+		}
+
+		fc->in.end += ret;
+		return ret;
+	}
+}
+
+int Frame_Next(FrameConn *fc, Frame *frame)
+{
+	unsigned int len, id;
+	size_t avail = fc->in.end - fc->in.start;
+	unsigned char *p = fc->in.data + fc->in.start;
+
+	if ( avail < FRAME_HEADER_SIZE )
+		return 0;
+
+	memcpy(&len, p, sizeof(len));
+	memcpy(&id, p + 4, sizeof(id));
+	len = ntohl(len);
+
+	if ( len > FRAME_MAX_PAYLOAD )
+		return -1;
+	if ( avail < FRAME_HEADER_SIZE + len )
+		return 0;
+
+	frame->id = ntohl(id);
+	frame->len = len;
+	frame->payload = p + FRAME_HEADER_SIZE;
+	fc->in.start += FRAME_HEADER_SIZE + len;
+
+	return 1;
+}
+
+int Frame_NextIso(FrameConn *fc, FrameSpan *spans, int max)
+{
+	int n = 0, len;
+	unsigned char *p = fc->in.data + fc->in.start, *end = fc->in.data + fc->in.end;
+
+	while ( n < max && end - p >= 2 )
+	{
+		len = frame_iso_len(p);
+		if ( len < 0 )
+			return -1;
+		if ( end - p < len )
+			break;
+
+		spans[n].data = p;
+		spans[n].len = len;
+		n++;
+		p += len;
+	}
+
+	fc->in.start = p - fc->in.data;
+	return n;
+}
+
+unsigned char *Frame_Detach(FrameConn *fc)
+{
+	unsigned char *old = fc->in.data, *data;
+	size_t rest = fc->in.end - fc->in.start;
+
+	data = (unsigned char *)malloc(fc->in.size);
+	if ( data == NULL )
+		return NULL;
+
+	memcpy(data, old + fc->in.start, rest);
+	fc->in.data = data;
+	fc->in.start = 0;
+	fc->in.end = rest;
+
+	return old;
+}
+
+int Frame_Read(FrameConn *fc, Frame *frame)
+{
+	int ret;
+
+	while ( 1 )
+	{
+		ret = Frame_Next(fc, frame);
+		if ( ret != 0 )
+			return ret;
+
+		ret = Frame_Fill(fc);
+		if ( ret == 0 )
+			return 0;
+		if ( ret < 0 )                            // FRAME_AGAIN here is a receive timeout
+			return -1;
+	}
+}
+
+int Frame_Queue(FrameConn *fc, unsigned int id, const void *payload, unsigned int len)
+{
+	unsigned int header[2];
+
+	if ( len > FRAME_MAX_PAYLOAD || frame_reserve(&fc->out, FRAME_HEADER_SIZE + len) != 0 )
+		return -1;
+
+	header[0] = htonl(len);
+	header[1] = htonl(id);
+	memcpy(fc->out.data + fc->out.end, header, FRAME_HEADER_SIZE);
+	memcpy(fc->out.data + fc->out.end + FRAME_HEADER_SIZE, payload, len);
+	fc->out.end += FRAME_HEADER_SIZE + len;
+
+	return 0;
+}
+
+int Frame_QueueRaw(FrameConn *fc, const void *data, unsigned int len)
+{
+	if ( frame_reserve(&fc->out, len) != 0 )
+		return -1;
+
+	memcpy(fc->out.data + fc->out.end, data, len);
+	fc->out.end += len;
+
+	return 0;
+}
+
+int Frame_Flush(FrameConn *fc)
+{
+	int ret, err;
+
+	while ( fc->out.start < fc->out.end )
+	{
+		if ( fc->ssl )
+		{
+			ret = SSL_write(fc->ssl, fc->out.data + fc->out.start, (int)(fc->out.end - fc->out.start));
+			if ( ret <= 0 )
+			{
+				err = SSL_get_error(fc->ssl, ret);
+				return (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) ? FRAME_AGAIN : -1;
+			}
+		}
+		else
+		{
+			ret = send(fc->sock, fc->out.data + fc->out.start, fc->out.end - fc->out.start, MSG_NOSIGNAL);
+			if ( ret < 0 )
+			{
+				if ( errno == EINTR )
+					continue;
+				return (errno == EAGAIN || errno == EWOULDBLOCK) ? FRAME_AGAIN : -1;
+			}
+		}
+
+		fc->out.start += ret;
+	}
+
+	fc->out.start = fc->out.end = 0;
+	return 1;
+}
+
+int Frame_Write(FrameConn *fc, unsigned int id, const void *payload, unsigned int len)
+{
+	if ( Frame_Queue(fc, id, payload, len) != 0 )
+		return -1;
+
+	return Frame_Flush(fc);
+}
@@ -0,0 +1,105 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+/****************************************************************************
+ *
+ * Length-prefixed framing for the client-server stream
+ *
+ *   | length (4 bytes) | message id (4 bytes) | payload (length bytes) |      both fields network order
+ *
+ * A stream read can return half a message or several; FrameConn keeps a reusable read buffer per
+ * connection and Frame_Next() cuts complete frames out of it, so the handlers never assume
+ * "one recv() is one message". The message id is chosen by the sender of a request and copied
+ * into its response: a client can keep many requests in flight on one connection (pipelining)
+ * and the server may answer them in any order.
+ *
+ * Output is queued with Frame_Queue() and sent with Frame_Flush(), so a batch of frames costs one
+ * send(). Both work on blocking and non-blocking sockets, with or without SSL.
+ *
+ * ISO8583 links (proto FRAME_PROTO_ISO8583) carry no id: every message starts with its own 2-byte BCD
+ * length, counting those 2 bytes (the Iso8583Parser wire format). Frame_NextIso() cuts all complete
+ * messages out of the read buffer at once, a header split across two reads included; Frame_Detach()
+ * lets them live on while the connection keeps reading.
+ *
+ *   gcc -c -O2 -DISO8583_NO_MAIN ../iso8583/Iso8583Parser.c
+ *   g++ server.cpp frame.cpp ../logger/async_log.cpp Iso8583Parser.o -lssl -lcrypto -lpthread -o server
+ *
+ * ***************************************************************************/
+
+#include <openssl/ssl.h>
+
+#define FRAME_HEADER_SIZE   8
+#define FRAME_MAX_PAYLOAD   (64 * 1024)
+#define FRAME_BUF_SIZE      (16 * 1024)   // initial buffer, grows up to one max frame (+ header)
+
+#define FRAME_AGAIN         -2            // non-blocking socket: nothing more to read / write now
+
+#define FRAME_PROTO_ID      0             // | length | message id | payload |
+#define FRAME_PROTO_ISO8583 1             // | BCD length (2 bytes, counts itself) | MTI | bitmap | ... |
+#define FRAME_ISO_MIN       (2 + 2 + 8)   // length, MTI and primary bitmap
+#define FRAME_ISO_MAX       9999          // what 4 BCD digits can say
+
+typedef struct FRAME_BUFFER
+{
+	unsigned char *data;
+	size_t size;                          // allocated
+	size_t start;                         // first unconsumed byte
+	size_t end;                           // one past the last valid byte
+}FrameBuffer;
+
+typedef struct FRAME_CONN
+{
+	int sock;
+	SSL *ssl;
+	int proto;                            // FRAME_PROTO_*, set after Frame_Init()
+	FrameBuffer in;                       // received, not yet parsed
+	FrameBuffer out;                      // queued, not yet sent
+}FrameConn;
+
+typedef struct FRAME
+{
+	unsigned int id;
+	unsigned int len;
+	unsigned char *payload;               // points into the read buffer, valid until the next Frame_Fill()
+}Frame;
+
+typedef struct FRAME_SPAN
+{
+	unsigned char *data;                  // whole ISO8583 message, length bytes included
+	unsigned int len;
+}FrameSpan;
+
+int  Frame_Init(FrameConn *fc, int sock, SSL *ssl);
+void Frame_Free(FrameConn *fc);
+
+// One recv() into the read buffer: bytes read, 0 on EOF, FRAME_AGAIN, -1 on error.
+int  Frame_Fill(FrameConn *fc);
+
+// Next complete frame already in the buffer: 1 got one, 0 need more bytes, -1 bad length.
+int  Frame_Next(FrameConn *fc, Frame *frame);
+
+// ISO8583: up to max complete messages from the read buffer, without copying: the spans point into it and
+// stay valid until the next Frame_Fill() or Frame_Detach(). Returns the count (0: need more bytes), -1 on
+// a length that is not BCD or out of range: the stream is out of step and the connection must go.
+int  Frame_NextIso(FrameConn *fc, FrameSpan *spans, int max);
+
+// Takes the read buffer away (the caller frees it, spans into it stay valid) and continues in a new one
+// holding the bytes not consumed yet, at most one partial message. NULL when out of memory.
+unsigned char *Frame_Detach(FrameConn *fc);
+
+// Blocking socket: reads until a whole frame is available. 1 got one, 0 on EOF, -1 on error.
+int  Frame_Read(FrameConn *fc, Frame *frame);
+
+// Appends one frame to the output buffer. 0 OK, -1 too big / no memory.
+int  Frame_Queue(FrameConn *fc, unsigned int id, const void *payload, unsigned int len);
+
+// Sends the output buffer: 1 all sent, FRAME_AGAIN socket full (rest stays queued), -1 on error.
+int  Frame_Flush(FrameConn *fc);
+
+// Appends bytes that carry their own framing (ISO8583 messages). 0 OK, -1 no memory.
+int  Frame_QueueRaw(FrameConn *fc, const void *data, unsigned int len);
+
+// Frame_Queue() + Frame_Flush().
+int  Frame_Write(FrameConn *fc, unsigned int id, const void *payload, unsigned int len);
+
+#endif
@@ -1,5 +1,6 @@
 /*
-      g++ server.cpp -lssl -lpthread -o server
+      gcc -c -O2 -DISO8583_NO_MAIN ../iso8583/Iso8583Parser.c
+      g++ server.cpp frame.cpp ../logger/async_log.cpp Iso8583Parser.o -lssl -lcrypto -lpthread -o server
 */
 
 /****************************************************************************
@@ -46,6 +47,13 @@
  * int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
  * int epoll_wait(int epfd, struct epoll_event events[.maxevents], int maxevents, int timeout);
  *
+ * int accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags);   // SOCK_NONBLOCK
+ * setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, ...) : N sockets bind the same ip:port, kernel load balances accept()
+ *
+ * int io_uring_setup(u32 entries, struct io_uring_params *p);                      // syscall(__NR_io_uring_setup, ...)
+ * int io_uring_enter(unsigned int fd, u32 to_submit, u32 min_complete, u32 flags, sigset_t *sig);
+ * int io_uring_register(unsigned int fd, unsigned int opcode, void *arg, unsigned int nr_args);
+ *
  *
  *
  *
@@ -79,10 +87,21 @@
 #include <arpa/inet.h>
 #include <poll.h>
 #include <sys/epoll.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
 
 // POSIX Threads
 #include <pthread.h>
 
+#include "../logger/async_log.h"
+#include "../iso8583/Iso8583Parser.h"
+#include "frame.h"
+
 #define LINUX
 
 #ifdef WINDOWS
@@ -147,8 +166,6 @@ static int password_cb(char *buf,int num,int rwflag,void *userdata);
 void generate_eph_rsa_key(SSL_CTX *ctx);
 void load_dh_params(SSL_CTX *ctx, char *file);
 
-int Time_Get(char *outField);
-int File_Log(const char* format, ...);
 BOOLEAN set_socket_nonblock(SOCKET sd);
 BOOLEAN set_socket_rcv_timeout(SOCKET sock, int secs);
 
@@ -165,6 +182,12 @@ short server_select(void);
 short server_select_with_client_array();
 short server_poll();
 short server_epoll();
+short server_multiReactor();
+short server_io_uring();
+short server_pipelined();
+short server_iso_gateway();
+SOCKET Socket_InitReusePort(const char *host, unsigned short port, int backlog);
+void raise_fd_limit(void);
 
 pthread_mutex_t lock;
 static char *pass;
@@ -359,6 +382,64 @@ void Socket_Destroy(SocketHandle *Socket)
 }
 
 
+/****************************************************************************
+ *
+ * TLS session resumption
+ *
+ * A full handshake costs the server an RSA private key operation plus the key exchange; a resumed
+ * one only derives keys from the saved master secret. Both mechanisms are enabled:
+ *
+ *   session cache  : server keeps SSL_SESSIONs keyed by session ID (TLS 1.2 clients)
+ *   session ticket : server encrypts the session state into a ticket that the client stores and
+ *                    presents again (TLS 1.2 and 1.3, nothing kept on the server). The ticket keys
+ *                    are created with the SSL_CTX, so forked server processes accept each other's tickets.
+ *
+ * A session is only resumable if the connection ended with SSL_shutdown(); SSL_free() alone
+ * marks it bad. handleClient_mThread() also keeps the connection open for further requests
+ * (keep-alive) until the client closes it or TLS_KEEPALIVE_SECS pass without a request.
+ *
+ * ***************************************************************************/
+
+#define TLS_SESSION_ID_CONTEXT   "client-server"
+#define TLS_SESSION_CACHE_SIZE   20480
+#define TLS_SESSION_TIMEOUT_SECS 3600
+#define TLS_KEEPALIVE_SECS       30
+#define TLS_STATS_EVERY          1000     // handshakes between CPU usage log lines
+
+static unsigned long tlsHandshakes, tlsResumed;
+
+// Counts a completed handshake; every TLS_STATS_EVERY logs the process CPU time per handshake.
+static void tls_stats_update(SSL *ssl)
+{
+	static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+	static double lastCpu;
+	static unsigned long lastHandshakes, lastResumed;
+	struct rusage ru;
+	double cpu;
+
+	pthread_mutex_lock(&statsLock);
+
+	tlsHandshakes++;
+	if ( SSL_session_reused(ssl) )
+		tlsResumed++;
+
+	if ( tlsHandshakes - lastHandshakes >= TLS_STATS_EVERY )
+	{
+		getrusage(RUSAGE_SELF, &ru);
+		cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+
+		File_Log("TLS STATS => handshakes %lu (resumed %lu) => last %lu : %lu resumed, %.1f us CPU per handshake",
+				tlsHandshakes, tlsResumed, tlsHandshakes - lastHandshakes, tlsResumed - lastResumed,
+				(cpu - lastCpu) * 1e6 / (tlsHandshakes - lastHandshakes));
+
+		lastCpu = cpu;
+		lastHandshakes = tlsHandshakes;
+		lastResumed = tlsResumed;
+	}
+
+	pthread_mutex_unlock(&statsLock);
+}
+
 SSL_CTX *initialize_ctx (char *certfile, char *keyfile, char *CA, char *password)
 {
 	int ret = 0;
@@ -420,6 +501,14 @@ SSL_CTX *initialize_ctx (char *certfile, char *keyfile, char *CA, char *password
 	SSL_CTX_set_verify_depth (ctx,2);
 	SSL_CTX_set_verify (ctx, SSL_VERIFY_PEER, verify_callback);
 
+	/* Session resumption: server side session cache + stateless tickets */
+	SSL_CTX_set_session_id_context(ctx, (const unsigned char *)TLS_SESSION_ID_CONTEXT, strlen(TLS_SESSION_ID_CONTEXT));
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+	SSL_CTX_sess_set_cache_size(ctx, TLS_SESSION_CACHE_SIZE);
+	SSL_CTX_set_timeout(ctx, TLS_SESSION_TIMEOUT_SECS);
+	SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+	SSL_CTX_set_num_tickets(ctx, 1);                // TLS 1.3 sends 2 by default, the client keeps one
+
 	//File_Log("SSL CTX Initialization OK");
 
 	return ctx;
@@ -464,11 +553,17 @@ void check_cert_chain (SSL *ssl, char *host)
 		File_Log("Certificate doesn't verify");
 	/*Check the common name*/
 	peer = SSL_get_peer_certificate (ssl);
+	if ( peer == NULL )
+	{
+		File_Log("No peer certificate");
+		return;
+	}
 	X509_NAME_get_text_by_NID (X509_get_subject_name (peer), NID_commonName, peer_CN, 256);
 	if (strcmp(peer_CN, host)){
 		File_Log("Common name not matched");
 		File_Log("%s : %s", peer_CN, host);
 	}
+	X509_free(peer);
 	
 }
 
@@ -511,65 +606,6 @@ void generate_eph_rsa_key(SSL_CTX *ctx)
 	RSA_free(rsa);
 }
 
-int File_Log(const char* format, ...)
-{
-	int ret=0;
-	int month = 0;
-	int fp = 0;
-	char buffer[15001] = {'\0'};
-	char logfile[30] = {'\0'};	
-
-	va_list args;
-
-	month = Time_Get(buffer);
-
-	va_start(args, format);
-	vsprintf (&buffer[strlen(buffer)], format, args );
-	va_end(args);	
-
-	sprintf(logfile, "log_s_%02d.txt", month);
-
-	printf("%s", buffer);
-
-
-	fp = open (logfile, O_WRONLY|O_APPEND|O_CREAT, S_IWRITE | S_IREAD); // S_IWRITE - Open or Create with write permission 
-	
-	if(fp<0)
-	{
-		switch(errno)
-		{
-			case EACCES: //return _ERR_FILE_ACCESS; 
-			case EMFILE: //return _ERR_FILE_TOO_MANY_HANDLERS;
-			default: //return _ERR_FILE_UNKNOWN;
-				return -1;
-		}
-	}
-
-	ret = write(fp, (const char *)buffer,strlen(buffer));
-
-	close(fp);
-
-	return ret;
-	
-
-}
-
-
-int Time_Get(char *outField)
-{
-
-	time_t t = time(0);
-	struct tm* lt = localtime(&t);
- 	char time_str[128] = {0};
-	
-	sprintf(time_str, "\n%02d%02d%02d: %02d/%02d/%02d: => ", lt->tm_hour, lt->tm_min, lt->tm_sec, lt->tm_mon + 1, lt->tm_mday, lt->tm_year - 100);
-
-	strncat(outField, time_str, strlen(time_str));
-	return lt->tm_mon + 1;
-}
-
-
-
 void printEventPoll(unsigned long event)
 {
 	if ( event & POLLIN )
@@ -773,30 +809,45 @@ void *handleClient_mThread(void *args)
 
 		SSL_set_bio(ssl, sbio, sbio);
 		ret = SSL_accept(ssl);
-		check_cert_chain(ssl, clientContext.sockInfo->commonName);
-	    	if ( ret < 0)
+	    	if ( ret <= 0)
 		{
 			SSL_free(ssl);
 			Socket_Close(peer_sock);
 			File_Log("SD %4d => %s:%d => Client %d => DISCONNECT ERROR SSL_accept()", peer_sock, inet_ntoa(address.sin_addr), ntohs(address.sin_port), count);
 			return (void *)"FAIL";
 		}	
+		check_cert_chain(ssl, clientContext.sockInfo->commonName);
+
+		tls_stats_update(ssl);
+		File_Log("SD %4d => %s:%d => Client %d => %s %s handshake", peer_sock, inet_ntoa(address.sin_addr), ntohs(address.sin_port), count,
+				SSL_get_version(ssl), SSL_session_reused(ssl) ? "RESUMED" : "FULL");
 	}
 
-	
-	ret = Socket_Read (peer_sock, ssl, buffer, sizeof(buffer));
-	File_Log("SD %4d => %s:%d => Client %d => RCV => %d => %s", peer_sock, inet_ntoa(address.sin_addr), ntohs(address.sin_port), count, ret, buffer);
+	// Keep-alive: serve requests until the client closes or stays idle for TLS_KEEPALIVE_SECS
+	set_socket_rcv_timeout(peer_sock, TLS_KEEPALIVE_SECS);
 
-	if ( ret > 0 )
+	while ( 1 )
 	{
+		memset(buffer, 0, sizeof(buffer));
+		ret = Socket_Read (peer_sock, ssl, buffer, sizeof(buffer) - 1);
+		File_Log("SD %4d => %s:%d => Client %d => RCV => %d => %s", peer_sock, inet_ntoa(address.sin_addr), ntohs(address.sin_port), count, ret, buffer);
+
+		if ( ret <= 0 )
+			break;
+
 		ret = Socket_Write(peer_sock, ssl, buffer, ret); 
 		File_Log("SD %4d => %s:%d => Client %d => SND => %d => %s", peer_sock, inet_ntoa(address.sin_addr), ntohs(address.sin_port), count, ret, (ret > 0) ? (char *)buffer : " ");
-	}
 
+		if ( ret <= 0 )
+			break;
+	}
 
 
 	if ( ssl)
+	{
+		SSL_shutdown(ssl);                      // keeps the session resumable
 		SSL_free(ssl);
+	}
 
 	Socket_Close(peer_sock);
 	
@@ -932,7 +983,7 @@ short server_multiProcess()
 		peer_sock  = accept(listener_sock, NULL, NULL);
 		if ( peer_sock == SOCKET_ERROR)
 		{
-			File_Log("ERROR : accept() failed %d");
+			File_Log("ERROR : accept() failed %d", errno);
 			exit(EXIT_FAILURE);
 		}
 		
@@ -1002,7 +1053,7 @@ short server_multiThread(void)
 		return -1;
 	}
 
-
+	signal(SIGPIPE, SIG_IGN);                       // keep-alive peers may vanish between requests
 
 	Server = Socket_ServerInit();
 	if ( !Server.isConnected)
@@ -1024,7 +1075,7 @@ short server_multiThread(void)
 		client = accept(Server.sock, &client_address, &client_address_len);
 		if ( client == SOCKET_ERROR)
 		{
-			File_Log("ERROR : accept() failed %d");
+			File_Log("ERROR : accept() failed %d", errno);
 			break;
 		}
 
@@ -1036,6 +1087,7 @@ short server_multiThread(void)
 			printf("ERROR : pthread_create() failed");
 			break;
 		}
+		pthread_detach(tid);
 
 	}
 
@@ -1664,9 +1716,1704 @@ short server_epoll()
 }	
 
 
-int main()
+/*****************************************    Multi-Reactor (SO_REUSEPORT)     *************************************************/
+
+/*
+ * One reactor thread per core. Each reactor owns
+ *   - its own listener bound with SO_REUSEPORT  -> the kernel spreads incoming connections, no shared accept queue
+ *   - its own epoll instance                    -> no cross-thread wakeups or locks on the I/O path
+ *   - its own pool of connection objects        -> fixed buffer per connection, recycled through a free list
+ * Connections are non-blocking and edge-triggered: read until EAGAIN, echo, and when the peer stops
+ * draining keep the unsent bytes, arm EPOLLOUT and stop reading until they are flushed (backpressure).
+ * Nothing is logged per request, only per-second totals from the main thread.
+ */
+
+#define REACTOR_MAX_EVENTS   1024
+#define REACTOR_BUF_SIZE     4096
+#define REACTOR_POOL_CHUNK   256          // connection objects allocated per pool refill
+#define REACTOR_ACCEPT_BATCH 64           // accepts per listener wakeup, keeps the loop fair
+#define REACTOR_STATS_SECS   5
+
+// Single writer (the owning reactor): plain load + relaxed atomic store, no locked instruction.
+#define REACTOR_COUNT(field) __atomic_store_n(&(field), (field) + 1, __ATOMIC_RELAXED)
+
+typedef struct REACTOR_CONN
 {
-	int choice = 0;
+	SOCKET sock;
+	int len;                              // bytes in buf to echo
+	int off;                              // bytes of buf already sent
+	BOOLEAN wantWrite;                    // EPOLLOUT armed
+	struct REACTOR_CONN *next;            // free list link
+	unsigned char buf[REACTOR_BUF_SIZE];
+}ReactorConn;
+
+typedef struct REACTOR
+{
+	int id;
+	pthread_t tid;
+	SOCKET listener;
+	SOCKET epoll_fd;
+	ReactorConn *freeList;
+	unsigned long accepted;               // published with relaxed atomic stores, read by the stats loop
+	unsigned long closed;
+	unsigned long requests;
+	unsigned long syscalls;               // epoll_wait/epoll_ctl/accept4/recv/send/close issued
+}Reactor;
+
+
+void raise_fd_limit(void)
+{
+	struct rlimit rl;
+
+	if ( getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max )
+	{
+		rl.rlim_cur = rl.rlim_max;
+		if ( setrlimit(RLIMIT_NOFILE, &rl) != 0 )
+			File_Log("ERROR : setrlimit RLIMIT_NOFILE");
+	}
+}
+
+
+SOCKET Socket_InitReusePort(const char *host, unsigned short port, int backlog)
+{
+	int on = 1;
+	SOCKET sock;
+	struct sockaddr_in address;
+
+	sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if ( sock == SOCKET_ERROR )
+	{
+		File_Log("Socket Initialize Error");
+		return SOCKET_ERROR;
+	}
+
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if ( setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == SOCKET_ERROR )
+	{
+		File_Log("ERROR : SO_REUSEPORT");
+		Socket_Close(sock);
+		return SOCKET_ERROR;
+	}
+
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = inet_addr(host);
+	address.sin_port = htons(port);
+
+	if ( bind(sock, (struct sockaddr *)&address, sizeof(address)) == SOCKET_ERROR )
+	{
+		File_Log("bind() failed");
+		Socket_Close(sock);
+		return SOCKET_ERROR;
+	}
+
+	if ( listen(sock, backlog) == SOCKET_ERROR )
+	{
+		File_Log("listen() failed");
+		Socket_Close(sock);
+		return SOCKET_ERROR;
+	}
+
+	return sock;
+}
+
+
+static ReactorConn *reactor_conn_get(Reactor *r)
+{
+	int i;
+	ReactorConn *conn, *chunk;
+
+	if ( r->freeList == NULL )
+	{
+		chunk = (ReactorConn *)malloc(REACTOR_POOL_CHUNK * sizeof(ReactorConn));
+		if ( chunk == NULL )
+			return NULL;
+
+		for ( i = 0; i < REACTOR_POOL_CHUNK; i++ )
+		{
+			chunk[i].next = r->freeList;
+			r->freeList = &chunk[i];
+		}
+	}
+
+	conn = r->freeList;
+	r->freeList = conn->next;
+	conn->len = conn->off = 0;
+	conn->wantWrite = _FALSE;
+	return conn;
+}
+
+static void reactor_conn_close(Reactor *r, ReactorConn *conn)
+{
+	Socket_Close(conn->sock);               // close() also drops it from the epoll set
+	conn->next = r->freeList;
+	r->freeList = conn;
+	REACTOR_COUNT(r->closed);
+	REACTOR_COUNT(r->syscalls);
+}
+
+static void reactor_arm(Reactor *r, ReactorConn *conn, BOOLEAN wantWrite)
+{
+	struct epoll_event ev;
+
+	if ( conn->wantWrite == wantWrite )
+		return;
+
+	ev.events = EPOLLIN | EPOLLET | EPOLLRDHUP | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+	ev.data.ptr = conn;
+	epoll_ctl(r->epoll_fd, EPOLL_CTL_MOD, conn->sock, &ev);
+	conn->wantWrite = wantWrite;
+	REACTOR_COUNT(r->syscalls);
+}
+
+// Returns 1 when buf is fully sent, 0 when the socket is full, -1 on error.
+static int reactor_flush(Reactor *r, ReactorConn *conn)
+{
+	int ret;
+
+	while ( conn->off < conn->len )
+	{
+		ret = send(conn->sock, conn->buf + conn->off, conn->len - conn->off, MSG_NOSIGNAL);
+		REACTOR_COUNT(r->syscalls);
+		if ( ret < 0 )
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+		conn->off += ret;
+	}
+
+	conn->len = conn->off = 0;
+	return 1;
+}
+
+// Edge-triggered: keep reading until EAGAIN, unless output is backed up.
+static void reactor_on_readable(Reactor *r, ReactorConn *conn)
+{
+	int ret;
+
+	while ( conn->len == 0 )
+	{
+		ret = recv(conn->sock, conn->buf, REACTOR_BUF_SIZE, 0);
+		REACTOR_COUNT(r->syscalls);
+		if ( ret == 0 || (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) )
+		{
+			reactor_conn_close(r, conn);
+			return;
+		}
+		if ( ret < 0 )
+			return;                         // drained
+
+		REACTOR_COUNT(r->requests);
+		conn->len = ret;
+
+		ret = reactor_flush(r, conn);
+		if ( ret < 0 )
+		{
+			reactor_conn_close(r, conn);
+			return;
+		}
+		if ( ret == 0 )
+			reactor_arm(r, conn, _TRUE);    // peer not reading, wait for EPOLLOUT
+	}
+}
+
+static void reactor_on_writable(Reactor *r, ReactorConn *conn)
+{
+	int ret = reactor_flush(r, conn);
+
+	if ( ret < 0 )
+	{
+		reactor_conn_close(r, conn);
+		return;
+	}
+	if ( ret == 0 )
+		return;
+
+	reactor_arm(r, conn, _FALSE);
+	reactor_on_readable(r, conn);           // input that arrived while paused raised no new edge
+}
+
+static void reactor_accept(Reactor *r)
+{
+	int i, on = 1;
+	SOCKET peer_sock;
+	ReactorConn *conn;
+	struct epoll_event ev;
+
+	for ( i = 0; i < REACTOR_ACCEPT_BATCH; i++ )
+	{
+		peer_sock = accept4(r->listener, NULL, NULL, SOCK_NONBLOCK);
+		REACTOR_COUNT(r->syscalls);
+		if ( peer_sock < 0 )
+		{
+			if ( errno != EAGAIN && errno != EWOULDBLOCK )
+				File_Log("REACTOR %d => ERROR : accept4() %s", r->id, strerror(errno));
+			return;
+		}
+
+		setsockopt(peer_sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+		conn = reactor_conn_get(r);
+		if ( conn == NULL )
+		{
+			File_Log("REACTOR %d => ERROR : connection pool exhausted", r->id);
+			Socket_Close(peer_sock);
+			continue;
+		}
+		conn->sock = peer_sock;
+
+		ev.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
+		ev.data.ptr = conn;
+		if ( epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, peer_sock, &ev) == SOCKET_ERROR )
+		{
+			File_Log("REACTOR %d => ERROR : EPOLL CTL ADD", r->id);
+			Socket_Close(peer_sock);
+			conn->next = r->freeList;
+			r->freeList = conn;
+			continue;
+		}
+
+		REACTOR_COUNT(r->accepted);
+	}
+}
+
+void *reactor_loop(void *args)
+{
+	int i, event_count;
+	unsigned long event;
+	ReactorConn *conn;
+	Reactor *r = (Reactor *)args;
+	struct epoll_event events[REACTOR_MAX_EVENTS];
+
+	while ( _TRUE )
+	{
+		event_count = epoll_wait(r->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+		REACTOR_COUNT(r->syscalls);
+		if ( event_count < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			File_Log("REACTOR %d => ERROR : EPOLL WAIT", r->id);
+			break;
+		}
+
+		for ( i = 0; i < event_count; i++ )
+		{
+			event = events[i].events;
+			conn = (ReactorConn *)events[i].data.ptr;
+
+			if ( conn == NULL )                        // listener (level-triggered)
+			{
+				reactor_accept(r);
+			}
+			else if ( event & (EPOLLHUP | EPOLLERR) )
+			{
+				reactor_conn_close(r, conn);
+			}
+			else if ( event & EPOLLOUT )               // writable first: it resumes reading itself
+			{
+				reactor_on_writable(r, conn);
+			}
+			else if ( event & (EPOLLIN | EPOLLRDHUP) ) // RDHUP: read the rest, recv() == 0 closes
+			{
+				reactor_on_readable(r, conn);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+short server_multiReactor()
+{
+	int i, ret, nreactors;
+	Reactor *reactors;
+	struct epoll_event ev;
+	unsigned long accepted, closed, requests, syscalls;
+	unsigned long last_accepted = 0, last_requests = 0, last_syscalls = 0;
+
+	SocketInfo sockInfo = getSocketInfo();
+
+	signal(SIGPIPE, SIG_IGN);
+	raise_fd_limit();
+
+	nreactors = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if ( nreactors < 1 )
+		nreactors = 1;
+
+	reactors = (Reactor *)calloc(nreactors, sizeof(Reactor));
+	if ( reactors == NULL )
+	{
+		File_Log("ERROR : calloc reactors");
+		return -1;
+	}
+
+	for ( i = 0; i < nreactors; i++ )
+	{
+		reactors[i].id = i;
+
+		reactors[i].listener = Socket_InitReusePort(sockInfo.hostIP, sockInfo.hostPort, SOMAXCONN);
+		if ( reactors[i].listener == SOCKET_ERROR )
+			exit(EXIT_FAILURE);
+
+		reactors[i].epoll_fd = epoll_create1(0);
+		if ( reactors[i].epoll_fd == SOCKET_ERROR )
+		{
+			File_Log("ERROR : EPOLL CREATE");
+			exit(EXIT_FAILURE);
+		}
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = NULL;
+		if ( epoll_ctl(reactors[i].epoll_fd, EPOLL_CTL_ADD, reactors[i].listener, &ev) == SOCKET_ERROR )
+		{
+			File_Log("ERROR : EPOLL CTL ADD");
+			exit(EXIT_FAILURE);
+		}
+
+		ret = pthread_create(&reactors[i].tid, NULL, reactor_loop, &reactors[i]);
+		if ( ret != 0 )
+		{
+			File_Log("ERROR : pthread_create() failed");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	File_Log("MULTI-REACTOR => %d reactors on %s:%d", nreactors, sockInfo.hostIP, sockInfo.hostPort);
+
+	// Each counter has one writer; a slightly stale read is fine for stats.
+	while ( _TRUE )
+	{
+		sleep(REACTOR_STATS_SECS);
+
+		accepted = closed = requests = syscalls = 0;
+		for ( i = 0; i < nreactors; i++ )
+		{
+			accepted += __atomic_load_n(&reactors[i].accepted, __ATOMIC_RELAXED);
+			closed   += __atomic_load_n(&reactors[i].closed, __ATOMIC_RELAXED);
+			requests += __atomic_load_n(&reactors[i].requests, __ATOMIC_RELAXED);
+			syscalls += __atomic_load_n(&reactors[i].syscalls, __ATOMIC_RELAXED);
+		}
+
+		File_Log("MULTI-REACTOR => active %lu, conn/s %lu, req/s %lu, syscalls/req %.2f", accepted - closed,
+				(accepted - last_accepted) / REACTOR_STATS_SECS, (requests - last_requests) / REACTOR_STATS_SECS,
+				requests > last_requests ? (double)(syscalls - last_syscalls) / (requests - last_requests) : 0.0);
+		last_accepted = accepted;
+		last_requests = requests;
+		last_syscalls = syscalls;
+	}
+
+	return 0;
+}
+
+
+/*****************************************    Pipelined (framed, out-of-order)     *************************************************/
+
+/*
+ * Framed protocol (frame.h) with many requests in flight per connection:
+ *   - the epoll thread owns every connection: reads, cuts complete frames out of the per-connection
+ *     read buffer and hands each batch of requests to the workers with one lock
+ *   - PIPE_WORKERS threads execute the requests (here: echo the payload) in parallel and post the
+ *     responses back; an eventfd wakes the epoll thread, which queues them and sends each
+ *     connection's responses with one send()
+ *   - responses go out in completion order, the client matches them by message id
+ *   - at most PIPE_MAX_INFLIGHT outstanding requests per connection, and no reading while responses
+ *     are stuck in the output buffer: the TCP window then pushes back on the client
+ * Plain TCP only; frame.cpp handles SSL for blocking sockets.
+ */
+
+#define PIPE_WORKERS         4
+#define PIPE_MAX_INFLIGHT    256
+#define PIPE_MAX_EVENTS      1024
+#define PIPE_WORKER_BATCH    64           // jobs a worker takes per lock
+#define PIPE_STATS_SECS      5
+
+typedef struct PIPE_JOB
+{
+	SOCKET sock;
+	unsigned int generation;              // of the connection when the request was read
+	unsigned int id;
+	unsigned int len;
+	unsigned char *payload;               // request, then response (same buffer, allocated with the job)
+	struct PIPE_JOB *next;
+}PipeJob;
+
+typedef struct PIPE_QUEUE
+{
+	PipeJob *head;
+	PipeJob *tail;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+}PipeQueue;
+
+typedef struct PIPE_CONN
+{
+	FrameConn fc;
+	unsigned int generation;              // bumped on close: responses for an old connection are dropped
+	int inflight;
+	unsigned int lastId;                  // id of the last response queued
+	BOOLEAN open;
+	BOOLEAN wantWrite;                    // EPOLLOUT armed, output backed up
+	BOOLEAN dirty;                        // responses queued since the last flush
+	struct PIPE_CONN *nextDirty;
+}PipeConn;
+
+static PipeConn *pipeConns;               // indexed by fd
+static int pipeConnsMax;
+static PipeQueue pipeTodo, pipeDone;
+static SOCKET pipeEpoll, pipeEventFd;
+static unsigned long pipeRequests, pipeOutOfOrder;
+
+
+// Appends a whole list; returns _TRUE when the queue was empty before.
+static BOOLEAN pipe_queue_push(PipeQueue *q, PipeJob *head, PipeJob *tail)
+{
+	BOOLEAN wasEmpty;
+
+	pthread_mutex_lock(&q->lock);
+	wasEmpty = q->head == NULL ? _TRUE : _FALSE;
+	if ( q->tail )
+		q->tail->next = head;
+	else
+		q->head = head;
+	q->tail = tail;
+	pthread_cond_signal(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+
+	return wasEmpty;
+}
+
+void *pipe_worker(void *)
+{
+	int n;
+	PipeJob *head, *tail;
+
+	while ( _TRUE )
+	{
+		pthread_mutex_lock(&pipeTodo.lock);
+		while ( pipeTodo.head == NULL )
+			pthread_cond_wait(&pipeTodo.cond, &pipeTodo.lock);
+
+		head = tail = pipeTodo.head;
+		for ( n = 1; n < PIPE_WORKER_BATCH && tail->next; n++ )
+			tail = tail->next;
+		pipeTodo.head = tail->next;
+		if ( pipeTodo.head == NULL )
+			pipeTodo.tail = NULL;
+		else
+			pthread_cond_signal(&pipeTodo.cond);    // more left: wake another worker
+		pthread_mutex_unlock(&pipeTodo.lock);
+		tail->next = NULL;
+
+		// The request handler: echo. The payload buffer already holds the response.
+
+		if ( pipe_queue_push(&pipeDone, head, tail) )
+		{
+			unsigned long long one = 1;
+			if ( write(pipeEventFd, &one, sizeof(one)) < 0 )
+				File_Log("PIPELINE => ERROR : eventfd write");
+		}
+	}
+
+	return NULL;
+}
+
+static void pipe_conn_close(PipeConn *c)
+{
+	Frame_Free(&c->fc);
+	Socket_Close(c->fc.sock);
+	c->open = _FALSE;
+	c->generation++;
+}
+
+static void pipe_arm(PipeConn *c, BOOLEAN wantWrite)
+{
+	struct epoll_event ev;
+
+	if ( c->wantWrite == wantWrite )
+		return;
+
+	ev.events = EPOLLIN | EPOLLET | EPOLLRDHUP | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+	ev.data.fd = c->fc.sock;
+	epoll_ctl(pipeEpoll, EPOLL_CTL_MOD, c->fc.sock, &ev);
+	c->wantWrite = wantWrite;
+}
+
+// Reads and dispatches requests until EAGAIN, the in-flight limit or backed up output.
+static void pipe_on_readable(PipeConn *c)
+{
+	int ret;
+	Frame frame;
+	PipeJob *job, *head = NULL, *tail = NULL;
+
+	while ( c->inflight < PIPE_MAX_INFLIGHT && !c->wantWrite )
+	{
+		ret = Frame_Next(&c->fc, &frame);
+		if ( ret == 0 )
+		{
+			ret = Frame_Fill(&c->fc);
+			if ( ret == FRAME_AGAIN )
+				break;
+			if ( ret > 0 )
+				continue;
+		}
+		if ( ret < 0 || ret == 0 )                    // bad frame, EOF or error
+		{
+			pipe_conn_close(c);
+			break;
+		}
+
+		job = (PipeJob *)malloc(sizeof(PipeJob) + frame.len);
+		if ( job == NULL )
+		{
+			pipe_conn_close(c);
+			break;
+		}
+		job->sock = c->fc.sock;
+		job->generation = c->generation;
+		job->id = frame.id;
+		job->len = frame.len;
+		job->payload = (unsigned char *)(job + 1);
+		job->next = NULL;
+		memcpy(job->payload, frame.payload, frame.len);
+
+		if ( tail )
+			tail->next = job;
+		else
+			head = job;
+		tail = job;
+		c->inflight++;
+		REACTOR_COUNT(pipeRequests);
+	}
+
+	if ( head )
+		pipe_queue_push(&pipeTodo, head, tail);
+}
+
+static void pipe_flush(PipeConn *c)
+{
+	int ret = Frame_Flush(&c->fc);
+
+	if ( ret < 0 )
+	{
+		pipe_conn_close(c);
+		return;
+	}
+
+	pipe_arm(c, ret == FRAME_AGAIN ? _TRUE : _FALSE);
+	if ( ret == 1 && c->inflight < PIPE_MAX_INFLIGHT / 2 )
+		pipe_on_readable(c);                          // resume a connection paused by the limits
+}
+
+static void pipe_on_done(void)
+{
+	unsigned long long count;
+	PipeJob *job, *next;
+	PipeConn *c, *dirty = NULL;
+
+	if ( read(pipeEventFd, &count, sizeof(count)) < 0 )
+		return;
+
+	pthread_mutex_lock(&pipeDone.lock);
+	job = pipeDone.head;
+	pipeDone.head = pipeDone.tail = NULL;
+	pthread_mutex_unlock(&pipeDone.lock);
+
+	for ( ; job; job = next )
+	{
+		next = job->next;
+		c = &pipeConns[job->sock];
+
+		if ( c->open && c->generation == job->generation )
+		{
+			if ( job->id < c->lastId )                  // answered after a later request (ids ascending per client)
+				REACTOR_COUNT(pipeOutOfOrder);
+			c->lastId = job->id;
+
+			c->inflight--;
+			if ( Frame_Queue(&c->fc, job->id, job->payload, job->len) != 0 )
+				pipe_conn_close(c);
+			else if ( !c->dirty )
+			{
+				c->dirty = _TRUE;
+				c->nextDirty = dirty;
+				dirty = c;
+			}
+		}
+		free(job);
+	}
+
+	for ( c = dirty; c; c = c->nextDirty )                // one send() per connection
+	{
+		c->dirty = _FALSE;
+		if ( c->open )
+			pipe_flush(c);
+	}
+}
+
+static void pipe_accept(SOCKET listener)
+{
+	int on = 1;
+	SOCKET peer_sock;
+	PipeConn *c;
+	struct epoll_event ev;
+
+	while ( (peer_sock = accept4(listener, NULL, NULL, SOCK_NONBLOCK)) >= 0 )
+	{
+		if ( peer_sock >= pipeConnsMax )
+		{
+			File_Log("PIPELINE => ERROR : fd %d above the connection table", peer_sock);
+			Socket_Close(peer_sock);
+			continue;
+		}
+
+		setsockopt(peer_sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+		c = &pipeConns[peer_sock];
+		if ( Frame_Init(&c->fc, peer_sock, NULL) != 0 )
+		{
+			Socket_Close(peer_sock);
+			continue;
+		}
+		c->inflight = 0;
+		c->lastId = 0;
+		c->wantWrite = c->dirty = _FALSE;
+		c->open = _TRUE;
+
+		ev.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
+		ev.data.fd = peer_sock;
+		if ( epoll_ctl(pipeEpoll, EPOLL_CTL_ADD, peer_sock, &ev) == SOCKET_ERROR )
+		{
+			File_Log("PIPELINE => ERROR : EPOLL CTL ADD");
+			pipe_conn_close(c);
+		}
+	}
+
+	if ( errno != EAGAIN && errno != EWOULDBLOCK )
+		File_Log("PIPELINE => ERROR : accept4() %s", strerror(errno));
+}
+
+void *pipe_loop(void *args)
+{
+	int i, event_count;
+	unsigned long event;
+	SOCKET fd, listener = *(SOCKET *)args;
+	PipeConn *c;
+	struct epoll_event events[PIPE_MAX_EVENTS];
+
+	while ( _TRUE )
+	{
+		event_count = epoll_wait(pipeEpoll, events, PIPE_MAX_EVENTS, -1);
+		if ( event_count < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			File_Log("PIPELINE => ERROR : EPOLL WAIT");
+			break;
+		}
+
+		for ( i = 0; i < event_count; i++ )
+		{
+			event = events[i].events;
+			fd = events[i].data.fd;
+
+			if ( fd == listener )
+			{
+				pipe_accept(listener);
+				continue;
+			}
+			if ( fd == pipeEventFd )
+			{
+				pipe_on_done();
+				continue;
+			}
+
+			c = &pipeConns[fd];
+			if ( !c->open )                                // closed earlier in this batch
+				continue;
+
+			if ( event & (EPOLLHUP | EPOLLERR) )
+				pipe_conn_close(c);
+			else if ( event & EPOLLOUT )
+				pipe_flush(c);
+			else if ( event & (EPOLLIN | EPOLLRDHUP) )
+				pipe_on_readable(c);
+		}
+	}
+
+	return NULL;
+}
+
+short server_pipelined()
+{
+	int i;
+	SOCKET listener;
+	pthread_t tid;
+	struct rlimit rl;
+	struct epoll_event ev;
+	unsigned long requests, last_requests = 0, outOfOrder;
+
+	SocketInfo sockInfo = getSocketInfo();
+
+	signal(SIGPIPE, SIG_IGN);
+	raise_fd_limit();
+
+	getrlimit(RLIMIT_NOFILE, &rl);
+	pipeConnsMax = rl.rlim_cur > 1048576 ? 1048576 : (int)rl.rlim_cur;
+	pipeConns = (PipeConn *)calloc(pipeConnsMax, sizeof(PipeConn));
+	if ( pipeConns == NULL )
+	{
+		File_Log("ERROR : calloc connection table");
+		return -1;
+	}
+
+	pthread_mutex_init(&pipeTodo.lock, NULL);
+	pthread_cond_init(&pipeTodo.cond, NULL);
+	pthread_mutex_init(&pipeDone.lock, NULL);
+	pthread_cond_init(&pipeDone.cond, NULL);
+
+	listener = Socket_InitReusePort(sockInfo.hostIP, sockInfo.hostPort, SOMAXCONN);
+	pipeEpoll = epoll_create1(0);
+	pipeEventFd = eventfd(0, EFD_NONBLOCK);
+	if ( listener == SOCKET_ERROR || pipeEpoll == SOCKET_ERROR || pipeEventFd == SOCKET_ERROR )
+	{
+		File_Log("ERROR : PIPELINE INIT");
+		return -1;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = listener;
+	epoll_ctl(pipeEpoll, EPOLL_CTL_ADD, listener, &ev);
+	ev.events = EPOLLIN;
+	ev.data.fd = pipeEventFd;
+	epoll_ctl(pipeEpoll, EPOLL_CTL_ADD, pipeEventFd, &ev);
+
+	for ( i = 0; i < PIPE_WORKERS; i++ )
+	{
+		if ( pthread_create(&tid, NULL, pipe_worker, NULL) != 0 )
+		{
+			File_Log("ERROR : pthread_create() failed");
+			return -1;
+		}
+	}
+
+	if ( pthread_create(&tid, NULL, pipe_loop, &listener) != 0 )
+	{
+		File_Log("ERROR : pthread_create() failed");
+		return -1;
+	}
+
+	File_Log("PIPELINE => %d workers on %s:%d, %d requests in flight per connection", PIPE_WORKERS,
+			sockInfo.hostIP, sockInfo.hostPort, PIPE_MAX_INFLIGHT);
+
+	while ( _TRUE )
+	{
+		sleep(PIPE_STATS_SECS);
+
+		requests = __atomic_load_n(&pipeRequests, __ATOMIC_RELAXED);
+		outOfOrder = __atomic_load_n(&pipeOutOfOrder, __ATOMIC_RELAXED);
+		File_Log("PIPELINE => req/s %lu, responses sent out of order %lu", (requests - last_requests) / PIPE_STATS_SECS, outOfOrder);
+		last_requests = requests;
+	}
+
+	return 0;
+}
+
+
+/*****************************************    ISO8583 Gateway (stream framer, batched workers)     *************************************************/
+
+/*
+ * An acquirer link: one TCP stream of ISO8583 messages, each starting with its own 2-byte BCD length
+ * (frame.h, FRAME_PROTO_ISO8583). Many messages arrive per recv() and a message can be split anywhere,
+ * its length header included.
+ *   - the epoll thread reads, and Frame_NextIso() finds every complete message in the read buffer
+ *     without copying; the buffer itself then goes to the workers with the message spans
+ *     (Frame_Detach()) and the connection carries on in a fresh one, so nothing is copied per message
+ *   - GW_WORKERS threads decode the batch (isoUnpack()), build the responses (request MTI + 10, the
+ *     routing fields echoed, D39 "00") back to back into one buffer and post the batch back
+ *   - an eventfd wakes the epoll thread, which queues each batch's responses with one copy and sends
+ *     every connection's output with one send()
+ *   - at most GW_MAX_INFLIGHT messages per connection at the workers, and no reading while output is
+ *     stuck: the TCP window then pushes back on the acquirer
+ * Responses to a connection's batches may overtake each other: an acquirer matches them by STAN/RRN.
+ * Plain TCP only.
+ */
+
+#define GW_WORKERS           4
+#define GW_MAX_INFLIGHT      2048         // messages per connection at the workers
+#define GW_MAX_BATCH         512          // messages per batch (a 16 KB read buffer holds at most 1365)
+#define GW_MAX_EVENTS        1024
+#define GW_STATS_SECS        5
+
+typedef struct GW_BATCH
+{
+	SOCKET sock;
+	unsigned int generation;              // of the connection when the messages were read
+	unsigned char *buf;                   // the connection's former read buffer, the spans point into it
+	int count;
+	unsigned char *out;                   // responses back to back
+	unsigned int outLen;
+	struct GW_BATCH *next;
+	FrameSpan span[GW_MAX_BATCH];
+}GwBatch;
+
+typedef struct GW_QUEUE
+{
+	GwBatch *head;
+	GwBatch *tail;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+}GwQueue;
+
+typedef struct GW_CONN
+{
+	FrameConn fc;
+	unsigned int generation;              // bumped on close: responses for an old connection are dropped
+	int inflight;
+	BOOLEAN open;
+	BOOLEAN wantWrite;                    // EPOLLOUT armed, output backed up
+	BOOLEAN dirty;                        // responses queued since the last flush
+	struct GW_CONN *nextDirty;
+}GwConn;
+
+static GwConn *gwConns;                   // indexed by fd
+static int gwConnsMax;
+static GwQueue gwTodo, gwDone;
+static SOCKET gwEpoll, gwEventFd;
+static unsigned long gwMessages, gwBatches, gwRejected;
+
+
+// Appends a whole list; returns _TRUE when the queue was empty before.
+static BOOLEAN gw_queue_push(GwQueue *q, GwBatch *head, GwBatch *tail)
+{
+	BOOLEAN wasEmpty;
+
+	pthread_mutex_lock(&q->lock);
+	wasEmpty = q->head == NULL ? _TRUE : _FALSE;
+	if ( q->tail )
+		q->tail->next = head;
+	else
+		q->head = head;
+	q->tail = tail;
+	pthread_cond_signal(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+
+	return wasEmpty;
+}
+
+// The request handler: authorization response with the fields the acquirer routes and matches on.
+// Returns the response length, -1 for a message that does not decode (no response).
+static int gw_handle(const unsigned char *req, unsigned int len, unsigned char *rsp, int rspSize)
+{
+	static const unsigned char echo[] = { 2, 3, 4, 7, 11, 12, 13, 32, 37, 41, 42, 49 };
+	unsigned char arena[512];
+	char value[100];
+	unsigned int i;
+	int n, mti;
+	IsoMsg msg;
+	IsoBuilder b;
+
+	if ( isoUnpack(req, len, &msg) != ISO_OK || (mti = isoGetMTI(&msg)) < 0 )
+		return -1;
+
+	isoBuilderInit(&b, mti + 10, arena, sizeof(arena));
+	for ( i = 0; i < sizeof(echo); i++ )
+	{
+		n = isoGetStr(&msg, echo[i], value, sizeof(value));
+		if ( n >= 0 && isoSetStr(&b, echo[i], value, n) != ISO_OK )
+			return -1;
+	}
+	isoSetStr(&b, 39, "00", 2);
+
+	return isoPack(&b, rsp, rspSize);
+}
+
+void *gw_worker(void *)
+{
+	int i, len;
+	unsigned int size;
+	GwBatch *batch;
+
+	while ( _TRUE )
+	{
+		pthread_mutex_lock(&gwTodo.lock);
+		while ( gwTodo.head == NULL )
+			pthread_cond_wait(&gwTodo.cond, &gwTodo.lock);
+
+		batch = gwTodo.head;
+		gwTodo.head = batch->next;
+		if ( gwTodo.head == NULL )
+			gwTodo.tail = NULL;
+		else
+			pthread_cond_signal(&gwTodo.cond);      // more left: wake another worker
+		pthread_mutex_unlock(&gwTodo.lock);
+		batch->next = NULL;
+
+		// A response is at most its request + D39 (4 bytes with the bitmap unchanged)
+		for ( i = 0, size = 0; i < batch->count; i++ )
+			size += batch->span[i].len + 4;
+		batch->out = (unsigned char *)malloc(size);
+		batch->outLen = 0;
+
+		for ( i = 0; batch->out && i < batch->count; i++ )
+		{
+			len = gw_handle(batch->span[i].data, batch->span[i].len, batch->out + batch->outLen, size - batch->outLen);
+			if ( len > 0 )
+				batch->outLen += len;
+			else
+				__atomic_fetch_add(&gwRejected, 1, __ATOMIC_RELAXED);   // workers race on it
+		}
+
+		if ( gw_queue_push(&gwDone, batch, batch) )
+		{
+			unsigned long long one = 1;
+			if ( write(gwEventFd, &one, sizeof(one)) < 0 )
+				File_Log("GATEWAY => ERROR : eventfd write");
+		}
+	}
+
+	return NULL;
+}
+
+static void gw_conn_close(GwConn *c)
+{
+	Frame_Free(&c->fc);
+	Socket_Close(c->fc.sock);
+	c->open = _FALSE;
+	c->generation++;
+}
+
+static void gw_arm(GwConn *c, BOOLEAN wantWrite)
+{
+	struct epoll_event ev;
+
+	if ( c->wantWrite == wantWrite )
+		return;
+
+	ev.events = EPOLLIN | EPOLLET | EPOLLRDHUP | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+	ev.data.fd = c->fc.sock;
+	epoll_ctl(gwEpoll, EPOLL_CTL_MOD, c->fc.sock, &ev);
+	c->wantWrite = wantWrite;
+}
+
+// Reads and dispatches messages until EAGAIN, the in-flight limit or backed up output.
+static void gw_on_readable(GwConn *c)
+{
+	int ret;
+	GwBatch *batch = NULL, *head = NULL, *tail = NULL;
+
+	while ( c->inflight < GW_MAX_INFLIGHT && !c->wantWrite )
+	{
+		if ( batch == NULL && (batch = (GwBatch *)malloc(sizeof(GwBatch))) == NULL )
+		{
+			gw_conn_close(c);
+			break;
+		}
+
+		ret = Frame_NextIso(&c->fc, batch->span, GW_MAX_BATCH);
+		if ( ret == 0 )
+		{
+			ret = Frame_Fill(&c->fc);
+			if ( ret == FRAME_AGAIN )
+				break;
+			if ( ret > 0 )
+				continue;
+		}
+		if ( ret <= 0 )                                   // length out of step, EOF or error
+		{
+			gw_conn_close(c);
+			break;
+		}
+
+		batch->buf = Frame_Detach(&c->fc);
+		if ( batch->buf == NULL )
+		{
+			gw_conn_close(c);
+			break;
+		}
+		batch->sock = c->fc.sock;
+		batch->generation = c->generation;
+		batch->count = ret;
+		batch->next = NULL;
+
+		if ( tail )
+			tail->next = batch;
+		else
+			head = batch;
+		tail = batch;
+		batch = NULL;
+
+		c->inflight += ret;
+		__atomic_store_n(&gwMessages, gwMessages + ret, __ATOMIC_RELAXED);
+		REACTOR_COUNT(gwBatches);
+	}
+
+	free(batch);
+	if ( head )
+		gw_queue_push(&gwTodo, head, tail);
+}
+
+static void gw_flush(GwConn *c)
+{
+	int ret = Frame_Flush(&c->fc);
+
+	if ( ret < 0 )
+	{
+		gw_conn_close(c);
+		return;
+	}
+
+	gw_arm(c, ret == FRAME_AGAIN ? _TRUE : _FALSE);
+	if ( ret == 1 && c->inflight < GW_MAX_INFLIGHT / 2 )
+		gw_on_readable(c);                            // resume a connection paused by the limits
+}
+
+static void gw_on_done(void)
+{
+	unsigned long long count;
+	GwBatch *batch, *next;
+	GwConn *c, *dirty = NULL;
+
+	if ( read(gwEventFd, &count, sizeof(count)) < 0 )
+		return;
+
+	pthread_mutex_lock(&gwDone.lock);
+	batch = gwDone.head;
+	gwDone.head = gwDone.tail = NULL;
+	pthread_mutex_unlock(&gwDone.lock);
+
+	for ( ; batch; batch = next )
+	{
+		next = batch->next;
+		c = &gwConns[batch->sock];
+
+		if ( c->open && c->generation == batch->generation )
+		{
+			c->inflight -= batch->count;
+			if ( batch->out == NULL || Frame_QueueRaw(&c->fc, batch->out, batch->outLen) != 0 )
+				gw_conn_close(c);
+			else if ( !c->dirty )
+			{
+				c->dirty = _TRUE;
+				c->nextDirty = dirty;
+				dirty = c;
+			}
+		}
+		free(batch->out);
+		free(batch->buf);
+		free(batch);
+	}
+
+	for ( c = dirty; c; c = c->nextDirty )                // one send() per connection
+	{
+		c->dirty = _FALSE;
+		if ( c->open )
+			gw_flush(c);
+	}
+}
+
+static void gw_accept(SOCKET listener)
+{
+	int on = 1;
+	SOCKET peer_sock;
+	GwConn *c;
+	struct epoll_event ev;
+
+	while ( (peer_sock = accept4(listener, NULL, NULL, SOCK_NONBLOCK)) >= 0 )
+	{
+		if ( peer_sock >= gwConnsMax )
+		{
+			File_Log("GATEWAY => ERROR : fd %d above the connection table", peer_sock);
+			Socket_Close(peer_sock);
+			continue;
+		}
+
+		setsockopt(peer_sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+		c = &gwConns[peer_sock];
+		if ( Frame_Init(&c->fc, peer_sock, NULL) != 0 )
+		{
+			Socket_Close(peer_sock);
+			continue;
+		}
+		c->fc.proto = FRAME_PROTO_ISO8583;
+		c->inflight = 0;
+		c->wantWrite = c->dirty = _FALSE;
+		c->open = _TRUE;
+
+		ev.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
+		ev.data.fd = peer_sock;
+		if ( epoll_ctl(gwEpoll, EPOLL_CTL_ADD, peer_sock, &ev) == SOCKET_ERROR )
+		{
+			File_Log("GATEWAY => ERROR : EPOLL CTL ADD");
+			gw_conn_close(c);
+		}
+	}
+
+	if ( errno != EAGAIN && errno != EWOULDBLOCK )
+		File_Log("GATEWAY => ERROR : accept4() %s", strerror(errno));
+}
+
+void *gw_loop(void *args)
+{
+	int i, event_count;
+	unsigned long event;
+	SOCKET fd, listener = *(SOCKET *)args;
+	GwConn *c;
+	struct epoll_event events[GW_MAX_EVENTS];
+
+	while ( _TRUE )
+	{
+		event_count = epoll_wait(gwEpoll, events, GW_MAX_EVENTS, -1);
+		if ( event_count < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			File_Log("GATEWAY => ERROR : EPOLL WAIT");
+			break;
+		}
+
+		for ( i = 0; i < event_count; i++ )
+		{
+			event = events[i].events;
+			fd = events[i].data.fd;
+
+			if ( fd == listener )
+			{
+				gw_accept(listener);
+				continue;
+			}
+			if ( fd == gwEventFd )
+			{
+				gw_on_done();
+				continue;
+			}
+
+			c = &gwConns[fd];
+			if ( !c->open )                                // closed earlier in this batch
+				continue;
+
+			if ( event & (EPOLLHUP | EPOLLERR) )
+				gw_conn_close(c);
+			else if ( event & EPOLLOUT )
+				gw_flush(c);
+			else if ( event & (EPOLLIN | EPOLLRDHUP) )
+				gw_on_readable(c);
+		}
+	}
+
+	return NULL;
+}
+
+short server_iso_gateway()
+{
+	int i;
+	SOCKET listener;
+	pthread_t tid;
+	struct rlimit rl;
+	struct epoll_event ev;
+	unsigned long messages, last_messages = 0, batches, last_batches = 0, rejected;
+
+	SocketInfo sockInfo = getSocketInfo();
+
+	signal(SIGPIPE, SIG_IGN);
+	raise_fd_limit();
+
+	getrlimit(RLIMIT_NOFILE, &rl);
+	gwConnsMax = rl.rlim_cur > 1048576 ? 1048576 : (int)rl.rlim_cur;
+	gwConns = (GwConn *)calloc(gwConnsMax, sizeof(GwConn));
+	if ( gwConns == NULL )
+	{
+		File_Log("ERROR : calloc connection table");
+		return -1;
+	}
+
+	pthread_mutex_init(&gwTodo.lock, NULL);
+	pthread_cond_init(&gwTodo.cond, NULL);
+	pthread_mutex_init(&gwDone.lock, NULL);
+	pthread_cond_init(&gwDone.cond, NULL);
+
+	listener = Socket_InitReusePort(sockInfo.hostIP, sockInfo.hostPort, SOMAXCONN);
+	gwEpoll = epoll_create1(0);
+	gwEventFd = eventfd(0, EFD_NONBLOCK);
+	if ( listener == SOCKET_ERROR || gwEpoll == SOCKET_ERROR || gwEventFd == SOCKET_ERROR )
+	{
+		File_Log("ERROR : GATEWAY INIT");
+		return -1;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = listener;
+	epoll_ctl(gwEpoll, EPOLL_CTL_ADD, listener, &ev);
+	ev.events = EPOLLIN;
+	ev.data.fd = gwEventFd;
+	epoll_ctl(gwEpoll, EPOLL_CTL_ADD, gwEventFd, &ev);
+
+	for ( i = 0; i < GW_WORKERS; i++ )
+	{
+		if ( pthread_create(&tid, NULL, gw_worker, NULL) != 0 )
+		{
+			File_Log("ERROR : pthread_create() failed");
+			return -1;
+		}
+	}
+
+	if ( pthread_create(&tid, NULL, gw_loop, &listener) != 0 )
+	{
+		File_Log("ERROR : pthread_create() failed");
+		return -1;
+	}
+
+	File_Log("GATEWAY => ISO8583 on %s:%d, %d workers, %d messages in flight per connection", sockInfo.hostIP,
+			sockInfo.hostPort, GW_WORKERS, GW_MAX_INFLIGHT);
+
+	while ( _TRUE )
+	{
+		sleep(GW_STATS_SECS);
+
+		messages = __atomic_load_n(&gwMessages, __ATOMIC_RELAXED);
+		batches = __atomic_load_n(&gwBatches, __ATOMIC_RELAXED);
+		rejected = __atomic_load_n(&gwRejected, __ATOMIC_RELAXED);
+		File_Log("GATEWAY => msg/s %lu, messages per batch %.1f, rejected %lu", (messages - last_messages) / GW_STATS_SECS,
+				batches > last_batches ? (double)(messages - last_messages) / (batches - last_batches) : 0.0, rejected);
+		last_messages = messages;
+		last_batches = batches;
+	}
+
+	return 0;
+}
+
+
+/*****************************************    io_uring (raw syscalls, no liburing)     *************************************************/
+
+/*
+ * Same layout as the multi-reactor mode (one thread per core, own SO_REUSEPORT listener), but every
+ * thread drives an io_uring instead of epoll + recv/send:
+ *   - one multishot ACCEPT SQE per listener produces a CQE per new connection
+ *   - RECV uses a provided buffer ring (IOSQE_BUFFER_SELECT): the kernel picks a buffer only when data
+ *     arrives, so idle connections hold no memory
+ *   - on each RECV CQE: SEND(that buffer) linked (IOSQE_IO_LINK) to the next RECV, the buffer goes
+ *     back to the ring when the SEND CQE arrives. A failed/short send cancels the linked RECV, whose
+ *     -ECANCELED CQE closes the connection (IORING_OP_CLOSE, also batched)
+ *   - a RECV that finds the buffer ring empty (-ENOBUFS) parks its connection on a FIFO; every SEND
+ *     CQE returns a buffer and re-arms the RECV of one parked connection, so an empty ring never
+ *     makes the thread resubmit RECVs in a loop
+ *   - all SQEs produced while draining the CQ are submitted by the io_uring_enter that waits for the
+ *     next completions -> one syscall per batch instead of one per operation
+ *
+ * Echo benchmark, same workload for all three modes (client mode 7, 64 byte closed loop):
+ *     ./server (6 | 7 | 8)        ./client -> 7 -> 2000 2 10
+ *   server_epoll        : per request epoll_wait + getpeername + recv + send + 2 File_Log (open/write/
+ *                         close + printf each), i.e. ~12 syscalls/req (counted from the code)
+ *   server_multiReactor : "syscalls/req" in its stats line
+ *   server_io_uring     : "enter/req" in its stats line
+ *   1 vCPU sandbox, client on the same core:
+ *       epoll 42k req/s (~12 syscalls/req), reactor 92k req/s (2.66), io_uring 67k req/s (0.001)
+ *   The syscall count collapses; throughput on one shared core is bound by the kernel-side recv/send
+ *   work that io_uring still does, so compare req/s on a multi-core box with the client pinned apart.
+ */
+
+#define URING_ENTRIES      4096
+#define URING_BUF_COUNT    4096           // provided buffers per ring (power of two, <= 32768)
+#define URING_BUF_SIZE     2048
+#define URING_BGID         1
+#define URING_STATS_SECS   5
+
+enum { URING_ACCEPT = 1, URING_RECV, URING_SEND, URING_CLOSE };
+
+// user_data = type:8 | bid:16 | fd:32
+#define URING_DATA(type, bid, fd) (((unsigned long long)(type) << 56) | ((unsigned long long)(bid) << 32) | (unsigned int)(fd))
+#define URING_TYPE(d)             ((int)((d) >> 56))
+#define URING_BID(d)              ((unsigned short)((d) >> 32))
+#define URING_FD(d)               ((int)((d) & 0xffffffff))
+
+typedef struct URING
+{
+	int id;
+	pthread_t tid;
+	int ring_fd;
+	SOCKET listener;
+
+	unsigned sq_entries;
+	unsigned sq_tail;                     // local tail, published before io_uring_enter
+	unsigned *sq_khead, *sq_ktail, *sq_kmask, *sq_array;
+	struct io_uring_sqe *sqes;
+
+	unsigned *cq_khead, *cq_ktail, *cq_kmask;
+	struct io_uring_cqe *cqes;
+
+	struct io_uring_buf_ring *br;         // provided buffer ring (tail lives here) + its buffers
+	struct io_uring_buf *br_bufs;         // same memory as br; br->bufs is mis-offset when the header is built as C++
+	unsigned char *bufs;
+	unsigned short br_tail;
+
+	SOCKET *parked;                       // FIFO of connections waiting for a buffer (power of two capacity)
+	unsigned parked_head, parked_cnt, parked_cap;
+
+	unsigned long accepted;               // single writer (REACTOR_COUNT), read by the stats loop
+	unsigned long closed;
+	unsigned long requests;
+	unsigned long enters;                 // io_uring_enter calls
+}Uring;
+
+
+static int uring_setup(Uring *u, unsigned entries)
+{
+	unsigned i;
+	void *sq_ptr, *cq_ptr;
+	size_t sq_size, cq_size;
+	struct io_uring_params p;
+	struct io_uring_buf_reg reg;
+
+	memset(&p, 0, sizeof(p));
+	p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+	u->ring_fd = syscall(__NR_io_uring_setup, entries, &p);
+	if ( u->ring_fd < 0 && errno == EINVAL )           // older kernel: plain ring
+	{
+		memset(&p, 0, sizeof(p));
+		u->ring_fd = syscall(__NR_io_uring_setup, entries, &p);
+	}
+	if ( u->ring_fd < 0 )
+	{
+		File_Log("URING %d => ERROR : io_uring_setup %s", u->id, strerror(errno));
+		return -1;
+	}
+
+	sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if ( p.features & IORING_FEAT_SINGLE_MMAP )
+		sq_size = cq_size = (sq_size > cq_size) ? sq_size : cq_size;
+
+	sq_ptr = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQ_RING);
+	cq_ptr = (p.features & IORING_FEAT_SINGLE_MMAP) ? sq_ptr :
+		mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_CQ_RING);
+	u->sqes = (struct io_uring_sqe *)mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+	if ( sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || u->sqes == MAP_FAILED )
+	{
+		File_Log("URING %d => ERROR : mmap ring", u->id);
+		return -1;
+	}
+
+	u->sq_entries = p.sq_entries;
+	u->sq_khead   = (unsigned *)((char *)sq_ptr + p.sq_off.head);
+	u->sq_ktail   = (unsigned *)((char *)sq_ptr + p.sq_off.tail);
+	u->sq_kmask   = (unsigned *)((char *)sq_ptr + p.sq_off.ring_mask);
+	u->sq_array   = (unsigned *)((char *)sq_ptr + p.sq_off.array);
+	u->sq_tail    = *u->sq_ktail;
+	for ( i = 0; i < p.sq_entries; i++ )               // SQE index == ring slot, set once
+		u->sq_array[i] = i;
+
+	u->cq_khead = (unsigned *)((char *)cq_ptr + p.cq_off.head);
+	u->cq_ktail = (unsigned *)((char *)cq_ptr + p.cq_off.tail);
+	u->cq_kmask = (unsigned *)((char *)cq_ptr + p.cq_off.ring_mask);
+	u->cqes     = (struct io_uring_cqe *)((char *)cq_ptr + p.cq_off.cqes);
+
+	// Provided buffer ring: page aligned ring of URING_BUF_COUNT descriptors + the buffers themselves.
+	u->br = (struct io_uring_buf_ring *)mmap(NULL, URING_BUF_COUNT * sizeof(struct io_uring_buf),
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	u->bufs = (unsigned char *)malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+	if ( u->br == MAP_FAILED || u->bufs == NULL )
+	{
+		File_Log("URING %d => ERROR : buffer ring alloc", u->id);
+		return -1;
+	}
+
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (unsigned long long)u->br;
+	reg.ring_entries = URING_BUF_COUNT;
+	reg.bgid = URING_BGID;
+	if ( syscall(__NR_io_uring_register, u->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0 )
+	{
+		File_Log("URING %d => ERROR : IORING_REGISTER_PBUF_RING %s", u->id, strerror(errno));
+		return -1;
+	}
+
+	u->br_bufs = (struct io_uring_buf *)u->br;
+	u->br_tail = 0;
+	for ( i = 0; i < URING_BUF_COUNT; i++ )
+	{
+		struct io_uring_buf *b = &u->br_bufs[u->br_tail++ & (URING_BUF_COUNT - 1)];
+		b->addr = (unsigned long long)(u->bufs + (size_t)i * URING_BUF_SIZE);
+		b->len  = URING_BUF_SIZE;
+		b->bid  = (unsigned short)i;
+	}
+	__atomic_store_n(&u->br->tail, u->br_tail, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+// Submit what is queued; wait for at least one completion when asked.
+static int uring_enter(Uring *u, unsigned wait)
+{
+	int ret;
+	unsigned to_submit = u->sq_tail - __atomic_load_n(u->sq_khead, __ATOMIC_ACQUIRE);
+
+	__atomic_store_n(u->sq_ktail, u->sq_tail, __ATOMIC_RELEASE);
+	ret = syscall(__NR_io_uring_enter, u->ring_fd, to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	REACTOR_COUNT(u->enters);
+
+	return ( ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY ) ? -1 : 0;
+}
+
+static struct io_uring_sqe *uring_get_sqe(Uring *u)
+{
+	struct io_uring_sqe *sqe;
+
+	// SQ full: push it to the kernel without waiting
+	while ( u->sq_tail - __atomic_load_n(u->sq_khead, __ATOMIC_ACQUIRE) >= u->sq_entries )
+		uring_enter(u, 0);
+
+	sqe = &u->sqes[u->sq_tail & *u->sq_kmask];
+	memset(sqe, 0, sizeof(*sqe));
+	u->sq_tail++;
+	return sqe;
+}
+
+static void uring_prep_accept(Uring *u)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(u);
+
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = u->listener;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;             // one SQE, a CQE per connection
+	sqe->user_data = URING_DATA(URING_ACCEPT, 0, u->listener);
+}
+
+static void uring_prep_recv(Uring *u, SOCKET sock)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(u);
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = sock;
+	sqe->len = URING_BUF_SIZE;
+	sqe->flags = IOSQE_BUFFER_SELECT;                  // kernel picks a buffer from group URING_BGID
+	sqe->buf_group = URING_BGID;
+	sqe->user_data = URING_DATA(URING_RECV, 0, sock);
+}
+
+static void uring_prep_send(Uring *u, SOCKET sock, unsigned short bid, unsigned len)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(u);
+
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = sock;
+	sqe->addr = (unsigned long long)(u->bufs + (size_t)bid * URING_BUF_SIZE);
+	sqe->len = len;
+	sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;       // short send == failure, breaks the link
+	sqe->flags = IOSQE_IO_LINK;                        // next SQE (recv) starts after this completes
+	sqe->user_data = URING_DATA(URING_SEND, bid, sock);
+}
+
+static void uring_prep_close(Uring *u, SOCKET sock)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(u);
+
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = sock;
+	sqe->user_data = URING_DATA(URING_CLOSE, 0, sock);
+	REACTOR_COUNT(u->closed);
+}
+
+static void uring_recycle_buffer(Uring *u, unsigned short bid)
+{
+	struct io_uring_buf *b = &u->br_bufs[u->br_tail & (URING_BUF_COUNT - 1)];
+
+	b->addr = (unsigned long long)(u->bufs + (size_t)bid * URING_BUF_SIZE);
+	b->len  = URING_BUF_SIZE;
+	b->bid  = bid;
+	u->br_tail++;
+	__atomic_store_n(&u->br->tail, u->br_tail, __ATOMIC_RELEASE);
+}
+
+// Every buffer in use belongs to a RECV whose SEND is in flight, so a SEND CQE always follows and
+// unparks the connection. No other operation is outstanding on a parked socket.
+static void uring_park(Uring *u, SOCKET sock)
+{
+	unsigned i, cap;
+	SOCKET *grown;
+
+	if ( u->parked_cnt == u->parked_cap )
+	{
+		cap = u->parked_cap ? u->parked_cap * 2 : 256;
+		grown = (SOCKET *)malloc(cap * sizeof(SOCKET));
+		if ( grown == NULL )
+		{
+			File_Log("URING %d => ERROR : park fd %d, out of memory", u->id, sock);
+			uring_prep_close(u, sock);
+			return;
+		}
+		for ( i = 0; i < u->parked_cnt; i++ )
+			grown[i] = u->parked[(u->parked_head + i) & (u->parked_cap - 1)];
+		free(u->parked);
+		u->parked = grown;
+		u->parked_head = 0;
+		u->parked_cap = cap;
+	}
+
+	u->parked[(u->parked_head + u->parked_cnt++) & (u->parked_cap - 1)] = sock;
+}
+
+static void uring_unpark(Uring *u)
+{
+	if ( u->parked_cnt == 0 )
+		return;
+
+	uring_prep_recv(u, u->parked[u->parked_head]);
+	u->parked_head = (u->parked_head + 1) & (u->parked_cap - 1);
+	u->parked_cnt--;
+}
+
+static void uring_handle_cqe(Uring *u, struct io_uring_cqe *cqe)
+{
+	int on = 1;
+	SOCKET sock = URING_FD(cqe->user_data);
+
+	switch ( URING_TYPE(cqe->user_data) )
+	{
+		case URING_ACCEPT:
+			if ( cqe->res >= 0 )
+			{
+				setsockopt(cqe->res, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+				uring_prep_recv(u, cqe->res);
+				REACTOR_COUNT(u->accepted);
+			}
+			else
+			{
+				File_Log("URING %d => ERROR : accept %s", u->id, strerror(-cqe->res));
+			}
+			if ( !(cqe->flags & IORING_CQE_F_MORE) )   // multishot ended, re-arm
+				uring_prep_accept(u);
+			break;
+
+		case URING_RECV:
+			if ( cqe->res > 0 )
+			{
+				REACTOR_COUNT(u->requests);
+				uring_prep_send(u, sock, (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT), cqe->res);
+				uring_prep_recv(u, sock);              // linked behind the send
+			}
+			else if ( cqe->res == -ENOBUFS )           // ring empty, re-armed when a SEND returns a buffer
+			{
+				uring_park(u, sock);
+			}
+			else                                       // EOF, error, or -ECANCELED by a failed send
+			{
+				uring_prep_close(u, sock);
+			}
+			break;
+
+		case URING_SEND:
+			uring_recycle_buffer(u, URING_BID(cqe->user_data));
+			uring_unpark(u);
+			break;
+
+		case URING_CLOSE:
+			break;
+	}
+}
+
+void *uring_loop(void *args)
+{
+	unsigned head, tail;
+	Uring *u = (Uring *)args;
+
+	// Created on this thread: with IORING_SETUP_SINGLE_ISSUER only the creating task may submit.
+	if ( uring_setup(u, URING_ENTRIES) < 0 )
+		exit(EXIT_FAILURE);
+
+	uring_prep_accept(u);
+
+	while ( _TRUE )
+	{
+		if ( uring_enter(u, 1) < 0 )
+		{
+			File_Log("URING %d => ERROR : io_uring_enter %s", u->id, strerror(errno));
+			break;
+		}
+
+		// Drain every completion; new SQEs go out with the next enter.
+		head = *u->cq_khead;
+		tail = __atomic_load_n(u->cq_ktail, __ATOMIC_ACQUIRE);
+		while ( head != tail )
+		{
+			uring_handle_cqe(u, &u->cqes[head & *u->cq_kmask]);
+			head++;
+			if ( head == tail )
+				tail = __atomic_load_n(u->cq_ktail, __ATOMIC_ACQUIRE);
+		}
+		__atomic_store_n(u->cq_khead, head, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+short server_io_uring()
+{
+	int i, nrings;
+	Uring *rings;
+	unsigned long accepted, closed, requests, enters;
+	unsigned long last_requests = 0, last_enters = 0;
+
+	SocketInfo sockInfo = getSocketInfo();
+
+	signal(SIGPIPE, SIG_IGN);
+	raise_fd_limit();
+
+	nrings = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if ( nrings < 1 )
+		nrings = 1;
+
+	rings = (Uring *)calloc(nrings, sizeof(Uring));
+	if ( rings == NULL )
+	{
+		File_Log("ERROR : calloc rings");
+		return -1;
+	}
+
+	for ( i = 0; i < nrings; i++ )
+	{
+		rings[i].id = i;
+
+		rings[i].listener = Socket_InitReusePort(sockInfo.hostIP, sockInfo.hostPort, SOMAXCONN);
+		if ( rings[i].listener == SOCKET_ERROR )
+			exit(EXIT_FAILURE);
+
+		if ( pthread_create(&rings[i].tid, NULL, uring_loop, &rings[i]) != 0 )
+		{
+			File_Log("ERROR : pthread_create() failed");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	File_Log("IO_URING => %d rings on %s:%d", nrings, sockInfo.hostIP, sockInfo.hostPort);
+
+	while ( _TRUE )
+	{
+		sleep(URING_STATS_SECS);
+
+		accepted = closed = requests = enters = 0;
+		for ( i = 0; i < nrings; i++ )
+		{
+			accepted += __atomic_load_n(&rings[i].accepted, __ATOMIC_RELAXED);
+			closed   += __atomic_load_n(&rings[i].closed, __ATOMIC_RELAXED);
+			requests += __atomic_load_n(&rings[i].requests, __ATOMIC_RELAXED);
+			enters   += __atomic_load_n(&rings[i].enters, __ATOMIC_RELAXED);
+		}
+
+		File_Log("IO_URING => active %lu, req/s %lu, enter/req %.3f", accepted - closed,
+				(requests - last_requests) / URING_STATS_SECS,
+				requests > last_requests ? (double)(enters - last_enters) / (requests - last_requests) : 0.0);
+		last_requests = requests;
+		last_enters = enters;
+	}
+
+	return 0;
+}
+
+
+int main()
+{
+	int choice = 0;
+
+	Log_Init("log_s", LOG_ECHO_STDOUT);
 	
 	printf("\n\n\n---------------- Choose the server you want to run -------------------------\n");
 	printf("\n 1. Server");
@@ -1675,6 +3422,10 @@ int main()
 	printf("\n 4. Server-Select");
 	printf("\n 5. Server-Poll");
 	printf("\n 6. Server-Epoll");
+	printf("\n 7. Server-Multi-Reactor (SO_REUSEPORT, epoll per core)");
+	printf("\n 8. Server-io_uring (multishot accept, provided buffers)");
+	printf("\n 9. Server-Pipelined (framed, out-of-order responses)");
+	printf("\n10. Server-ISO8583-Gateway (stream framer, batched workers)");
 	
 	printf("\n\n Enter your choice : ");
 	scanf("%d", &choice);
@@ -1687,6 +3438,10 @@ int main()
 		case 4: server_select(); break;
 		case 5: server_poll(); break;
 		case 6: server_epoll(); break;
+		case 7: server_multiReactor(); break;
+		case 8: server_io_uring(); break;
+		case 9: server_pipelined(); break;
+		case 10: server_iso_gateway(); break;
 		default: printf("\n Sorry !!!! , You have entered in invalid choice\n"); break;
 	}	
 	
@@ -187,6 +187,8 @@ int main(int argc, char *argv[], char **env)
 #include <fcntl.h>
 #include <stdarg.h>
 
+#include "../logger/async_log.h"
+
 
 typedef enum
 {
@@ -197,13 +199,11 @@ typedef enum
 int File_Read(char *filename, char *buffer, int len);
 int File_Write(char *filename, char *buffer, int len);
 int File_Append(char *filename, char *buffer, int len);
-int File_Log(const char* format, ...);
 STATUS File_Print(char *filename);
 
 int average(int count, ...);
 char *FGETS(char *s, int max, FILE *fp);
 int FPUTS(const char *s, FILE *fp);
-int Time_Get(char *outField);
 void printFileStruct(FILE *fp);
 
 
@@ -296,51 +296,6 @@ STATUS File_Print(char *filename)
 
 }
 
-int File_Log(const char* format, ...)
-{
-	int ret=0;
-	int month = 0;
-	int fp = 0;
-	char buffer[15001] = {'\0'};
-	char logfile[30] = {'\0'};	
-
-	va_list args;
-
-	month = Time_Get(buffer);
-
-	va_start(args, format);
-	vsprintf (&buffer[strlen(buffer)], format, args );
-	va_end(args);	
-
-	sprintf(logfile, "log_%02d.txt", month);
-
-	printf("%s", buffer);
-
-
-	fp = open (logfile, O_WRONLY|O_APPEND|O_CREAT, S_IWRITE | S_IREAD); // S_IWRITE - Open or Create with write permission 
-	
-	if(fp<0)
-	{
-		switch(errno)
-		{
-			case EACCES: //return _ERR_FILE_ACCESS; 
-			case EMFILE: //return _ERR_FILE_TOO_MANY_HANDLERS;
-			default: //return _ERR_FILE_UNKNOWN;
-				printf("\n errno = %d , errstr = %s" , errno, strerror(errno));
-				return -1;
-		}
-	}
-
-	ret = write(fp, (const char *)buffer,strlen(buffer));
-
-	close(fp);
-
-	return ret;
-	
-
-}
-
-
 char *FGETS(char *s, int max, FILE *fp)
 {
 	int c;
@@ -385,20 +340,6 @@ void printFileStruct(FILE *fp)
 }
 
 
-int Time_Get(char *outField)
-{
-
-	time_t t = time(0);
-	struct tm* lt = localtime(&t);
- 	char time_str[128] = {0};
-	
-	sprintf(time_str, "\n%02d%02d%02d: %02d/%02d/%02d: => ", lt->tm_hour, lt->tm_min, lt->tm_sec, lt->tm_mon + 1, lt->tm_mday, lt->tm_year - 100);
-
-	strncat(outField, time_str, strlen(time_str));
-	return lt->tm_mon + 1;
-}
-
-
 int average(int count, ...)
 {
 	int sum = 0;
@@ -416,6 +357,8 @@ int average(int count, ...)
 int main(int argc, char *argv[], char **env)
 {
 	int offset = 0;
+
+	Log_Init("log", LOG_ECHO_STDOUT);
 	File_Log("Number of arguments : %d", argc);
 
 	while ( offset < argc){
@@ -10,6 +10,12 @@
 #include "stdarg.h"
 #include "errno.h"
 #include "Iso8583Parser.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BCD_X86
+#endif
+
+static int File_Log(const char* format, ...);
 //#include "windows.h"
 
 char *padChar(char *src, int pLen, int ch)
@@ -39,2077 +45,843 @@ char *padChar(char *src, int pLen, int ch)
 
 }
 
-int pack(IsoPkt *isoPkt, unsigned char *pkt)
-{
-    	int offset = 0, bcdLen = 0, asciiLen = 0;
-	unsigned char bitmap[17] = {0};
-	unsigned char tempBuffer[1001] = {'\0'};
-	unsigned char lenBuffer[11] = {'\0'};
-	short bitMapLen = isoPkt->isSecondaryBitMapSet ? 16 : 8;
-	short headerLen = 0;
-
-	offset += 2; // Length
-	offset += headerLen; // Header
-	offset += 2; // MTI
-	offset += bitMapLen; // Bit Map
-
-	File_Log("\n----------------- Packing---------------------");
-
-	/************** Field 1  Parsing **********************/
-
-	if ( *(isoPkt->D1)  )
-	{
-		SETBIT(bitmap[0], BIT1);
-	}
-
-	/************** Field 2  ( n ..19 - Primary Account Number ) **********************/
-
-	if ( *(isoPkt->D2)  )
-	{
-
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D2);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		sprintf((char *)lenBuffer, "%02d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 2, 1);
-		memcpy(pkt+offset, tempBuffer, 1);
-		offset += 1;
-
-		strn2BCD(pkt+offset, isoPkt->D2, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[0], BIT2);
-
-	}
-	
-
-	/************** Field 3 ( n 6 - Processing code) **********************/
-	
-	if ( *(isoPkt->D3)  )
-	{
-		asciiLen = strlen((char *)isoPkt->D3);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, isoPkt->D3, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[0], BIT3);
-	}
-	
-
-	/************** Field 4  ( n 12 - Amount, transaction ) **********************/
-
-	if ( *(isoPkt->D4)  )
-	{
-        	memset(tempBuffer, 0, sizeof(tempBuffer));
-    		strcpy((char *)tempBuffer, (char *)isoPkt->D4);
-        	padChar((char *)tempBuffer, -LEN_D4*2, '0');
-        
-		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[0], BIT4);
-	}
-
-	/************** Field 5 ( n 12 - Amount, settlement ) **********************/
-
-	if ( *(isoPkt->D5)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D5);
-        	padChar((char *)tempBuffer, -LEN_D5*2, '0');
-        
-		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[0], BIT5);
-	}
-
-	/************** Field 6  ( n 12 - Amount, cardholder billing ) **********************/
-
-	if ( *(isoPkt->D6)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D6);
-		padChar((char *)tempBuffer, -LEN_D6*2, '0');
-        
-		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[0], BIT6);
-	}
-
-	/************** Field 7  ( n 10 - Transmission date & time) **********************/
-
-	if ( *(isoPkt->D7)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D7);
-        	padChar((char *)tempBuffer, -LEN_D7*2, '0');
-        
-		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[0], BIT7);
-	}
-
-	/************** Field 8  ( n 8 - Amount, cardholder billing fee) **********************/
-
-	if ( *(isoPkt->D8)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D8);
-        	padChar((char *)tempBuffer, -LEN_D8*2, '0');
-        
-		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[0], BIT8);
-	}
-
-
-	/************** Field 9  ( n 8 - Conversion rate, settlement ) **********************/
-
-	if ( *(isoPkt->D9)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D9);
-        	padChar((char *)tempBuffer, -LEN_D9*2, '0');
-        
-		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[1], BIT1);
-	}
-
-	/************** Field 10  ( n 8 - Conversion rate, cardholder billing ) **********************/
-
-	if ( *(isoPkt->D10)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D10);
-        	padChar((char *)tempBuffer, -LEN_D10*2, '0');
-        
-		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[1], BIT2);
-	}
-
-	/************** Field 11  ( n 6 - Systems trace audit number ) **********************/
-
-	if ( *(isoPkt->D11)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D11);
-        	padChar((char *)tempBuffer, -LEN_D11*2, '0');
-        
-		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[1], BIT3);
-	}
-
-	/************** Field 12  ( n 6 - Time, local transaction (hhmmss) ) **********************/
-
-	if ( *(isoPkt->D12)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D12);
-        	padChar((char *)tempBuffer, -LEN_D12*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[1], BIT4);
-	}
-
-	/************** Field 13  ( n 4 -Date, local transaction (MMDD) ) **********************/
-
-	if ( *(isoPkt->D13)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D13);
-        	padChar((char *)tempBuffer, -LEN_D13*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[1], BIT5);
-	}
-
-	/************** Field 14  ( n 4 - Date, expiration ) **********************/
-
-	if ( *(isoPkt->D14)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D14);
-        	padChar((char *)tempBuffer, -LEN_D14*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[1], BIT6);
-	}
-
-	/************** Field 15  ( n 4 - Date, settlement ) **********************/
-
-	if ( *(isoPkt->D15)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D15);
-        	padChar((char *)tempBuffer, -LEN_D15*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[1], BIT7);
-	}
-
-	/************** Field 16  ( n 4 - Date, conversion ) **********************/
-
-	if ( *(isoPkt->D16)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D16);
-        	padChar((char *)tempBuffer, -LEN_D16*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[1], BIT8);
-	}
-	
-	/************** Field 17  ( n 4 - Date, capture ) *********************/
-
-	if ( *(isoPkt->D17)  )
-	{
-	    	memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D17);
-        	padChar((char *)tempBuffer, -LEN_D17*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[2], BIT1);
-	}
-
-
-	/************** Field 18  ( n 4 - Merchant type ) **********************/
-
-	if ( *(isoPkt->D18)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D18);
-        	padChar((char *)tempBuffer, -LEN_D18*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[2], BIT2);
-	}
-
-	/************** Field 19  ( n 3 - Acquiring institution country code ) **********************/
-
-	if ( *(isoPkt->D19)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D19);
-        	padChar((char *)tempBuffer, -LEN_D19*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[2], BIT3);
-	}
-
-	/************** Field 20  ( n 3 - PAN extended, country code ) **********************/
-
-	if ( *(isoPkt->D20)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D20);
-        	padChar((char *)tempBuffer, -LEN_D20*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[2], BIT4);
-	}
-
-	/************** Field 21  ( n 3 - Forwarding institution. country code ) **********************/
-
-	if ( *(isoPkt->D21)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D21);
-        	padChar((char *)tempBuffer, -LEN_D21*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[2], BIT5);
-	}
-
-	/************** Field 22  ( n 3 - Point of service entry mode ) **********************/
-
-	if ( *(isoPkt->D22)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D22);
-        	padChar((char *)tempBuffer, -LEN_D22*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[2], BIT6);
-	}
-
-	/************** Field 23  ( n 3 - Application PAN number ) **********************/
-
-	if ( *(isoPkt->D23)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D23);
-        	padChar((char *)tempBuffer, -LEN_D23*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[2], BIT7);
-	}
-
-	/************** Field 24  ( n 3 - Function code (ISO 8583:1993)/Network International identifier (NII) ) **********************/
-
-	if ( *(isoPkt->D24)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D24);
-        	padChar((char *)tempBuffer, -LEN_D24*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[2], BIT8);
-	}
-
-	/************** Field 25  ( n 2 - Point of service condition code ) **********************/
-
-	if ( *(isoPkt->D25)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D25);
-        	padChar((char *)tempBuffer, -LEN_D25*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[3], BIT1);
-	}
-
-	/************** Field 26  ( n 2 - Point of service capture code ) **********************/
-
-	if ( *(isoPkt->D26)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D26);
-        	padChar((char *)tempBuffer, -LEN_D26*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[3], BIT2);
-	}
-
-	/************** Field 27  ( n 1 - Authorizing identification response asciiLength ) / Axis **********************/
-
-	if ( *(isoPkt->D27)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D27);
-        	padChar((char *)tempBuffer, -LEN_D27*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[3], BIT3);
-	}
-
-	/************** Field 28  ( n 8 - Amount, transaction fee ) / SBI **********************/
-
-	if ( *(isoPkt->D28)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D28);
-        	padChar((char *)tempBuffer, -LEN_D28*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[3], BIT4);
-	}
-
-	/************** Field 29  ( n 8 - Amount, settlement fee ) / HDFC **********************/
-
-	if ( *(isoPkt->D29)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D29);
-        	padChar((char *)tempBuffer, -LEN_D29*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[3], BIT5);
-	}
-
-	/************** Field 30  ( n 8 - Amount, transaction processing fee )  / Citi **********************/
-
-	if ( *(isoPkt->D30)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D30);
-        	padChar((char *)tempBuffer, -LEN_D30*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[3], BIT6);
-	}
-
-	/************** Field 31  ( n 8 - Amount, settlement processing fee ) / ICICI **********************/
-
-	if ( *(isoPkt->D31)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D31);
-        	padChar((char *)tempBuffer, -LEN_D31*2, '0');
-        
-    		asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[3], BIT7);
-	}
-
-	/************** Field 32  ( n ..11 - Acquiring institution identification code ) / uniPAY **********************/
-
-	if ( *(isoPkt->D32)  )
-	{
-
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D32);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		sprintf((char *)lenBuffer, "%02d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 2, 1);
-		memcpy(pkt+offset, tempBuffer, 1);
-		offset += 1;
-
-		strn2BCD(pkt+offset, isoPkt->D32, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[3], BIT8);
-
-	}
-
-	/************** Field 33  ( n ..11 - Forwarding institution identification code ) **********************/
-
-	if ( *(isoPkt->D33)  )
-	{
-
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D33);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		sprintf((char *)lenBuffer, "%02d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 2, 1);
-		memcpy(pkt+offset, tempBuffer, 1);
-		offset += 1;
-
-		strn2BCD(pkt+offset, isoPkt->D33, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[4], BIT1);
-
-	}
-
-	/************** Field 34  ( ns ..28 - Primary account number, extended ) **********************/
-
-	if ( *(isoPkt->D34)  )
-	{
-
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-    		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D34);
-		sprintf((char *)lenBuffer, "%02d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 2, 1);
-		memcpy(pkt+offset, tempBuffer, 1);
-		offset += 1;
-
-		memcpy(pkt+offset, isoPkt->D34, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[4], BIT2);
-
-	}
-
-
-	/************** Field 35  ( z ..37 - Track 2 data ) **********************/
-
-	if ( *(isoPkt->D35)  )
-	{
-
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D35);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		sprintf((char *)lenBuffer, "%02d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 2, 1);
-		memcpy(pkt+offset, tempBuffer, 1);
-		offset += 1;
-
-		strn2BCD(pkt+offset, isoPkt->D35, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[4], BIT3);
-
-	}
-
-	/************** Field 36  ( n ..104 - Track 3 data ) **********************/
-
-	if ( *(isoPkt->D36)  )
-	{
-
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D36);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		sprintf((char *)lenBuffer, "%02d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 2, 1);
-		memcpy(pkt+offset, tempBuffer, 1);
-		offset += 1;
-
-		strn2BCD(pkt+offset, isoPkt->D36, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[4], BIT4);
-
-	}
-
-
-	/************** Field 37  ( an 12 - Retrieval reference number ) **********************/
-
-	if ( *(isoPkt->D37)  )
-	{
-        	memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D37);
-        	padChar((char *)tempBuffer, -LEN_D37, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-		memcpy(pkt+offset, tempBuffer, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[4], BIT5);
-	}
-
-	/************** Field 38  ( an 6 - Authorization identification response ) **********************/
-
-	if ( *(isoPkt->D38)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D38);
-        	padChar((char *)tempBuffer, -LEN_D38, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-    		memcpy(pkt+offset, tempBuffer, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[4], BIT6);
-	}
-
-	/************** Field 39  ( an 2 - Response code ) **********************/
-
-	if ( *(isoPkt->D39)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D39);
-        	padChar((char *)tempBuffer, -LEN_D39, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-    		memcpy(pkt+offset, tempBuffer, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[4], BIT7);
-	}
-
-	/************** Field 40  ( an 3 - Service restriction code ) **********************/
-
-	if ( *(isoPkt->D40)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D40);
-        	padChar((char *)tempBuffer, -LEN_D40, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-    		memcpy(pkt+offset, tempBuffer, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[4], BIT8);
-	}
-	
-	/************** Field 41  ( ans 16 - Card acceptor terminal identification ) **********************/
-
-	if ( *(isoPkt->D41)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D41);
-        	padChar((char *)tempBuffer, -LEN_D41, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-        	memcpy(pkt+offset, tempBuffer, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[5], BIT1);
-	}
-
-	/************** Field 42  ( ans 15 - Card acceptor identification code ) **********************/
-
-	if ( *(isoPkt->D42)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D42);
-        	padChar((char *)tempBuffer, -LEN_D42, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-        	memcpy(pkt+offset, tempBuffer, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[5], BIT2);
-	}
-	
-	/************** Field 43  ( ans 40 - Card acceptor name/location (1-23 address 24-36 city 37-38 state 39-40 country)  ) **********************/
-
-	if ( *(isoPkt->D43)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D43);
-        	padChar((char *)tempBuffer, -LEN_D43, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-        	memcpy(pkt+offset, tempBuffer, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[5], BIT3);
-	}
-	
-	/************** Field 44  ( an ..25 - Additional response data ) **********************/
-
-	if ( *(isoPkt->D44)  )
-	{
-
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D44);
-		sprintf((char *)lenBuffer, "%02d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 2, 1);
-		memcpy(pkt+offset, tempBuffer, 1);
-		offset += 1;
-
-		memcpy(pkt+offset, isoPkt->D44, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[5], BIT4);
-
-	}
-
-	/************** Field 45  ( an ..76 -Track 1 data ) **********************/
-
-	if ( *(isoPkt->D45)  )
-	{
-
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D45);
-		sprintf((char *)lenBuffer, "%02d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 2, 1);
-		memcpy(pkt+offset, tempBuffer, 1);
-		offset += 1;
-
-		memcpy(pkt+offset, isoPkt->D45, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[5], BIT5);
-
-	}
-
-	/************** Field 46  ( an ...999  - Additional data - ISO ) **********************/
-
-	if ( *(isoPkt->D46)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-    		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D46);
-		sprintf((char *)lenBuffer, "%04d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-        
-        	memcpy(pkt+offset, isoPkt->D46, asciiLen);
-    		offset += asciiLen;
-		SETBIT(bitmap[5], BIT6);
-	}
-
-	
-	/************** Field 47  ( an ...999 - Additional data - national ) **********************/
-
-	if ( *(isoPkt->D47)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D47);
-		sprintf((char *)lenBuffer, "%04d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D47, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[5], BIT7);
-	}
-
-	/************** Field 48  ( an ...999 - Additional data - private ) **********************/
-
-	if ( *(isoPkt->D48)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		asciiLen = strlen((char *)isoPkt->D48);
-		sprintf((char *)lenBuffer, "%04d", asciiLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D48, asciiLen);
-		offset += asciiLen;
-		SETBIT(bitmap[5], BIT8);
-	}
-
-
-	/************** Field 49  ( a or n 3 - Currency code, transaction ) **********************/
-
-	if ( *(isoPkt->D49)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D49);
-        	padChar((char *)tempBuffer, -LEN_D49, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-        	memcpy(pkt+offset, tempBuffer, asciiLen);
-    		offset += asciiLen;
-		SETBIT(bitmap[6], BIT1);
-	}
-
-	/************** Field 50  ( a or n 3 - Currency code, settlement, , using as an 3 )***********/
-
-	if ( *(isoPkt->D50)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D50);
-        	padChar((char *)tempBuffer, -LEN_D50, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-        	memcpy(pkt+offset, tempBuffer, asciiLen);
-    		offset += asciiLen;
-		SETBIT(bitmap[6], BIT2);
-	}
-
-	/************** Field 51  ( a or n 3 - Currency code, cardholder billing, using as an 3 ) *****/
-
-	if ( *(isoPkt->D51)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D51);
-        	padChar((char *)tempBuffer, -LEN_D51, '0');
-        	asciiLen = strlen((char *)tempBuffer);
-        	memcpy(pkt+offset, tempBuffer, asciiLen);
-    		offset += asciiLen;
-		SETBIT(bitmap[6], BIT3);
-	}
-
-	/************** Field 52  ( b 64 - Personal identification number data, using as an 3 ) ********/
-
-	if ( *(isoPkt->D52)  )
-	{
-		bcdLen = LEN_D52;
-		memcpy(pkt+offset, isoPkt->D52, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[6], BIT4);
-	}
-
-
-
-	/************** Field 53  ( n 16 - Security related control information ) **********************/
-
-	if ( *(isoPkt->D53)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-        	strcpy((char *)tempBuffer, (char *)isoPkt->D53);
-        	padChar((char *)tempBuffer, -LEN_D53*2, '0');
-        
-        	asciiLen = strlen((char *)tempBuffer);
-		bcdLen = (asciiLen/2)+(asciiLen%2);
-		strn2BCD(pkt+offset, tempBuffer, asciiLen, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[6], BIT5);
-	}
-
-	/************** Field 54  ( an ...120 - Additional amounts ) **********************/
-
-	if ( *(isoPkt->D54)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D54);
-		sprintf((char *)lenBuffer, "%02d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 2, 1);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 1;
-
-		memcpy(pkt+offset, isoPkt->D54, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[6], BIT6);
-	}
-
-	/************** Field 55  ( an ...999 - Reserved ISO ) **********************/
-
-	if ( *(isoPkt->D55)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D55);
-		sprintf((char *)lenBuffer, "%04d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D55, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[6], BIT7);
-	}
-
-	/************** Field 56  ( ans ...999 - Reserved ISO ) **********************/
-
-	if ( *(isoPkt->D56)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D56);
-		sprintf((char *)lenBuffer, "%04d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D56, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[6], BIT8);
-	}
-
-
-	/************** Field 57  ( ans ...999 - Reserved national ) **********************/
-
-	if ( *(isoPkt->D57)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D57);
-		sprintf((char *)lenBuffer, "%04d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D57, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[7], BIT1);
-	}
-
-	/************** Field 58  ( ans ...999 - Reserved national ) **********************/
-
-	if ( *(isoPkt->D58)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D58);
-		sprintf((char *)lenBuffer, "%04d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D58, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[7], BIT2);
-	}
-
-	/************** Field 59  ( ans ...999 - Reserved national use ) **********************/
-
-	if ( *(isoPkt->D59)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D59);
-		sprintf((char *)lenBuffer, "%04d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D59, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[7], BIT3);
-	}
-
-	/************** Field 60  ( ans ...999 - Reserved national ) ***********/
-
-	if ( *(isoPkt->D60)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D60);
-		sprintf((char *)lenBuffer, "%04d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D60, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[7], BIT4);
-	}
-
-	/************** Field 61  ( ans ...999 - Reserved private ) **********************/
-
-	if ( *(isoPkt->D61)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D61);
-		sprintf((char *)lenBuffer, "%04d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D61, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[7], BIT5);
-	}
-
-	/************** Field 62  ( ans ...999 - Reserved private ) **********************/
-
-	if ( *(isoPkt->D62)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D62);
-		sprintf((char *)lenBuffer, "%04d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D62, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[7], BIT6);
-	}
-
-	/************** Field 63  ( ans ...999 - Reserved private ) **********************/
-
-	if ( *(isoPkt->D63)  )
-	{
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		bcdLen = strlen((char *)isoPkt->D63);
-		sprintf((char *)lenBuffer, "%04d", bcdLen);
-		strn2BCD(tempBuffer, lenBuffer, 4, 2);
-		memcpy(pkt+offset, tempBuffer, 2);
-		offset += 2;
-
-		memcpy(pkt+offset, isoPkt->D63, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[7], BIT7);
-	}
-
-	/************** Field 64  ( b 16 - Message authentication code (MAC) ) **********************/
-
-	if ( *(isoPkt->D64) )
-	{
-		bcdLen = LEN_D64;
-		memcpy(pkt+offset, isoPkt->D64, bcdLen);
-		offset += bcdLen;
-		SETBIT(bitmap[7], BIT8);
-	}
-
-
-	/****************************************  Setting Length ***********************************/
-
-	memset(tempBuffer, 0, sizeof(tempBuffer));
-	memset(lenBuffer, 0, sizeof(lenBuffer));
-	sprintf((char *)lenBuffer, "%04d", offset);
-	strn2BCD(tempBuffer, lenBuffer, 4, 2);
-	memcpy(pkt, tempBuffer, 2);
-	isoPkt->pktLen = offset;
-
-	/****************************************  Setting Header ***********************************/
-
-	if ( headerLen > 0)
-	{
-		strn2BCD(tempBuffer, isoPkt->header, 10, 5);
-		memcpy(pkt+2, tempBuffer, 5);
-	}
-
-	/****************************************  Setting MTI    ***********************************/
-
-	memset(tempBuffer, 0, sizeof(tempBuffer));
-	memset(lenBuffer, 0, sizeof(lenBuffer));
-	strncpy((char *)lenBuffer, (char *)isoPkt->MTI, 4);
-	strn2BCD(tempBuffer, lenBuffer, 4, 2);
-	memcpy(pkt+2+headerLen, tempBuffer, 2);
-
-	/****************************************  Setting BitMap ***********************************/
-
-	memcpy(pkt+2+headerLen+2, bitmap, bitMapLen);
-	memcpy(isoPkt->BITMAP, bitmap, bitMapLen);
-
-	/****************************************  Completion of Packing ***********************************/
-
-	File_Log("Packet Length  : %d", isoPkt->pktLen);
+/************************************ Table-driven unpacking ************************************
+ *
+ * One spec per data element drives a single decode loop. Decoding only records where each present
+ * field sits in the packet (IsoFieldView); the BCD/ASCII conversion happens when a field is asked
+ * for (isoGetStr / isoGetNum), so a switch that looks at five fields pays for five fields.
+ *
+ * Formats and lengths are the ones pack() writes:
+ *   n, z      packed BCD, right aligned (odd digit counts start with a 0 nibble)
+ *   an, ans   ASCII, b  binary
+ *   LL / LLL  length prefix of 1 / 2 BCD bytes (digits for BCD fields, bytes otherwise)
+ *
+ * IsoDialect.hpp carries this table as a constexpr dialect (iso::Iso87Bcd) for C++ decoders that are
+ * specialized at compile time, next to other wire formats; keep the two in step.
+ *
+ ************************************************************************************************/
 
-	printHexDump("Raw Packet    ", pkt, isoPkt->pktLen);	
+#define BCD(n)    { ISO_FMT_BCD,    ISO_LEN_FIXED, n }
+#define ASC(n)    { ISO_FMT_ASCII,  ISO_LEN_FIXED, n }
+#define BIN(n)    { ISO_FMT_BINARY, ISO_LEN_FIXED, n }
+#define LLBCD(n)  { ISO_FMT_BCD,    ISO_LEN_LL,    n }
+#define LLASC(n)  { ISO_FMT_ASCII,  ISO_LEN_LL,    n }
+#define LLLASC(n) { ISO_FMT_ASCII,  ISO_LEN_LLL,   n }
 
-	return offset;
+static const IsoFieldSpec isoSpec[ISO_MAX_FIELDS + 1] =
+{
+	[2]  = LLBCD(19),       // Primary account number
+	[3]  = BCD(6),          // Processing code
+	[4]  = BCD(12),         // Amount, transaction
+	[5]  = BCD(12),         // Amount, settlement
+	[6]  = BCD(12),         // Amount, cardholder billing
+	[7]  = BCD(10),         // Transmission date & time
+	[8]  = BCD(8),          // Amount, cardholder billing fee
+	[9]  = BCD(8),          // Conversion rate, settlement
+	[10] = BCD(8),          // Conversion rate, cardholder billing
+	[11] = BCD(6),          // System trace audit number
+	[12] = BCD(6),          // Time, local transaction
+	[13] = BCD(4),          // Date, local transaction
+	[14] = BCD(4),          // Date, expiration
+	[15] = BCD(4),          // Date, settlement
+	[16] = BCD(4),          // Date, conversion
+	[17] = BCD(4),          // Date, capture
+	[18] = BCD(4),          // Merchant type
+	[19] = BCD(3),          // Acquiring institution country code
+	[20] = BCD(3),          // PAN extended, country code
+	[21] = BCD(3),          // Forwarding institution country code
+	[22] = BCD(3),          // Point of service entry mode
+	[23] = BCD(3),          // Application PAN sequence number
+	[24] = BCD(3),          // Function code / NII
+	[25] = BCD(2),          // Point of service condition code
+	[26] = BCD(2),          // Point of service capture code
+	[27] = BCD(1),          // Authorizing identification response length
+	[28] = BCD(8),          // Amount, transaction fee
+	[29] = BCD(8),          // Amount, settlement fee
+	[30] = BCD(8),          // Amount, transaction processing fee
+	[31] = BCD(8),          // Amount, settlement processing fee
+	[32] = LLBCD(11),       // Acquiring institution identification code
+	[33] = LLBCD(11),       // Forwarding institution identification code
+	[34] = LLASC(28),       // Primary account number, extended
+	[35] = LLBCD(37),       // Track 2 data ('=' travels as nibble D)
+	[36] = LLBCD(99),       // Track 3 data (104 digits do not fit a 1 byte prefix)
+	[37] = ASC(LEN_D37),    // Retrieval reference number
+	[38] = ASC(LEN_D38),    // Authorization identification response
+	[39] = ASC(LEN_D39),    // Response code
+	[40] = ASC(LEN_D40),    // Service restriction code
+	[41] = ASC(LEN_D41),    // Card acceptor terminal identification
+	[42] = ASC(LEN_D42),    // Card acceptor identification code
+	[43] = ASC(LEN_D43),    // Card acceptor name/location
+	[44] = LLASC(25),       // Additional response data
+	[45] = LLASC(76),       // Track 1 data
+	[46] = LLLASC(999),     // Additional data - ISO
+	[47] = LLLASC(999),     // Additional data - national
+	[48] = LLLASC(999),     // Additional data - private
+	[49] = ASC(LEN_D49),    // Currency code, transaction
+	[50] = ASC(LEN_D50),    // Currency code, settlement
+	[51] = ASC(LEN_D51),    // Currency code, cardholder billing
+	[52] = BIN(LEN_D52),    // PIN data
+	[53] = BCD(LEN_D53*2),  // Security related control information
+	[54] = LLASC(99),       // Additional amounts (120 do not fit a 1 byte prefix)
+	[55] = LLLASC(999),     // Reserved ISO (EMV)
+	[56] = LLLASC(999),     // Reserved ISO
+	[57] = LLLASC(999),     // Reserved national
+	[58] = LLLASC(999),     // Reserved national
+	[59] = LLLASC(999),     // Reserved national
+	[60] = LLLASC(999),     // Reserved national
+	[61] = LLLASC(999),     // Reserved private
+	[62] = LLLASC(999),     // Reserved private
+	[63] = LLLASC(999),     // Reserved private
+	[64] = BIN(LEN_D64),    // MAC
+};
+
+#undef BCD
+#undef ASC
+#undef BIN
+#undef LLBCD
+#undef LLASC
+#undef LLLASC
+
+// Two BCD digits of one byte, -1 when a nibble is not a decimal digit
+static int bcdByte(unsigned char b)
+{
+	if ( (b >> 4) > 9 || (b & 0x0F) > 9 )
+		return -1;
+	return (b >> 4) * 10 + (b & 0x0F);
 }
 
-short unpack(unsigned char *pkt, int pktLen, IsoPkt *isoPkt)
+/************************************ BCD <-> ASCII kernels *************************************
+ *
+ * Packing subtracts '0' from 16 or 32 characters at once, checks that every nibble is a digit (or 0x0D,
+ * '=', when the field allows the track 2 separator) and folds pairs with one multiply-add
+ * (16 * even + odd); unpacking splits each byte into its two nibbles and interleaves them. Both use
+ * the widest kernel the CPU has, picked at load time; numeric fields are short (4 to 37 digits mostly),
+ * so the tails go through the narrower kernels down to scalar pairs.
+ *
+ ************************************************************************************************/
+
+// Inlined into the SIMD kernels for their tails: a call from AVX2 code into SSE code can cost a
+// state transition of hundreds of cycles.
+#ifdef __GNUC__
+#define BCD_INLINE static inline __attribute__((always_inline))
+#else
+#define BCD_INLINE static inline
+#endif
+
+// '0'..'9' -> 0..9, '=' -> 0x0D when sep is set, anything else -> 0xFF
+BCD_INLINE unsigned char bcdNibble(char c, int sep)
 {
-	
-	int offset = 0, bcdLen = 0, asciiLen = 0;
-	unsigned char bitmap[17] = {0};
-	char tempBuffer[1001] = {'\0'};
-	char lenBuffer[11] = {'\0'};
-	short bitMapLen = 0, headerLen = 0;
-
-	// Parsing Length
-
-	memcpy(lenBuffer, pkt+offset, 2);
-	BCDn2str(tempBuffer, lenBuffer, 2, 4, 4);
-	isoPkt->pktLen = atoi(tempBuffer);
-	memset(tempBuffer, 0, sizeof(tempBuffer));
-	memset(lenBuffer, 0, sizeof(lenBuffer));
-	offset += 2;
-
-	File_Log("\n----------------- Unpacking---------------------");
-
-	File_Log("Packet Length  : %d", isoPkt->pktLen);
-
-	printHexDump("Raw Packet    ", pkt, pktLen);
-
-	
-
-	// Parsing Header
-	if ( headerLen > 0)
-	{
-		memcpy(lenBuffer, pkt+offset, 5);
-		BCDn2str(tempBuffer, lenBuffer, 5, 10, 10);
-		strncpy((char *)isoPkt->header, tempBuffer, strlen(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		offset += 5;
-		File_Log("Packet Header  : %s", isoPkt->header);
-	}
-
-	//Parsing MTI
-	memcpy(lenBuffer, pkt+offset, 2);
-	BCDn2str(tempBuffer, lenBuffer, 2, 4, 4);
-	strncpy((char *)isoPkt->MTI, tempBuffer, strlen(tempBuffer));
-	memset(lenBuffer, 0, sizeof(lenBuffer));
-	memset(tempBuffer, 0, sizeof(tempBuffer));
-	offset += 2;
-	File_Log("Packet MTI     : %s", isoPkt->MTI);
-
-
-	bitMapLen = ( TESTBIT(bitmap[0], BIT1) ) ? 16 : 8;
-
-	//D1 Parsing - BitMap
-	memcpy((char *)isoPkt->D1, pkt+offset, bitMapLen);
-	memcpy(bitmap, pkt+offset, bitMapLen);
-        memcpy(isoPkt->BITMAP, bitmap, bitMapLen);	
-	offset += bitMapLen;
-	File_Log("Packet BitMap  : %02x %02x %02x %02x %02x %02x %02x %02x", bitmap[0], bitmap[1], bitmap[2], bitmap[3], bitmap[4], bitmap[5], bitmap[6], bitmap[7]);
-
-
-	/************** Field 1  Parsing **********************/
-
-	if ( TESTBIT(bitmap[0], BIT1) )
-	{
-	}
-
-	/************** Field 2  ( n ..19 - Primary Account Number ) **********************/
-
-	if ( TESTBIT(bitmap[0], BIT2) )
-	{
-		bcdLen = 1;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		asciiLen = atoi((char *)tempBuffer);
-		bcdLen = (asciiLen / 2) + (asciiLen % 2);
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D2, (char *)tempBuffer, bcdLen, asciiLen, asciiLen);
-		offset += bcdLen;
-		File_Log("D2             : %s", isoPkt->D2);
-	}
-
-	/************** Field 3 ( n 6 - Processing code) **********************/
-
-	if ( TESTBIT(bitmap[0], BIT3) )
-	{
-		bcdLen = LEN_D3;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D3, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D3             : %s", isoPkt->D3);
-	}
-
-	/************** Field 4  ( n 12 - Amount, transaction ) **********************/
-
-	if ( TESTBIT(bitmap[0], BIT4) )
-	{
-		bcdLen = LEN_D4;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D4, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D4             : %s", isoPkt->D4);
-	}
-	
-	/************** Field 5 ( n 12 - Amount, settlement ) **********************/
-
-	if ( TESTBIT(bitmap[0], BIT5) )
-	{
-		bcdLen = LEN_D5;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D5, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D5             : %s", isoPkt->D5);
-	}
-
-
-	/************** Field 6  ( n 12 - Amount, cardholder billing ) **********************/
-
-	if ( TESTBIT(bitmap[0], BIT6) )
-	{
-		bcdLen = LEN_D6;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D6, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D6             : %s", isoPkt->D6);
-	}
-
-	/************** Field 7  ( n 10 - Transmission date & time) **********************/
-
-	if ( TESTBIT(bitmap[0], BIT7) )
-	{
-		bcdLen = LEN_D7;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D7, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D7             : %s", isoPkt->D7);
-
-	}
-
-
-	/************** Field 8  ( n 8 - Amount, cardholder billing fee) **********************/
-
-	if ( TESTBIT(bitmap[0], BIT8) )
-	{
-		bcdLen = LEN_D8;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D8, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D8             : %s", isoPkt->D8);
-	}
-
+	unsigned char n = (unsigned char)(c - '0');
 
+	return n <= 9 || (sep && n == 0x0D) ? n : 0xFF;
+}
 
-	/************** Field 9  ( n 8 - Conversion rate, settlement ) **********************/
+BCD_INLINE int bcdPackPairs(unsigned char *bcd, const char *digits, int len, int sep)
+{
+	unsigned char hi, lo;
 
-	if ( TESTBIT(bitmap[1], BIT1) )
+	if ( len & 1 )
 	{
-		bcdLen = LEN_D9;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D9, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D9             : %s", isoPkt->D9);
+		lo = bcdNibble(*digits++, sep);
+		if ( lo > 15 )
+			return ISO_ERR_DIGIT;
+		*bcd++ = lo;
+		len--;
 	}
-
-	/************** Field 10  ( n 8 - Conversion rate, cardholder billing ) **********************/
-
-	if ( TESTBIT(bitmap[1], BIT2) )
+	for ( ; len > 0; len -= 2, digits += 2 )
 	{
-		bcdLen = LEN_D10;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D10, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D10            : %s", isoPkt->D10);
+		hi = bcdNibble(digits[0], sep);
+		lo = bcdNibble(digits[1], sep);
+		if ( (hi | lo) > 15 )
+			return ISO_ERR_DIGIT;
+		*bcd++ = (hi << 4) | lo;
 	}
 
-	/************** Field 11  ( n 6 - Systems trace audit number ) **********************/
+	return ISO_OK;
+}
 
-	if ( TESTBIT(bitmap[1], BIT3) )
+BCD_INLINE void bcdUnpackPairs(char *out, const unsigned char *bcd, int digits)
+{
+	if ( digits & 1 )
 	{
-		bcdLen = LEN_D11;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D11, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D11            : %s", isoPkt->D11);
-
+		*out++ = (*bcd++ & 0x0F) + '0';
+		digits--;
 	}
-
-	/************** Field 12  ( n 6 - Time, local transaction (hhmmss) ) **********************/
-
-	if ( TESTBIT(bitmap[1], BIT4) )
+	for ( ; digits > 0; digits -= 2, bcd++ )
 	{
-		bcdLen = LEN_D12;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D12, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D12            : %s", isoPkt->D12);
+		*out++ = (*bcd >> 4) + '0';
+		*out++ = (*bcd & 0x0F) + '0';
 	}
+}
 
-	/************** Field 13  ( n 4 -Date, local transaction (MMDD) ) **********************/
-
-	if ( TESTBIT(bitmap[1], BIT5) )
-	{
-		bcdLen = LEN_D13;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D13, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D13            : %s", isoPkt->D13);
-	}
+static int bcdPackScalar(unsigned char *bcd, const char *digits, int len, int sep)
+{
+	return bcdPackPairs(bcd, digits, len, sep);
+}
 
-	/************** Field 14  ( n 4 - Date, expiration ) **********************/
+static void bcdUnpackScalar(char *out, const unsigned char *bcd, int digits)
+{
+	bcdUnpackPairs(out, bcd, digits);
+}
 
-	if ( TESTBIT(bitmap[1], BIT6) )
-	{
-		bcdLen = LEN_D14;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D14, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D14            : %s", isoPkt->D14);
+#ifdef BCD_X86
 
-	}
+// 0xFF in every byte of d (character - '0') that is neither a digit nor the separator nibble in sepNibble
+#define BCD_BAD16(d, sepNibble) _mm_xor_si128(_mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(d, nine), d), \
+		_mm_cmpeq_epi8(d, sepNibble)), ones)
 
-	/************** Field 15  ( n 4 - Date, settlement ) **********************/
+__attribute__((target("ssse3")))
+BCD_INLINE int bcdPack16(unsigned char *bcd, const char *digits, int len, int sep)
+{
+	const __m128i zero = _mm_set1_epi8('0'), nine = _mm_set1_epi8(9), weights = _mm_set1_epi16(0x0110);
+	const __m128i ones = _mm_set1_epi8(-1), sepNibble = _mm_set1_epi8(sep ? 0x0D : 9);   // 9: no extra nibble
+	__m128i d, bad = _mm_setzero_si128();
+	unsigned int quad;
 
-	if ( TESTBIT(bitmap[1], BIT7) )
+	if ( len & 1 )
 	{
-		bcdLen = LEN_D15;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D15, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D15            : %s", isoPkt->D15);
+		if ( bcdNibble(*digits, sep) > 15 )
+			return ISO_ERR_DIGIT;
+		*bcd++ = bcdNibble(*digits++, sep);
+		len--;
 	}
-
-	/************** Field 16  ( n 4 - Date, conversion ) **********************/
-
-	if ( TESTBIT(bitmap[1], BIT8) )
+	for ( ; len >= 16; len -= 16, digits += 16, bcd += 8 )
 	{
-		bcdLen = LEN_D16;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D16, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D16            : %s", isoPkt->D16);
+		d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)digits), zero);
+		bad = _mm_or_si128(bad, BCD_BAD16(d, sepNibble));
+		d = _mm_maddubs_epi16(d, weights);
+		_mm_storel_epi64((__m128i *)bcd, _mm_packus_epi16(d, d));
 	}
-
-
-	/************** Field 17  ( n 4 - Date, capture ) *********************/
-
-	if ( TESTBIT(bitmap[2], BIT1) )
+	if ( len >= 8 )
 	{
-		bcdLen = LEN_D17;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D17, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D17            : %s", isoPkt->D17);
+		d = _mm_sub_epi8(_mm_loadl_epi64((const __m128i *)digits), zero);
+		bad = _mm_or_si128(bad, _mm_move_epi64(BCD_BAD16(d, sepNibble)));   // upper half is not input
+		d = _mm_maddubs_epi16(d, weights);
+		quad = _mm_cvtsi128_si32(_mm_packus_epi16(d, d));
+		memcpy(bcd, &quad, 4);
+		len -= 8;
+		digits += 8;
+		bcd += 4;
 	}
+	if ( _mm_movemask_epi8(bad) != 0 )
+		return ISO_ERR_DIGIT;
 
+	return bcdPackPairs(bcd, digits, len, sep);
+}
 
-	/************** Field 18  ( n 4 - Merchant type ) **********************/
+__attribute__((target("ssse3")))
+BCD_INLINE void bcdUnpack16(char *out, const unsigned char *bcd, int digits)
+{
+	const __m128i mask = _mm_set1_epi8(0x0F), zero = _mm_set1_epi8('0');
+	__m128i b, hi, lo;
+	int quad;
 
-	if ( TESTBIT(bitmap[2], BIT2) )
+	if ( digits & 1 )
 	{
-		bcdLen = LEN_D18;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D18, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D18            : %s", isoPkt->D18);
+		*out++ = (*bcd++ & 0x0F) + '0';
+		digits--;
 	}
-
-	/************** Field 19  ( n 3 - Acquiring institution country code ) **********************/
-
-	if ( TESTBIT(bitmap[2], BIT3) )
+	for ( ; digits >= 32; digits -= 32, bcd += 16, out += 32 )
 	{
-		bcdLen = LEN_D19;
-		asciiLen = (bcdLen*2)-1;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D19, (char *)tempBuffer, bcdLen, asciiLen, asciiLen);
-		padChar((char *)isoPkt->D19, 3, '\0');
-		offset += bcdLen;
-		File_Log("D19            : %s", isoPkt->D19);
+		b = _mm_loadu_si128((const __m128i *)bcd);
+		hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+		lo = _mm_and_si128(b, mask);
+		_mm_storeu_si128((__m128i *)out, _mm_add_epi8(_mm_unpacklo_epi8(hi, lo), zero));
+		_mm_storeu_si128((__m128i *)(out + 16), _mm_add_epi8(_mm_unpackhi_epi8(hi, lo), zero));
 	}
-
-	/************** Field 20  ( n 3 - PAN extended, country code ) **********************/
-
-	if ( TESTBIT(bitmap[2], BIT4) )
+	if ( digits >= 16 )
 	{
-		bcdLen = LEN_D20;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D20, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		padChar((char *)isoPkt->D20, 3, '\0');
-		offset += bcdLen;
-		File_Log("D20            : %s", isoPkt->D20);
+		b = _mm_loadl_epi64((const __m128i *)bcd);
+		hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+		lo = _mm_and_si128(b, mask);
+		_mm_storeu_si128((__m128i *)out, _mm_add_epi8(_mm_unpacklo_epi8(hi, lo), zero));
+		digits -= 16;
+		bcd += 8;
+		out += 16;
 	}
-
-	/************** Field 21  ( n 3 - Forwarding institution. country code ) **********************/
-
-	if ( TESTBIT(bitmap[2], BIT5) )
+	if ( digits >= 8 )
 	{
-		bcdLen = LEN_D21;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D21, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		padChar((char *)isoPkt->D21, 3, '\0');
-		offset += bcdLen;
-		File_Log("D21            : %s", isoPkt->D21);
+		memcpy(&quad, bcd, 4);
+		b = _mm_cvtsi32_si128(quad);
+		hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+		lo = _mm_and_si128(b, mask);
+		_mm_storel_epi64((__m128i *)out, _mm_add_epi8(_mm_unpacklo_epi8(hi, lo), zero));
+		digits -= 8;
+		bcd += 4;
+		out += 8;
 	}
 
-	/************** Field 22  ( n 3 - Point of service entry mode ) **********************/
-
-	if ( TESTBIT(bitmap[2], BIT6) )
-	{
-		bcdLen = LEN_D22;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D22, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		//padChar((char *)isoPkt->D22, 3, '\0');
-		offset += bcdLen;
-		File_Log("D22            : %s", isoPkt->D22);
-	}
+	bcdUnpackPairs(out, bcd, digits);
+}
 
-	/************** Field 23  ( n 3 - Application PAN number ) **********************/
+__attribute__((target("ssse3")))
+static int bcdPackSsse3(unsigned char *bcd, const char *digits, int len, int sep)
+{
+	return bcdPack16(bcd, digits, len, sep);
+}
 
-	if ( TESTBIT(bitmap[2], BIT7) )
-	{
-		bcdLen = LEN_D23;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D23, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		//padChar((char *)isoPkt->D23, 3, '\0');
-		offset += bcdLen;
-		File_Log("D23            : %s", isoPkt->D23);
-	}
+__attribute__((target("ssse3")))
+static void bcdUnpackSsse3(char *out, const unsigned char *bcd, int digits)
+{
+	bcdUnpack16(out, bcd, digits);
+}
 
-	/************** Field 24  ( n 3 - Function code (ISO 8583:1993)/Network International identifier (NII) ) **********************/
+__attribute__((target("avx2")))
+static int bcdPackAvx2(unsigned char *bcd, const char *digits, int len, int sep)
+{
+	const __m256i zero = _mm256_set1_epi8('0'), nine = _mm256_set1_epi8(9), weights = _mm256_set1_epi16(0x0110);
+	const __m256i sepNibble = _mm256_set1_epi8(sep ? 0x0D : 9);
+	__m256i d, ok = _mm256_set1_epi8(-1);
 
-	if ( TESTBIT(bitmap[2], BIT8) )
+	if ( len & 1 )
 	{
-		bcdLen = LEN_D24;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D24, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		//padChar((char *)isoPkt->D24, 3, '\0');
-		offset += bcdLen;
-		File_Log("D24            : %s", isoPkt->D24);
+		if ( bcdNibble(*digits, sep) > 15 )
+			return ISO_ERR_DIGIT;
+		*bcd++ = bcdNibble(*digits++, sep);
+		len--;
 	}
-
-
-	/************** Field 25  ( n 2 - Point of service condition code ) **********************/
-
-	if ( TESTBIT(bitmap[3], BIT1) )
+	for ( ; len >= 32; len -= 32, digits += 32, bcd += 16 )
 	{
-		bcdLen = LEN_D25;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D25, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D25            : %s", isoPkt->D25);
+		d = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)digits), zero);
+		ok = _mm256_and_si256(ok, _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(d, nine), d),
+				_mm256_cmpeq_epi8(d, sepNibble)));
+		d = _mm256_maddubs_epi16(d, weights);
+		d = _mm256_permute4x64_epi64(_mm256_packus_epi16(d, d), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128((__m128i *)bcd, _mm256_castsi256_si128(d));
 	}
+	if ( _mm256_movemask_epi8(ok) != -1 )
+		return ISO_ERR_DIGIT;
 
+	return bcdPack16(bcd, digits, len, sep);
+}
 
-	/************** Field 26  ( n 2 - Point of service capture code ) **********************/
+__attribute__((target("avx2")))
+static void bcdUnpackAvx2(char *out, const unsigned char *bcd, int digits)
+{
+	const __m256i mask = _mm256_set1_epi16(0x0F), zero = _mm256_set1_epi16(0x3030);
+	__m256i b;
 
-	if ( TESTBIT(bitmap[3], BIT2) )
+	if ( digits & 1 )
 	{
-		bcdLen = LEN_D26;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D26, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D26            : %s", isoPkt->D26);
-
+		*out++ = (*bcd++ & 0x0F) + '0';
+		digits--;
 	}
-	
-
-	/************** Field 27  ( n 1 - Authorizing identification response asciiLength ) **********************/
-
-	if ( TESTBIT(bitmap[3], BIT3) )
+	for ( ; digits >= 32; digits -= 32, bcd += 16, out += 32 )
 	{
-		bcdLen = LEN_D27;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D27, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		//padChar((char *)isoPkt->D27, 1, '\0');
-		offset += bcdLen;
-		File_Log("D27            : %s", isoPkt->D27);
+		// One byte per 16-bit lane: high nibble to the low (first) byte, low nibble to the high byte
+		b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)bcd));
+		b = _mm256_or_si256(_mm256_srli_epi16(b, 4), _mm256_slli_epi16(_mm256_and_si256(b, mask), 8));
+		_mm256_storeu_si256((__m256i *)out, _mm256_add_epi8(b, zero));
 	}
 
+	bcdUnpack16(out, bcd, digits);
+}
 
-	/************** Field 28  ( n 8 - Amount, transaction fee ) **********************/
-
-	if ( TESTBIT(bitmap[3], BIT4) )
-	{
-		bcdLen = LEN_D28;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D28, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D28            : %s", isoPkt->D28);
-	}
-
+#endif
 
-	/************** Field 29  ( n 8 - Amount, settlement fee ) **********************/
+// Written only by bcdKernel(): by bcdKernelInit() before main(), or by an explicit override that has to
+// come before any thread uses the parser. Decoding threads only ever read them.
+static int (*bcdPackFn)(unsigned char *bcd, const char *digits, int len, int sep) = bcdPackScalar;
+static void (*bcdUnpackFn)(char *out, const unsigned char *bcd, int digits) = bcdUnpackScalar;
 
-	if ( TESTBIT(bitmap[3], BIT5) )
-	{
-		bcdLen = LEN_D29;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D29, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D29            : %s", isoPkt->D29);
-	}
+int bcdKernel(int level)
+{
+	int best = ISO_SIMD_SCALAR;
+
+#ifdef BCD_X86
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports("avx2") )
+		best = ISO_SIMD_AVX2;
+	else if ( __builtin_cpu_supports("ssse3") )
+		best = ISO_SIMD_SSSE3;
+#endif
+	if ( level < 0 || level > best )
+		level = best;
+
+	switch ( level )
+	{
+#ifdef BCD_X86
+		case ISO_SIMD_AVX2:
+			bcdPackFn = bcdPackAvx2;
+			bcdUnpackFn = bcdUnpackAvx2;
+			break;
+		case ISO_SIMD_SSSE3:
+			bcdPackFn = bcdPackSsse3;
+			bcdUnpackFn = bcdUnpackSsse3;
+			break;
+#endif
+		default:
+			bcdPackFn = bcdPackScalar;
+			bcdUnpackFn = bcdUnpackScalar;
+			break;
+	}
+
+	return level;
+}
 
+#ifdef BCD_X86
+// The process is still single threaded while constructors run: no first call can race on the pointers.
+__attribute__((constructor))
+static void bcdKernelInit(void)
+{
+	bcdKernel(ISO_SIMD_BEST);
+}
+#endif
 
-	/************** Field 30  ( n 8 - Amount, transaction processing fee ) **********************/
+// Below 8 digits no vector step applies: the pairs loop runs inline, without the indirect call
+int bcdPack(unsigned char *bcd, const char *digits, int len, int sep)
+{
+	if ( len < 8 )
+		return bcdPackPairs(bcd, digits, len, sep);
+	return bcdPackFn(bcd, digits, len, sep);
+}
 
-	if ( TESTBIT(bitmap[3], BIT6) )
-	{
-		bcdLen = LEN_D30;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D30, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D30            : %s", isoPkt->D30);
-	}
+void bcdUnpack(char *out, const unsigned char *bcd, int digits)
+{
+	if ( digits < 8 )
+		bcdUnpackPairs(out, bcd, digits);
+	else
+		bcdUnpackFn(out, bcd, digits);
+}
 
+short isoUnpack(const unsigned char *pkt, int pktLen, IsoMsg *msg)
+{
+	int offset = 0, field, len, bytes, hi, lo, lastField;
 
-	/************** Field 31  ( n 8 - Amount, settlement processing fee ) **********************/
+	msg->pkt = pkt;
+	msg->pktLen = pktLen;
+	memset(msg->field, 0, sizeof(msg->field));
 
-	if ( TESTBIT(bitmap[3], BIT7) )
-	{
-		bcdLen = LEN_D31;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D31, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D31            : %s", isoPkt->D31);
-	}
+	// Length, MTI and primary bitmap
+	if ( pktLen < 2 + 2 + 8 )
+		return ISO_ERR_SHORT;
 
+	hi = bcdByte(pkt[0]);
+	lo = bcdByte(pkt[1]);
+	if ( hi < 0 || lo < 0 )
+		return ISO_ERR_LENGTH;
+	msg->length = hi * 100 + lo;
+	offset = 2;
 
-	/************** Field 32  ( n ..11 - Acquiring institution identification code ) **********************/
+	msg->mtiOffset = offset;
+	offset += 2;
 
-	if ( TESTBIT(bitmap[3], BIT8) )
+	memcpy(msg->bitmap, pkt + offset, 8);
+	lastField = 64;
+	if ( TESTBIT(msg->bitmap[0], BIT1) )
 	{
-		bcdLen = 1;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		asciiLen = atoi((char *)tempBuffer);
-		bcdLen = (asciiLen / 2) + (asciiLen % 2);
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D32, (char *)tempBuffer, bcdLen, asciiLen, asciiLen);
-		offset += bcdLen;
-		File_Log("D32            : %s", isoPkt->D32);
+		if ( pktLen < offset + 16 )
+			return ISO_ERR_SHORT;
+		memcpy(msg->bitmap + 8, pkt + offset + 8, 8);
+		lastField = 128;
 	}
+	msg->field[1].offset = offset;
+	msg->field[1].len = lastField / 8;
+	offset += lastField / 8;
 
+	for ( field = 2; field <= lastField; field++ )
+	{
+		const IsoFieldSpec *spec = &isoSpec[field];
 
-	/************** Field 33  ( n ..11 - Forwarding institution identification code ) **********************/
+		if ( !TESTBIT(msg->bitmap[(field - 1) / 8], (7 - (field - 1) % 8)) )
+			continue;
+		if ( spec->maxLen == 0 )
+			return ISO_ERR_FIELD;
 
-	if ( TESTBIT(bitmap[4], BIT1) )
-	{
-		bcdLen = 1;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		asciiLen = atoi((char *)tempBuffer);
-		bcdLen = (asciiLen / 2) + (asciiLen % 2);
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D33, (char *)tempBuffer, bcdLen, asciiLen, asciiLen);
-		offset += bcdLen;
-		File_Log("D33            : %s", isoPkt->D33);
-	}
+		len = spec->maxLen;
+		if ( spec->lenType != ISO_LEN_FIXED )
+		{
+			int prefix = spec->lenType == ISO_LEN_LL ? 1 : 2;
+
+			if ( offset + prefix > pktLen )
+				return ISO_ERR_SHORT;
+			len = bcdByte(pkt[offset]);
+			if ( prefix == 2 && len >= 0 )
+			{
+				lo = bcdByte(pkt[offset + 1]);
+				len = lo < 0 ? -1 : len * 100 + lo;
+			}
+			if ( len < 0 || len > spec->maxLen )
+				return ISO_ERR_LENGTH;
+			offset += prefix;
+		}
 
-	/************** Field 34  ( ns ..28 - Primary account number, extended ) **********************/
+		bytes = spec->format == ISO_FMT_BCD ? (len + 1) / 2 : len;
+		if ( offset + bytes > pktLen )
+			return ISO_ERR_SHORT;
 
-	if ( TESTBIT(bitmap[4], BIT2) )
-	{
-		bcdLen = 1;
-    		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D34, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D34            : %s", isoPkt->D34);
+		msg->field[field].offset = offset;
+		msg->field[field].len = len;
+		offset += bytes;
 	}
 
-	/************** Field 35  ( z ..37 - Track 2 data ) **********************/
-
-	if ( TESTBIT(bitmap[4], BIT3) )
-	{
-		bcdLen = 1;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		asciiLen = atoi((char *)tempBuffer);
-		bcdLen = (asciiLen / 2) + (asciiLen % 2);
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D35, (char *)tempBuffer, bcdLen, asciiLen, asciiLen);
-		offset += bcdLen;
-		File_Log("D35            : %s", isoPkt->D35);
+	return ISO_OK;
+}
 
-	}
+int isoHas(const IsoMsg *msg, int field)
+{
+	return field >= 1 && field <= ISO_MAX_FIELDS && msg->field[field].offset != 0;
+}
 
-	/************** Field 36  ( n ..104 - Track 3 data ) **********************/
+int isoGetMTI(const IsoMsg *msg)
+{
+	const unsigned char *p = msg->pkt + msg->mtiOffset;
+	int hi = bcdByte(p[0]), lo = bcdByte(p[1]);
 
-	if ( TESTBIT(bitmap[4], BIT4) )
-	{
-		bcdLen = 1;
-    		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		asciiLen = atoi((char *)tempBuffer);
-		bcdLen = (asciiLen / 2) + (asciiLen % 2);
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D36, (char *)tempBuffer, bcdLen, asciiLen, asciiLen);
-		offset += bcdLen;
-		File_Log("D36            : %s", isoPkt->D36);
+	return ( hi < 0 || lo < 0 ) ? -1 : hi * 100 + lo;
+}
 
-	}
+const unsigned char *isoGetRaw(const IsoMsg *msg, int field, int *bytes)
+{
+	if ( !isoHas(msg, field) )
+		return NULL;
 
-	/************** Field 37  ( an 12 - Retrieval reference number ) **********************/
+	*bytes = msg->field[field].len;
+	if ( field > 1 && isoSpec[field].format == ISO_FMT_BCD )
+		*bytes = (*bytes + 1) / 2;
+	return msg->pkt + msg->field[field].offset;
+}
 
-	if ( TESTBIT(bitmap[4], BIT5) )
-	{
-		asciiLen = LEN_D37; 
-		memcpy((char *)isoPkt->D37, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D37            : %s", isoPkt->D37);
+int isoGetStr(const IsoMsg *msg, int field, char *out, int outSize)
+{
+	int len;
+	const unsigned char *src;
 
-	}
+	if ( !isoHas(msg, field) )
+		return -1;
 
-	/************** Field 38  ( an 6 - Authorization identification response ) **********************/
+	len = msg->field[field].len;
+	if ( len + 1 > outSize )
+		return -1;
 
-	if ( TESTBIT(bitmap[4], BIT6) )
-	{
-		asciiLen = LEN_D38; 
-		memcpy((char *)isoPkt->D38, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D38            : %s", isoPkt->D38);
-	}
+	src = msg->pkt + msg->field[field].offset;
+	if ( field > 1 && isoSpec[field].format == ISO_FMT_BCD )
+		bcdUnpack(out, src, len);
+	else
+		memcpy(out, src, len);
+	out[len] = '\0';
 
-	/************** Field 39  ( an 2 - Response code ) **********************/
+	return len;
+}
 
-	if ( TESTBIT(bitmap[4], BIT7) )
-	{
-		asciiLen = LEN_D39; 
-		memcpy((char *)isoPkt->D39, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D39            : %s", isoPkt->D39);
-	}
+int isoGetNum(const IsoMsg *msg, int field, unsigned long long *value)
+{
+	int i, digits, d;
+	const unsigned char *bcd;
+	unsigned long long v = 0;
 
+	if ( !isoHas(msg, field) || field == 1 || isoSpec[field].format != ISO_FMT_BCD )
+		return -1;
 
-	/************** Field 40  ( an 3 - Service restriction code ) **********************/
+	digits = msg->field[field].len;
+	if ( digits > 19 )
+		return -1;
 
-	if ( TESTBIT(bitmap[4], BIT8) )
+	bcd = msg->pkt + msg->field[field].offset;
+	for ( i = (digits & 1); i < digits + (digits & 1); i++ )
 	{
-		asciiLen = LEN_D40; 
-		memcpy((char *)isoPkt->D40, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D40            : %s", isoPkt->D40);
+		d = ( i & 1 ) ? (bcd[i / 2] & 0x0F) : (bcd[i / 2] >> 4);
+		if ( d > 9 )
+			return -1;
+		v = v * 10 + d;
 	}
 
-	
-
-	/************** Field 41  ( ans 16 - Card acceptor terminal identification ) **********************/
-
+	*value = v;
+	return 0;
+}
 
-	if ( TESTBIT(bitmap[5], BIT1) )
-	{
-		asciiLen = LEN_D41; 
-		memcpy((char *)isoPkt->D41, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D41            : %s", isoPkt->D41);
-	}
+// IsoPkt member of every data element, for unpack()
+#define PKT_FIELD(n) [n] = { offsetof(IsoPkt, D##n), sizeof(((IsoPkt *)0)->D##n) }
 
-		
-	/************** Field 42  ( ans 15 - Card acceptor identification code ) **********************/
+static const struct { unsigned short offset, size; } isoPktField[65] =
+{
+	PKT_FIELD(2),  PKT_FIELD(3),  PKT_FIELD(4),  PKT_FIELD(5),  PKT_FIELD(6),  PKT_FIELD(7),
+	PKT_FIELD(8),  PKT_FIELD(9),  PKT_FIELD(10), PKT_FIELD(11), PKT_FIELD(12), PKT_FIELD(13),
+	PKT_FIELD(14), PKT_FIELD(15), PKT_FIELD(16), PKT_FIELD(17), PKT_FIELD(18), PKT_FIELD(19),
+	PKT_FIELD(20), PKT_FIELD(21), PKT_FIELD(22), PKT_FIELD(23), PKT_FIELD(24), PKT_FIELD(25),
+	PKT_FIELD(26), PKT_FIELD(27), PKT_FIELD(28), PKT_FIELD(29), PKT_FIELD(30), PKT_FIELD(31),
+	PKT_FIELD(32), PKT_FIELD(33), PKT_FIELD(34), PKT_FIELD(35), PKT_FIELD(36), PKT_FIELD(37),
+	PKT_FIELD(38), PKT_FIELD(39), PKT_FIELD(40), PKT_FIELD(41), PKT_FIELD(42), PKT_FIELD(43),
+	PKT_FIELD(44), PKT_FIELD(45), PKT_FIELD(46), PKT_FIELD(47), PKT_FIELD(48), PKT_FIELD(49),
+	PKT_FIELD(50), PKT_FIELD(51), PKT_FIELD(52), PKT_FIELD(53), PKT_FIELD(54), PKT_FIELD(55),
+	PKT_FIELD(56), PKT_FIELD(57), PKT_FIELD(58), PKT_FIELD(59), PKT_FIELD(60), PKT_FIELD(61),
+	PKT_FIELD(62), PKT_FIELD(63), PKT_FIELD(64),
+};
+
+#undef PKT_FIELD
 
-	if ( TESTBIT(bitmap[5], BIT2) )
-	{
-		asciiLen = LEN_D42; 
-		memcpy((char *)isoPkt->D42, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D42            : %s", isoPkt->D42);
-	}
+/*
+ * Fills IsoPkt the way callers of the old per-field unpack() expect. Prefer isoUnpack(): it does not
+ * touch the 12 KB struct at all. Build with -DISO_TRACE to log every message as before.
+ */
+short unpack(unsigned char *pkt, int pktLen, IsoPkt *isoPkt)
+{
+	IsoMsg msg;
+	short ret;
+	int field, bitMapLen;
 
-	
-	/************** Field 43  ( ans 40 - Card acceptor name/location (1-23 address 24-36 city 37-38 state 39-40 country)  ) **********************/
+	ret = isoUnpack(pkt, pktLen, &msg);
+	if ( ret != ISO_OK )
+		return ret;
 
-	if ( TESTBIT(bitmap[5], BIT3) )
-	{
-		asciiLen = 40; 
-		memcpy((char *)isoPkt->D43, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D43            : %s", isoPkt->D43);
-	}
+	isoPkt->pktLen = msg.length;
+	bcdUnpack((char *)isoPkt->MTI, pkt + msg.mtiOffset, 4);
+	isoPkt->MTI[4] = '\0';
 
-	
-	/************** Field 44  ( an ..25 - Additional response data ) **********************/
+	bitMapLen = msg.field[1].len;
+	memcpy(isoPkt->D1, msg.bitmap, bitMapLen);
+	memcpy(isoPkt->BITMAP, msg.bitmap, bitMapLen);
+	isoPkt->isSecondaryBitMapSet = bitMapLen == 16;
 
-	if ( TESTBIT(bitmap[5], BIT4) )
+	for ( field = 2; field <= 64; field++ )
 	{
-		bcdLen = 1;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D44, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D44            : %s", isoPkt->D44);
+		if ( isoHas(&msg, field) )
+			isoGetStr(&msg, field, (char *)isoPkt + isoPktField[field].offset, isoPktField[field].size);
 	}
 
-	
-	/************** Field 45  ( an ..76 -Track 1 data ) **********************/
-
-	if ( TESTBIT(bitmap[5], BIT5) )
+#ifdef ISO_TRACE
+	File_Log("\n----------------- Unpacking---------------------");
+	File_Log("Packet Length  : %d", isoPkt->pktLen);
+	printHexDump("Raw Packet    ", pkt, pktLen);
+	File_Log("Packet MTI     : %s", isoPkt->MTI);
+	for ( field = 2; field <= 64; field++ )
 	{
-		bcdLen = 1;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D45, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D45            : %s", isoPkt->D45);
+		if ( isoHas(&msg, field) )
+			File_Log("D%-2d            : %s", field, (char *)isoPkt + isoPktField[field].offset);
 	}
+#endif
 
-	
-	/************** Field 46  ( an ...999  - Additional data - ISO ) **********************/
+	return ISO_OK;
+}
 
-	if ( TESTBIT(bitmap[5], BIT6) )
-	{
-		bcdLen = 2;
-    		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D46, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D46            : %s", isoPkt->D46);
-	}
+/************************************ Arena-backed builder **************************************
+ *
+ * Only the fields that are set are held, already in wire format (length prefix included), in an arena
+ * the caller provides. Every isoSet*() keeps the bitmap and the packed length current, so isoPack()
+ * is one pass of memcpy in field order into a buffer the caller sized with isoPackedLen().
+ *
+ ************************************************************************************************/
 
-	
-	/************** Field 47  ( an ...999 - Additional data - national ) **********************/
+static unsigned char toBcdByte(int v)
+{
+	return (unsigned char)(((v / 10) << 4) | (v % 10));
+}
 
-	if ( TESTBIT(bitmap[5], BIT7) )
-	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D47, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D47            : %s", isoPkt->D47);
-	}
+void isoBuilderInit(IsoBuilder *b, int mti, unsigned char *arena, int arenaSize)
+{
+	memset(b->bitmap, 0, sizeof(b->bitmap));
+	memset(b->field, 0, sizeof(b->field));
+	b->arena = arena;
+	b->arenaSize = arenaSize;
+	b->used = 0;
+	b->wireLen = 2 + 2 + 8;
+	b->mti = mti;
+	b->secondary = 0;
+}
 
-		
-	/************** Field 48  ( an ...999 - Additional data - private ) **********************/
+/*
+ * value: digits for n/z fields ('0'..'9', '=' for the track 2 separator), characters or bytes for the
+ * others; len -1 for strlen(). Fixed fields shorter than their length are padded with '0' on the left,
+ * as pack() always did. Setting a field again replaces it (the old bytes stay in the arena).
+ */
+int isoSetStr(IsoBuilder *b, int field, const char *value, int len)
+{
+	const IsoFieldSpec *spec;
+	int prefix, digits, bytes, pad;
+	unsigned char *out;
 
-	if ( TESTBIT(bitmap[5], BIT8) )
-	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D48, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D48            : %s", isoPkt->D48);
-	}
+	if ( field < 2 || field > ISO_MAX_FIELDS || isoSpec[field].maxLen == 0 )
+		return ISO_ERR_FIELD;
+	spec = &isoSpec[field];
 
-	/************** Field 49  ( a or n 3 - Currency code, transaction , using as an 3 ) ***********/
+	if ( len < 0 )
+		len = strlen(value);
+	if ( len > spec->maxLen ||
+			(spec->format == ISO_FMT_BINARY && spec->lenType == ISO_LEN_FIXED && len != spec->maxLen) )
+		return ISO_ERR_LENGTH;
 
-	if ( TESTBIT(bitmap[6], BIT1) )
-	{	
-		asciiLen = LEN_D49; 
-    		memcpy((char *)isoPkt->D49, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D49            : %s", isoPkt->D49);
-	}
-    
+	prefix = spec->lenType == ISO_LEN_LL ? 1 : spec->lenType == ISO_LEN_LLL ? 2 : 0;
+	digits = spec->lenType == ISO_LEN_FIXED ? spec->maxLen : len;
+	bytes = spec->format == ISO_FMT_BCD ? (digits + 1) / 2 : digits;
 
-	/************** Field 50  ( a or n 3 - Currency code, settlement, using as an 3 ) **********/
+	if ( b->used + prefix + bytes > b->arenaSize )
+		return ISO_ERR_SPACE;
+	if ( b->wireLen + prefix + bytes + 8 > 9999 )
+		return ISO_ERR_LENGTH;               // the 4 digit length header could not say it
 
-	if ( TESTBIT(bitmap[6], BIT2) )
+	out = b->arena + b->used;
+	if ( prefix == 1 )
 	{
-		asciiLen = LEN_D50; 
-		memcpy((char *)isoPkt->D50, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D50            : %s", isoPkt->D50);
+		out[0] = toBcdByte(len);
 	}
-
-	/************** Field 51  ( a or n 3 - Currency code, cardholder billing, using as an 3 ) ******/
-
-	if ( TESTBIT(bitmap[6], BIT3) )
+	else if ( prefix == 2 )
 	{
-		asciiLen = LEN_D51; 
-		memcpy((char *)isoPkt->D51, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D51            : %s", isoPkt->D51);
+		out[0] = toBcdByte(len / 100);
+		out[1] = toBcdByte(len % 100);
 	}
 
-	/************** Field 52  ( b 64 - Personal identification number data ) **********************/
-
-	if ( TESTBIT(bitmap[6], BIT4) )
+	if ( spec->format == ISO_FMT_BCD )
 	{
-		asciiLen = LEN_D52; 
-		memcpy((char *)isoPkt->D52, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D52            : %s", isoPkt->D52);
+		pad = bytes - (len + 1) / 2;
+		memset(out + prefix, 0, pad);
+		if ( bcdPack(out + prefix + pad, value, len, field == 35) != ISO_OK )
+			return ISO_ERR_DIGIT;   // nothing is committed before this point
 	}
-
-	/************** Field 53  ( n 18 - Security related control information ) **********************/
-
-
-	if ( TESTBIT(bitmap[6], BIT5) )
+	else
 	{
-		bcdLen = LEN_D53;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memcpy(tempBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)isoPkt->D53, (char *)tempBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		offset += bcdLen;
-		File_Log("D53            : %s", isoPkt->D53);
+		pad = digits - len;
+		memset(out + prefix, '0', pad);
+		memcpy(out + prefix + pad, value, len);
 	}
 
-	/************** Field 54  ( an ...120 - Additional amounts ) **********************/
-
-	if ( TESTBIT(bitmap[6], BIT6) )
+	if ( TESTBIT(b->bitmap[(field - 1) / 8], (7 - (field - 1) % 8)) )
 	{
-		bcdLen = 1;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D54, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D54            : %s", isoPkt->D54);
+		b->wireLen -= b->field[field].len;
 	}
-
-	/************** Field 55  ( an ...999 - Reserved ISO ) **********************/
-
-	if ( TESTBIT(bitmap[6], BIT7) )
+	else
 	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D55, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D55            : %s", isoPkt->D55);
+		SETBIT(b->bitmap[(field - 1) / 8], (7 - (field - 1) % 8));
+		if ( field > 64 && b->secondary++ == 0 )
+		{
+			SETBIT(b->bitmap[0], BIT1);
+			b->wireLen += 8;
+		}
 	}
 
-	/************** Field 56  ( ans ...999 - Reserved ISO ) **********************/
+	b->field[field].offset = b->used;
+	b->field[field].len = prefix + bytes;
+	b->used += prefix + bytes;
+	b->wireLen += prefix + bytes;
 
-	if ( TESTBIT(bitmap[6], BIT8) )
-	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D56, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D56            : %s", isoPkt->D56);
-	}
+	return ISO_OK;
+}
 
-	/************** Field 57  ( ans ...999 - Reserved national ) **********************/
+int isoSetNum(IsoBuilder *b, int field, unsigned long long value)
+{
+	char digits[21];
+	int i = sizeof(digits) - 1;
+
+	if ( field < 2 || field > ISO_MAX_FIELDS || isoSpec[field].format != ISO_FMT_BCD )
+		return ISO_ERR_FIELD;
 
-	if ( TESTBIT(bitmap[7], BIT1) )
+	digits[i] = '\0';
+	do
 	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D57, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D57            : %s", isoPkt->D57);
-	}
+		digits[--i] = '0' + value % 10;
+		value /= 10;
+	} while ( value );
+
+	return isoSetStr(b, field, digits + i, sizeof(digits) - 1 - i);
+}
 
-	/************** Field 58  ( ans ...999 - Reserved national ) **********************/
+void isoClear(IsoBuilder *b, int field)
+{
+	if ( field < 2 || field > ISO_MAX_FIELDS || !TESTBIT(b->bitmap[(field - 1) / 8], (7 - (field - 1) % 8)) )
+		return;
 
-	if ( TESTBIT(bitmap[7], BIT2) )
+	CLRBIT(b->bitmap[(field - 1) / 8], (7 - (field - 1) % 8));
+	b->wireLen -= b->field[field].len;
+	if ( field > 64 && --b->secondary == 0 )
 	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D58, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D58            : %s", isoPkt->D58);
+		CLRBIT(b->bitmap[0], BIT1);
+		b->wireLen -= 8;
 	}
+}
 
-	/************** Field 59  ( ans ...999 - Reserved national use ) **********************/
+int isoPackedLen(const IsoBuilder *b)
+{
+	return b->wireLen;
+}
 
-	if ( TESTBIT(bitmap[7], BIT3) )
-	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D59, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D59            : %s", isoPkt->D59);
-	}
+int isoPack(const IsoBuilder *b, unsigned char *pkt, int pktSize)
+{
+	int offset, bitMapLen, i, bit, field;
 
-	/************** Field 60  ( ans ...999 - Reserved national  ) **********************/
+	if ( pktSize < b->wireLen )
+		return ISO_ERR_SPACE;
 
-	if ( TESTBIT(bitmap[7], BIT4) )
-	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D60, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D60            : %s", isoPkt->D60);
-	}
+	pkt[0] = toBcdByte(b->wireLen / 100);
+	pkt[1] = toBcdByte(b->wireLen % 100);
+	pkt[2] = toBcdByte(b->mti / 100 % 100);
+	pkt[3] = toBcdByte(b->mti % 100);
 
-	/************** Field 61  ( ans ...999 - Reserved private ) **********************/
+	bitMapLen = b->secondary ? 16 : 8;
+	memcpy(pkt + 4, b->bitmap, bitMapLen);
+	offset = 4 + bitMapLen;
 
-	if ( TESTBIT(bitmap[7], BIT5) )
+	for ( i = 0; i < bitMapLen; i++ )
 	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D61, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D61            : %s", isoPkt->D61);
+		if ( b->bitmap[i] == 0 )
+			continue;
+		for ( bit = 0; bit < 8; bit++ )
+		{
+			field = i * 8 + bit + 1;
+			if ( field == 1 || !TESTBIT(b->bitmap[i], (7 - bit)) )
+				continue;
+			memcpy(pkt + offset, b->arena + b->field[field].offset, b->field[field].len);
+			offset += b->field[field].len;
+		}
 	}
 
-	/************** Field 62  ( ans ...999 - Reserved private ) **********************/
-
-	if ( TESTBIT(bitmap[7], BIT6) )
-	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D62, pkt+offset, bcdLen);
-		offset += bcdLen;
-		File_Log("D62            : %s", isoPkt->D62);
+	return offset;
+}
 
-	}
+/*
+ * Packs the set D2..D64 of an IsoPkt through a builder. Binary fields (D52, D64) are taken at their
+ * full length, everything else up to its NUL. Returns the packet length or an ISO_ERR_* code.
+ */
+int pack(IsoPkt *isoPkt, unsigned char *pkt)
+{
+	unsigned char arena[sizeof(IsoPkt)];   // every member at its longest still fits
+	IsoBuilder b;
+	const char *member;
+	int field, len, ret;
 
-	/************** Field 63  ( ans ...999 - Reserved private ) **********************/
+	isoBuilderInit(&b, atoi((char *)isoPkt->MTI), arena, sizeof(arena));
 
-	if ( TESTBIT(bitmap[7], BIT7) )
+	for ( field = 2; field <= 64; field++ )
 	{
-		bcdLen = 2;
-		memset(tempBuffer, 0, sizeof(tempBuffer));
-		memset(lenBuffer, 0, sizeof(lenBuffer));
-		memcpy(lenBuffer, pkt+offset, bcdLen);
-		BCDn2str((char *)tempBuffer, (char *)lenBuffer, bcdLen, bcdLen*2, bcdLen*2);
-		tempBuffer[bcdLen*2]='\0';
-		offset += bcdLen;
-
-		bcdLen = atoi((char *)tempBuffer);
-		memcpy(isoPkt->D63, pkt+offset, bcdLen);	
-		offset += bcdLen;
-		File_Log("D63            : %s", isoPkt->D63);
-
-	}
+		member = (const char *)isoPkt + isoPktField[field].offset;
+		if ( !*member )
+			continue;
 
-	/************** Field 64  ( b 16 - Message authentication code (MAC) ) **********************/
+		if ( isoSpec[field].format == ISO_FMT_BINARY )
+			len = isoSpec[field].maxLen;
+		else
+			len = strnlen(member, isoPktField[field].size);
 
-	if ( TESTBIT(bitmap[7], BIT8) )
-	{
-		asciiLen = LEN_D64; 
-		memcpy((char *)isoPkt->D64, pkt+offset, asciiLen);
-		offset += asciiLen;
-		File_Log("D64            : %s", isoPkt->D64);
-	}    
+		ret = isoSetStr(&b, field, member, len);
+		if ( ret != ISO_OK )
+			return ret;
+	}
 
-	return 0;
+	len = isoPack(&b, pkt, isoPackedLen(&b));
+	isoPkt->pktLen = len;
+	memcpy(isoPkt->BITMAP, b.bitmap, b.secondary ? 16 : 8);
 
+#ifdef ISO_TRACE
+	File_Log("\n----------------- Packing---------------------");
+	File_Log("Packet Length  : %d", isoPkt->pktLen);
+	printHexDump("Raw Packet    ", pkt, isoPkt->pktLen);
+#endif
 
+	return len;
 }
 
+// data right-aligned into BCDasciiLen bytes, zero nibbles in front
 void strn2BCD(unsigned char *bcd, unsigned char *data, int dataasciiLen, int BCDasciiLen)
 {
-	int i,rem,div;
-	memset(bcd,0,BCDasciiLen);
-	div = dataasciiLen / 2;
-	rem = dataasciiLen % 2;
-	for(i = 0;i < (div);i++)
-	{
-		bcd[BCDasciiLen - i - 1] = (((data[dataasciiLen - 2*i -1 ] - '0')) | ((data[dataasciiLen - (2*i) - 2] - '0') << 4));
-	}
-	if(rem != 0)
-	{
-		bcd[(BCDasciiLen - div) - 1] = (data[0] - '0');
-	}
+	int bytes = (dataasciiLen + 1) / 2;
+
+	memset(bcd, 0, BCDasciiLen - bytes);
+	bcdPack(bcd + BCDasciiLen - bytes, (const char *)data, dataasciiLen, 1);
 }
 
+// The last numdigits nibbles of bcd right-aligned into dataasciiLen characters, '0' in front
 void BCDn2str(char *data, char *bcd, int BCDasciiLen, int dataasciiLen,int numdigits)
 {
-	// dataasciiLen >= (numdigits)
-	int i;
-	memset(data,0x30,dataasciiLen);
-	for(i = 0;i<numdigits;i++)
-	{
-		if((i%2) == 0)
-		{
-			data[dataasciiLen - i - 1] =  (((bcd[BCDasciiLen - (i/2) - 1]) & 0x0F) + '0');
-
-		}
-		else
-		{
-			data[dataasciiLen - i - 1] =  (((bcd[BCDasciiLen - (i/2) - 1] >> 4) & 0x0F) + '0');
-		}
-
-	}
-
-	
+	memset(data, '0', dataasciiLen - numdigits);
+	bcdUnpack(data + dataasciiLen - numdigits, (unsigned char *)bcd + BCDasciiLen - (numdigits + 1) / 2, numdigits);
 }
 
 /*********************** Already Defined in userEntry.c file *********************************
@@ -2201,94 +973,495 @@ void printHexDump(const char *title, const unsigned char *str, int len)
 
 }
 
+static void fillTestPkt(IsoPkt *reqPkt)
+{
+	strcpy((char *)reqPkt->header, "0001110222");
+	strcpy((char *)reqPkt->MTI, "0200");
+	strcpy((char *)reqPkt->D2,  "12345678901234567");
+	strcpy((char *)reqPkt->D3,  "000000");
+	strcpy((char *)reqPkt->D4,  "123456789012");
+	strcpy((char *)reqPkt->D5,  "878787878277");
+	strcpy((char *)reqPkt->D6,  "343434343434");
+	strcpy((char *)reqPkt->D7,  "5555555555");
+	strcpy((char *)reqPkt->D8,  "444441");
+	strcpy((char *)reqPkt->D9,  "1111121");
+	strcpy((char *)reqPkt->D10, "5555");
+	strcpy((char *)reqPkt->D11, "22");
+	strcpy((char *)reqPkt->D12, "101010");
+	strcpy((char *)reqPkt->D13, "2103");
+	strcpy((char *)reqPkt->D14, "1214");
+	strcpy((char *)reqPkt->D22, "021");
+	strcpy((char *)reqPkt->D23, "005");
+	strcpy((char *)reqPkt->D24, "999");
+	strcpy((char *)reqPkt->D25, "79");
+	strcpy((char *)reqPkt->D26, "69");
+	strcpy((char *)reqPkt->D27, "7");
+	strcpy((char *)reqPkt->D28, "28");
+	strcpy((char *)reqPkt->D29, "2929");
+	strcpy((char *)reqPkt->D30, "303030");
+	strcpy((char *)reqPkt->D31, "31313131");
+	strcpy((char *)reqPkt->D32, "3232323");
+	strcpy((char *)reqPkt->D33, "33333");
+	strcpy((char *)reqPkt->D34, "Pan Extended");
+	strcpy((char *)reqPkt->D35, "1234567890123456=12142061234567");
+	strcpy((char *)reqPkt->D36, "34512345678901234567890123456789012345678901234567890123456789012");
+	strcpy((char *)reqPkt->D37, "RRN NUMBER");
+	strcpy((char *)reqPkt->D38, "989897");
+	strcpy((char *)reqPkt->D39, "00");
+	strcpy((char *)reqPkt->D40, "SRC");
+	strcpy((char *)reqPkt->D41, "41012001");
+	strcpy((char *)reqPkt->D42, "123456789012345");
+	strcpy((char *)reqPkt->D43, "ADDRESS 1-23 address 24-36 city 37-38");
+	strcpy((char *)reqPkt->D44, "Additional response data");
+	strcpy((char *)reqPkt->D45, "Track 1 data,  an ..76");
+	strcpy((char *)reqPkt->D46, "Additional data - ISO       an ...999");
+	strcpy((char *)reqPkt->D47, "Additional data - national  an ...999");
+	strcpy((char *)reqPkt->D48, "Additional data - private   an ...999");
+	strcpy((char *)reqPkt->D49, "D49"); // a or n 3
+	strcpy((char *)reqPkt->D50, "D50"); // a or n 3
+	strcpy((char *)reqPkt->D51, "D51"); // a or n 3
+	strcpy((char *)reqPkt->D52, "12345678");
+	strcpy((char *)reqPkt->D53, "6543211234567890");
+	strcpy((char *)reqPkt->D54, "Additional amounts");
+	strcpy((char *)reqPkt->D55, "Reserved ISO  E M V   D A T A");
+	strcpy((char *)reqPkt->D56, "Reserved ISO  DE56");
+	strcpy((char *)reqPkt->D57, "Reserved national  DE57");
+	strcpy((char *)reqPkt->D58, "Reserved national  DE58");
+	strcpy((char *)reqPkt->D59, "Reserved national  DE59");
+	strcpy((char *)reqPkt->D60, "Reserved national  DE60");
+	strcpy((char *)reqPkt->D61, "Reserved Private DE61......................");
+	strcpy((char *)reqPkt->D62, "Reserved Private DE61......................");
+	strcpy((char *)reqPkt->D63, "Reserved Private DE61......................");
+}
+
+// Numeric fields take '0'..'9' only ('=' in track 2 too): a bad character at every position of a
+// track 2 long enough for every kernel's vector loop and tails must be rejected by every kernel.
+static int digitTest(void)
+{
+	static const char bad[] = ":;<>?/A ";
+	unsigned char arena[256];
+	char value[40];
+	IsoBuilder b;
+	int level, best, pos, k, failures = 0;
+
+	best = bcdKernel(ISO_SIMD_BEST);
+	for ( level = ISO_SIMD_SCALAR; level <= best; level++ )
+	{
+		bcdKernel(level);
+		isoBuilderInit(&b, 200, arena, sizeof(arena));
+
+		if ( isoSetStr(&b, 35, "1234567890123456=12142061234567", -1) != ISO_OK ||
+				isoSetStr(&b, 2, "4111111111111111", -1) != ISO_OK )
+			failures++;
+		if ( isoSetStr(&b, 2, "411111111111=111", -1) != ISO_ERR_DIGIT ||
+				isoSetStr(&b, 4, "00000000100:", -1) != ISO_ERR_DIGIT )
+			failures++;
+
+		for ( pos = 0; pos < 37; pos++ )
+		{
+			for ( k = 0; bad[k]; k++ )
+			{
+				memset(value, '7', 37);
+				value[pos] = bad[k];
+				if ( isoSetStr(&b, 35, value, 37) != ISO_ERR_DIGIT )
+				{
+					printf("\nkernel %d: '%c' at %d of D35 accepted", level, bad[k], pos);
+					failures++;
+				}
+			}
+		}
+	}
+	bcdKernel(ISO_SIMD_BEST);
+
+	printf("\nnon-digit rejection: %s", failures ? "FAILED" : "ok");
+	return failures;
+}
+
 int parserTest(void)
 {
-	short len = 0;
+	short len = 0, ret;
+	int field;
+	char value[1000];
 	IsoPkt reqPkt = {0};
-	IsoPkt rspPkt = {0};
+	IsoMsg msg;
 	unsigned char pkt[1025] ={0};
 
-	strcpy((char *)reqPkt.header, "0001110222");
-	strcpy((char *)reqPkt.MTI, "0200");
-	strcpy((char *)reqPkt.D2,  "12345678901234567");
-	strcpy((char *)reqPkt.D3,  "000000");
-	strcpy((char *)reqPkt.D4,  "123456789012");
-    	strcpy((char *)reqPkt.D5,  "878787878277");
-    	strcpy((char *)reqPkt.D6,  "343434343434");
-    	strcpy((char *)reqPkt.D7,  "5555555555");
-    	strcpy((char *)reqPkt.D8,  "444441");
-    	strcpy((char *)reqPkt.D9,  "1111121");
-    	strcpy((char *)reqPkt.D10, "5555");
-	strcpy((char *)reqPkt.D11, "22");
-	strcpy((char *)reqPkt.D12, "101010");
-	strcpy((char *)reqPkt.D13, "2103");
-	strcpy((char *)reqPkt.D14, "1214");
-	strcpy((char *)reqPkt.D22, "021");
-	strcpy((char *)reqPkt.D23, "005");
-	strcpy((char *)reqPkt.D24, "999");
-	strcpy((char *)reqPkt.D25, "79");
-	strcpy((char *)reqPkt.D26, "69");
-    	strcpy((char *)reqPkt.D27, "7");
-    	strcpy((char *)reqPkt.D28, "28");
-    	strcpy((char *)reqPkt.D29, "2929");
-    	strcpy((char *)reqPkt.D30, "303030");
-    	strcpy((char *)reqPkt.D31, "31313131");
-    	strcpy((char *)reqPkt.D32, "3232323");
-    	strcpy((char *)reqPkt.D33, "33333");
-    	strcpy((char *)reqPkt.D34, "Pan Extended");
-	strcpy((char *)reqPkt.D35, "1234567890123456=12142061234567");
-    	strcpy((char *)reqPkt.D36, "34512345678901234567890123456789012345678901234567890123456789012");
-    	strcpy((char *)reqPkt.D37, "RRN NUMBER");
-    	strcpy((char *)reqPkt.D38, "989897");
-    	strcpy((char *)reqPkt.D39, "00");
-    	strcpy((char *)reqPkt.D40, "SRC");
-	strcpy((char *)reqPkt.D41, "41012001");
-	strcpy((char *)reqPkt.D42, "123456789012345");
-    	strcpy((char *)reqPkt.D43, "ADDRESS 1-23 address 24-36 city 37-38");
-	strcpy((char *)reqPkt.D44, "Additional response data");
-    	strcpy((char *)reqPkt.D45, "Track 1 data,  an ..76");
-    	strcpy((char *)reqPkt.D46, "Additional data - ISO       an ...999");
-    	strcpy((char *)reqPkt.D47, "Additional data - national  an ...999");
-    	strcpy((char *)reqPkt.D48, "Additional data - private   an ...999");
-    	strcpy((char *)reqPkt.D49, "D49"); // a or n 3
-    	strcpy((char *)reqPkt.D50, "D50"); // a or n 3
-	strcpy((char *)reqPkt.D51, "D51"); // a or n 3
-	strcpy((char *)reqPkt.D52, "12345678");
-	strcpy((char *)reqPkt.D53, "6543211234567890");
-	strcpy((char *)reqPkt.D54, "Additional amounts");
-    	strcpy((char *)reqPkt.D55, "Reserved ISO  E M V   D A T A");
-    	strcpy((char *)reqPkt.D56, "Reserved ISO  DE56");
-    	strcpy((char *)reqPkt.D57, "Reserved national  DE57");
-    	strcpy((char *)reqPkt.D58, "Reserved national  DE58");
-    	strcpy((char *)reqPkt.D59, "Reserved national  DE59");
-    	strcpy((char *)reqPkt.D60, "Reserved national  DE60");
-	strcpy((char *)reqPkt.D61, "Reserved Private DE61......................");
-	strcpy((char *)reqPkt.D62, "Reserved Private DE61......................");
-	strcpy((char *)reqPkt.D63, "Reserved Private DE61......................");
-	
+	fillTestPkt(&reqPkt);
 
 	// Packing
 	len = pack(&reqPkt, pkt);	
 	
 	//Unpacking
-	unpack(pkt, len, &rspPkt);
+	ret = isoUnpack(pkt, len, &msg);
+	if ( ret != ISO_OK )
+	{
+		printf("\nisoUnpack failed: %d\n", ret);
+		return ret;
+	}
+
+	printf("\nMTI %04d, %d bytes", isoGetMTI(&msg), msg.length);
+	for ( field = 2; field <= ISO_MAX_FIELDS; field++ )
+	{
+		if ( isoGetStr(&msg, field, value, sizeof(value)) >= 0 )
+			printf("\nD%-3d : %s", field, field == 52 || field == 64 ? "(binary)" : value);
+	}
+
+	ret = digitTest();
+	printf("\n");
+
+	return ret;
+}
+
+static double elapsedSeconds(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
 
+/*
+ * ns per field for bcdPack()/bcdUnpack() with every kernel the CPU has, at the lengths numeric fields
+ * come in: MTI/date (4), STAN/processing code (6), amount (12), PAN (19), track 2 (37), LL maximum (99).
+ */
+static int bcdBench(int iterations)
+{
+	static const int lengths[] = { 4, 6, 12, 19, 37, 99 };
+	static const char *names[] = { "scalar", "ssse3", "avx2" };
+	char digits[100], out[100];
+	unsigned char bcd[50];
+	char *volatile src = digits;              // reloaded every call: nothing gets hoisted out of the loops
+	unsigned char *volatile packed = bcd;
+	struct timespec start;
+	double packNs, unpackNs;
+	unsigned long long sum = 0;
+	int level, best, i, k, len;
+
+	for ( i = 0; i < (int)sizeof(digits); i++ )
+		digits[i] = '0' + (i * 7) % 10;
+
+	best = bcdKernel(ISO_SIMD_BEST);
+	printf("\nBCD kernels (ns per field, pack / unpack)\n  digits ");
+	for ( level = ISO_SIMD_SCALAR; level <= best; level++ )
+		printf("%18s", names[level]);
+
+	for ( k = 0; k < (int)(sizeof(lengths) / sizeof(lengths[0])); k++ )
+	{
+		len = lengths[k];
+		printf("\n  %6d ", len);
+		for ( level = ISO_SIMD_SCALAR; level <= best; level++ )
+		{
+			bcdKernel(level);
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for ( i = 0; i < iterations; i++ )
+			{
+				sum += bcdPack(packed, src, len, 0);
+				sum += bcd[0];
+			}
+			packNs = elapsedSeconds(&start) * 1e9 / iterations;
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for ( i = 0; i < iterations; i++ )
+			{
+				bcdUnpack(out, packed, len);
+				sum += out[len - 1];
+			}
+			unpackNs = elapsedSeconds(&start) * 1e9 / iterations;
+
+			printf("     %5.1f / %5.1f", packNs, unpackNs);
+		}
+	}
 	printf("\n");
 
+	bcdKernel(ISO_SIMD_BEST);
+	return sum == 0;
+}
 
-	return 0;
+/*
+ * Packs per second: pack() of the test message from its IsoPkt, and a builder filling an authorization
+ * response (12 fields) straight from values.
+ * Parses per second of the test message (63 fields, ~900 bytes):
+ *   unpack()      fills the full IsoPkt, as the old per-field code did (minus its logging)
+ *   isoUnpack()   views only
+ *   authorization isoUnpack() + the fields an authorization switch routes on (2, 3, 4, 11, 37, 41, 49)
+ */
+int parserBench(int iterations)
+{
+	IsoPkt reqPkt = {0};
+	static IsoPkt rspPkt;
+	IsoMsg msg;
+	IsoBuilder b;
+	unsigned char pkt[1025] = {0}, arena[256], out[256];
+	char pan[20], rrn[13], tid[9], cur[4];
+	unsigned long long procCode, amount, stan, sum = 0;
+	struct timespec start;
+	double secs;
+	short len = 0;
+	int i;
+
+	fillTestPkt(&reqPkt);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for ( i = 0; i < iterations; i++ )
+	{
+		len = pack(&reqPkt, pkt);
+		sum += pkt[len - 1];
+	}
+	secs = elapsedSeconds(&start);
+	printf("\npack()        : %10.0f msg/s  (%.0f ns/msg)", iterations / secs, secs * 1e9 / iterations);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for ( i = 0; i < iterations; i++ )
+	{
+		isoBuilderInit(&b, 210, arena, sizeof(arena));
+		isoSetStr(&b, 2, "4761739001010010", -1);
+		isoSetNum(&b, 3, 0);
+		isoSetNum(&b, 4, 12500 + i % 100);
+		isoSetStr(&b, 7, "1019120000", 10);
+		isoSetNum(&b, 11, i % 1000000);
+		isoSetStr(&b, 12, "120000", 6);
+		isoSetStr(&b, 13, "1019", 4);
+		isoSetStr(&b, 37, "629212000001", 12);
+		isoSetStr(&b, 38, "A1B2C3", 6);
+		isoSetStr(&b, 39, "00", 2);
+		isoSetStr(&b, 41, "41012001", 8);
+		isoSetStr(&b, 49, "840", 3);
+		len = isoPack(&b, out, sizeof(out));
+		sum += out[len - 1];
+	}
+	secs = elapsedSeconds(&start);
+	printf("\nbuilder 0210  : %10.0f msg/s  (%.0f ns/msg, %d bytes)", iterations / secs, secs * 1e9 / iterations, len);
+
+	len = pack(&reqPkt, pkt);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for ( i = 0; i < iterations; i++ )
+	{
+		unpack(pkt, len, &rspPkt);
+		sum += rspPkt.D4[11];
+	}
+	secs = elapsedSeconds(&start);
+	printf("\nunpack()      : %10.0f msg/s  (%.0f ns/msg)", iterations / secs, secs * 1e9 / iterations);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for ( i = 0; i < iterations; i++ )
+	{
+		isoUnpack(pkt, len, &msg);
+		sum += msg.field[4].offset;
+	}
+	secs = elapsedSeconds(&start);
+	printf("\nisoUnpack()   : %10.0f msg/s  (%.0f ns/msg)", iterations / secs, secs * 1e9 / iterations);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for ( i = 0; i < iterations; i++ )
+	{
+		isoUnpack(pkt, len, &msg);
+		isoGetStr(&msg, 2, pan, sizeof(pan));
+		isoGetNum(&msg, 3, &procCode);
+		isoGetNum(&msg, 4, &amount);
+		isoGetNum(&msg, 11, &stan);
+		isoGetStr(&msg, 37, rrn, sizeof(rrn));
+		isoGetStr(&msg, 41, tid, sizeof(tid));
+		isoGetStr(&msg, 49, cur, sizeof(cur));
+		sum += amount + stan + procCode + pan[3] + rrn[0] + tid[0] + cur[0];
+	}
+	secs = elapsedSeconds(&start);
+	printf("\nauthorization : %10.0f msg/s  (%.0f ns/msg)\n", iterations / secs, secs * 1e9 / iterations);
+
+	return bcdBench(iterations) + (sum == 0);
+}
+
+static unsigned int fuzzRand(unsigned int *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+// A valid value for the field: digits (and '=' in track 2) for numeric fields, printable text otherwise
+static int fuzzValue(int field, unsigned int *state, char *value)
+{
+	const IsoFieldSpec *spec = &isoSpec[field];
+	int len, i;
+
+	if ( spec->format == ISO_FMT_BINARY )
+		len = spec->maxLen;
+	else
+		len = 1 + fuzzRand(state) % spec->maxLen;
+
+	for ( i = 0; i < len; i++ )
+	{
+		if ( spec->format == ISO_FMT_BCD )
+			value[i] = field == 35 && fuzzRand(state) % 8 == 0 ? '=' : '0' + fuzzRand(state) % 10;
+		else if ( spec->format == ISO_FMT_ASCII )
+			value[i] = ' ' + fuzzRand(state) % 95;
+		else
+			value[i] = 1 + fuzzRand(state) % 255;
+	}
+	value[len] = '\0';
+
+	return len;
+}
+
+// Every kernel against the scalar one, on random lengths with the odd '=' or character out of range
+static int fuzzKernels(int iterations, unsigned int *state)
+{
+	char digits[130], out[130], expectedOut[130];
+	unsigned char bcd[65], expectedBcd[65];
+	int i, j, r, len, sep, ret, level, best, failures = 0;
+
+	best = bcdKernel(ISO_SIMD_BEST);
+	for ( i = 0; i < iterations; i++ )
+	{
+		len = fuzzRand(state) % (int)sizeof(digits);
+		sep = fuzzRand(state) & 1;
+		for ( j = 0; j < len; j++ )
+		{
+			r = fuzzRand(state) % 512;
+			digits[j] = r == 0 ? fuzzRand(state) % 256 : r < 8 ? '=' : '0' + fuzzRand(state) % 10;
+		}
+
+		bcdKernel(ISO_SIMD_SCALAR);
+		ret = bcdPack(expectedBcd, digits, len, sep);
+		bcdUnpack(expectedOut, expectedBcd, len);
+
+		for ( level = ISO_SIMD_SCALAR + 1; level <= best; level++ )
+		{
+			bcdKernel(level);
+			if ( bcdPack(bcd, digits, len, sep) != ret ||
+					(ret == ISO_OK && memcmp(bcd, expectedBcd, (len + 1) / 2) != 0) )
+			{
+				printf("\nkernel %d: bcdPack() of %d characters differs", level, len);
+				failures++;
+			}
+			bcdUnpack(out, expectedBcd, len);
+			if ( memcmp(out, expectedOut, len) != 0 )
+			{
+				printf("\nkernel %d: bcdUnpack() of %d digits differs", level, len);
+				failures++;
+			}
+		}
+	}
+
+	bcdKernel(ISO_SIMD_BEST);
+	return failures;
+}
+
+/*
+ * The BCD kernels against each other first. Then the round trip of random messages: builder ->
+ * isoPack() -> unpack() / isoUnpack() must give back every value (fixed fields padded with '0' on the
+ * left), and pack() of the unpacked IsoPkt must produce the same bytes. Each packet is then truncated and has a byte flipped for isoUnpack(), which must stay
+ * inside it: build with -fsanitize=address to have that checked.
+ */
+int parserFuzz(int iterations, unsigned int seed)
+{
+	static IsoPkt isoPkt;
+	static unsigned char arena[sizeof(IsoPkt)];
+	static char expected[65][1000];
+	unsigned char pkt[12000], repacked[12000], *copy;
+	char value[1000];
+	int present[65];
+	unsigned int state = seed ? seed : 1;
+	IsoBuilder b;
+	IsoMsg msg;
+	int i, field, len, pad, pktLen, cut, failures = 0, rejected = 0;
+
+	failures = fuzzKernels(iterations, &state);
+
+	for ( i = 0; i < iterations; i++ )
+	{
+		isoBuilderInit(&b, fuzzRand(&state) % 10000, arena, sizeof(arena));
+
+		for ( field = 2; field <= 64; field++ )
+		{
+			present[field] = fuzzRand(&state) % 3 == 0;
+			if ( !present[field] )
+				continue;
+
+			len = fuzzValue(field, &state, value);
+			if ( isoSetStr(&b, field, value, len) != ISO_OK )
+			{
+				printf("\nseed %u, message %d: isoSetStr(D%d) rejected a valid value", seed, i, field);
+				return 1;
+			}
+
+			pad = isoSpec[field].lenType == ISO_LEN_FIXED ? isoSpec[field].maxLen - len : 0;
+			memset(expected[field], '0', pad);
+			memcpy(expected[field] + pad, value, len + 1);
+		}
+
+		pktLen = isoPack(&b, pkt, sizeof(pkt));
+		if ( pktLen != isoPackedLen(&b) )
+		{
+			printf("\nmessage %d: isoPack() wrote %d bytes, isoPackedLen() said %d", i, pktLen, isoPackedLen(&b));
+			failures++;
+			continue;
+		}
+
+		memset(&isoPkt, 0, sizeof(isoPkt));
+		if ( unpack(pkt, pktLen, &isoPkt) != ISO_OK || isoUnpack(pkt, pktLen, &msg) != ISO_OK ||
+				isoGetMTI(&msg) != b.mti )
+		{
+			printf("\nmessage %d: does not unpack", i);
+			failures++;
+			continue;
+		}
+
+		for ( field = 2; field <= 64; field++ )
+		{
+			len = isoGetStr(&msg, field, value, sizeof(value));
+			if ( (len >= 0) != present[field] ||
+					(present[field] && (memcmp(value, expected[field], len) != 0 ||
+					memcmp((char *)&isoPkt + isoPktField[field].offset, expected[field], len) != 0)) )
+			{
+				printf("\nmessage %d: D%d differs", i, field);
+				failures++;
+			}
+		}
+
+		if ( pack(&isoPkt, repacked) != pktLen || memcmp(pkt, repacked, pktLen) != 0 )
+		{
+			printf("\nmessage %d: pack() of the unpacked IsoPkt differs", i);
+			failures++;
+		}
+
+		// Damaged copies, allocated to size so that a read past the end is caught
+		cut = fuzzRand(&state) % pktLen;
+		copy = malloc(pktLen);
+		memcpy(copy, pkt, pktLen);
+		rejected += isoUnpack(copy, cut, &msg) != ISO_OK;
+		copy[fuzzRand(&state) % pktLen] ^= 1 + fuzzRand(&state) % 255;
+		if ( isoUnpack(copy, pktLen, &msg) == ISO_OK )
+		{
+			for ( field = 2; field <= ISO_MAX_FIELDS; field++ )
+				isoGetStr(&msg, field, value, sizeof(value));
+		}
+		free(copy);
+	}
+
+	printf("\n%d messages, %d mismatches, %d truncated copies rejected\n", iterations, failures, rejected);
+	return failures != 0;
 }
 
 
 /*********************************************** Test Function for Iso8583 Parser *************************
  *
+ * Build with -DISO8583_NO_MAIN to link the parser into another program.
  */
 
-int main()
+#ifndef ISO8583_NO_MAIN
+int main(int argc, char *argv[])
 {
-	parserTest();
-	return 0;
+	if ( argc > 1 && strcmp(argv[1], "bench") == 0 )
+		return parserBench(argc > 2 ? atoi(argv[2]) : 1000000);
+	if ( argc > 1 && strcmp(argv[1], "fuzz") == 0 )
+		return parserFuzz(argc > 2 ? atoi(argv[2]) : 100000, argc > 3 ? strtoul(argv[3], NULL, 0) : 1);
+
+	return parserTest();
 }
+#endif
 
 /*
 *
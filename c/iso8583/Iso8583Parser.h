@@ -1,4 +1,9 @@
+#ifndef ISO8583_PARSER_H
+#define ISO8583_PARSER_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef struct packetField
 {
@@ -141,12 +146,107 @@ typedef struct packetField
 #define LEN_D53 8
 #define LEN_D64 2
 
+
+/************************************ Table-driven unpacking ************************************/
+
+#define ISO_MAX_FIELDS 128
+
+#define ISO_OK          0
+#define ISO_ERR_SHORT  -1   // packet ends inside a field
+#define ISO_ERR_LENGTH -2   // length prefix not BCD or above the field's maximum
+#define ISO_ERR_FIELD  -3   // bitmap announces a field without a spec
+#define ISO_ERR_DIGIT  -4   // character that has no BCD nibble in a numeric field
+#define ISO_ERR_SPACE  -5   // arena or output buffer too small
+
+enum { ISO_FMT_BCD, ISO_FMT_ASCII, ISO_FMT_BINARY };
+enum { ISO_LEN_FIXED, ISO_LEN_LL, ISO_LEN_LLL };
+
+typedef struct isoFieldSpec
+{
+	unsigned char format;     // ISO_FMT_*
+	unsigned char lenType;    // ISO_LEN_*
+	unsigned short maxLen;    // digits for BCD, bytes otherwise; the exact length of fixed fields
+}IsoFieldSpec;
+
+typedef struct isoFieldView
+{
+	unsigned short offset;    // into the packet, 0: field absent
+	unsigned short len;       // digits for BCD, bytes otherwise
+}IsoFieldView;
+
+// Where every field of one packet is; the packet must outlive it.
+typedef struct isoMsg
+{
+	const unsigned char *pkt;
+	int pktLen;
+	unsigned short length;    // from the 2 byte length prefix
+	unsigned short mtiOffset;
+	unsigned char bitmap[16];
+	IsoFieldView field[ISO_MAX_FIELDS + 1];   // [1]: the bitmap itself
+}IsoMsg;
+
+short isoUnpack(const unsigned char *pkt, int pktLen, IsoMsg *msg);
+int isoHas(const IsoMsg *msg, int field);
+int isoGetMTI(const IsoMsg *msg);
+// NUL terminated digits (BCD fields) or bytes; returns the length, -1 if absent or outSize is too small
+int isoGetStr(const IsoMsg *msg, int field, char *out, int outSize);
+// Value of a BCD field of up to 19 digits; 0 on success
+int isoGetNum(const IsoMsg *msg, int field, unsigned long long *value);
+// The field's bytes inside the packet, without length prefix
+const unsigned char *isoGetRaw(const IsoMsg *msg, int field, int *bytes);
+
+/************************************ Arena-backed builder **************************************/
+
+typedef struct isoBuilder
+{
+	unsigned char *arena;
+	int arenaSize;
+	int used;                 // arena bytes
+	int wireLen;              // what isoPack() writes, kept current by every isoSet*()
+	unsigned short mti;
+	unsigned short secondary; // fields above 64 that are set
+	unsigned char bitmap[16];
+	IsoFieldView field[ISO_MAX_FIELDS + 1];   // wire bytes (length prefix included) in the arena
+}IsoBuilder;
+
+void isoBuilderInit(IsoBuilder *b, int mti, unsigned char *arena, int arenaSize);
+int isoSetStr(IsoBuilder *b, int field, const char *value, int len);
+int isoSetNum(IsoBuilder *b, int field, unsigned long long value);
+void isoClear(IsoBuilder *b, int field);
+int isoPackedLen(const IsoBuilder *b);
+// Returns the bytes written, ISO_ERR_SPACE when pktSize < isoPackedLen()
+int isoPack(const IsoBuilder *b, unsigned char *pkt, int pktSize);
+
+/************************************ BCD <-> ASCII kernels *************************************/
+
+#define ISO_SIMD_BEST   -1
+#define ISO_SIMD_SCALAR  0
+#define ISO_SIMD_SSSE3   1
+#define ISO_SIMD_AVX2    2
+
+// len characters right-aligned into (len + 1) / 2 bytes, a 0 nibble in front when len is odd. '0'..'9'
+// only, plus '=' (nibble D, the track 2 separator) when sep is set, else ISO_ERR_DIGIT with bcd partly
+// written.
+int bcdPack(unsigned char *bcd, const char *digits, int len, int sep);
+// The last `digits` nibbles of (digits + 1) / 2 bytes as '0' + nibble, not NUL-terminated.
+void bcdUnpack(char *out, const unsigned char *bcd, int digits);
+// Makes bcdPack()/bcdUnpack() use the given ISO_SIMD_* kernel, or the best the CPU has when it has not
+// that one. Returns the level in use. Not needed for normal use: the best is picked at load time. Not
+// thread-safe: call it before starting any thread that packs or unpacks.
+int bcdKernel(int level);
+
 int pack(IsoPkt *isoPkt, unsigned char *pkt);
 short unpack(unsigned char *pkt, int pktLen, IsoPkt *isoPkt);
 int parserTest(void);
+int parserBench(int iterations);
+int parserFuzz(int iterations, unsigned int seed);
 
-static int File_Log(const char* format, ...);
 void strn2BCD(unsigned char *bcd, unsigned char *data, int datalen, int BCDlen);
 void BCDn2str(char *data, char *bcd, int BCDlen, int datalen,int numdigits);
 void printHexDump(const char *title, const unsigned char *str, int len);
 
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,334 @@
+// IsoDialect.hpp
+//
+// ISO8583 dialects as constexpr field-spec tables, decoded by Codec<Dialect>.
+//
+// isoUnpack() reads isoSpec[] on every field it meets. Codec<D>::unpack() expands into one block per
+// data element with D's format, length prefix and maximum folded in as constants, so no table is read
+// while decoding; absent fields cost a bit test. Every dialect gets its own code: any number of them
+// can be used side by side in one program (a gateway talking BCD to terminals and ASCII to a host).
+//
+// A dialect is a type with two constexpr members:
+//   coding   how the message length, the MTI and the LL/LLL prefixes travel (iso::Coding)
+//   fields   the spec of data elements 2..128 (iso::SpecTable), maxLen 0: not defined
+// Field views are the ones of isoUnpack() (IsoMsg, offsets into the packet), read them with the
+// Codec's getStr()/getNum(), which know the dialect's formats.
+//
+//   gcc -c -O2 -DISO8583_NO_MAIN Iso8583Parser.c
+//   g++ -std=c++17 -O2 dialect_bench.cpp Iso8583Parser.o -o dialect_bench
+#pragma once
+
+#include "Iso8583Parser.h"
+
+#include <array>
+#include <utility>
+#include <cstring>
+
+namespace iso
+{
+
+using SpecTable = std::array<IsoFieldSpec, ISO_MAX_FIELDS + 1>;
+
+enum class Coding
+{
+	Bcd,      // length: 2 bytes BCD (counting itself), MTI: 2 bytes BCD, LL: 1 BCD byte, LLL: 2 BCD bytes
+	Ascii,    // length: 4 digits (counting itself), MTI: 4 digits, LL: 2 digits, LLL: 3 digits
+};
+
+// Spec constructors, the names of the ones in Iso8583Parser.c
+constexpr IsoFieldSpec bcd(unsigned short n)    { return { ISO_FMT_BCD,    ISO_LEN_FIXED, n }; }
+constexpr IsoFieldSpec asc(unsigned short n)    { return { ISO_FMT_ASCII,  ISO_LEN_FIXED, n }; }
+constexpr IsoFieldSpec bin(unsigned short n)    { return { ISO_FMT_BINARY, ISO_LEN_FIXED, n }; }
+constexpr IsoFieldSpec llBcd(unsigned short n)  { return { ISO_FMT_BCD,    ISO_LEN_LL,    n }; }
+constexpr IsoFieldSpec llAsc(unsigned short n)  { return { ISO_FMT_ASCII,  ISO_LEN_LL,    n }; }
+constexpr IsoFieldSpec lllAsc(unsigned short n) { return { ISO_FMT_ASCII,  ISO_LEN_LLL,   n }; }
+constexpr IsoFieldSpec lllBin(unsigned short n) { return { ISO_FMT_BINARY, ISO_LEN_LLL,   n }; }
+
+// Table edits for deriving one dialect from another
+constexpr SpecTable with(SpecTable t, int field, IsoFieldSpec spec)
+{
+	t[field] = spec;
+	return t;
+}
+
+// Numeric fields travel as digits instead of packed BCD
+constexpr SpecTable bcdAsAscii(SpecTable t)
+{
+	for ( auto &spec : t )
+		if ( spec.format == ISO_FMT_BCD )
+			spec.format = ISO_FMT_ASCII;
+	return t;
+}
+
+// Every maximum fits its length prefix, fixed fields have a length
+constexpr bool validSpecs(const SpecTable &t)
+{
+	for ( int field = 2; field <= ISO_MAX_FIELDS; field++ )
+	{
+		const IsoFieldSpec &spec = t[field];
+		if ( spec.format > ISO_FMT_BINARY || spec.lenType > ISO_LEN_LLL )
+			return false;
+		if ( spec.lenType == ISO_LEN_LL && spec.maxLen > 99 )
+			return false;
+		if ( spec.lenType == ISO_LEN_LLL && spec.maxLen > 999 )
+			return false;
+	}
+	return t[0].maxLen == 0 && t[1].maxLen == 0;
+}
+
+/************************************ Dialects ************************************/
+
+// The wire format of pack() / isoUnpack(): isoSpec[] of Iso8583Parser.c
+struct Iso87Bcd
+{
+	static constexpr Coding coding = Coding::Bcd;
+	static constexpr SpecTable fields = []
+	{
+		SpecTable t{};
+		t[2]  = llBcd(19);       t[3]  = bcd(6);          t[4]  = bcd(12);         t[5]  = bcd(12);
+		t[6]  = bcd(12);         t[7]  = bcd(10);         t[8]  = bcd(8);          t[9]  = bcd(8);
+		t[10] = bcd(8);          t[11] = bcd(6);          t[12] = bcd(6);          t[13] = bcd(4);
+		t[14] = bcd(4);          t[15] = bcd(4);          t[16] = bcd(4);          t[17] = bcd(4);
+		t[18] = bcd(4);          t[19] = bcd(3);          t[20] = bcd(3);          t[21] = bcd(3);
+		t[22] = bcd(3);          t[23] = bcd(3);          t[24] = bcd(3);          t[25] = bcd(2);
+		t[26] = bcd(2);          t[27] = bcd(1);          t[28] = bcd(8);          t[29] = bcd(8);
+		t[30] = bcd(8);          t[31] = bcd(8);          t[32] = llBcd(11);       t[33] = llBcd(11);
+		t[34] = llAsc(28);       t[35] = llBcd(37);       t[36] = llBcd(99);       t[37] = asc(LEN_D37);
+		t[38] = asc(LEN_D38);    t[39] = asc(LEN_D39);    t[40] = asc(LEN_D40);    t[41] = asc(LEN_D41);
+		t[42] = asc(LEN_D42);    t[43] = asc(LEN_D43);    t[44] = llAsc(25);       t[45] = llAsc(76);
+		t[46] = lllAsc(999);     t[47] = lllAsc(999);     t[48] = lllAsc(999);     t[49] = asc(LEN_D49);
+		t[50] = asc(LEN_D50);    t[51] = asc(LEN_D51);    t[52] = bin(LEN_D52);    t[53] = bcd(LEN_D53*2);
+		t[54] = llAsc(99);       t[64] = bin(LEN_D64);
+		for ( int field = 55; field <= 63; field++ )
+			t[field] = lllAsc(999);
+		return t;
+	}();
+};
+
+// Host links that keep everything printable: ASCII lengths, MTI and numbers, binary bitmap.
+// Track 3 and the additional amounts get their full ISO sizes, EMV data (55) is binary TLV.
+struct Iso87Ascii
+{
+	static constexpr Coding coding = Coding::Ascii;
+	static constexpr SpecTable fields =
+		with(with(with(bcdAsAscii(Iso87Bcd::fields),
+			36, lllAsc(104)),
+			54, lllAsc(120)),
+			55, lllBin(999));
+};
+
+/************************************ Codec ************************************/
+
+template <class D>
+class Codec
+{
+	static_assert(validSpecs(D::fields), "dialect field spec does not fit its length prefix");
+
+	public:
+		static constexpr int lengthBytes = D::coding == Coding::Bcd ? 2 : 4;
+		static constexpr int mtiBytes = D::coding == Coding::Bcd ? 2 : 4;
+
+		// Same contract as isoUnpack(): ISO_OK, or the ISO_ERR_* of the first field that does not decode
+		static short unpack(const unsigned char *pkt, int pktLen, IsoMsg *msg)
+		{
+			int offset, len;
+			short ret = ISO_OK;
+
+			msg->pkt = pkt;
+			msg->pktLen = pktLen;
+			memset(msg->field, 0, sizeof(msg->field));
+
+			if ( pktLen < lengthBytes + mtiBytes + 8 )
+				return ISO_ERR_SHORT;
+
+			len = number<lengthBytes>(pkt);
+			if ( len < 0 )
+				return ISO_ERR_LENGTH;
+			msg->length = len;
+			msg->mtiOffset = lengthBytes;
+			offset = lengthBytes + mtiBytes;
+
+			memcpy(msg->bitmap, pkt + offset, 8);
+			msg->field[1].offset = offset;
+			msg->field[1].len = 8;
+			if ( msg->bitmap[0] & 0x80 )
+			{
+				if ( pktLen < offset + 16 )
+					return ISO_ERR_SHORT;
+				memcpy(msg->bitmap + 8, pkt + offset + 8, 8);
+				msg->field[1].len = 16;
+			}
+			offset += msg->field[1].len;
+
+			// Data elements in wire order; a fold stops at the first failure
+			auto run = [&](auto first, auto seq)
+			{
+				return fields<decltype(first)::value>(pkt, pktLen, msg, offset, ret, seq);
+			};
+			if ( !run(std::integral_constant<int, 2>{}, std::make_index_sequence<63>{}) )
+				return ret;
+			if ( msg->field[1].len == 16 && !run(std::integral_constant<int, 65>{}, std::make_index_sequence<64>{}) )
+				return ret;
+
+			return ISO_OK;
+		}
+
+		static int getMTI(const IsoMsg *msg)
+		{
+			return number<mtiBytes>(msg->pkt + msg->mtiOffset);
+		}
+
+		// NUL terminated digits or bytes; the length, -1 if absent or outSize is too small
+		template <int F>
+		static int getStr(const IsoMsg *msg, char *out, int outSize)
+		{
+			return str(msg, F, F > 1 && D::fields[F].format == ISO_FMT_BCD, out, outSize);
+		}
+
+		static int getStr(const IsoMsg *msg, int field, char *out, int outSize)
+		{
+			if ( field < 1 || field > ISO_MAX_FIELDS )
+				return -1;
+			return str(msg, field, field > 1 && D::fields[field].format == ISO_FMT_BCD, out, outSize);
+		}
+
+		// Numeric field of up to 19 digits, packed BCD or ASCII digits; 0 on success
+		template <int F>
+		static int getNum(const IsoMsg *msg, unsigned long long *value)
+		{
+			static_assert(F > 1 && D::fields[F].format != ISO_FMT_BINARY, "not a numeric field");
+			return num(msg, F, D::fields[F].format == ISO_FMT_BCD, value);
+		}
+
+		static int getNum(const IsoMsg *msg, int field, unsigned long long *value)
+		{
+			if ( field < 2 || field > ISO_MAX_FIELDS || D::fields[field].format == ISO_FMT_BINARY )
+				return -1;
+			return num(msg, field, D::fields[field].format == ISO_FMT_BCD, value);
+		}
+
+	private:
+		// BCD: bytes * 2 digits, ASCII: bytes digits; -1 if one of them is not a digit
+		template <int Bytes>
+		static inline int number(const unsigned char *p)
+		{
+			int v = 0;
+			for ( int i = 0; i < Bytes; i++ )
+			{
+				if constexpr ( D::coding == Coding::Bcd )
+				{
+					if ( (p[i] >> 4) > 9 || (p[i] & 0x0F) > 9 )
+						return -1;
+					v = v * 100 + (p[i] >> 4) * 10 + (p[i] & 0x0F);
+				}
+				else
+				{
+					if ( (unsigned char)(p[i] - '0') > 9 )
+						return -1;
+					v = v * 10 + (p[i] - '0');
+				}
+			}
+			return v;
+		}
+
+		template <int First, size_t... I>
+		static inline bool fields(const unsigned char *pkt, int pktLen, IsoMsg *msg, int &offset, short &ret,
+				std::index_sequence<I...>)
+		{
+			return ( ... && ((ret = field<First + (int)I>(pkt, pktLen, msg, offset)) == ISO_OK) );
+		}
+
+		template <int F>
+		static inline short field(const unsigned char *pkt, int pktLen, IsoMsg *msg, int &offset)
+		{
+			constexpr IsoFieldSpec spec = D::fields[F];
+			int len, bytes;
+
+			if ( !(msg->bitmap[(F - 1) / 8] & (0x80 >> ((F - 1) % 8))) )
+				return ISO_OK;
+
+			if constexpr ( spec.maxLen == 0 )
+				return ISO_ERR_FIELD;
+			else
+			{
+				if constexpr ( spec.lenType == ISO_LEN_FIXED )
+					len = spec.maxLen;
+				else
+				{
+					constexpr int digits = spec.lenType == ISO_LEN_LL ? 2 : 3;
+					constexpr int prefix = D::coding == Coding::Ascii ? digits : (digits + 1) / 2;
+
+					if ( offset + prefix > pktLen )
+						return ISO_ERR_SHORT;
+					len = number<prefix>(pkt + offset);
+					if ( len < 0 || len > spec.maxLen )
+						return ISO_ERR_LENGTH;
+					offset += prefix;
+				}
+
+				bytes = spec.format == ISO_FMT_BCD ? (len + 1) / 2 : len;
+				if ( offset + bytes > pktLen )
+					return ISO_ERR_SHORT;
+
+				msg->field[F].offset = offset;
+				msg->field[F].len = len;
+				offset += bytes;
+				return ISO_OK;
+			}
+		}
+
+		static int str(const IsoMsg *msg, int field, bool packed, char *out, int outSize)
+		{
+			int len;
+			const unsigned char *src;
+
+			if ( !isoHas(msg, field) )
+				return -1;
+
+			len = msg->field[field].len;
+			if ( len + 1 > outSize )
+				return -1;
+
+			src = msg->pkt + msg->field[field].offset;
+			if ( packed )
+				bcdUnpack(out, src, len);
+			else
+				memcpy(out, src, len);
+			out[len] = '\0';
+
+			return len;
+		}
+
+		static int num(const IsoMsg *msg, int field, bool packed, unsigned long long *value)
+		{
+			int i, digits, d;
+			const unsigned char *src;
+			unsigned long long v = 0;
+
+			if ( !isoHas(msg, field) )
+				return -1;
+
+			digits = msg->field[field].len;
+			if ( digits > 19 )
+				return -1;
+
+			src = msg->pkt + msg->field[field].offset;
+			for ( i = 0; i < digits; i++ )
+			{
+				if ( packed )
+				{
+					int nibble = i + (digits & 1);
+					d = ( nibble & 1 ) ? (src[nibble / 2] & 0x0F) : (src[nibble / 2] >> 4);
+				}
+				else
+					d = src[i] - '0';
+				if ( d < 0 || d > 9 )
+					return -1;
+				v = v * 10 + d;
+			}
+
+			*value = v;
+			return 0;
+		}
+};
+
+}
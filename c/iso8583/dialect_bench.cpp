@@ -0,0 +1,332 @@
+// dialect_bench.cpp
+//
+//   gcc -c -O2 -DISO8583_NO_MAIN Iso8583Parser.c
+//   g++ -std=c++17 -O2 dialect_bench.cpp Iso8583Parser.o -o dialect_bench
+//   ./dialect_bench [messages] [fuzz cases]
+//
+// Decodes one 0200 with 26 data elements [messages] times with
+//   isoUnpack()             the isoSpec[] loop of Iso8583Parser.c
+//   hand-written            one block per data element with its format and sizes typed in
+//   Codec<Iso87Bcd>         the same wire format from a constexpr dialect
+//   Codec<Iso87Ascii>       the same message re-encoded in the ASCII dialect
+// and first checks that the three BCD decoders agree, views and return codes, on [fuzz cases] copies of
+// the message with random bytes changed and random truncations, and that both dialects read the same
+// values.
+
+#include "IsoDialect.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using iso::Codec;
+using iso::Iso87Ascii;
+using iso::Iso87Bcd;
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/************************************ Hand-written decoder ************************************
+ *
+ * What a decoder written field by field for this one wire format looks like: the blocks are stamped
+ * out from the list below so that they cannot drift from isoSpec[], every format and size in them is a
+ * literal.
+ *
+ *********************************************************************************************/
+
+#define HAND_FIELDS(X) \
+	X(2, ISO_FMT_BCD, ISO_LEN_LL, 19)             X(3, ISO_FMT_BCD, ISO_LEN_FIXED, 6) \
+	X(4, ISO_FMT_BCD, ISO_LEN_FIXED, 12)          X(5, ISO_FMT_BCD, ISO_LEN_FIXED, 12) \
+	X(6, ISO_FMT_BCD, ISO_LEN_FIXED, 12)          X(7, ISO_FMT_BCD, ISO_LEN_FIXED, 10) \
+	X(8, ISO_FMT_BCD, ISO_LEN_FIXED, 8)           X(9, ISO_FMT_BCD, ISO_LEN_FIXED, 8) \
+	X(10, ISO_FMT_BCD, ISO_LEN_FIXED, 8)          X(11, ISO_FMT_BCD, ISO_LEN_FIXED, 6) \
+	X(12, ISO_FMT_BCD, ISO_LEN_FIXED, 6)          X(13, ISO_FMT_BCD, ISO_LEN_FIXED, 4) \
+	X(14, ISO_FMT_BCD, ISO_LEN_FIXED, 4)          X(15, ISO_FMT_BCD, ISO_LEN_FIXED, 4) \
+	X(16, ISO_FMT_BCD, ISO_LEN_FIXED, 4)          X(17, ISO_FMT_BCD, ISO_LEN_FIXED, 4) \
+	X(18, ISO_FMT_BCD, ISO_LEN_FIXED, 4)          X(19, ISO_FMT_BCD, ISO_LEN_FIXED, 3) \
+	X(20, ISO_FMT_BCD, ISO_LEN_FIXED, 3)          X(21, ISO_FMT_BCD, ISO_LEN_FIXED, 3) \
+	X(22, ISO_FMT_BCD, ISO_LEN_FIXED, 3)          X(23, ISO_FMT_BCD, ISO_LEN_FIXED, 3) \
+	X(24, ISO_FMT_BCD, ISO_LEN_FIXED, 3)          X(25, ISO_FMT_BCD, ISO_LEN_FIXED, 2) \
+	X(26, ISO_FMT_BCD, ISO_LEN_FIXED, 2)          X(27, ISO_FMT_BCD, ISO_LEN_FIXED, 1) \
+	X(28, ISO_FMT_BCD, ISO_LEN_FIXED, 8)          X(29, ISO_FMT_BCD, ISO_LEN_FIXED, 8) \
+	X(30, ISO_FMT_BCD, ISO_LEN_FIXED, 8)          X(31, ISO_FMT_BCD, ISO_LEN_FIXED, 8) \
+	X(32, ISO_FMT_BCD, ISO_LEN_LL, 11)            X(33, ISO_FMT_BCD, ISO_LEN_LL, 11) \
+	X(34, ISO_FMT_ASCII, ISO_LEN_LL, 28)          X(35, ISO_FMT_BCD, ISO_LEN_LL, 37) \
+	X(36, ISO_FMT_BCD, ISO_LEN_LL, 99)            X(37, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D37) \
+	X(38, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D38)  X(39, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D39) \
+	X(40, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D40)  X(41, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D41) \
+	X(42, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D42)  X(43, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D43) \
+	X(44, ISO_FMT_ASCII, ISO_LEN_LL, 25)          X(45, ISO_FMT_ASCII, ISO_LEN_LL, 76) \
+	X(46, ISO_FMT_ASCII, ISO_LEN_LLL, 999)        X(47, ISO_FMT_ASCII, ISO_LEN_LLL, 999) \
+	X(48, ISO_FMT_ASCII, ISO_LEN_LLL, 999)        X(49, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D49) \
+	X(50, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D50)  X(51, ISO_FMT_ASCII, ISO_LEN_FIXED, LEN_D51) \
+	X(52, ISO_FMT_BINARY, ISO_LEN_FIXED, LEN_D52) X(53, ISO_FMT_BCD, ISO_LEN_FIXED, LEN_D53*2) \
+	X(54, ISO_FMT_ASCII, ISO_LEN_LL, 99)          X(55, ISO_FMT_ASCII, ISO_LEN_LLL, 999) \
+	X(56, ISO_FMT_ASCII, ISO_LEN_LLL, 999)        X(57, ISO_FMT_ASCII, ISO_LEN_LLL, 999) \
+	X(58, ISO_FMT_ASCII, ISO_LEN_LLL, 999)        X(59, ISO_FMT_ASCII, ISO_LEN_LLL, 999) \
+	X(60, ISO_FMT_ASCII, ISO_LEN_LLL, 999)        X(61, ISO_FMT_ASCII, ISO_LEN_LLL, 999) \
+	X(62, ISO_FMT_ASCII, ISO_LEN_LLL, 999)        X(63, ISO_FMT_ASCII, ISO_LEN_LLL, 999) \
+	X(64, ISO_FMT_BINARY, ISO_LEN_FIXED, LEN_D64)
+
+static inline int handBcd(unsigned char b)
+{
+	return ( (b >> 4) > 9 || (b & 0x0F) > 9 ) ? -1 : (b >> 4) * 10 + (b & 0x0F);
+}
+
+#define HAND_FIELD(f, fmt, lenType, maxLen) \
+	if ( msg->bitmap[(f - 1) / 8] & (0x80 >> ((f - 1) % 8)) ) \
+	{ \
+		len = maxLen; \
+		if ( lenType == ISO_LEN_LL ) \
+		{ \
+			if ( offset + 1 > pktLen ) \
+				return ISO_ERR_SHORT; \
+			len = handBcd(pkt[offset]); \
+			if ( len < 0 || len > maxLen ) \
+				return ISO_ERR_LENGTH; \
+			offset += 1; \
+		} \
+		else if ( lenType == ISO_LEN_LLL ) \
+		{ \
+			if ( offset + 2 > pktLen ) \
+				return ISO_ERR_SHORT; \
+			hi = handBcd(pkt[offset]); \
+			lo = handBcd(pkt[offset + 1]); \
+			if ( hi < 0 || lo < 0 || (len = hi * 100 + lo) > maxLen ) \
+				return ISO_ERR_LENGTH; \
+			offset += 2; \
+		} \
+		bytes = fmt == ISO_FMT_BCD ? (len + 1) / 2 : len; \
+		if ( offset + bytes > pktLen ) \
+			return ISO_ERR_SHORT; \
+		msg->field[f].offset = offset; \
+		msg->field[f].len = len; \
+		offset += bytes; \
+	}
+
+static short handUnpack(const unsigned char *pkt, int pktLen, IsoMsg *msg)
+{
+	int offset, len, bytes, hi, lo;
+
+	msg->pkt = pkt;
+	msg->pktLen = pktLen;
+	memset(msg->field, 0, sizeof(msg->field));
+
+	if ( pktLen < 2 + 2 + 8 )
+		return ISO_ERR_SHORT;
+	hi = handBcd(pkt[0]);
+	lo = handBcd(pkt[1]);
+	if ( hi < 0 || lo < 0 )
+		return ISO_ERR_LENGTH;
+	msg->length = hi * 100 + lo;
+	msg->mtiOffset = 2;
+	offset = 4;
+
+	memcpy(msg->bitmap, pkt + offset, 8);
+	msg->field[1].offset = offset;
+	msg->field[1].len = 8;
+	if ( msg->bitmap[0] & 0x80 )
+	{
+		if ( pktLen < offset + 16 )
+			return ISO_ERR_SHORT;
+		memcpy(msg->bitmap + 8, pkt + offset + 8, 8);
+		msg->field[1].len = 16;
+	}
+	offset += msg->field[1].len;
+
+	HAND_FIELDS(HAND_FIELD)
+
+	// No data element above 64 is defined
+	if ( msg->field[1].len == 16 )
+		for ( int i = 8; i < 16; i++ )
+			if ( msg->bitmap[i] )
+				return ISO_ERR_FIELD;
+
+	return ISO_OK;
+}
+
+#undef HAND_FIELD
+
+/************************************ Test messages ************************************/
+
+static int buildBcd(unsigned char *pkt, int size)
+{
+	static const struct { int field; const char *value; } sale[] =
+	{
+		{ 2, "4761739001010119" }, { 3, "000000" }, { 4, "000000012550" }, { 7, "1019143015" },
+		{ 11, "004711" }, { 12, "143015" }, { 13, "1019" }, { 14, "2812" }, { 18, "5411" },
+		{ 22, "051" }, { 25, "00" }, { 32, "12345678" }, { 35, "4761739001010119=28122011143804489" },
+		{ 37, "629214004711" }, { 38, "A1B2C3" }, { 39, "00" }, { 41, "TERM0001" },
+		{ 42, "MERCHANT0000001" }, { 43, "CORNER SHOP              SPRINGFIELD  US" },
+		{ 48, "P0112345678901234567890" }, { 49, "840" }, { 52, "\x12\x34\x56\x78\x9A\xBC\xDE\xF0" },
+		{ 53, "2001010100000000" }, { 54, "0002840C000000001000" },
+		{ 55, "9F2608C2C12B098F3DA6E39F2701809F10120110A0000F040000000000000000000000FF" },
+		{ 64, "\x5A\xC3" },
+	};
+	unsigned char arena[2048];
+	IsoBuilder b;
+
+	isoBuilderInit(&b, 200, arena, sizeof(arena));
+	for ( const auto &f : sale )
+	{
+		int ret = isoSetStr(&b, f.field, f.value, f.field == 52 ? LEN_D52 : f.field == 64 ? LEN_D64 : -1);
+		if ( ret != ISO_OK )
+		{
+			printf("D%d: isoSetStr() %d\n", f.field, ret);
+			return -1;
+		}
+	}
+	return isoPack(&b, pkt, size);
+}
+
+// The decoded message in the ASCII dialect
+static int buildAscii(const IsoMsg *src, unsigned char *pkt)
+{
+	char value[1000];
+	int offset = 4, len;
+
+	memcpy(pkt + offset, "0200", 4);
+	offset += 4;
+	memcpy(pkt + offset, src->bitmap, 8);
+	offset += 8;
+
+	for ( int field = 2; field <= 64; field++ )
+	{
+		if ( (len = Codec<Iso87Bcd>::getStr(src, field, value, sizeof(value))) < 0 )
+			continue;
+		const IsoFieldSpec &spec = Iso87Ascii::fields[field];
+		if ( spec.lenType != ISO_LEN_FIXED )
+			offset += sprintf((char *)pkt + offset, spec.lenType == ISO_LEN_LL ? "%02d" : "%03d", len);
+		memcpy(pkt + offset, value, len);
+		offset += len;
+	}
+
+	char header[5];
+	snprintf(header, sizeof(header), "%04d", offset);
+	memcpy(pkt, header, 4);
+	return offset;
+}
+
+/************************************ Checks ************************************/
+
+static bool sameViews(const IsoMsg *a, const IsoMsg *b)
+{
+	return memcmp(a->field, b->field, sizeof(a->field)) == 0;
+}
+
+static int fuzz(const unsigned char *base, int baseLen, int cases, unsigned int seed)
+{
+	unsigned char pkt[2048];
+	IsoMsg ref, hand, codec;
+	int failures = 0;
+
+	srand(seed);
+	for ( int i = 0; i < cases; i++ )
+	{
+		memcpy(pkt, base, baseLen);
+		int len = ( i % 4 == 0 ) ? rand() % (baseLen + 1) : baseLen;
+		for ( int n = rand() % 4; n > 0; n-- )
+			pkt[rand() % baseLen] = (unsigned char)rand();
+
+		short r = isoUnpack(pkt, len, &ref);
+		short h = handUnpack(pkt, len, &hand);
+		short c = Codec<Iso87Bcd>::unpack(pkt, len, &codec);
+		if ( r != h || r != c || (r == ISO_OK && (!sameViews(&ref, &hand) || !sameViews(&ref, &codec))) )
+		{
+			if ( failures++ < 5 )
+				printf("  case %d: isoUnpack %d, hand-written %d, Codec<Iso87Bcd> %d\n", i, r, h, c);
+		}
+	}
+	return failures;
+}
+
+static int sameValues(const IsoMsg *bcd, const IsoMsg *ascii)
+{
+	char a[1000], b[1000];
+	int failures = 0;
+
+	if ( Codec<Iso87Bcd>::getMTI(bcd) != Codec<Iso87Ascii>::getMTI(ascii) )
+		failures++;
+	for ( int field = 2; field <= ISO_MAX_FIELDS; field++ )
+	{
+		int la = Codec<Iso87Bcd>::getStr(bcd, field, a, sizeof(a));
+		int lb = Codec<Iso87Ascii>::getStr(ascii, field, b, sizeof(b));
+		if ( la != lb || (la >= 0 && memcmp(a, b, la) != 0) )
+		{
+			printf("  D%d differs between the dialects\n", field);
+			failures++;
+		}
+	}
+
+	unsigned long long x, y;
+	if ( Codec<Iso87Bcd>::getNum<4>(bcd, &x) != 0 || Codec<Iso87Ascii>::getNum<4>(ascii, &y) != 0 || x != y
+			|| x != 12550 )
+		failures++;
+	return failures;
+}
+
+/************************************ Timing ************************************/
+
+template <class F>
+static double timeDecode(const char *label, const unsigned char *pkt, int len, long n, F decode, double base)
+{
+	IsoMsg msg;
+	unsigned long sum = 0;
+	double start = now();
+
+	for ( long i = 0; i < n; i++ )
+	{
+		asm volatile("" : : "r"(pkt) : "memory");   // nothing is hoisted out of the loop
+		decode(pkt, len, &msg);
+		sum += msg.field[64].offset;
+	}
+
+	double ns = (now() - start) * 1e9 / n;
+	printf("  %-20s %7.1f ns/msg  %6.2f M msg/s", label, ns, 1e3 / ns);
+	if ( base > 0 )
+		printf("  %+5.1f%%", (ns / base - 1) * 100);
+	printf("%s\n", sum ? "" : "  (D64 missing)");
+	return ns;
+}
+
+int main(int argc, char **argv)
+{
+	long n = argc > 1 ? atol(argv[1]) : 5000000;
+	int cases = argc > 2 ? atoi(argv[2]) : 1000000;
+	unsigned char bcdPkt[2048], asciiPkt[2048];
+	IsoMsg bcdMsg, asciiMsg;
+	int failures;
+
+	int bcdLen = buildBcd(bcdPkt, sizeof(bcdPkt));
+	if ( bcdLen < 0 || Codec<Iso87Bcd>::unpack(bcdPkt, bcdLen, &bcdMsg) != ISO_OK )
+	{
+		printf("test message does not build\n");
+		return 1;
+	}
+	int asciiLen = buildAscii(&bcdMsg, asciiPkt);
+	if ( Codec<Iso87Ascii>::unpack(asciiPkt, asciiLen, &asciiMsg) != ISO_OK )
+	{
+		printf("ASCII test message does not decode\n");
+		return 1;
+	}
+
+	printf("checks\n");
+	failures = fuzz(bcdPkt, bcdLen, cases, 1);
+	printf("  %d mutated / truncated BCD messages: %d disagreements\n", cases, failures);
+	int differ = sameValues(&bcdMsg, &asciiMsg);
+	printf("  Iso87Bcd vs Iso87Ascii field values: %d differences\n", differ);
+	failures += differ;
+
+	printf("decode, %d byte BCD / %d byte ASCII message, %ld times\n", bcdLen, asciiLen, n);
+	double base = timeDecode("isoUnpack", bcdPkt, bcdLen, n, isoUnpack, 0);
+	timeDecode("hand-written", bcdPkt, bcdLen, n, handUnpack, base);
+	timeDecode("Codec<Iso87Bcd>", bcdPkt, bcdLen, n, Codec<Iso87Bcd>::unpack, base);
+	timeDecode("Codec<Iso87Ascii>", asciiPkt, asciiLen, n, Codec<Iso87Ascii>::unpack, base);
+
+	return failures != 0;
+}
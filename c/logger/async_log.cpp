@@ -0,0 +1,791 @@
+/*
+      Asynchronous logger, see async_log.h
+
+      g++ -c async_log.cpp -o async_log.o
+*/
+
+/****************************************************************************
+ *
+ * Producer (any thread)                          Consumer (one background thread)
+ * ---------------------                          --------------------------------
+ * ring = this thread's LogRing                   for every ring
+ * size = header + packed args                        for every record tail..head
+ * reserve size bytes at ring->head                       format it into the batch buffer
+ * write header + args                                    iov += { timestamp prefix, message }
+ * store-release ring->head                       writev(log file, iov)   (+ stdout with LOG_ECHO_STDOUT)
+ *                                                store-release ring->tail of every drained ring
+ *
+ * LogRing is a single-producer/single-consumer byte ring: head and tail are byte positions that only
+ * grow; a record never wraps, a LOG_PAD marker skips the rest of the buffer instead.
+ * Rings live in a push-front list that the consumer walks without a lock. Rings are never freed:
+ * the pthread key destructor marks them retired and a new thread reuses a retired, drained ring.
+ *
+ * Record : | size | reserved | format pointer | timespec | arg slot | arg slot | ... |
+ * Slot   : 8 bytes per int/long/double/pointer, 16 per long double,
+ *          8 byte length + bytes (8 byte aligned) per string
+ *
+ * ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "async_log.h"
+
+#define LOG_RING_SIZE      (256 * 1024)   // per producer thread, power of two
+#define LOG_MAX_RECORD     (LOG_RING_SIZE / 4)
+#define LOG_MAX_STRING     8192           // longer %s arguments are truncated
+#define LOG_BATCH_SIZE     (256 * 1024)   // formatted bytes per writev
+#define LOG_MAX_IOV        1024           // <= IOV_MAX
+#define LOG_PAD            0x80000000u    // size flag: padding up to the end of the ring
+#define LOG_IDLE_MIN_US    50
+#define LOG_IDLE_MAX_US    10000
+#define LOG_FULL_WAIT_US   50             // producer back off while its ring is full (blocking policy)
+
+#define LOG_ALIGN8(n)      (((n) + 7) & ~(size_t)7)
+
+typedef struct LOG_RECORD
+{
+	uint32_t size;                        // whole record incl. header, multiple of 8 (| LOG_PAD)
+	uint32_t reserved;
+	const char *format;
+	struct timespec ts;
+}LogRecord;                               // packed argument slots follow
+
+typedef struct LOG_RING
+{
+	size_t head __attribute__((aligned(64)));  // producer: bytes ever written
+	size_t tail __attribute__((aligned(64)));  // consumer: bytes ever released
+	size_t drained;                            // consumer only: formatted, released after the writev
+	unsigned long dropped;                     // producer only
+	int retired;                               // owner thread exited
+	unsigned char *buf;
+	struct LOG_RING *next;
+}LogRing;
+
+typedef enum
+{
+	ARG_NONE,                             // %% or unknown conversion
+	ARG_INT,                              // d i u x X o c, with hh / h / none
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_SIZE,
+	ARG_INTMAX,
+	ARG_PTRDIFF,
+	ARG_DOUBLE,
+	ARG_LDOUBLE,
+	ARG_PTR,
+	ARG_STR,
+	ARG_WCHAR,                            // unsupported, consumed and printed as '?'
+	ARG_WSTR,                             // unsupported, consumed and printed as "(wide)"
+	ARG_COUNT                             // %n, consumed and ignored
+}ARG_TYPE;
+
+typedef struct
+{
+	const char *start;                    // '%'
+	const char *end;                      // one past the conversion character
+	int widthStar;
+	int precisionStar;
+	int precision;                        // literal precision, -1 if none
+	ARG_TYPE type;
+}LogSpec;
+
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;   // ring registration, init/shutdown
+static pthread_key_t   g_ringKey;
+static pthread_t       g_writer;
+static LogRing        *g_rings;
+static int             g_started;
+static int             g_stop;
+static int             g_shutdown;
+static int             g_flags;
+static char            g_prefix[64];
+
+// Consumer-only state
+static int             g_fd = -1;
+static int             g_fileDay = -1;                 // tm_year * 1000 + tm_yday of the open file
+static char            g_batch[LOG_BATCH_SIZE];
+static size_t          g_batchLen;
+static struct iovec    g_iov[LOG_MAX_IOV];
+static int             g_iovCnt;
+static time_t          g_prefixSec = -1;
+static char           *g_prefixPtr;
+static size_t          g_prefixLen;
+static char            g_strScratch[LOG_MAX_STRING + 1];
+
+
+/*****************************************    Format spec parsing (shared)     *************************************************/
+
+static const char *log_parse_spec(const char *p, LogSpec *spec)
+{
+	int len = 0;                          // 1 h/hh, 3 l, 4 ll, 5 z, 6 j, 7 t, 8 L
+
+	spec->start = p++;
+	spec->widthStar = spec->precisionStar = 0;
+	spec->precision = -1;
+
+	while ( *p && strchr("-+ #0'", *p) )
+		p++;
+
+	if ( *p == '*' ) { spec->widthStar = 1; p++; }
+	else while ( isdigit((unsigned char)*p) ) p++;
+
+	if ( *p == '.' )
+	{
+		p++;
+		if ( *p == '*' ) { spec->precisionStar = 1; p++; }
+		else
+		{
+			spec->precision = 0;
+			while ( isdigit((unsigned char)*p) )
+				spec->precision = spec->precision * 10 + (*p++ - '0');
+		}
+	}
+
+	switch ( *p )
+	{
+		case 'h': len = 1; p++; if ( *p == 'h' ) p++; break;
+		case 'l': len = 3; p++; if ( *p == 'l' ) { len = 4; p++; } break;
+		case 'q': len = 4; p++; break;
+		case 'z': len = 5; p++; break;
+		case 'j': len = 6; p++; break;
+		case 't': len = 7; p++; break;
+		case 'L': len = 8; p++; break;
+	}
+
+	switch ( *p )
+	{
+		case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+			spec->type = len == 3 ? ARG_LONG : len == 4 ? ARG_LLONG : len == 5 ? ARG_SIZE :
+				len == 6 ? ARG_INTMAX : len == 7 ? ARG_PTRDIFF : ARG_INT;
+			break;
+		case 'c': spec->type = len == 3 ? ARG_WCHAR : ARG_INT; break;
+		case 's': spec->type = len == 3 ? ARG_WSTR : ARG_STR; break;
+		case 'p': spec->type = ARG_PTR; break;
+		case 'n': spec->type = ARG_COUNT; break;
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			spec->type = len == 8 ? ARG_LDOUBLE : ARG_DOUBLE;
+			break;
+		case '\0':
+			spec->type = ARG_NONE;
+			spec->end = p;
+			return p;
+		default:
+			spec->type = ARG_NONE;
+			break;
+	}
+
+	spec->end = p + 1;
+	return p + 1;
+}
+
+
+/*****************************************    Producer     *************************************************/
+
+#define LOG_PUT(out, n, value) \
+	do { if ( out ) memcpy((out) + (n), &(value), sizeof(value)); (n) += 8; } while ( 0 )
+
+// Packs the arguments of format into out (or only measures them when out is NULL).
+static size_t log_args_walk(const char *format, va_list args, unsigned char *out)
+{
+	size_t n = 0;
+	const char *p = format;
+	LogSpec spec;
+
+	while ( (p = strchr(p, '%')) != NULL )
+	{
+		int precision;
+
+		p = log_parse_spec(p, &spec);
+		precision = spec.precision;
+
+		if ( spec.widthStar )
+		{
+			long long w = va_arg(args, int);
+			LOG_PUT(out, n, w);
+		}
+		if ( spec.precisionStar )
+		{
+			long long pr = va_arg(args, int);
+			precision = (int)pr;
+			LOG_PUT(out, n, pr);
+		}
+
+		switch ( spec.type )
+		{
+			case ARG_INT:     { long long v = va_arg(args, int);       LOG_PUT(out, n, v); break; }
+			case ARG_WCHAR:   { long long v = va_arg(args, unsigned);  LOG_PUT(out, n, v); break; }
+			case ARG_LONG:    { long long v = va_arg(args, long);      LOG_PUT(out, n, v); break; }
+			case ARG_LLONG:   { long long v = va_arg(args, long long); LOG_PUT(out, n, v); break; }
+			case ARG_SIZE:    { long long v = va_arg(args, size_t);    LOG_PUT(out, n, v); break; }
+			case ARG_INTMAX:  { long long v = va_arg(args, intmax_t);  LOG_PUT(out, n, v); break; }
+			case ARG_PTRDIFF: { long long v = va_arg(args, ptrdiff_t); LOG_PUT(out, n, v); break; }
+			case ARG_DOUBLE:  { double v = va_arg(args, double);       LOG_PUT(out, n, v); break; }
+			case ARG_PTR:
+			case ARG_WSTR:
+			case ARG_COUNT:   { void *v = va_arg(args, void *);        LOG_PUT(out, n, v); break; }
+
+			case ARG_LDOUBLE:
+			{
+				long double v = va_arg(args, long double);
+				if ( out )
+					memcpy(out + n, &v, sizeof(v));
+				n += LOG_ALIGN8(sizeof(v));
+				break;
+			}
+
+			case ARG_STR:
+			{
+				const char *s = va_arg(args, const char *);
+				uint64_t len;
+				size_t max = LOG_MAX_STRING;
+
+				if ( s == NULL )
+					s = "(null)";
+				if ( precision >= 0 && (size_t)precision < max )
+					max = precision;                   // printf would not read further either
+
+				len = strnlen(s, max);
+				LOG_PUT(out, n, len);
+				if ( out )
+					memcpy(out + n, s, len);
+				n += LOG_ALIGN8(len);
+				break;
+			}
+
+			case ARG_NONE:
+				break;
+		}
+	}
+
+	return n;
+}
+
+static void log_ring_retire(void *arg)
+{
+	__atomic_store_n(&((LogRing *)arg)->retired, 1, __ATOMIC_RELEASE);
+}
+
+static LogRing *log_thread_ring(void)
+{
+	LogRing *r = (LogRing *)pthread_getspecific(g_ringKey);
+
+	if ( r )
+		return r;
+
+	pthread_mutex_lock(&g_lock);
+
+	for ( r = g_rings; r; r = r->next )      // reuse a ring whose thread exited and which is drained
+	{
+		if ( __atomic_load_n(&r->retired, __ATOMIC_ACQUIRE) &&
+				__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == r->head )
+		{
+			r->retired = 0;
+			break;
+		}
+	}
+
+	if ( r == NULL )
+	{
+		r = (LogRing *)calloc(1, sizeof(LogRing));
+		if ( r )
+			r->buf = (unsigned char *)malloc(LOG_RING_SIZE);
+		if ( r == NULL || r->buf == NULL )
+		{
+			free(r);
+			pthread_mutex_unlock(&g_lock);
+			return NULL;
+		}
+		r->next = g_rings;
+		__atomic_store_n(&g_rings, r, __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&g_lock);
+
+	pthread_setspecific(g_ringKey, r);
+	return r;
+}
+
+// Contiguous space for size bytes, or NULL when the ring is full. *newHead is the head to publish.
+static unsigned char *log_reserve(LogRing *r, size_t size, size_t *newHead)
+{
+	size_t head = r->head;
+	size_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	size_t off  = head & (LOG_RING_SIZE - 1);
+	size_t pad  = (LOG_RING_SIZE - off < size) ? LOG_RING_SIZE - off : 0;
+
+	if ( LOG_RING_SIZE - (head - tail) < pad + size )
+		return NULL;
+
+	if ( pad )
+	{
+		((LogRecord *)(r->buf + off))->size = (uint32_t)pad | LOG_PAD;
+		off = 0;
+	}
+
+	*newHead = head + pad + size;
+	return r->buf + off;
+}
+
+int File_Log(const char *format, ...)
+{
+	va_list args, sizing;
+	size_t size, newHead;
+	unsigned char *dst = NULL;
+	LogRecord *rec;
+	LogRing *r;
+
+	if ( !__atomic_load_n(&g_started, __ATOMIC_ACQUIRE) && Log_Init("log", 0) != 0 )
+		return -1;
+
+	r = log_thread_ring();
+	if ( r == NULL )
+		return -1;
+
+	va_start(args, format);
+
+	va_copy(sizing, args);
+	size = sizeof(LogRecord) + log_args_walk(format, sizing, NULL);
+	va_end(sizing);
+
+	if ( size <= LOG_MAX_RECORD )
+	{
+		// Blocking policy: wait for the writer to release space. Give up once it is stopping, it may
+		// already have drained this ring for the last time.
+		while ( (dst = log_reserve(r, size, &newHead)) == NULL &&
+				!(g_flags & LOG_DROP_WHEN_FULL) && !__atomic_load_n(&g_stop, __ATOMIC_ACQUIRE) )
+			usleep(LOG_FULL_WAIT_US);
+	}
+
+	if ( dst == NULL )
+	{
+		va_end(args);
+		__atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+		return -1;
+	}
+
+	rec = (LogRecord *)dst;
+	rec->size = (uint32_t)size;
+	rec->format = format;
+	clock_gettime(CLOCK_REALTIME_COARSE, &rec->ts);
+	log_args_walk(format, args, dst + sizeof(LogRecord));
+
+	va_end(args);
+
+	__atomic_store_n(&r->head, newHead, __ATOMIC_RELEASE);
+	return (int)size;
+}
+
+
+/*****************************************    Consumer     *************************************************/
+
+static void log_writev_all(int fd, struct iovec *iov, int cnt)
+{
+	ssize_t ret;
+
+	while ( cnt > 0 )
+	{
+		ret = writev(fd, iov, cnt > IOV_MAX ? IOV_MAX : cnt);
+		if ( ret < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			return;
+		}
+
+		while ( cnt > 0 && (size_t)ret >= iov->iov_len )   // skip fully written entries
+		{
+			ret -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if ( cnt > 0 )
+		{
+			iov->iov_base = (char *)iov->iov_base + ret;
+			iov->iov_len -= ret;
+		}
+	}
+}
+
+static void log_batch_write(void)
+{
+	LogRing *r;
+
+	if ( g_iovCnt > 0 )
+	{
+		if ( g_flags & LOG_ECHO_STDOUT )
+		{
+			static struct iovec echo[LOG_MAX_IOV];         // writev consumes its iov array
+			memcpy(echo, g_iov, g_iovCnt * sizeof(struct iovec));
+			log_writev_all(STDOUT_FILENO, echo, g_iovCnt);
+		}
+		if ( g_fd >= 0 )
+			log_writev_all(g_fd, g_iov, g_iovCnt);
+	}
+
+	g_batchLen = 0;
+	g_iovCnt = 0;
+	g_prefixSec = -1;                                     // the cached prefix lived in g_batch
+
+	// Everything formatted so far is on disk: hand the ring space back to the producers.
+	for ( r = __atomic_load_n(&g_rings, __ATOMIC_ACQUIRE); r; r = r->next )
+		if ( r->tail != r->drained )
+			__atomic_store_n(&r->tail, r->drained, __ATOMIC_RELEASE);
+}
+
+static void log_open_file(const struct tm *lt)
+{
+	char logfile[sizeof(g_prefix) + 32];
+
+	if ( g_fd >= 0 )
+		close(g_fd);
+
+	snprintf(logfile, sizeof(logfile), "%s_%04d%02d%02d.txt", g_prefix, lt->tm_year + 1900, lt->tm_mon + 1, lt->tm_mday);
+	g_fd = open(logfile, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, S_IWRITE | S_IREAD);
+	g_fileDay = lt->tm_year * 1000 + lt->tm_yday;
+}
+
+// Same prefix as the old Time_Get(): "\nHHMMSS: MM/DD/YY: => ", formatted once per second.
+static void log_prefix(time_t sec)
+{
+	struct tm lt;
+	int len;
+
+	if ( sec == g_prefixSec )
+		return;
+
+	localtime_r(&sec, &lt);
+
+	if ( lt.tm_year * 1000 + lt.tm_yday != g_fileDay )   // new day: finish the old file first
+	{
+		log_batch_write();
+		log_open_file(&lt);
+	}
+
+	if ( LOG_BATCH_SIZE - g_batchLen < 64 )
+		log_batch_write();
+
+	g_prefixPtr = g_batch + g_batchLen;
+	len = snprintf(g_prefixPtr, 64, "\n%02d%02d%02d: %02d/%02d/%02d: => ", lt.tm_hour, lt.tm_min, lt.tm_sec,
+			lt.tm_mon + 1, lt.tm_mday, lt.tm_year - 100);
+	g_prefixLen = len;
+	g_batchLen += len;
+	g_prefixSec = sec;
+}
+
+#define LOG_GET(in, n, value) \
+	do { memcpy(&(value), (in) + (n), sizeof(value)); (n) += 8; } while ( 0 )
+
+#define LOG_EMIT(value) \
+	(spec.widthStar && spec.precisionStar ? snprintf(dst, room, fmt, w, pr, value) : \
+	 spec.widthStar ? snprintf(dst, room, fmt, w, value) : \
+	 spec.precisionStar ? snprintf(dst, room, fmt, pr, value) : snprintf(dst, room, fmt, value))
+
+// Formats rec into out. Returns the length, or -1 when it does not fit into cap.
+static int log_format(const LogRecord *rec, char *out, size_t cap)
+{
+	size_t len = 0, n = 0, lit;
+	const unsigned char *in = (const unsigned char *)(rec + 1);
+	const char *p = rec->format, *pct;
+	char fmt[32];
+	LogSpec spec;
+
+	while ( *p )
+	{
+		int ret = 0;
+		int w = 0, pr = 0;
+		long long iv = 0, wv, pv;
+		char *dst;
+		size_t room;
+
+		pct = strchr(p, '%');
+		lit = pct ? (size_t)(pct - p) : strlen(p);
+		if ( len + lit >= cap )
+			return -1;
+		memcpy(out + len, p, lit);
+		len += lit;
+		if ( pct == NULL )
+			break;
+
+		p = log_parse_spec(pct, &spec);
+		dst = out + len;
+		room = cap - len;
+
+		if ( spec.widthStar )     { LOG_GET(in, n, wv); w = (int)wv; }
+		if ( spec.precisionStar ) { LOG_GET(in, n, pv); pr = (int)pv; }
+
+		if ( (size_t)(spec.end - spec.start) >= sizeof(fmt) )
+			spec.type = ARG_NONE;                 // absurd spec: copied literally below
+		memcpy(fmt, spec.start, spec.end - spec.start);
+		fmt[spec.end - spec.start] = '\0';
+
+		switch ( spec.type )
+		{
+			case ARG_INT:     LOG_GET(in, n, iv); ret = LOG_EMIT((int)iv); break;
+			case ARG_LONG:    LOG_GET(in, n, iv); ret = LOG_EMIT((long)iv); break;
+			case ARG_LLONG:   LOG_GET(in, n, iv); ret = LOG_EMIT((long long)iv); break;
+			case ARG_SIZE:    LOG_GET(in, n, iv); ret = LOG_EMIT((size_t)iv); break;
+			case ARG_INTMAX:  LOG_GET(in, n, iv); ret = LOG_EMIT((intmax_t)iv); break;
+			case ARG_PTRDIFF: LOG_GET(in, n, iv); ret = LOG_EMIT((ptrdiff_t)iv); break;
+			case ARG_WCHAR:   LOG_GET(in, n, iv); ret = snprintf(dst, room, "?"); break;
+			case ARG_COUNT:   n += 8; break;
+			case ARG_WSTR:    n += 8; ret = snprintf(dst, room, "(wide)"); break;
+
+			case ARG_DOUBLE:
+			{
+				double d;
+				LOG_GET(in, n, d);
+				ret = LOG_EMIT(d);
+				break;
+			}
+
+			case ARG_LDOUBLE:
+			{
+				long double ld;
+				memcpy(&ld, in + n, sizeof(ld));
+				n += LOG_ALIGN8(sizeof(ld));
+				ret = LOG_EMIT(ld);
+				break;
+			}
+
+			case ARG_PTR:
+			{
+				void *ptr;
+				LOG_GET(in, n, ptr);
+				ret = LOG_EMIT(ptr);
+				break;
+			}
+
+			case ARG_STR:
+			{
+				uint64_t slen;
+				LOG_GET(in, n, slen);
+				memcpy(g_strScratch, in + n, slen);
+				g_strScratch[slen] = '\0';
+				n += LOG_ALIGN8(slen);
+				ret = LOG_EMIT(g_strScratch);
+				break;
+			}
+
+			case ARG_NONE:
+				if ( spec.end - spec.start == 2 && spec.start[1] == '%' )
+					ret = snprintf(dst, room, "%%");
+				else
+					ret = snprintf(dst, room, "%.*s", (int)(spec.end - spec.start), spec.start);
+				break;
+		}
+
+		if ( ret < 0 )
+			ret = 0;
+		if ( (size_t)ret >= room )
+			return -1;
+		len += ret;
+	}
+
+	return (int)len;
+}
+
+static void log_emit(const LogRecord *rec)
+{
+	int len;
+
+	log_prefix(rec->ts.tv_sec);
+
+	len = log_format(rec, g_batch + g_batchLen, LOG_BATCH_SIZE - g_batchLen);
+	if ( len < 0 || g_iovCnt + 2 > LOG_MAX_IOV )
+	{
+		log_batch_write();
+		log_prefix(rec->ts.tv_sec);
+		len = log_format(rec, g_batch + g_batchLen, LOG_BATCH_SIZE - g_batchLen);
+		if ( len < 0 )                                       // bigger than a whole batch: truncate
+			len = (int)(LOG_BATCH_SIZE - g_batchLen - 1);
+	}
+
+	g_iov[g_iovCnt].iov_base = g_prefixPtr;
+	g_iov[g_iovCnt].iov_len  = g_prefixLen;
+	g_iov[g_iovCnt + 1].iov_base = g_batch + g_batchLen;
+	g_iov[g_iovCnt + 1].iov_len  = len;
+	g_iovCnt += 2;
+	g_batchLen += len;
+}
+
+// Formats every available record of every ring and writes them. Returns the number of records.
+static unsigned long log_drain(void)
+{
+	unsigned long count = 0;
+	size_t head, tail;
+	LogRecord *rec;
+	LogRing *r;
+
+	for ( r = __atomic_load_n(&g_rings, __ATOMIC_ACQUIRE); r; r = r->next )
+	{
+		head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		tail = r->drained;
+
+		while ( tail != head )
+		{
+			rec = (LogRecord *)(r->buf + (tail & (LOG_RING_SIZE - 1)));
+			if ( !(rec->size & LOG_PAD) )
+			{
+				log_emit(rec);
+				count++;
+			}
+			tail += rec->size & ~LOG_PAD;
+			r->drained = tail;
+		}
+	}
+
+	if ( count )
+		log_batch_write();
+
+	return count;
+}
+
+static void *log_writer(void *)
+{
+	int stop;
+	useconds_t idle = LOG_IDLE_MIN_US;
+
+	while ( 1 )
+	{
+		stop = __atomic_load_n(&g_stop, __ATOMIC_ACQUIRE);
+
+		if ( log_drain() )
+		{
+			idle = LOG_IDLE_MIN_US;
+			continue;
+		}
+		if ( stop )
+			break;
+
+		usleep(idle);                                       // back off while idle, no busy polling
+		idle = (idle * 2 > LOG_IDLE_MAX_US) ? LOG_IDLE_MAX_US : idle * 2;
+	}
+
+	return NULL;
+}
+
+
+/*****************************************    Lifecycle     *************************************************/
+
+static void log_atfork_prepare(void) { pthread_mutex_lock(&g_lock); }
+static void log_atfork_parent(void)  { pthread_mutex_unlock(&g_lock); }
+
+// Only the forking thread survives: drop what the parent will write anyway and start our own writer.
+static void log_atfork_child(void)
+{
+	LogRing *r;
+
+	for ( r = g_rings; r; r = r->next )
+		r->tail = r->drained = r->head;
+
+	g_batchLen = 0;
+	g_iovCnt = 0;
+	g_prefixSec = -1;
+
+	if ( g_started && !g_shutdown )
+	{
+		g_stop = 0;
+		if ( pthread_create(&g_writer, NULL, log_writer, NULL) != 0 )
+			g_started = 0;
+	}
+
+	pthread_mutex_unlock(&g_lock);
+}
+
+int Log_Init(const char *prefix, int flags)
+{
+	static int once;
+
+	pthread_mutex_lock(&g_lock);
+
+	if ( g_started || g_shutdown )
+	{
+		pthread_mutex_unlock(&g_lock);
+		return g_started ? 0 : -1;
+	}
+
+	snprintf(g_prefix, sizeof(g_prefix), "%s", prefix);
+	g_flags = flags;
+	g_stop = 0;
+
+	if ( !once )
+	{
+		pthread_key_create(&g_ringKey, log_ring_retire);
+		pthread_atfork(log_atfork_prepare, log_atfork_parent, log_atfork_child);
+		atexit(Log_Shutdown);
+		once = 1;
+	}
+
+	if ( pthread_create(&g_writer, NULL, log_writer, NULL) != 0 )
+	{
+		pthread_mutex_unlock(&g_lock);
+		return -1;
+	}
+
+	__atomic_store_n(&g_started, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&g_lock);
+	return 0;
+}
+
+void Log_Flush(void)
+{
+	LogRing *r;
+
+	if ( !__atomic_load_n(&g_started, __ATOMIC_ACQUIRE) )
+		return;
+
+	// tail only moves past a record after the writev that contains it
+	for ( r = __atomic_load_n(&g_rings, __ATOMIC_ACQUIRE); r; r = r->next )
+	{
+		size_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		while ( (ptrdiff_t)(__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) - head) < 0 )
+			usleep(100);
+	}
+}
+
+void Log_Shutdown(void)
+{
+	pthread_mutex_lock(&g_lock);
+
+	if ( !g_started )
+	{
+		pthread_mutex_unlock(&g_lock);
+		return;
+	}
+
+	__atomic_store_n(&g_started, 0, __ATOMIC_RELEASE);
+	g_shutdown = 1;
+	__atomic_store_n(&g_stop, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&g_lock);
+
+	pthread_join(g_writer, NULL);                             // drains every ring before it exits
+
+	if ( g_fd >= 0 )
+		close(g_fd);
+	g_fd = -1;
+}
+
+unsigned long Log_Dropped(void)
+{
+	unsigned long dropped = 0;
+	LogRing *r;
+
+	for ( r = __atomic_load_n(&g_rings, __ATOMIC_ACQUIRE); r; r = r->next )
+		dropped += __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+
+	return dropped;
+}
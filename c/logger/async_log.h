@@ -0,0 +1,50 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+/****************************************************************************
+ *
+ * Asynchronous logger (drop-in replacement for the per-program File_Log)
+ *
+ *   g++ your_prog.cpp ../logger/async_log.cpp -lpthread -o your_prog
+ *
+ * File_Log() on the calling thread only
+ *   - reads a coarse realtime clock
+ *   - copies the format pointer and the raw arguments (ints, doubles, pointers, string bytes) into a
+ *     binary record in the calling thread's own ring buffer (single producer / single consumer,
+ *     lock free, no syscalls, no formatting)
+ *
+ * A background thread drains every ring, formats the records (timestamp prefix computed once per
+ * second), and writes each batch with one writev(). The log file is "<prefix>_YYYYMMDD.txt" and
+ * rotates at local midnight. LOG_ECHO_STDOUT also writes every batch to stdout, like the old File_Log
+ * (straight to fd 1, so not ordered with printf() output still sitting in the stdio buffer).
+ *
+ * Rules
+ *   - the format must be a string literal (only the pointer is stored); log dynamic text with "%s"
+ *   - %n and wide (%ls / %lc) conversions are not supported
+ *   - a full ring makes the caller wait for the writer (like the old synchronous File_Log, no record
+ *     is lost); with LOG_DROP_WHEN_FULL the record is dropped instead and Log_Dropped() counts it
+ *   - records larger than a quarter of the ring are always dropped (and counted)
+ *   - rings of exited threads are drained and reused by new threads
+ *   - fork(): the child gets its own background thread, records pending at fork are left to the parent
+ *
+ * ***************************************************************************/
+
+#define LOG_ECHO_STDOUT     0x01
+#define LOG_DROP_WHEN_FULL  0x02   // never block the caller, drop the record when its ring is full
+
+// Starts the background writer. Without it the first File_Log() initializes with prefix "log", no echo.
+int  Log_Init(const char *prefix, int flags);
+
+// Queues one record, waiting for ring space unless LOG_DROP_WHEN_FULL. Returns the record size, or -1
+// when it was dropped.
+int  File_Log(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// Blocks until everything queued before the call is written.
+void Log_Flush(void);
+
+// Drains all rings and stops the background writer (also registered with atexit()).
+void Log_Shutdown(void);
+
+unsigned long Log_Dropped(void);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+      g++ -O2 log_bench.cpp async_log.cpp -lpthread -o log_bench
+
+      ./log_bench [threads] [calls per thread] [block|drop]
+*/
+
+/****************************************************************************
+ *
+ * Caller side cost of one log line: the old synchronous File_Log (vsprintf + open/write/close on
+ * every call, stdout echo left out) against the asynchronous File_Log of async_log.cpp.
+ *
+ * Every thread logs the same mixed line (ints, a string, a double) <calls> times and times each
+ * call. Reported: calls/s over all threads until the callers return, lines/s actually written
+ * (accepted records over the time until they are on disk), caller latency percentiles and the
+ * records dropped.
+ *
+ * "block" (default) is the logger's default policy: a full ring makes the caller wait, so nothing is
+ * dropped and calls/s is bounded by the writer. "drop" runs with LOG_DROP_WHEN_FULL: calls/s then
+ * measures the enqueue cost only, and the accepted lines/s is what the writer kept up with.
+ *
+ * ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "async_log.h"
+
+typedef int (*LOG_FN)(const char *format, ...);
+
+typedef struct
+{
+	LOG_FN log;
+	int id;
+	long calls;
+	long *latency;                        // ns per call
+}BenchThread;
+
+
+/*****************************************    Legacy File_Log (before async_log)     *************************************************/
+
+static int Time_Get(char *outField)
+{
+	time_t t = time(0);
+	struct tm* lt = localtime(&t);
+	char time_str[128] = {0};
+
+	sprintf(time_str, "\n%02d%02d%02d: %02d/%02d/%02d: => ", lt->tm_hour, lt->tm_min, lt->tm_sec, lt->tm_mon + 1, lt->tm_mday, lt->tm_year - 100);
+
+	strncat(outField, time_str, strlen(time_str));
+	return lt->tm_mon + 1;
+}
+
+__attribute__((format(printf, 1, 2)))
+static int Sync_File_Log(const char* format, ...)
+{
+	int ret=0;
+	int month = 0;
+	int fp = 0;
+	char buffer[15001] = {'\0'};
+	char logfile[30] = {'\0'};
+
+	va_list args;
+
+	month = Time_Get(buffer);
+
+	va_start(args, format);
+	vsprintf (&buffer[strlen(buffer)], format, args );
+	va_end(args);
+
+	sprintf(logfile, "bench_sync_%02d.txt", month);
+
+	fp = open (logfile, O_WRONLY|O_APPEND|O_CREAT, S_IWRITE | S_IREAD);
+	if(fp<0)
+		return -1;
+
+	ret = write(fp, (const char *)buffer,strlen(buffer));
+
+	close(fp);
+
+	return ret;
+}
+
+
+/*****************************************    Benchmark     *************************************************/
+
+static long now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void *bench_thread(void *args)
+{
+	BenchThread *t = (BenchThread *)args;
+	static const char *states[] = { "ACCEPTED", "READING", "WRITING", "CLOSED" };
+	long i, start;
+
+	for ( i = 0; i < t->calls; i++ )
+	{
+		start = now_ns();
+		t->log("worker %d : fd %ld state %s bytes %d elapsed %.3f ms", t->id, i & 1023, states[i & 3], (int)(i * 7), i * 0.001);
+		t->latency[i] = now_ns() - start;
+	}
+
+	return NULL;
+}
+
+static void run(const char *name, LOG_FN log, int threads, long calls)
+{
+	BenchThread *t = (BenchThread *)calloc(threads, sizeof(BenchThread));
+	pthread_t *tid = (pthread_t *)calloc(threads, sizeof(pthread_t));
+	long *all = (long *)malloc(sizeof(long) * threads * calls);
+	long start, callersDone, n = (long)threads * calls, written = n;
+	unsigned long droppedBefore = Log_Dropped();
+	int i;
+
+	start = now_ns();
+	for ( i = 0; i < threads; i++ )
+	{
+		t[i].log = log;
+		t[i].id = i;
+		t[i].calls = calls;
+		t[i].latency = all + i * calls;
+		pthread_create(&tid[i], NULL, bench_thread, &t[i]);
+	}
+	for ( i = 0; i < threads; i++ )
+		pthread_join(tid[i], NULL);
+	callersDone = now_ns();
+
+	if ( log == File_Log )
+	{
+		Log_Flush();                      // include the time to get everything on disk
+		written -= Log_Dropped() - droppedBefore;
+	}
+
+	std::sort(all, all + n);
+
+	printf("\n%-6s : %8.0f calls/s (callers)  %8.0f lines/s (written)  %8ld dropped   latency ns p50 %6ld  p99 %7ld  p99.9 %8ld  max %9ld",
+			name, n * 1e9 / (callersDone - start), written * 1e9 / (now_ns() - start), n - written,
+			all[n / 2], all[n * 99 / 100], all[n * 999 / 1000], all[n - 1]);
+
+	free(all);
+	free(tid);
+	free(t);
+}
+
+int main(int argc, char *argv[])
+{
+	int threads = argc > 1 ? atoi(argv[1]) : 4;
+	long calls  = argc > 2 ? atol(argv[2]) : 100000;
+	int drop    = argc > 3 && strcmp(argv[3], "drop") == 0;
+
+	printf("\n%d threads x %ld calls, async policy %s", threads, calls, drop ? "drop when full" : "block when full");
+
+	Log_Init("bench_async", drop ? LOG_DROP_WHEN_FULL : 0);
+
+	run("sync", Sync_File_Log, threads, calls);
+	run("async", File_Log, threads, calls);
+
+	printf("\n");
+
+	Log_Shutdown();
+	return 0;
+}
@@ -1,23 +1,219 @@
+// TCP port forwarder / L4 load balancer: LISTEN_PORT -> one of the TARGET IP:PORTs
+//
+//   g++ -O2 -std=c++17 -pthread forwarder.cpp -o forwarder
+//   ./forwarder [--mode splice|copy] [--workers N] [--buffer KB] [--listen PORT]
+//               [--target IP:PORT]... [--balance least|hash] [--connect-timeout MS] [--quiet]
+//
+// Modes
+//   copy   : bytes go through user space: readv() into a fixed-size per-direction ring buffer, writev()
+//            out of it (one worker by default)
+//   splice : bytes stay in the kernel: splice() moves them from the source socket into a per-direction
+//            pipe and from the pipe into the destination socket, no copy into user memory
+//
+// Backpressure
+//   Every direction buffers at most --buffer KB (default 64, rounded up to a power of two): the ring in
+//   copy mode, the pipe (F_SETPIPE_SZ) in splice mode. In copy mode a direction stops reading its source
+//   when the ring reaches the high watermark (3/4 full) and EPOLLIN is dropped from the source fd with
+//   modify_fd(); reading resumes once the destination drained it to the low watermark (1/4 full).
+//   A slow destination therefore slows the sender down through TCP flow control instead of growing
+//   the forwarder's memory.
+//
+// Upstreams
+//   --target can be given several times (default 127.0.0.1:9090). Every client gets one upstream:
+//     least : fewest active connections, ties round-robin (default)
+//     hash  : consistent hash of the client IP on a ring of HASH_POINTS points per upstream, so a client
+//             keeps its upstream and adding / removing one only moves the clients of that one
+//   The upstream connect is non-blocking: the client is parked until the connect completes (EPOLLOUT +
+//   SO_ERROR) or --connect-timeout (default 2000 ms) expires. A failed connect is retried on the next
+//   upstream the client has not tried yet. MAX_FAILS consecutive failures mark an upstream down for
+//   UPSTREAM_DOWN_TIME; after that exactly one new connection probes it (the others keep avoiding it while
+//   the probe is in flight) and only a successful probe marks it up again, a failed one starts another
+//   UPSTREAM_DOWN_TIME. Only when no upstream is up are the down ones tried anyway.
+//
+// Workers
+//   Every worker thread has its own listener bound with SO_REUSEPORT, its own epoll instance, its own
+//   connection table and its own copy of the upstream list (connection counts and health are per worker):
+//   the kernel spreads new connections over the listeners, nothing is shared between workers.
+//   Default: one worker per CPU for splice, one for copy.
+//
+// Connections live in a table indexed by the client fd; epoll_event.data.ptr points straight at the
+// Endpoint (client or upstream socket) of the connection, so an event needs no lookup. Connections closed
+// while handling a batch of events are freed after the batch, later events of the batch see them closed.
+//
+// Each direction is pumped independently (EPOLLIN on its source, EPOLLOUT on its destination).
+// EOF on one side is forwarded as shutdown(SHUT_WR) once the pending bytes are written; the pair is
+// closed when both directions are finished or on any error.
+
 #include <iostream>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <memory>
 #include <vector>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <algorithm>
 #include <unistd.h>
 #include <fcntl.h>
 #include <cstring>
+#include <cstdlib>
+#include <csignal>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int MAX_UPSTREAMS = 64;                          // Connection::tried is a 64 bit mask
+constexpr int MAX_FAILS = 2;                               // consecutive failed connects -> down
+constexpr auto UPSTREAM_DOWN_TIME = std::chrono::seconds(5);
+constexpr int HASH_POINTS = 160;                           // consistent hash ring points per upstream
+
+enum class Mode
+{
+    Copy,
+    Splice
+};
+
+enum class Balance
+{
+    LeastConnections,
+    ConsistentHash
+};
+
+struct Options
+{
+    Mode mode = Mode::Splice;
+    int workers = 0;                      // 0: one per CPU (splice) / 1 (copy)
+    size_t buffer_size = 64 * 1024;       // per direction, power of two
+    int listen_port = 8080;
+    std::vector<sockaddr_in> targets;
+    Balance balance = Balance::LeastConnections;
+    int connect_timeout_ms = 2000;
+    bool quiet = false;
+};
+
+// Fixed-capacity byte ring. head and tail only grow; the buffered bytes are [tail, head) modulo the
+// capacity (a power of two), so both the free and the used space are at most two segments.
+struct RingBuffer
+{
+    std::unique_ptr<char[]> data;
+    size_t capacity = 0;
+    size_t head = 0;                      // total bytes written into the ring
+    size_t tail = 0;                      // total bytes taken out of it
+
+    void allocate(size_t size)
+    {
+        data = std::make_unique<char[]>(size);
+        capacity = size;
+    }
+
+    size_t size() const { return head - tail; }
+    bool empty() const { return head == tail; }
+
+    // One readv() into the free space. Same return as read().
+    ssize_t read_from(int fd)
+    {
+        size_t pos = head & (capacity - 1), space = capacity - size();
+        size_t first = std::min(space, capacity - pos);
+        iovec iov[2] = {{data.get() + pos, first}, {data.get(), space - first}};
+
+        ssize_t n = readv(fd, iov, iov[1].iov_len ? 2 : 1);
+        if (n > 0)
+            head += n;
+        return n;
+    }
+
+    // One writev() of the buffered bytes. Same return as write().
+    ssize_t write_to(int fd)
+    {
+        size_t pos = tail & (capacity - 1), used = size();
+        size_t first = std::min(used, capacity - pos);
+        iovec iov[2] = {{data.get() + pos, first}, {data.get(), used - first}};
+
+        ssize_t n = writev(fd, iov, iov[1].iov_len ? 2 : 1);
+        if (n > 0)
+            tail += n;
+        return n;
+    }
+};
+
+// One direction of a forwarded connection: from_fd -> to_fd.
+struct Direction
+{
+    int from_fd = -1;
+    int to_fd = -1;
+    RingBuffer ring;                      // copy: read from from_fd, not yet written to to_fd
+    bool paused = false;                  // copy: ring above the high watermark, from_fd not read
+    bool reading = true;                  // EPOLLIN currently registered on from_fd
+    int pipe_fds[2] = {-1, -1};           // splice: kernel buffer between the two sockets
+    size_t pipe_size = 0;                 // splice: pipe capacity
+    size_t in_pipe = 0;                   // splice: bytes sitting in the pipe
+    bool eof = false;                     // from_fd reached EOF
+    bool done = false;                    // everything forwarded, to_fd shut down for writing
+};
+
+// One backend. Every worker has its own copy.
+struct Upstream
+{
+    sockaddr_in addr{};
+    std::string name;                     // ip:port
+    int active = 0;                       // connections using it, connects in progress included
+    int failures = 0;                     // consecutive failed connects
+    Clock::time_point down_until{};
+    bool probing = false;                 // down, and one connection is probing it
+
+    bool up(Clock::time_point now) const { return failures < MAX_FAILS || (now >= down_until && !probing); }
+};
+
+struct Connection;
+
+// What epoll_event.data.ptr points at: one socket of a connection, or the listener (conn == nullptr).
+struct Endpoint
+{
+    Connection* conn = nullptr;
+    int fd = -1;
+};
 
 struct Connection
 {
+    Endpoint client;
+    Endpoint target;
+    Direction client_to_target;
+    Direction target_to_client;
+    uint32_t client_ip = 0;               // consistent hash key
+    int upstream = -1;                    // index into Worker::upstreams, -1: none
+    uint64_t tried = 0;                   // bit per upstream already tried for this client
+    bool connecting = false;              // upstream connect in progress
+    bool probe = false;                   // that connect is the probe of a down upstream
+    unsigned connect_serial = 0;          // matches the PendingConnect of the current attempt
+    bool closed = false;
+};
+
+// Connect timeout queue entry. All connects get the same timeout, so a FIFO is deadline ordered.
+struct PendingConnect
+{
+    Clock::time_point deadline;
     int client_fd;
-    int target_fd;
-    std::string buffer_client_to_target;
-    std::string buffer_target_to_client;
+    unsigned serial;                      // stale when the connection moved on (connected, retried, closed)
+};
+
+struct Worker
+{
+    const Options& opt;
+    int epoll_fd = -1;
+    Endpoint listener;
+    std::vector<std::unique_ptr<Connection>> table;    // indexed by client fd
+    std::vector<std::unique_ptr<Connection>> closed;   // freed after the current batch of events
+    std::vector<Upstream> upstreams;
+    std::vector<std::pair<uint64_t, int>> hash_ring;   // (point, upstream index), sorted
+    std::deque<PendingConnect> pending;
+    unsigned next_serial = 0;
+    size_t next_upstream = 0;                          // least connections: round-robin start for ties
+
+    explicit Worker(const Options& o) : opt(o) {}
 };
 
 void set_non_blocking(int fd)
@@ -29,190 +225,620 @@ void set_non_blocking(int fd)
 int create_listener(int port)
 {
     int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) return -1;
+
     int opt = 1;
     setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
 
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_port = htons(port);
     addr.sin_addr.s_addr = INADDR_ANY;
 
-    bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
-    listen(listen_fd, 128);
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd, SOMAXCONN) < 0)
+    {
+        perror("bind/listen");
+        close(listen_fd);
+        return -1;
+    }
     set_non_blocking(listen_fd);
     return listen_fd;
 }
 
-int connect_to_target(const std::string& ip, int port)
+std::string address_name(const sockaddr_in& addr)
 {
-    int fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (fd < 0) return -1;
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
 
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    inet_pton(AF_INET, ip.c_str(), &addr.sin_addr);
+// splitmix64 finalizer: spreads ring points and client keys over the whole 64 bit range.
+uint64_t mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+void add_fd(int epoll_fd, Endpoint* ep, uint32_t events)
+{
+    epoll_event ev{};
+    ev.data.ptr = ep;
+    ev.events = events;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ep->fd, &ev);
+}
+
+void modify_fd(int epoll_fd, Endpoint* ep, uint32_t events)
+{
+    epoll_event ev{};
+    ev.data.ptr = ep;
+    ev.events = events;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, ep->fd, &ev);
+}
+
+// Source finished and everything written: pass the EOF on.
+void finish_direction(Direction& d)
+{
+    if (!d.done)
+    {
+        shutdown(d.to_fd, SHUT_WR);
+        d.done = true;
+    }
+}
+
+// Returns false when the connection has to be closed.
+//
+// Reads and writes alternate until neither side moves: the source is read until EAGAIN (edge-triggered
+// epoll needs that) unless the ring passes the high watermark first, in which case the direction pauses
+// and only EPOLLOUT on to_fd brings it back.
+bool pump_copy(Direction& d)
+{
+    size_t high = d.ring.capacity - d.ring.capacity / 4;
+    size_t low = d.ring.capacity / 4;
+    bool progress = true;
+
+    while (progress)
+    {
+        progress = false;
+
+        if (!d.ring.empty())
+        {
+            ssize_t n = d.ring.write_to(d.to_fd);
+            if (n > 0)
+                progress = true;
+            else if (errno != EAGAIN)
+                return false;
+        }
+
+        if (d.paused && d.ring.size() <= low)
+            d.paused = false;
+        else if (!d.paused && d.ring.size() >= high)
+            d.paused = true;
+
+        if (!d.paused && !d.eof)
+        {
+            ssize_t n = d.ring.read_from(d.from_fd);
+            if (n > 0)
+                progress = true;
+            else if (n == 0)
+                d.eof = true;
+            else if (errno != EAGAIN)
+                return false;
+        }
+    }
+
+    if (d.eof && d.ring.empty())
+        finish_direction(d);
+    return true;
+}
+
+// Returns false when the connection has to be closed.
+bool pump_splice(Direction& d)
+{
+    while (true)
+    {
+        if (d.in_pipe > 0)
+        {
+            ssize_t n = splice(d.pipe_fds[0], nullptr, d.to_fd, nullptr, d.in_pipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0)
+            {
+                d.in_pipe -= n;
+                continue;
+            }
+            if (n < 0 && errno == EAGAIN)
+                return true;              // destination full, EPOLLOUT on to_fd resumes (and reads on)
+            return false;
+        }
+
+        if (d.eof)
+        {
+            finish_direction(d);
+            return true;
+        }
+
+        // The pipe is empty here, so EAGAIN can only mean the source socket is drained.
+        ssize_t n = splice(d.from_fd, nullptr, d.pipe_fds[1], nullptr, d.pipe_size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0)
+            d.in_pipe += n;
+        else if (n == 0)
+            d.eof = true;
+        else if (errno == EAGAIN)
+            return true;
+        else
+            return false;
+    }
+}
+
+// Drops EPOLLIN from the source fd while the direction is paused and restores it afterwards.
+// EPOLL_CTL_MOD re-checks readiness, so data that arrived in the meantime is reported again.
+void update_read_interest(Worker& w, Connection& c, Direction& d)
+{
+    bool want = !d.paused;
+    if (want == d.reading)
+        return;
+
+    // from_fd is also the other direction's destination: EPOLLOUT stays.
+    Endpoint* ep = (d.from_fd == c.client.fd) ? &c.client : &c.target;
+    modify_fd(w.epoll_fd, ep, (want ? EPOLLIN | EPOLLRDHUP : 0) | EPOLLOUT | EPOLLET);
+    d.reading = want;
+}
+
+bool open_pipe(Direction& d, size_t size)
+{
+    if (pipe2(d.pipe_fds, O_NONBLOCK | O_CLOEXEC) < 0)
+        return false;
+
+    int actual = fcntl(d.pipe_fds[1], F_SETPIPE_SZ, static_cast<int>(size));
+    d.pipe_size = actual > 0 ? actual : fcntl(d.pipe_fds[1], F_GETPIPE_SZ);
+    return true;
+}
+
+void upstream_failed(Worker& w, int index, Clock::time_point now)
+{
+    Upstream& u = w.upstreams[index];
+    if (++u.failures < MAX_FAILS)
+        return;
+
+    u.down_until = now + UPSTREAM_DOWN_TIME;          // again after every failed probe
+    if (u.failures == MAX_FAILS)
+        std::cerr << "[!] Upstream " << u.name << " marked down.\n";
+}
+
+// The probe of c's upstream is over (connected, failed or the client went away): another one may start.
+void end_probe(Worker& w, Connection& c)
+{
+    if (!c.probe)
+        return;
+    w.upstreams[c.upstream].probing = false;
+    c.probe = false;
+}
+
+void upstream_ok(Worker& w, int index)
+{
+    Upstream& u = w.upstreams[index];
+    if (u.failures >= MAX_FAILS)
+        std::cerr << "[+] Upstream " << u.name << " marked up.\n";
+    u.failures = 0;
+}
+
+// Upstream for the next connect attempt of c, -1 when every upstream has been tried.
+int pick_upstream(Worker& w, const Connection& c, Clock::time_point now)
+{
+    for (bool ignore_health : {false, true})
+    {
+        auto usable = [&](int i) {
+            return !(c.tried & (1ULL << i)) && (ignore_health || w.upstreams[i].up(now));
+        };
+
+        if (w.opt.balance == Balance::ConsistentHash)
+        {
+            size_t start = std::lower_bound(w.hash_ring.begin(), w.hash_ring.end(),
+                                            std::make_pair(mix64(c.client_ip), -1)) - w.hash_ring.begin();
+            for (size_t k = 0; k < w.hash_ring.size(); ++k)
+            {
+                int i = w.hash_ring[(start + k) % w.hash_ring.size()].second;
+                if (usable(i))
+                    return i;
+            }
+        }
+        else
+        {
+            int best = -1;
+            for (size_t k = 0; k < w.upstreams.size(); ++k)
+            {
+                int i = static_cast<int>((w.next_upstream + k) % w.upstreams.size());
+                if (usable(i) && (best < 0 || w.upstreams[i].active < w.upstreams[best].active))
+                    best = i;
+            }
+            if (best >= 0)
+            {
+                w.next_upstream = best + 1;
+                return best;
+            }
+        }
+    }
+    return -1;
+}
 
-    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+// Starts a non-blocking connect to the next upstream. False when no upstream is left to try.
+bool start_connect(Worker& w, Connection& c)
+{
+    Clock::time_point now = Clock::now();
+
+    while (true)
     {
-        if (errno != EINPROGRESS)
+        int i = pick_upstream(w, c, now);
+        if (i < 0)
+            return false;
+        c.tried |= 1ULL << i;
+
+        Upstream& u = w.upstreams[i];
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return false;
+
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&u.addr), sizeof(u.addr)) < 0 && errno != EINPROGRESS)
         {
+            if (!w.opt.quiet)
+                std::cerr << "[!] Connect to " << u.name << " failed: " << strerror(errno) << "\n";
             close(fd);
-            return -1;
+            upstream_failed(w, i, now);
+            continue;
         }
+
+        c.upstream = i;
+        u.active++;
+        c.target.fd = fd;
+        c.client_to_target.to_fd = fd;
+        c.target_to_client.from_fd = fd;
+        c.connecting = true;
+        c.probe = u.failures >= MAX_FAILS && !u.probing;
+        u.probing |= c.probe;
+        c.connect_serial = ++w.next_serial;
+        w.pending.push_back({now + std::chrono::milliseconds(w.opt.connect_timeout_ms), c.client.fd, c.connect_serial});
+
+        // Writable (or an error) once the connect completes, even when it already has.
+        add_fd(w.epoll_fd, &c.target, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+        return true;
     }
-    set_non_blocking(fd);
-    return fd;
 }
 
-void add_fd(int epoll_fd, int fd, uint32_t events)
+void close_connection(Worker& w, Connection& c)
 {
-    epoll_event ev{};
-    ev.data.fd = fd;
-    ev.events = events;
-    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    if (c.closed)
+        return;
+    c.closed = true;
+
+    for (Direction* d : {&c.client_to_target, &c.target_to_client})
+    {
+        if (d->pipe_fds[0] >= 0) close(d->pipe_fds[0]);
+        if (d->pipe_fds[1] >= 0) close(d->pipe_fds[1]);
+    }
+    if (c.target.fd >= 0)
+        close(c.target.fd);
+    if (c.upstream >= 0)
+    {
+        end_probe(w, c);
+        w.upstreams[c.upstream].active--;
+    }
+    close(c.client.fd);
+
+    // The fd can be reused by accept() within this batch: move the connection out of its slot now,
+    // free it once no event of the batch can point at it any more.
+    w.closed.push_back(std::move(w.table[c.client.fd]));
+
+    if (!w.opt.quiet)
+        std::cout << "[-] Connection closed.\n";
 }
 
-void modify_fd(int epoll_fd, int fd, uint32_t events)
+// Pumps the given directions, then closes the connection or adjusts its read interest.
+void pump_directions(Worker& w, Connection& c, Direction* first, Direction* second)
 {
-    epoll_event ev{};
-    ev.data.fd = fd;
-    ev.events = events;
-    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    auto pump = (w.opt.mode == Mode::Splice) ? pump_splice : pump_copy;
+
+    // Errors and hangups surface as read/write failures inside the pumps.
+    bool ok = (!first || pump(*first)) && (!second || pump(*second));
+
+    if (!ok || (c.client_to_target.done && c.target_to_client.done))
+    {
+        close_connection(w, c);
+        return;
+    }
+
+    update_read_interest(w, c, c.client_to_target);
+    update_read_interest(w, c, c.target_to_client);
+}
+
+// The current connect attempt failed or timed out: next upstream, or give up on the client.
+void connect_failed(Worker& w, Connection& c, const char* reason)
+{
+    Upstream& u = w.upstreams[c.upstream];
+    if (!w.opt.quiet)
+        std::cerr << "[!] Connect to " << u.name << " failed: " << reason << "\n";
+
+    u.active--;
+    end_probe(w, c);
+    upstream_failed(w, c.upstream, Clock::now());
+    close(c.target.fd);
+    c.target.fd = -1;
+    c.upstream = -1;
+    c.connecting = false;
+
+    if (!start_connect(w, c))
+        close_connection(w, c);
+}
+
+// EPOLLOUT / EPOLLERR on the upstream socket of a connection that is still connecting.
+void on_connect_event(Worker& w, Connection& c)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(c.target.fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+        err = errno;
+    if (err != 0)
+    {
+        connect_failed(w, c, strerror(err));
+        return;
+    }
+
+    // An event left over from the socket of a previous attempt: this one is still in progress.
+    sockaddr_in peer{};
+    socklen_t peer_len = sizeof(peer);
+    if (getpeername(c.target.fd, reinterpret_cast<sockaddr*>(&peer), &peer_len) < 0)
+        return;
+
+    c.connecting = false;
+    end_probe(w, c);
+    upstream_ok(w, c.upstream);
+    if (!w.opt.quiet)
+        std::cout << "[+] Client connected to " << w.upstreams[c.upstream].name << ".\n";
+
+    // Whatever the client sent while we were connecting is still in its socket.
+    pump_directions(w, c, &c.client_to_target, &c.target_to_client);
+}
+
+void expire_connects(Worker& w)
+{
+    Clock::time_point now = Clock::now();
+
+    while (!w.pending.empty() && w.pending.front().deadline <= now)
+    {
+        PendingConnect p = w.pending.front();
+        w.pending.pop_front();
+
+        Connection* c = (static_cast<size_t>(p.client_fd) < w.table.size()) ? w.table[p.client_fd].get() : nullptr;
+        if (c && c->connecting && c->connect_serial == p.serial)
+            connect_failed(w, *c, "timeout");
+    }
+}
+
+void accept_connections(Worker& w, int listen_fd)
+{
+    while (true)
+    {
+        sockaddr_in client_addr{};
+        socklen_t len = sizeof(client_addr);
+        int client_fd = accept4(listen_fd, reinterpret_cast<sockaddr*>(&client_addr), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0)
+        {
+            if (errno != EAGAIN)
+                perror("accept");
+            return;
+        }
+
+        if (static_cast<size_t>(client_fd) >= w.table.size())
+            w.table.resize(std::max<size_t>(client_fd + 1, w.table.size() * 2));
+        w.table[client_fd] = std::make_unique<Connection>();
+
+        Connection& c = *w.table[client_fd];
+        c.client = {&c, client_fd};
+        c.target = {&c, -1};
+        c.client_ip = ntohl(client_addr.sin_addr.s_addr);
+        c.client_to_target.from_fd = client_fd;
+        c.target_to_client.to_fd = client_fd;
+
+        if (w.opt.mode == Mode::Splice &&
+            (!open_pipe(c.client_to_target, w.opt.buffer_size) || !open_pipe(c.target_to_client, w.opt.buffer_size)))
+        {
+            perror("pipe2");
+            close_connection(w, c);
+            continue;
+        }
+        if (w.opt.mode == Mode::Copy)
+        {
+            c.client_to_target.ring.allocate(w.opt.buffer_size);
+            c.target_to_client.ring.allocate(w.opt.buffer_size);
+        }
+
+        add_fd(w.epoll_fd, &c.client, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+
+        if (!start_connect(w, c))
+        {
+            std::cerr << "[!] No upstream available.\n";
+            close_connection(w, c);
+            continue;
+        }
+
+        if (!w.opt.quiet)
+            std::cout << "[+] New client connected.\n";
+    }
 }
 
-int main()
+void worker_loop(const Options& opt)
 {
-    constexpr int LISTEN_PORT = 8080;
-    constexpr std::string_view TARGET_IP = "127.0.0.1";
-    constexpr int TARGET_PORT = 9090;
+    int listen_fd = create_listener(opt.listen_port);
+    if (listen_fd < 0)
+        return;
 
-    int listen_fd = create_listener(LISTEN_PORT);
-    std::cout << "Listening on port " << LISTEN_PORT << "\n";
+    Worker w(opt);
+    w.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    w.listener.fd = listen_fd;
+    add_fd(w.epoll_fd, &w.listener, EPOLLIN);
 
-    int epoll_fd = epoll_create1(0);
-    add_fd(epoll_fd, listen_fd, EPOLLIN);
+    for (const sockaddr_in& addr : opt.targets)
+    {
+        Upstream u;
+        u.addr = addr;
+        u.name = address_name(addr);
+        w.upstreams.push_back(u);
 
-    std::unordered_map<int, std::shared_ptr<Connection>> fd_map;
+        // Points depend on the address only, not on the position in the list.
+        uint64_t seed = mix64((static_cast<uint64_t>(ntohl(addr.sin_addr.s_addr)) << 16) | ntohs(addr.sin_port));
+        for (int p = 0; p < HASH_POINTS; ++p)
+            w.hash_ring.emplace_back(mix64(seed + p), static_cast<int>(w.upstreams.size() - 1));
+    }
+    std::sort(w.hash_ring.begin(), w.hash_ring.end());
 
-    std::vector<epoll_event> events(64);
+    std::vector<epoll_event> events(256);
 
     while (true)
     {
-        int n = epoll_wait(epoll_fd, events.data(), events.size(), 1000);
+        int timeout = 1000;
+        if (!w.pending.empty())
+        {
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(w.pending.front().deadline - Clock::now());
+            timeout = static_cast<int>(std::clamp<long long>(wait.count(), 0, 1000));
+        }
+
+        int n = epoll_wait(w.epoll_fd, events.data(), events.size(), timeout);
         if (n < 0)
         {
+            if (errno == EINTR) continue;
             perror("epoll_wait");
             break;
         }
 
         for (int i = 0; i < n; ++i)
         {
-            int fd = events[i].data.fd;
+            Endpoint* ep = static_cast<Endpoint*>(events[i].data.ptr);
             uint32_t ev = events[i].events;
 
-            if (fd == listen_fd && (ev & EPOLLIN))
+            if (ep->conn == nullptr)
             {
-                sockaddr_in client_addr{};
-                socklen_t len = sizeof(client_addr);
-                int client_fd = accept(listen_fd, reinterpret_cast<sockaddr*>(&client_addr), &len);
-                if (client_fd < 0)
-                {
-                    perror("accept");
-                    continue;
-                }
-                set_non_blocking(client_fd);
-
-                int target_fd = connect_to_target(std::string(TARGET_IP), TARGET_PORT);
-                if (target_fd < 0)
-                {
-                    close(client_fd);
-                    continue;
-                }
-
-                auto conn = std::make_shared<Connection>();
-                conn->client_fd = client_fd;
-                conn->target_fd = target_fd;
-
-                fd_map[client_fd] = conn;
-                fd_map[target_fd] = conn;
-
-                add_fd(epoll_fd, client_fd, EPOLLIN | EPOLLOUT | EPOLLET);
-                add_fd(epoll_fd, target_fd, EPOLLIN | EPOLLOUT | EPOLLET);
-
-                std::cout << "[+] New client connected.\n";
+                accept_connections(w, listen_fd);
                 continue;
             }
 
-            if (fd_map.find(fd) != fd_map.end())
+            Connection& c = *ep->conn;
+            if (c.closed)
+                continue;                 // closed earlier in this batch
+
+            if (c.connecting)
             {
-                auto conn = fd_map[fd];
-
-                int peer_fd = (fd == conn->client_fd) ? conn->target_fd : conn->client_fd;
-                bool is_client = (fd == conn->client_fd);
-
-                if (ev & EPOLLIN)
-                {
-                    char buf[4096];
-                    while (true)
-                    {
-                        ssize_t nread = read(fd, buf, sizeof(buf));
-                        if (nread > 0)
-                        {
-                            if (is_client)
-                                conn->buffer_client_to_target.append(buf, nread);
-                            else
-                                conn->buffer_target_to_client.append(buf, nread);
-                        }
-                        else if (nread == -1 && errno == EAGAIN)
-                        {
-                            break;
-                        }
-                        else
-                        {
-                            close(conn->client_fd);
-                            close(conn->target_fd);
-                            fd_map.erase(conn->client_fd);
-                            fd_map.erase(conn->target_fd);
-                            std::cout << "[-] Connection closed.\n";
-                            break;
-                        }
-                    }
-                }
-
-                if (ev & EPOLLOUT)
-                {
-                    std::string& outbuf =
-                        is_client ? conn->buffer_target_to_client : conn->buffer_client_to_target;
-
-                    while (!outbuf.empty())
-                    {
-                        ssize_t nwritten = write(fd, outbuf.data(), outbuf.size());
-                        if (nwritten > 0)
-                        {
-                            outbuf.erase(0, nwritten);
-                        }
-                        else if (nwritten == -1 && errno == EAGAIN)
-                        {
-                            break;
-                        }
-                        else
-                        {
-                            close(conn->client_fd);
-                            close(conn->target_fd);
-                            fd_map.erase(conn->client_fd);
-                            fd_map.erase(conn->target_fd);
-                            std::cout << "[-] Connection closed during write.\n";
-                            break;
-                        }
-                    }
-                }
+                // The client waits (its data stays in its socket) until the upstream is connected.
+                if (ep == &c.target && (ev & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+                    on_connect_event(w, c);
+                continue;
             }
+
+            bool is_client = (ep == &c.client);
+            Direction& from_here = is_client ? c.client_to_target : c.target_to_client;
+            Direction& to_here = is_client ? c.target_to_client : c.client_to_target;
+
+            pump_directions(w, c,
+                            (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) ? &from_here : nullptr,
+                            (ev & (EPOLLOUT | EPOLLHUP | EPOLLERR)) ? &to_here : nullptr);
         }
+
+        w.closed.clear();
+        expire_connects(w);
+        w.closed.clear();
     }
 
     close(listen_fd);
-    close(epoll_fd);
-    return 0;
+    close(w.epoll_fd);
 }
 
+bool parse_address(const std::string& text, sockaddr_in& addr)
+{
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos)
+        return false;
+
+    addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(std::atoi(text.c_str() + colon + 1));
+    return inet_pton(AF_INET, text.substr(0, colon).c_str(), &addr.sin_addr) == 1 && addr.sin_port != 0;
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options opt;
+    bool usage = false;
+
+    for (int i = 1; i < argc && !usage; ++i)
+    {
+        std::string_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--mode" && has_value)
+            opt.mode = std::string_view(argv[++i]) == "copy" ? Mode::Copy : Mode::Splice;
+        else if (arg == "--workers" && has_value)
+            opt.workers = std::atoi(argv[++i]);
+        else if (arg == "--buffer" && has_value)
+            opt.buffer_size = std::max(4L, std::atol(argv[++i])) * 1024;
+        else if (arg == "--listen" && has_value)
+            opt.listen_port = std::atoi(argv[++i]);
+        else if (arg == "--target" && has_value)
+        {
+            sockaddr_in addr;
+            usage = !parse_address(argv[++i], addr) || opt.targets.size() == MAX_UPSTREAMS;
+            opt.targets.push_back(addr);
+        }
+        else if (arg == "--balance" && has_value)
+            opt.balance = std::string_view(argv[++i]) == "hash" ? Balance::ConsistentHash : Balance::LeastConnections;
+        else if (arg == "--connect-timeout" && has_value)
+            opt.connect_timeout_ms = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--quiet")
+            opt.quiet = true;
+        else
+            usage = true;
+    }
+
+    if (usage)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " [--mode splice|copy] [--workers N] [--buffer KB] [--listen PORT]\n"
+                  << "       [--target IP:PORT]... (up to " << MAX_UPSTREAMS << ") [--balance least|hash]"
+                  << " [--connect-timeout MS] [--quiet]\n";
+        std::exit(1);
+    }
+
+    if (opt.targets.empty())
+        parse_address("127.0.0.1:9090", opt.targets.emplace_back());
+
+    size_t size = 4096;
+    while (size < opt.buffer_size)
+        size *= 2;
+    opt.buffer_size = size;
+
+    if (opt.workers <= 0)
+        opt.workers = (opt.mode == Mode::Copy) ? 1 : std::max(1u, std::thread::hardware_concurrency());
+
+    return opt;
+}
+
+int main(int argc, char* argv[])
+{
+    Options opt = parse_options(argc, argv);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Listening on port " << opt.listen_port << " ->";
+    for (const sockaddr_in& addr : opt.targets)
+        std::cout << " " << address_name(addr);
+    std::cout << " (" << (opt.balance == Balance::ConsistentHash ? "consistent hash" : "least connections") << ", "
+              << (opt.mode == Mode::Splice ? "splice" : "copy") << ", " << opt.workers << " workers, "
+              << opt.buffer_size / 1024 << " KB per direction)\n";
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < opt.workers; ++i)
+        workers.emplace_back(worker_loop, std::cref(opt));
+
+    for (auto& t : workers)
+        t.join();
+
+    return 0;
+}
@@ -0,0 +1,296 @@
+// Local throughput benchmark for forwarder.cpp
+//
+//   g++ -O2 -std=c++17 -pthread fwd_bench.cpp -o fwd_bench
+//   ./forwarder --mode copy --quiet &        (or --mode splice)
+//   ./fwd_bench [connections] [MB per connection] [seconds]
+//   ./fwd_bench soak <forwarder pid> [connections] [seconds]
+//
+// fwd_bench runs the echo target itself on 127.0.0.1:9090 and talks to the forwarder on 127.0.0.1:8080.
+//   throughput  : <connections> streams at once, each sends <MB> through the forwarder and reads the
+//                 echo back (both directions loaded) -> GB/s forwarded per direction
+//   connections : 4 threads open a connection, send one byte, wait for its echo and close, for
+//                 <seconds> -> connections/s through the forwarder (includes the forwarder's connect
+//                 to the target)
+// Run it once against each forwarder mode to compare.
+//
+// soak: the target on 127.0.0.1:9090 is a deliberately slow sink (reads 4 KB every 10 ms, never answers)
+// while <connections> clients push data through the forwarder as fast as it accepts it, for <seconds>.
+// Prints once per second the bytes the forwarder took in, the bytes the sink got and the forwarder's
+// resident memory (VmRSS of <forwarder pid>): with backpressure the memory stays flat and the gap between
+// sent and delivered stays at the socket buffers + forwarder buffers.
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+constexpr int FORWARDER_PORT = 8080;
+constexpr int TARGET_PORT = 9090;
+constexpr size_t CHUNK = 64 * 1024;
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int connect_local(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// Echo target: one thread per connection, echoes until EOF, then closes.
+void echo_target(int listen_fd)
+{
+    while (true)
+    {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        std::thread([fd] {
+            std::vector<char> buf(CHUNK);
+            ssize_t n;
+            while ((n = read(fd, buf.data(), buf.size())) > 0)
+            {
+                for (ssize_t off = 0; off < n; )
+                {
+                    ssize_t w = write(fd, buf.data() + off, n - off);
+                    if (w <= 0) { close(fd); return; }
+                    off += w;
+                }
+            }
+            close(fd);
+        }).detach();
+    }
+}
+
+// Slow sink: one thread per connection, 4 KB every 10 ms until EOF.
+std::atomic<long long> sink_bytes{0};
+
+void slow_sink(int listen_fd)
+{
+    while (true)
+    {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        std::thread([fd] {
+            char buf[4096];
+            ssize_t n;
+            while ((n = read(fd, buf, sizeof(buf))) > 0)
+            {
+                sink_bytes += n;
+                usleep(10000);
+            }
+            close(fd);
+        }).detach();
+    }
+}
+
+long rss_kb(int pid)
+{
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            return std::atol(line.c_str() + 6);
+    return -1;
+}
+
+int run_soak(int pid, int connections, int seconds)
+{
+    std::atomic<long long> sent{0};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < connections; ++i)
+        threads.emplace_back([&] {
+            int fd = connect_local(FORWARDER_PORT);
+            if (fd < 0) return;
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+            std::vector<char> out(CHUNK, 's');
+            while (!stop)
+            {
+                pollfd p{fd, POLLOUT, 0};
+                if (poll(&p, 1, 100) <= 0) continue;
+
+                ssize_t n = write(fd, out.data(), out.size());
+                if (n > 0) sent += n;
+                else if (errno != EAGAIN) break;
+            }
+            close(fd);
+        });
+
+    long start_rss = rss_kb(pid), max_rss = start_rss;
+    std::cout << "soak        : " << connections << " connections into a 400 KB/s sink each, forwarder pid " << pid
+              << ", VmRSS " << start_rss << " KB at start\n";
+
+    for (int s = 1; s <= seconds; ++s)
+    {
+        sleep(1);
+        long rss = rss_kb(pid);
+        max_rss = std::max(max_rss, rss);
+        std::cout << "  " << s << " s  sent " << (sent >> 20) << " MB  delivered " << (sink_bytes >> 20)
+                  << " MB  in flight " << ((sent - sink_bytes) >> 10) << " KB  VmRSS " << rss << " KB\n";
+    }
+
+    stop = true;
+    for (auto& t : threads)
+        t.join();
+
+    std::cout << "soak        : VmRSS grew by " << max_rss - start_rss << " KB at most\n";
+    return 0;
+}
+
+// Sends bytes and reads the echo back at the same time. Returns false on any error.
+bool stream_through(size_t bytes)
+{
+    int fd = connect_local(FORWARDER_PORT);
+    if (fd < 0) return false;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    std::vector<char> out(CHUNK, 'x'), in(CHUNK);
+    size_t sent = 0, received = 0;
+    bool ok = true;
+
+    while (received < bytes)
+    {
+        pollfd p{fd, static_cast<short>(POLLIN | (sent < bytes ? POLLOUT : 0)), 0};
+        if (poll(&p, 1, 10000) <= 0) { ok = false; break; }
+
+        if ((p.revents & POLLOUT) && sent < bytes)
+        {
+            ssize_t n = write(fd, out.data(), std::min(CHUNK, bytes - sent));
+            if (n > 0) sent += n;
+            else if (errno != EAGAIN) { ok = false; break; }
+        }
+        if (p.revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            ssize_t n = read(fd, in.data(), in.size());
+            if (n > 0) received += n;
+            else if (n == 0 || errno != EAGAIN) { ok = false; break; }
+        }
+    }
+
+    close(fd);
+    return ok;
+}
+
+bool one_connection()
+{
+    int fd = connect_local(FORWARDER_PORT);
+    if (fd < 0) return false;
+
+    char c = 'c';
+    bool ok = write(fd, &c, 1) == 1 && read(fd, &c, 1) == 1;
+
+    // RST instead of FIN: no TIME_WAIT pile-up on the benchmark side
+    linger lg{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    close(fd);
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    bool soak = argc > 2 && std::string(argv[1]) == "soak";
+    if (soak)
+    {
+        argv += 2;                        // "soak <pid>" before the usual arguments
+        argc -= 2;
+    }
+
+    int connections = argc > 1 ? std::atoi(argv[1]) : 8;
+    size_t megabytes = argc > 2 && !soak ? std::atol(argv[2]) : 256;
+    int seconds = argc > (soak ? 2 : 3) ? std::atoi(argv[soak ? 2 : 3]) : 5;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TARGET_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd, SOMAXCONN) < 0)
+    {
+        perror("echo target bind/listen");
+        return 1;
+    }
+    if (soak)
+    {
+        std::thread(slow_sink, listen_fd).detach();
+        return run_soak(std::atoi(argv[0]), connections, seconds);
+    }
+    std::thread(echo_target, listen_fd).detach();
+
+    // Throughput
+    std::atomic<int> failed{0};
+    std::vector<std::thread> threads;
+    size_t bytes = megabytes << 20;
+    auto start = Clock::now();
+
+    for (int i = 0; i < connections; ++i)
+        threads.emplace_back([&] { if (!stream_through(bytes)) failed++; });
+    for (auto& t : threads)
+        t.join();
+
+    double secs = seconds_since(start);
+    std::cout << "throughput  : " << connections << " x " << megabytes << " MB echoed in " << secs << " s => "
+              << (double)bytes * connections / secs / 1e9 << " GB/s per direction"
+              << (failed ? "  (" + std::to_string(failed.load()) + " streams failed)" : "") << "\n";
+
+    // Connection rate
+    std::atomic<long> opened{0};
+    threads.clear();
+    failed = 0;
+    start = Clock::now();
+
+    for (int i = 0; i < 4; ++i)
+        threads.emplace_back([&] {
+            while (seconds_since(start) < seconds)
+            {
+                if (one_connection()) opened++;
+                else failed++;
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+
+    std::cout << "connections : " << opened.load() / seconds_since(start) << " conn/s (open, 1 byte echo, close)"
+              << (failed ? "  (" + std::to_string(failed.load()) + " failed)" : "") << "\n";
+
+    return 0;
+}